@@ -0,0 +1,213 @@
+// --- MixKernelBenchmark.cpp ---
+// Checks every SIMD level of the mixing kernels in MixKernels.h against the scalar ones
+// and then times them. Levels this CPU can't run are skipped. Exits with 1 if any level's
+// output differs from the scalar output by more than rounding, so it doubles as a
+// correctness check on new machines and compilers.
+// It does not need miniaudio or an audio device. Build it with optimizations, e.g.:
+//   g++ -O2 -std=c++17 -I../SoundSystem MixKernelBenchmark.cpp ../SoundSystem/MixKernels.cpp -o MixKernelBenchmark
+//   cl /O2 /std:c++17 /EHsc /I..\SoundSystem MixKernelBenchmark.cpp ..\SoundSystem\MixKernels.cpp
+
+#include "MixKernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+using MixKernels::Level;
+using MixKernels::Table;
+
+static volatile float g_sink; // Keeps results alive under optimization
+
+template <typename Fn>
+static double MeasureNsPerSample(size_t samples, int repeats, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(samples) * repeats);
+}
+
+static std::vector<float> RandomSamples(size_t count, std::mt19937& rng, float range = 1.0f) {
+    std::uniform_real_distribution<float> dist(-range, range);
+    std::vector<float> samples(count);
+    for (float& sample : samples) {
+        sample = dist(rng);
+    }
+    return samples;
+}
+
+// Fused multiply-adds round once where the scalar code rounds twice, so allow a few ulps.
+// Anything else (a wrong lane, a missed tail) is off by far more.
+static bool Close(float expected, float actual) {
+    if (std::isnan(expected) || std::isnan(actual)) {
+        return std::isnan(expected) && std::isnan(actual);
+    }
+    return std::fabs(expected - actual) <= 1e-6f + 1e-5f * std::fabs(expected);
+}
+
+static bool Compare(const char* kernel, Level level, const std::vector<float>& expected, const std::vector<float>& actual, size_t size) {
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (!Close(expected[i], actual[i])) {
+            std::printf("  MISMATCH %s %s (size %zu) at %zu: scalar %.9g, got %.9g\n",
+                        MixKernels::LevelName(level), kernel, size, i, expected[i], actual[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs each kernel of 'table' and of the scalar table on the same inputs, over sizes that
+// cover empty buffers, partial vectors and every tail length.
+static bool Verify(const Table& table) {
+    const Table& scalar = *MixKernels::GetTable(Level::Scalar);
+    std::mt19937 rng(2024);
+    bool ok = true;
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size <= 40; ++size) {
+        sizes.push_back(size);
+    }
+    sizes.push_back(1023);
+    sizes.push_back(4096);
+
+    for (size_t frames : sizes) {
+        for (uint32_t channels : { 1u, 2u, 6u }) {
+            std::vector<float> src = RandomSamples(frames * channels, rng);
+            std::vector<float> expected = RandomSamples(frames * channels, rng);
+            std::vector<float> actual = expected;
+            scalar.mixRamp(expected.data(), src.data(), frames, channels, 0.25f, 0.9f);
+            table.mixRamp(actual.data(), src.data(), frames, channels, 0.25f, 0.9f);
+            ok &= Compare("mixRamp", table.level, expected, actual, frames);
+        }
+
+        std::vector<float> expected = RandomSamples(frames * 2, rng);
+        std::vector<float> actual = expected;
+        scalar.panStereo(expected.data(), frames, 0.3f, 0.8f);
+        table.panStereo(actual.data(), frames, 0.3f, 0.8f);
+        ok &= Compare("panStereo", table.level, expected, actual, frames);
+
+        std::vector<float> mono = RandomSamples(frames, rng);
+        expected = RandomSamples(frames * 2, rng);
+        actual = expected;
+        scalar.spreadMonoToStereo(expected.data(), mono.data(), frames, 0.6f, 0.4f);
+        table.spreadMonoToStereo(actual.data(), mono.data(), frames, 0.6f, 0.4f);
+        ok &= Compare("spreadMonoToStereo", table.level, expected, actual, frames);
+
+        std::uniform_int_distribution<int> pcm(-32768, 32767);
+        std::vector<int16_t> s16(frames);
+        for (int16_t& sample : s16) {
+            sample = static_cast<int16_t>(pcm(rng));
+        }
+        if (frames > 1) {
+            s16[0] = -32768;
+            s16[1] = 32767;
+        }
+        expected.assign(frames, 0.0f);
+        actual.assign(frames, 0.0f);
+        scalar.s16ToF32(expected.data(), s16.data(), frames);
+        table.s16ToF32(actual.data(), s16.data(), frames);
+        ok &= Compare("s16ToF32", table.level, expected, actual, frames);
+
+        // Out-of-range values, infinities and NaN must all land in [-1, 1] the same way.
+        expected = RandomSamples(frames, rng, 3.0f);
+        const float specials[] = { std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+                                   -std::numeric_limits<float>::infinity(), 1.0f, -1.0f };
+        for (size_t i = 0; i < frames && i < 5; ++i) {
+            expected[frames - 1 - i] = specials[i];
+        }
+        actual = expected;
+        scalar.clip(expected.data(), frames);
+        table.clip(actual.data(), frames);
+        ok &= Compare("clip", table.level, expected, actual, frames);
+
+        std::vector<float> aRe = RandomSamples(frames, rng), aIm = RandomSamples(frames, rng);
+        std::vector<float> bRe = RandomSamples(frames, rng), bIm = RandomSamples(frames, rng);
+        std::vector<float> expectedIm = RandomSamples(frames, rng);
+        std::vector<float> actualIm = expectedIm;
+        expected = RandomSamples(frames, rng);
+        actual = expected;
+        scalar.complexMulAcc(expected.data(), expectedIm.data(), aRe.data(), aIm.data(), bRe.data(), bIm.data(), frames);
+        table.complexMulAcc(actual.data(), actualIm.data(), aRe.data(), aIm.data(), bRe.data(), bIm.data(), frames);
+        ok &= Compare("complexMulAcc (real)", table.level, expected, actual, frames);
+        ok &= Compare("complexMulAcc (imaginary)", table.level, expectedIm, actualIm, frames);
+
+        // Small taps keep the sums near the inputs' scale, where the tolerance is meaningful.
+        size_t taps = 1 + frames % 19;
+        std::vector<float> input = RandomSamples(frames + taps - 1, rng);
+        std::vector<float> left = RandomSamples(taps, rng, 0.1f), right = RandomSamples(taps, rng, 0.1f);
+        expected.assign(frames, 0.0f);
+        actual.assign(frames, 0.0f);
+        expectedIm.assign(frames, 0.0f);
+        actualIm.assign(frames, 0.0f);
+        scalar.firStereo(expected.data(), expectedIm.data(), input.data(), left.data(), right.data(), taps, frames);
+        table.firStereo(actual.data(), actualIm.data(), input.data(), left.data(), right.data(), taps, frames);
+        ok &= Compare("firStereo (left)", table.level, expected, actual, frames);
+        ok &= Compare("firStereo (right)", table.level, expectedIm, actualIm, frames);
+    }
+    return ok;
+}
+
+static void Time(const Table& table) {
+    const size_t kFrames = 4096; // A long device period, stereo
+    const int kRepeats = 2000;
+    std::mt19937 rng(7);
+    std::vector<float> src = RandomSamples(kFrames * 2, rng);
+    std::vector<float> dst = RandomSamples(kFrames * 2, rng);
+    std::vector<float> mono = RandomSamples(kFrames, rng);
+    std::vector<int16_t> s16(kFrames * 2, 1234);
+
+    double mixNs = MeasureNsPerSample(kFrames * 2, kRepeats, [&] {
+        table.mixRamp(dst.data(), src.data(), kFrames, 2, 0.5f, 0.25f);
+    });
+    double panNs = MeasureNsPerSample(kFrames * 2, kRepeats, [&] {
+        table.panStereo(dst.data(), kFrames, 0.999f, 1.001f);
+    });
+    double spreadNs = MeasureNsPerSample(kFrames * 2, kRepeats, [&] {
+        table.spreadMonoToStereo(dst.data(), mono.data(), kFrames, 0.1f, -0.1f);
+    });
+    double convertNs = MeasureNsPerSample(kFrames * 2, kRepeats, [&] {
+        table.s16ToF32(src.data(), s16.data(), kFrames * 2);
+    });
+    double clipNs = MeasureNsPerSample(kFrames * 2, kRepeats, [&] {
+        table.clip(dst.data(), kFrames * 2);
+    });
+    // Per complex product: 'src' and 'dst' stand in for the two spectra, split in halves.
+    std::vector<float> accRe(kFrames, 0.0f), accIm(kFrames, 0.0f);
+    double complexNs = MeasureNsPerSample(kFrames, kRepeats, [&] {
+        table.complexMulAcc(accRe.data(), accIm.data(), src.data(), src.data() + kFrames, dst.data(), dst.data() + kFrames, kFrames);
+    });
+    // Per output frame of a binaural voice: a 128-tap HRIR pair, a typical length at 48 kHz.
+    const size_t kTaps = 128;
+    std::vector<float> taps = RandomSamples(kTaps * 2, rng, 0.1f);
+    double firNs = MeasureNsPerSample(kFrames - kTaps, kRepeats / 10, [&] {
+        table.firStereo(accRe.data(), accIm.data(), mono.data(), taps.data(), taps.data() + kTaps, kTaps, kFrames - kTaps);
+    });
+    g_sink = dst[kFrames] + src[kFrames] + accRe[kFrames / 2];
+    std::printf("%-8s  mixRamp %6.3f  panStereo %6.3f  spreadMonoToStereo %6.3f  s16ToF32 %6.3f  clip %6.3f  ns/sample  complexMulAcc %6.3f ns/bin  firStereo %6.2f ns/frame\n",
+                MixKernels::LevelName(table.level), mixNs, panNs, spreadNs, convertNs, clipNs, complexNs, firNs);
+}
+
+int main() {
+    std::printf("CPU supports: %s\n", MixKernels::LevelName(MixKernels::DetectLevel()));
+    bool ok = true;
+    for (int level = 0; level < static_cast<int>(Level::Count); ++level) {
+        const Table* table = MixKernels::GetTable(static_cast<Level>(level));
+        if (!table) {
+            std::printf("%-8s  not supported here, skipped\n", MixKernels::LevelName(static_cast<Level>(level)));
+            continue;
+        }
+        if (!Verify(*table)) {
+            ok = false;
+            continue;
+        }
+        Time(*table);
+    }
+    if (!ok) {
+        std::printf("FAILED: SIMD output differs from the scalar kernels.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,352 @@
+// --- SoundSystemBenchmark.cpp ---
+// Benchmarks the exported API of SoundSystem.h end to end, through the shared library:
+//   - api:   per-call cost of the exports a game calls every frame;
+//   - load:  LoadSound throughput for WAV files of several lengths, plus every .wav,
+//            .mp3 and .flac file in --assets (the repository ships no audio, and this
+//            program can only generate WAV itself);
+//   - mixer: frames mixed per second with N looping 3D sounds, on the no-device engine
+//            (InitializeSoundSystemNoDevice + ReadMixedFrames), so results don't depend
+//            on a sound card and runs are repeatable.
+// Results are written as JSON (to stdout, or to --out) so runs can be compared across releases.
+//
+// Built by CMakeLists.txt with SOUNDSYSTEM_BUILD_BENCHMARKS. Usage:
+//   SoundSystemBenchmark [--assets <dir>] [--out <file.json>] [--quick]
+
+#include "SoundSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const uint32_t kSampleRate = 48000;
+static const uint32_t kChannels = 2;
+
+struct BenchResult {
+    std::string category; // "api", "load" or "mixer"
+    std::string name;
+    std::string unit;
+    double value;
+    uint64_t iterations;
+    std::string detail;   // Extra JSON members, already formatted (may be empty)
+};
+
+static std::vector<BenchResult> g_results;
+
+static volatile uint64_t g_sink; // Keeps query results alive under optimization
+
+// Only errors reach stderr; everything else would distort the timings.
+static void OnLogMessage(int level, const char* message, void* userData) {
+    (void)userData;
+    if (level >= SOUNDSYSTEM_LOG_LEVEL_ERROR) {
+        std::fprintf(stderr, "%s\n", message);
+    }
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string JsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+        case '"':  escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+                escaped += buffer;
+            }
+            else {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+// Writes a 16-bit PCM stereo WAV with a sine sweep, at 44.1 kHz so loads also resample.
+static bool WriteTestWav(const fs::path& path, double seconds) {
+    const uint32_t rate = 44100;
+    const uint16_t channels = 2;
+    const uint32_t frames = static_cast<uint32_t>(seconds * rate);
+    const uint32_t dataSize = frames * channels * 2;
+
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    auto write32 = [file](uint32_t v) { std::fwrite(&v, 4, 1, file); };
+    auto write16 = [file](uint16_t v) { std::fwrite(&v, 2, 1, file); };
+    std::fwrite("RIFF", 1, 4, file);
+    write32(36 + dataSize);
+    std::fwrite("WAVEfmt ", 1, 8, file);
+    write32(16);
+    write16(1); // PCM
+    write16(channels);
+    write32(rate);
+    write32(rate * channels * 2);
+    write16(static_cast<uint16_t>(channels * 2));
+    write16(16);
+    std::fwrite("data", 1, 4, file);
+    write32(dataSize);
+
+    std::vector<int16_t> samples(static_cast<size_t>(frames) * channels);
+    double phase = 0.0;
+    for (uint32_t i = 0; i < frames; ++i) {
+        double frequency = 220.0 + 660.0 * i / frames;
+        phase += 2.0 * 3.14159265358979 * frequency / rate;
+        int16_t sample = static_cast<int16_t>(std::sin(phase) * 12000.0);
+        samples[i * channels] = sample;
+        samples[i * channels + 1] = sample;
+    }
+    std::fwrite(samples.data(), sizeof(int16_t), samples.size(), file);
+    return std::fclose(file) == 0;
+}
+
+// Times 'rounds' rounds of 'callsPerRound' calls. Queued commands are applied between rounds,
+// outside the timed region, so the command queue never fills up and only the call is measured.
+template <typename Fn>
+static void MeasureCall(const char* name, uint32_t rounds, uint32_t callsPerRound, Fn&& fn) {
+    double seconds = 0.0;
+    for (uint32_t round = 0; round < rounds; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < callsPerRound; ++i) {
+            fn(i);
+        }
+        seconds += SecondsSince(start);
+        UpdateSoundSystem();
+    }
+    uint64_t calls = static_cast<uint64_t>(rounds) * callsPerRound;
+    g_results.push_back({ "api", name, "ns/call", seconds * 1e9 / static_cast<double>(calls), calls, "" });
+}
+
+static void BenchmarkApi(const fs::path& wavPath, bool quick) {
+    const uint32_t rounds = quick ? 20 : 200;
+    const uint32_t calls = 1000;
+    const char* id = "bench/api/emitter";
+
+    LoadSound(wavPath.string().c_str(), id);
+    SoundHandle handle = GetSoundHandle(id);
+    SetMaxVoices(0);
+
+    MeasureCall("SndPlaySound", rounds, calls, [&](uint32_t) { SndPlaySound(id, true); });
+    MeasureCall("SndPlaySoundByHandle", rounds, calls, [&](uint32_t) { SndPlaySoundByHandle(handle, true); });
+    MeasureCall("SetSoundPosition", rounds, calls, [&](uint32_t i) { SetSoundPosition(id, static_cast<float>(i), 0.0f, 1.0f); });
+    MeasureCall("SetSoundPositionByHandle", rounds, calls, [&](uint32_t i) { SetSoundPositionByHandle(handle, static_cast<float>(i), 0.0f, 1.0f); });
+    MeasureCall("SetSoundVolume", rounds, calls, [&](uint32_t i) { SetSoundVolume(id, (i & 1) ? 0.5f : 0.75f); });
+    MeasureCall("SetSoundVolumeByHandle", rounds, calls, [&](uint32_t i) { SetSoundVolumeByHandle(handle, (i & 1) ? 0.5f : 0.75f); });
+    MeasureCall("SetSoundPitch", rounds, calls, [&](uint32_t i) { SetSoundPitch(id, (i & 1) ? 0.9f : 1.1f); });
+    MeasureCall("SetListenerPosition", rounds, calls, [&](uint32_t i) { SetListenerPosition(0.0f, 0.0f, static_cast<float>(i)); });
+    MeasureCall("IsSoundPlaying", rounds, calls, [&](uint32_t) { g_sink = g_sink + IsSoundPlaying(id); });
+    MeasureCall("IsSoundPlayingByHandle", rounds, calls, [&](uint32_t) { g_sink = g_sink + IsSoundPlayingByHandle(handle); });
+    MeasureCall("GetSoundHandle", rounds, calls, [&](uint32_t) { g_sink = g_sink + GetSoundHandle(id); });
+    StopSound(id);
+
+    // Instances: start and stop in pairs so the pool never runs dry.
+    MeasureCall("PlaySoundInstance+StopVoice", rounds, calls, [&](uint32_t) {
+        StopVoice(PlaySoundInstanceByHandle(handle, 1.0f, 1.0f));
+    });
+
+    // Batched updates, reported per entry for comparison with the single setters.
+    std::vector<SoundParamUpdate> updates(calls);
+    for (uint32_t i = 0; i < calls; ++i) {
+        updates[i] = { handle, SOUNDSYSTEM_PARAM_POSITION | SOUNDSYSTEM_PARAM_VOLUME, static_cast<float>(i), 0.0f, 1.0f, 0.5f, 0.0f, 1.0f };
+    }
+    double seconds = 0.0;
+    for (uint32_t round = 0; round < rounds; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        SetSoundParametersBatch(updates.data(), updates.size());
+        seconds += SecondsSince(start);
+    }
+    uint64_t entries = static_cast<uint64_t>(rounds) * calls;
+    g_results.push_back({ "api", "SetSoundParametersBatch", "ns/entry", seconds * 1e9 / static_cast<double>(entries), entries, "" });
+
+    // Applying a full frame of queued setters.
+    seconds = 0.0;
+    for (uint32_t round = 0; round < rounds; ++round) {
+        for (uint32_t i = 0; i < calls; ++i) {
+            SetSoundPositionByHandle(handle, static_cast<float>(i), 0.0f, 1.0f);
+        }
+        auto start = std::chrono::steady_clock::now();
+        UpdateSoundSystem();
+        seconds += SecondsSince(start);
+    }
+    g_results.push_back({ "api", "UpdateSoundSystem (1000 queued setters)", "ns/call", seconds * 1e9 / rounds, rounds, "" });
+
+    UnloadSound(id);
+}
+
+static void BenchmarkLoad(const std::vector<fs::path>& files, bool quick) {
+    const uint32_t repeats = quick ? 2 : 5;
+    for (const fs::path& file : files) {
+        std::string path = file.string();
+        std::error_code error;
+        uintmax_t fileSize = fs::file_size(file, error);
+
+        double seconds = 0.0;
+        uint32_t loaded = 0;
+        for (uint32_t i = 0; i < repeats; ++i) {
+            // Unloading frees the decoded data, so every iteration decodes the file again.
+            auto start = std::chrono::steady_clock::now();
+            bool ok = LoadSound(path.c_str(), "bench/load");
+            seconds += SecondsSince(start);
+            if (!ok) {
+                break;
+            }
+            ++loaded;
+            UnloadSound("bench/load");
+        }
+        if (loaded == 0) {
+            std::fprintf(stderr, "Skipping '%s': LoadSound failed.\n", path.c_str());
+            continue;
+        }
+        double msPerLoad = seconds * 1e3 / loaded;
+        char detail[128];
+        std::snprintf(detail, sizeof(detail), "\"fileBytes\": %llu, \"fileMBPerSecond\": %.2f",
+            static_cast<unsigned long long>(fileSize), fileSize / (1024.0 * 1024.0) / (seconds / loaded));
+        g_results.push_back({ "load", file.filename().string(), "ms/load", msPerLoad, loaded, detail });
+    }
+}
+
+static void BenchmarkMixer(const fs::path& wavPath, bool quick) {
+    const uint32_t kPeriod = 480; // 10 ms at 48 kHz, a typical device period
+    const double renderSeconds = quick ? 2.0 : 10.0;
+    std::vector<float> buffer(static_cast<size_t>(kPeriod) * kChannels);
+
+    SetMaxVoices(0);
+    SetVirtualVoiceThreshold(0.0f); // Every sound is mixed, however far away
+    for (uint32_t soundCount : { 1u, 16u, 64u, 128u, 256u }) {
+        // Each emitter is its own sound ID; they share one decoded buffer.
+        std::vector<std::string> ids;
+        for (uint32_t i = 0; i < soundCount; ++i) {
+            ids.push_back("bench/mixer/" + std::to_string(i));
+            LoadSound(wavPath.string().c_str(), ids.back().c_str());
+            float angle = 6.2831853f * i / soundCount;
+            SetSoundPosition(ids.back().c_str(), std::cos(angle) * 5.0f, 0.0f, std::sin(angle) * 5.0f);
+            SndPlaySound(ids.back().c_str(), true);
+        }
+        ReadMixedFrames(buffer.data(), kPeriod); // Applies the queued plays
+
+        uint64_t frames = static_cast<uint64_t>(renderSeconds * kSampleRate);
+        uint64_t mixed = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (mixed < frames) {
+            mixed += ReadMixedFrames(buffer.data(), kPeriod);
+        }
+        double seconds = SecondsSince(start);
+
+        char detail[128];
+        std::snprintf(detail, sizeof(detail), "\"sounds\": %u, \"realtimeFactor\": %.2f, \"periodFrames\": %u",
+            soundCount, (mixed / static_cast<double>(kSampleRate)) / seconds, kPeriod);
+        g_results.push_back({ "mixer", "looping 3D sounds (" + std::to_string(soundCount) + ")", "frames/s",
+            mixed / seconds, mixed, detail });
+
+        for (const std::string& id : ids) {
+            UnloadSound(id.c_str());
+        }
+    }
+}
+
+static void WriteJson(std::FILE* out, double totalSeconds) {
+    std::fprintf(out, "{\n  \"benchmark\": \"SoundSystemBenchmark\",\n");
+    std::fprintf(out, "  \"sampleRate\": %u,\n  \"channels\": %u,\n  \"totalSeconds\": %.3f,\n", kSampleRate, kChannels, totalSeconds);
+    std::fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < g_results.size(); ++i) {
+        const BenchResult& result = g_results[i];
+        std::fprintf(out, "    { \"category\": \"%s\", \"name\": \"%s\", \"unit\": \"%s\", \"value\": %.3f, \"iterations\": %llu",
+            result.category.c_str(), JsonEscape(result.name).c_str(), result.unit.c_str(), result.value,
+            static_cast<unsigned long long>(result.iterations));
+        if (!result.detail.empty()) {
+            std::fprintf(out, ", %s", result.detail.c_str());
+        }
+        std::fprintf(out, " }%s\n", i + 1 < g_results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    fs::path assetsDir;
+    const char* outPath = nullptr;
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--assets") == 0 && i + 1 < argc) {
+            assetsDir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        }
+        else {
+            std::fprintf(stderr, "Usage: %s [--assets <dir>] [--out <file.json>] [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Generated WAVs: a short one-shot, a typical effect and a music-length file.
+    fs::path workDir = fs::temp_directory_path() / "SoundSystemBenchmark";
+    std::error_code error;
+    fs::create_directories(workDir, error);
+    std::vector<fs::path> loadFiles;
+    for (double seconds : { 0.5, 5.0, 60.0 }) {
+        fs::path path = workDir / ("sweep_" + std::to_string(static_cast<int>(seconds * 1000)) + "ms.wav");
+        if (!WriteTestWav(path, seconds)) {
+            std::fprintf(stderr, "Failed to write '%s'.\n", path.string().c_str());
+            return 1;
+        }
+        loadFiles.push_back(path);
+    }
+    if (!assetsDir.empty()) {
+        std::vector<fs::path> assets;
+        for (const auto& entry : fs::directory_iterator(assetsDir, error)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+            if (entry.is_regular_file() && (extension == ".wav" || extension == ".mp3" || extension == ".flac")) {
+                assets.push_back(entry.path());
+            }
+        }
+        std::sort(assets.begin(), assets.end());
+        loadFiles.insert(loadFiles.end(), assets.begin(), assets.end());
+    }
+
+    SetSoundLogCallback(OnLogMessage, nullptr);
+    if (!InitializeSoundSystemNoDevice(kSampleRate, kChannels)) {
+        std::fprintf(stderr, "InitializeSoundSystemNoDevice failed.\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    BenchmarkApi(loadFiles[1], quick);
+    BenchmarkLoad(loadFiles, quick);
+    BenchmarkMixer(loadFiles[1], quick);
+    double totalSeconds = SecondsSince(start);
+
+    ShutdownSoundSystem();
+    for (size_t i = 0; i < 3; ++i) {
+        fs::remove(loadFiles[i], error);
+    }
+
+    std::FILE* out = outPath ? std::fopen(outPath, "w") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "Failed to open '%s'.\n", outPath);
+        return 1;
+    }
+    WriteJson(out, totalSeconds);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// --- SoundTableBenchmark.cpp ---
+// Micro-benchmark comparing the sound ID registry in SoundTable.h against the
+// std::map<std::string, ...> registry SoundSystem.cpp used before it.
+// It does not need miniaudio or an audio device. Build it with optimizations, e.g.:
+//   g++ -O2 -std=c++17 -I../SoundSystem SoundTableBenchmark.cpp -o SoundTableBenchmark
+//   cl /O2 /std:c++17 /EHsc /I..\SoundSystem SoundTableBenchmark.cpp
+
+#include "SoundTable.h"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Stand-in for SoundSystem.cpp's slot: the ID table compares candidate IDs against it.
+struct BenchSlot {
+    char payload[512]; // Roughly the footprint of the ma_sound stored next to the ID
+    std::string id;
+};
+
+static volatile uint64_t g_sink; // Keeps lookup results alive under optimization
+
+template <typename Fn>
+static double MeasureNsPerOp(size_t operations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(operations);
+}
+
+static void RunCase(size_t soundCount, size_t lookupCount) {
+    std::vector<std::string> ids;
+    ids.reserve(soundCount);
+    for (size_t i = 0; i < soundCount; ++i) {
+        ids.push_back("sfx/level_" + std::to_string(i % 37) + "/emitter_" + std::to_string(i));
+    }
+
+    // Lookups come from C strings in random order, as they would through the DLL boundary.
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<size_t> pick(0, soundCount - 1);
+    std::vector<const char*> queries(lookupCount);
+    for (const char*& query : queries) {
+        query = ids[pick(rng)].c_str();
+    }
+
+    // Previous registry: std::map keyed by std::string, built from the const char* on every call.
+    std::map<std::string, uint32_t> map;
+    for (size_t i = 0; i < soundCount; ++i) {
+        map[ids[i]] = static_cast<uint32_t>(i);
+    }
+    double mapNs = MeasureNsPerOp(lookupCount, [&] {
+        uint64_t sum = 0;
+        for (const char* query : queries) {
+            auto it = map.find(std::string(query));
+            sum += it != map.end() ? it->second : 0;
+        }
+        g_sink = sum;
+    });
+
+    // Current registry: open-addressing table over slab-stored slots.
+    SlabArray<BenchSlot> slots;
+    SoundIdTable table;
+    for (size_t i = 0; i < soundCount; ++i) {
+        BenchSlot* slot = slots.EmplaceBack();
+        slot->id = ids[i];
+        table.Insert(HashSoundId(ids[i].data(), ids[i].size()), static_cast<uint32_t>(i));
+    }
+    double tableNs = MeasureNsPerOp(lookupCount, [&] {
+        uint64_t sum = 0;
+        for (const char* query : queries) {
+            size_t length = std::strlen(query);
+            uint32_t index = table.Find(HashSoundId(query, length), [&](uint32_t candidate) {
+                const std::string& id = slots[candidate].id;
+                return id.size() == length && std::memcmp(id.data(), query, length) == 0;
+            });
+            sum += index != SoundIdTable::kEmpty ? index : 0;
+        }
+        g_sink = sum;
+    });
+
+    std::printf("%8zu sounds: std::map %7.1f ns/lookup, SoundIdTable %7.1f ns/lookup (%.2fx)\n",
+        soundCount, mapNs, tableNs, mapNs / tableNs);
+}
+
+int main() {
+    const size_t kLookups = 2000000;
+    for (size_t soundCount : { 100, 1000, 5000, 20000 }) {
+        RunCase(soundCount, kLookups);
+    }
+    return 0;
+}
@@ -0,0 +1,420 @@
+// --- Convolver.cpp ---
+// Partitioned convolution (see Convolver.h) and the real FFT it runs on.
+//
+// The FFT is a plain iterative radix-2 transform over split real and imaginary arrays,
+// with each stage's twiddles stored contiguously so the butterfly loop vectorizes. A real
+// signal of 2M samples is transformed as M complex samples (even samples in the real
+// parts, odd in the imaginary parts) and then untangled into M + 1 bins, which halves the
+// work of a full complex transform. Transforms are unnormalized; the 1/M scale is folded
+// into the impulse response spectra once, at Init.
+
+#include "Convolver.h"
+#include "MixKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+namespace {
+
+    const double kPi = 3.14159265358979323846;
+
+    bool IsPowerOfTwo(uint32_t value) {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+
+} // namespace
+
+// Real FFT of 2 * 'halfSize' samples. 'halfSize' is a power of two.
+class Convolver::Fft {
+public:
+    explicit Fft(uint32_t halfSize)
+        : m_size(halfSize), m_bitReverse(halfSize), m_workRe(halfSize), m_workIm(halfSize),
+          m_splitCos(halfSize + 1), m_splitSin(halfSize + 1) {
+        uint32_t bits = 0;
+        while ((1u << bits) < halfSize) {
+            ++bits;
+        }
+        for (uint32_t i = 0; i < halfSize; ++i) {
+            uint32_t reversed = 0;
+            for (uint32_t bit = 0; bit < bits; ++bit) {
+                reversed |= ((i >> bit) & 1u) << (bits - 1 - bit);
+            }
+            m_bitReverse[i] = reversed;
+        }
+        // Stage with butterflies 'half' apart uses e^(-2 pi i k / (2 half)) for k < half.
+        for (uint32_t half = 1; half < halfSize; half *= 2) {
+            for (uint32_t k = 0; k < half; ++k) {
+                double angle = -kPi * k / half;
+                m_twiddleRe.push_back(static_cast<float>(std::cos(angle)));
+                m_twiddleIm.push_back(static_cast<float>(std::sin(angle)));
+            }
+        }
+        // e^(-2 pi i k / (2 halfSize)), for separating the even and odd halves.
+        for (uint32_t k = 0; k <= halfSize; ++k) {
+            double angle = kPi * k / halfSize;
+            m_splitCos[k] = static_cast<float>(std::cos(angle));
+            m_splitSin[k] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    // Transforms 2 * size() real samples into size() + 1 bins.
+    void Forward(const float* samples, float* re, float* im) {
+        const uint32_t m = m_size;
+        for (uint32_t j = 0; j < m; ++j) {
+            m_workRe[j] = samples[2 * j];
+            m_workIm[j] = samples[2 * j + 1];
+        }
+        Transform(m_workRe.data(), m_workIm.data());
+        for (uint32_t k = 0; k <= m; ++k) {
+            float zr = m_workRe[k % m], zi = m_workIm[k % m];
+            float mr = m_workRe[(m - k) % m], mi = m_workIm[(m - k) % m];
+            // Spectra of the even and odd samples.
+            float evenRe = 0.5f * (zr + mr), evenIm = 0.5f * (zi - mi);
+            float oddRe = 0.5f * (zi + mi), oddIm = -0.5f * (zr - mr);
+            float c = m_splitCos[k], s = m_splitSin[k];
+            re[k] = evenRe + c * oddRe + s * oddIm;
+            im[k] = evenIm + c * oddIm - s * oddRe;
+        }
+    }
+
+    // Inverse of Forward, scaled by size().
+    void Inverse(const float* re, const float* im, float* samples) {
+        const uint32_t m = m_size;
+        for (uint32_t k = 0; k < m; ++k) {
+            float xr = re[k], xi = im[k];
+            float yr = re[m - k], yi = im[m - k];
+            float evenRe = 0.5f * (xr + yr), evenIm = 0.5f * (xi - yi);
+            float diffRe = 0.5f * (xr - yr), diffIm = 0.5f * (xi + yi);
+            float c = m_splitCos[k], s = m_splitSin[k];
+            float oddRe = diffRe * c - diffIm * s;
+            float oddIm = diffRe * s + diffIm * c;
+            m_workRe[k] = evenRe - oddIm;
+            m_workIm[k] = evenIm + oddRe;
+        }
+        // Transforming with real and imaginary parts swapped runs the inverse transform.
+        Transform(m_workIm.data(), m_workRe.data());
+        for (uint32_t j = 0; j < m; ++j) {
+            samples[2 * j] = m_workRe[j];
+            samples[2 * j + 1] = m_workIm[j];
+        }
+    }
+
+    size_t MemoryBytes() const {
+        return (m_workRe.capacity() + m_workIm.capacity() + m_twiddleRe.capacity() + m_twiddleIm.capacity() +
+                m_splitCos.capacity() + m_splitSin.capacity()) * sizeof(float) + m_bitReverse.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    // In-place forward complex transform of size() points.
+    void Transform(float* re, float* im) const {
+        const uint32_t m = m_size;
+        for (uint32_t i = 0; i < m; ++i) {
+            uint32_t j = m_bitReverse[i];
+            if (j > i) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+        const float* twiddleRe = m_twiddleRe.data();
+        const float* twiddleIm = m_twiddleIm.data();
+        for (uint32_t half = 1; half < m; half *= 2) {
+            for (uint32_t base = 0; base < m; base += 2 * half) {
+                float* topRe = re + base;
+                float* topIm = im + base;
+                float* bottomRe = topRe + half;
+                float* bottomIm = topIm + half;
+                for (uint32_t k = 0; k < half; ++k) {
+                    float tr = bottomRe[k] * twiddleRe[k] - bottomIm[k] * twiddleIm[k];
+                    float ti = bottomRe[k] * twiddleIm[k] + bottomIm[k] * twiddleRe[k];
+                    bottomRe[k] = topRe[k] - tr;
+                    bottomIm[k] = topIm[k] - ti;
+                    topRe[k] += tr;
+                    topIm[k] += ti;
+                }
+            }
+            twiddleRe += half;
+            twiddleIm += half;
+        }
+    }
+
+    uint32_t m_size;
+    std::vector<uint32_t> m_bitReverse;
+    std::vector<float> m_workRe, m_workIm;
+    std::vector<float> m_twiddleRe, m_twiddleIm;
+    std::vector<float> m_splitCos, m_splitSin;
+};
+
+// One uniformly partitioned convolution: a range of the IR cut into 'block'-frame
+// partitions, and the delay line of input spectra those partitions are multiplied with.
+// Spectra are stored partition after partition, 'bins' floats each.
+struct Convolver::Stage {
+    struct Channel {
+        std::vector<float> irRe, irIm;      // IR partitions, scaled by 1 / block for the unnormalized inverse
+        std::vector<float> delayRe, delayIm; // Input spectra; slot 'newest' is the latest, older ones precede it
+        std::vector<float> input;           // The previous block, then the block being gathered
+        std::vector<float> accRe, accIm;    // Sum of the products so far for the next output block
+        std::vector<float> output;          // The latest output block
+    };
+
+    uint32_t block = 0;
+    uint32_t bins = 0;                      // block + 1
+    uint32_t partitions = 0;
+    uint32_t newest = 0;
+    std::unique_ptr<Fft> fft;
+    std::vector<Channel> channels;
+
+    // Transforms the 'count' IR frames from 'first' on. 'time' is scratch of 2 * block floats.
+    void Init(uint32_t channelCount, uint32_t blockFrames, const float* impulse, uint64_t first, uint64_t count,
+              uint32_t irChannels, std::vector<float>& time) {
+        block = blockFrames;
+        bins = blockFrames + 1;
+        partitions = static_cast<uint32_t>((count + blockFrames - 1) / blockFrames);
+        fft.reset(new Fft(blockFrames));
+        channels.resize(channelCount);
+
+        const float scale = 1.0f / static_cast<float>(blockFrames);
+        size_t spectrumFloats = static_cast<size_t>(partitions) * bins;
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            Channel& state = channels[c];
+            state.irRe.assign(spectrumFloats, 0.0f);
+            state.irIm.assign(spectrumFloats, 0.0f);
+            state.delayRe.assign(spectrumFloats, 0.0f);
+            state.delayIm.assign(spectrumFloats, 0.0f);
+            state.input.assign(2 * static_cast<size_t>(block), 0.0f);
+            state.accRe.assign(bins, 0.0f);
+            state.accIm.assign(bins, 0.0f);
+            state.output.assign(block, 0.0f);
+
+            // Each partition goes in the first half of the transform, zeros in the second.
+            uint32_t irChannel = std::min(c, irChannels - 1);
+            for (uint32_t p = 0; p < partitions; ++p) {
+                std::fill(time.begin(), time.begin() + 2 * static_cast<size_t>(block), 0.0f);
+                uint64_t offset = static_cast<uint64_t>(p) * block;
+                uint64_t length = std::min<uint64_t>(block, count - offset);
+                for (uint64_t i = 0; i < length; ++i) {
+                    time[i] = impulse[(first + offset + i) * irChannels + irChannel] * scale;
+                }
+                fft->Forward(time.data(), &state.irRe[p * static_cast<size_t>(bins)], &state.irIm[p * static_cast<size_t>(bins)]);
+            }
+        }
+    }
+
+    void Clear() {
+        for (Channel& state : channels) {
+            std::fill(state.delayRe.begin(), state.delayRe.end(), 0.0f);
+            std::fill(state.delayIm.begin(), state.delayIm.end(), 0.0f);
+            std::fill(state.input.begin(), state.input.end(), 0.0f);
+            std::fill(state.accRe.begin(), state.accRe.end(), 0.0f);
+            std::fill(state.accIm.begin(), state.accIm.end(), 0.0f);
+            std::fill(state.output.begin(), state.output.end(), 0.0f);
+        }
+        newest = 0;
+    }
+
+    // Transforms each channel's input window onto the delay line, replacing the oldest
+    // spectrum, and slides the window on by a block.
+    void PushInput() {
+        newest = newest + 1 < partitions ? newest + 1 : 0;
+        for (Channel& state : channels) {
+            fft->Forward(state.input.data(), &state.delayRe[newest * static_cast<size_t>(bins)], &state.delayIm[newest * static_cast<size_t>(bins)]);
+            std::memcpy(state.input.data(), state.input.data() + block, sizeof(float) * block);
+        }
+    }
+
+    // Adds the products of partitions [first, last) to the accumulators. Partition p meets
+    // the input spectrum from p blocks before the newest.
+    void Accumulate(const MixKernels::Table& kernels, uint32_t first, uint32_t last) {
+        for (Channel& state : channels) {
+            uint32_t slot = newest >= first ? newest - first : newest + partitions - first;
+            for (uint32_t p = first; p < last; ++p) {
+                size_t inputOffset = slot * static_cast<size_t>(bins);
+                size_t irOffset = p * static_cast<size_t>(bins);
+                kernels.complexMulAcc(state.accRe.data(), state.accIm.data(),
+                                      &state.delayRe[inputOffset], &state.delayIm[inputOffset],
+                                      &state.irRe[irOffset], &state.irIm[irOffset], bins);
+                slot = slot > 0 ? slot - 1 : partitions - 1;
+            }
+        }
+    }
+
+    // Turns the accumulated spectra into the next output block and clears them. Overlap-save:
+    // the first half of the circular result wraps around; the second is the output.
+    void Finish(std::vector<float>& time) {
+        for (Channel& state : channels) {
+            fft->Inverse(state.accRe.data(), state.accIm.data(), time.data());
+            std::memcpy(state.output.data(), time.data() + block, sizeof(float) * block);
+            std::fill(state.accRe.begin(), state.accRe.end(), 0.0f);
+            std::fill(state.accIm.begin(), state.accIm.end(), 0.0f);
+        }
+    }
+
+    size_t MemoryBytes() const {
+        size_t floats = 0;
+        for (const Channel& state : channels) {
+            floats += state.irRe.capacity() + state.irIm.capacity() + state.delayRe.capacity() + state.delayIm.capacity() +
+                      state.input.capacity() + state.accRe.capacity() + state.accIm.capacity() + state.output.capacity();
+        }
+        return floats * sizeof(float) + (fft ? fft->MemoryBytes() : 0);
+    }
+};
+
+namespace {
+
+    // Tail partitions are this many head blocks long, up to kMaxTailFrames.
+    const uint32_t kTailRatio = 16;
+    const uint32_t kMaxTailFrames = 16384;
+
+} // namespace
+
+Convolver::Convolver() = default;
+Convolver::~Convolver() = default;
+
+bool Convolver::Init(uint32_t channels, uint32_t blockFrames, const float* impulse, uint64_t irFrames, uint32_t irChannels) {
+    if (channels == 0 || irChannels == 0 || !impulse || irFrames == 0 ||
+        !IsPowerOfTwo(blockFrames) || blockFrames < 16 || blockFrames > 8192) {
+        return false;
+    }
+    m_channels = 0;
+    m_head.reset();
+    m_tail.reset();
+
+    // The tail starts two tail blocks into the IR. Its output for an input block is then
+    // due one tail block after that input block is complete, which is the time its
+    // products are spread over. The head covers everything before it.
+    uint32_t tailFrames = std::min(blockFrames * kTailRatio, std::max(kMaxTailFrames, blockFrames * 2));
+    uint64_t headFrames = std::min<uint64_t>(irFrames, 2 * static_cast<uint64_t>(tailFrames));
+    uint64_t tailPartitions = (irFrames - headFrames + tailFrames - 1) / tailFrames;
+    if (irFrames / blockFrames > 0xFFFFFFu) {
+        return false;
+    }
+    try {
+        m_time.assign(2 * static_cast<size_t>(tailPartitions > 0 ? tailFrames : blockFrames), 0.0f);
+        std::unique_ptr<Stage> head(new Stage());
+        head->Init(channels, blockFrames, impulse, 0, headFrames, irChannels, m_time);
+        std::unique_ptr<Stage> tail;
+        if (tailPartitions > 0) {
+            tail.reset(new Stage());
+            tail->Init(channels, tailFrames, impulse, headFrames, irFrames - headFrames, irChannels, m_time);
+        }
+        m_head = std::move(head);
+        m_tail = std::move(tail);
+    }
+    catch (const std::bad_alloc&) {
+        m_head.reset();
+        m_tail.reset();
+        return false;
+    }
+    m_channels = channels;
+    m_blockFrames = blockFrames;
+    m_tailSteps = m_tail ? tailFrames / blockFrames : 1;
+    // The tail's delay line, accumulators and pending output must all have drained too.
+    m_idleAfter = m_head->partitions + (m_tail ? (static_cast<uint64_t>(m_tail->partitions) + 3) * m_tailSteps : 0);
+    Reset();
+    return true;
+}
+
+void Convolver::Reset() {
+    if (m_head) {
+        m_head->Clear();
+    }
+    if (m_tail) {
+        m_tail->Clear();
+    }
+    m_fill = 0;
+    m_step = 0;
+    m_silentBlocks = m_idleAfter + 1; // Everything is zero, so there is nothing to compute yet
+}
+
+uint32_t Convolver::PartitionCount() const {
+    return (m_head ? m_head->partitions : 0) + (m_tail ? m_tail->partitions : 0);
+}
+
+void Convolver::Process(const float* in, float* out, uint32_t frames) {
+    if (m_channels == 0) {
+        return; // Not initialized
+    }
+    uint32_t done = 0;
+    while (done < frames) {
+        uint32_t chunk = std::min(m_blockFrames - m_fill, frames - done);
+        for (uint32_t c = 0; c < m_channels; ++c) {
+            Stage::Channel& state = m_head->channels[c];
+            float* gather = state.input.data() + m_blockFrames + m_fill;
+            const float* play = state.output.data() + m_fill;
+            const float* src = in + static_cast<size_t>(done) * m_channels + c;
+            float* dst = out + static_cast<size_t>(done) * m_channels + c;
+            // Each sample is read before its own slot of 'out' is written, so in == out is fine.
+            for (uint32_t f = 0; f < chunk; ++f) {
+                gather[f] = src[static_cast<size_t>(f) * m_channels];
+                dst[static_cast<size_t>(f) * m_channels] = play[f];
+            }
+        }
+        m_fill += chunk;
+        done += chunk;
+        if (m_fill == m_blockFrames) {
+            ProcessBlock();
+            m_fill = 0;
+        }
+    }
+}
+
+void Convolver::ProcessBlock() {
+    const uint32_t block = m_blockFrames;
+    bool silent = true;
+    for (const Stage::Channel& state : m_head->channels) {
+        const float* gathered = state.input.data() + block;
+        for (uint32_t i = 0; i < block && silent; ++i) {
+            silent = gathered[i] == 0.0f;
+        }
+    }
+    m_silentBlocks = silent ? m_silentBlocks + 1 : 0;
+    uint32_t step = m_step;
+    m_step = m_step + 1 < m_tailSteps ? m_step + 1 : 0;
+    if (m_silentBlocks > m_idleAfter) {
+        // Every delay line holds only spectra of silence, so every sum is silent too. The
+        // buffers are all zero already except the head's last output block.
+        if (m_silentBlocks == m_idleAfter + 1) {
+            for (Stage::Channel& state : m_head->channels) {
+                std::fill(state.output.begin(), state.output.end(), 0.0f);
+            }
+        }
+        return;
+    }
+
+    const MixKernels::Table& kernels = MixKernels::Active();
+    if (m_tail) {
+        for (uint32_t c = 0; c < m_channels; ++c) {
+            std::memcpy(m_tail->channels[c].input.data() + m_tail->block + static_cast<size_t>(step) * block,
+                        m_head->channels[c].input.data() + block, sizeof(float) * block);
+        }
+    }
+
+    m_head->PushInput();
+    m_head->Accumulate(kernels, 0, m_head->partitions);
+    m_head->Finish(m_time);
+
+    if (m_tail) {
+        // The tail block finished last round is played out a short block at a time.
+        for (uint32_t c = 0; c < m_channels; ++c) {
+            float* output = m_head->channels[c].output.data();
+            const float* tail = m_tail->channels[c].output.data() + static_cast<size_t>(step) * block;
+            for (uint32_t i = 0; i < block; ++i) {
+                output[i] += tail[i];
+            }
+        }
+        // This step's share of the products for the next tail block.
+        uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(m_tail->partitions) * step / m_tailSteps);
+        uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(m_tail->partitions) * (step + 1) / m_tailSteps);
+        m_tail->Accumulate(kernels, first, last);
+        if (step + 1 == m_tailSteps) {
+            // Its last chunk was just played, so the finished block can replace it, and the
+            // input block that just completed joins the delay line for the round after.
+            m_tail->Finish(m_time);
+            m_tail->PushInput();
+        }
+    }
+}
+
+size_t Convolver::MemoryBytes() const {
+    return m_time.capacity() * sizeof(float) + (m_head ? m_head->MemoryBytes() : 0) + (m_tail ? m_tail->MemoryBytes() : 0);
+}
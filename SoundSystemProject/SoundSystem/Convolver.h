@@ -0,0 +1,77 @@
+// --- Convolver.h ---
+// Partitioned FFT convolution, the engine behind reverb buses.
+//
+// The impulse response is cut into partitions and each partition is transformed once, at
+// Init. Input is gathered into blocks; every full block is transformed and pushed onto a
+// delay line of input spectra, and one output block is the inverse transform of the sum,
+// over all partitions, of partition spectrum times the input spectrum that many blocks
+// old (overlap-save). The sums are done with the MixKernels::complexMulAcc kernel.
+//
+// Partitioning is non-uniform, in two stages. The head of the IR uses 'blockFrames'
+// partitions, which sets the latency. The rest uses partitions 16 times longer, which cut
+// the number of spectrum products for a long tail by about as much; the tail's bigger
+// blocks only have to be ready much later, so their products are spread evenly over the
+// short blocks in between instead of landing on one callback. Short IRs only use the head.
+//
+// When the input has been silent for longer than the impulse response, blocks are skipped
+// outright: a reverb bus nothing is sending to costs next to nothing.
+//
+// Not thread-safe: Init and Reset must not overlap Process.
+
+#ifndef CONVOLVER_H
+#define CONVOLVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Convolver {
+public:
+    Convolver();
+    ~Convolver();
+    Convolver(const Convolver&) = delete;
+    Convolver& operator=(const Convolver&) = delete;
+
+    // Prepares to convolve 'channels' interleaved channels with the 'irFrames' frames of
+    // 'impulse' (interleaved, 'irChannels' channels). Output channel c uses IR channel c,
+    // or the IR's last channel if it has fewer, so a mono IR is applied to every channel.
+    // 'blockFrames' must be a power of two from 16 to 8192. Returns false on bad arguments
+    // or if memory runs out.
+    bool Init(uint32_t channels, uint32_t blockFrames, const float* impulse, uint64_t irFrames, uint32_t irChannels);
+
+    // Convolves 'frames' interleaved frames. 'in' and 'out' may be the same buffer. The
+    // output lags the input by LatencyFrames(); it is the reverb's tail, with no dry signal.
+    void Process(const float* in, float* out, uint32_t frames);
+
+    // Clears the delay lines and any tail still ringing.
+    void Reset();
+
+    uint32_t Channels() const { return m_channels; }
+    uint32_t LatencyFrames() const { return m_blockFrames; }
+
+    // Spectrum products per channel for the IR: head partitions plus tail partitions.
+    uint32_t PartitionCount() const;
+
+    // Memory held for spectra and buffers.
+    size_t MemoryBytes() const;
+
+private:
+    class Fft;
+    struct Stage;
+
+    void ProcessBlock();
+
+    uint32_t m_channels = 0;
+    uint32_t m_blockFrames = 0;
+    uint32_t m_fill = 0;            // Frames gathered towards the next block
+    uint32_t m_tailSteps = 1;       // Short blocks per tail block
+    uint32_t m_step = 0;            // Short blocks since the tail block started, below m_tailSteps
+    uint64_t m_silentBlocks = 0;    // Consecutive all-zero input blocks
+    uint64_t m_idleAfter = 0;       // Silent blocks after which every delay line holds only zeros
+    std::unique_ptr<Stage> m_head;
+    std::unique_ptr<Stage> m_tail;  // Null when the IR fits in the head
+    std::vector<float> m_time;      // Time-domain scratch, twice the longest block
+};
+
+#endif // CONVOLVER_H
@@ -0,0 +1,207 @@
+// --- EmitterStore.cpp ---
+// Emitter bookkeeping around MixKernels::spatialize: ids over packed arrays, and keeping
+// the active emitters at the front.
+
+#include "EmitterStore.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <new>
+#include <utility>
+
+const uint32_t EmitterStore::kNoEmitter;
+const float EmitterStore::kDefaultMinDistance = 1.0f;
+const float EmitterStore::kDefaultMaxDistance = std::numeric_limits<float>::max();
+const float EmitterStore::kDefaultRolloff = 1.0f;
+
+std::array<std::vector<float>*, EmitterStore::kFloatArrays> EmitterStore::FloatArrays() {
+    return { &m_x, &m_y, &m_z, &m_vx, &m_vy, &m_vz, &m_minDistance, &m_maxDistance,
+             &m_rolloff, &m_gain, &m_gainLeft, &m_gainRight, &m_doppler };
+}
+
+uint32_t EmitterStore::Add() {
+    // Reserve every array before appending to any, so running out of memory part way
+    // can't leave them different lengths.
+    size_t size = m_x.size();
+    try {
+        if (size == m_x.capacity()) {
+            size_t capacity = std::max<size_t>(64, size * 2);
+            for (std::vector<float>* array : FloatArrays()) {
+                array->reserve(capacity);
+            }
+            m_idAt.reserve(capacity);
+        }
+        if (m_freeIds.empty()) {
+            m_slotOf.reserve(m_slotOf.size() + 1);
+            m_freeIds.reserve(m_slotOf.size() + 1);
+        }
+    }
+    catch (const std::bad_alloc&) {
+        return kNoEmitter;
+    }
+
+    uint32_t id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else {
+        id = static_cast<uint32_t>(m_slotOf.size());
+        m_slotOf.push_back(kNoEmitter);
+    }
+    m_x.push_back(0.0f);
+    m_y.push_back(0.0f);
+    m_z.push_back(0.0f);
+    m_vx.push_back(0.0f);
+    m_vy.push_back(0.0f);
+    m_vz.push_back(0.0f);
+    m_minDistance.push_back(kDefaultMinDistance);
+    m_maxDistance.push_back(kDefaultMaxDistance);
+    m_rolloff.push_back(kDefaultRolloff);
+    m_gain.push_back(1.0f);
+    m_gainLeft.push_back(1.0f);
+    m_gainRight.push_back(1.0f);
+    m_doppler.push_back(1.0f);
+    m_idAt.push_back(id);
+    m_slotOf[id] = static_cast<uint32_t>(size);
+    return id;
+}
+
+void EmitterStore::Remove(uint32_t id) {
+    SetActive(id, false);
+    // Fill the hole with the last emitter, which is inactive unless the hole is the end.
+    size_t last = m_x.size() - 1;
+    Swap(m_slotOf[id], last);
+    for (std::vector<float>* array : FloatArrays()) {
+        array->pop_back();
+    }
+    m_idAt.pop_back();
+    m_slotOf[id] = kNoEmitter;
+    m_freeIds.push_back(id); // Capacity reserved by Add
+}
+
+void EmitterStore::Clear() {
+    for (std::vector<float>* array : FloatArrays()) {
+        array->clear();
+    }
+    m_idAt.clear();
+    m_slotOf.clear();
+    m_freeIds.clear();
+    m_activeCount = 0;
+    m_stale = false;
+}
+
+void EmitterStore::SetActive(uint32_t id, bool active) {
+    size_t slot = m_slotOf[id];
+    if (active && slot >= m_activeCount) {
+        Swap(slot, m_activeCount++);
+        m_stale = true;
+    }
+    else if (!active && slot < m_activeCount) {
+        Swap(slot, --m_activeCount);
+    }
+}
+
+void EmitterStore::SetPosition(uint32_t id, float x, float y, float z) {
+    size_t slot = m_slotOf[id];
+    m_x[slot] = x;
+    m_y[slot] = y;
+    m_z[slot] = z;
+    m_stale = true;
+}
+
+void EmitterStore::SetVelocity(uint32_t id, float x, float y, float z) {
+    size_t slot = m_slotOf[id];
+    m_vx[slot] = x;
+    m_vy[slot] = y;
+    m_vz[slot] = z;
+    m_stale = true;
+}
+
+void EmitterStore::SetRange(uint32_t id, float minDistance, float maxDistance, float rolloff) {
+    size_t slot = m_slotOf[id];
+    m_minDistance[slot] = minDistance;
+    m_maxDistance[slot] = maxDistance;
+    m_rolloff[slot] = rolloff;
+    m_stale = true;
+}
+
+void EmitterStore::CopyEmitter(uint32_t to, uint32_t from) {
+    size_t source = m_slotOf[from];
+    size_t slot = m_slotOf[to];
+    m_x[slot] = m_x[source];
+    m_y[slot] = m_y[source];
+    m_z[slot] = m_z[source];
+    m_vx[slot] = m_vx[source];
+    m_vy[slot] = m_vy[source];
+    m_vz[slot] = m_vz[source];
+    m_minDistance[slot] = m_minDistance[source];
+    m_maxDistance[slot] = m_maxDistance[source];
+    m_rolloff[slot] = m_rolloff[source];
+    m_stale = true;
+}
+
+void EmitterStore::GetPosition(uint32_t id, float& x, float& y, float& z) const {
+    size_t slot = m_slotOf[id];
+    x = m_x[slot];
+    y = m_y[slot];
+    z = m_z[slot];
+}
+
+float EmitterStore::Attenuation(uint32_t id, float distance) const {
+    size_t slot = m_slotOf[id];
+    float minDistance = m_minDistance[slot];
+    float maxDistance = m_maxDistance[slot];
+    if (!(minDistance > 0.0f && minDistance < maxDistance)) {
+        return 1.0f;
+    }
+    float clamped = std::min(std::max(distance, minDistance), maxDistance);
+    float gain = minDistance / (minDistance + m_rolloff[slot] * (clamped - minDistance));
+    return std::min(std::max(gain, 0.0f), 1.0f);
+}
+
+void EmitterStore::Update(const MixKernels::ListenerFrame& listener) {
+    if (m_activeCount > 0) {
+        MixKernels::Active().spatialize(listener, Arrays(0), m_activeCount);
+    }
+    m_stale = false;
+}
+
+void EmitterStore::UpdateOne(uint32_t id, const MixKernels::ListenerFrame& listener) {
+    MixKernels::GetTable(MixKernels::Level::Scalar)->spatialize(listener, Arrays(m_slotOf[id]), 1);
+}
+
+size_t EmitterStore::MemoryBytes() const {
+    return m_x.capacity() * kFloatArrays * sizeof(float) + m_idAt.capacity() * sizeof(uint32_t) +
+           m_slotOf.capacity() * sizeof(uint32_t) + m_freeIds.capacity() * sizeof(uint32_t);
+}
+
+void EmitterStore::Swap(size_t a, size_t b) {
+    if (a == b) {
+        return;
+    }
+    for (std::vector<float>* array : FloatArrays()) {
+        std::swap((*array)[a], (*array)[b]);
+    }
+    std::swap(m_idAt[a], m_idAt[b]);
+    m_slotOf[m_idAt[a]] = static_cast<uint32_t>(a);
+    m_slotOf[m_idAt[b]] = static_cast<uint32_t>(b);
+}
+
+MixKernels::EmitterArrays EmitterStore::Arrays(size_t first) {
+    MixKernels::EmitterArrays arrays;
+    arrays.x = m_x.data() + first;
+    arrays.y = m_y.data() + first;
+    arrays.z = m_z.data() + first;
+    arrays.vx = m_vx.data() + first;
+    arrays.vy = m_vy.data() + first;
+    arrays.vz = m_vz.data() + first;
+    arrays.minDistance = m_minDistance.data() + first;
+    arrays.maxDistance = m_maxDistance.data() + first;
+    arrays.rolloff = m_rolloff.data() + first;
+    arrays.gain = m_gain.data() + first;
+    arrays.gainLeft = m_gainLeft.data() + first;
+    arrays.gainRight = m_gainRight.data() + first;
+    arrays.doppler = m_doppler.data() + first;
+    return arrays;
+}
@@ -0,0 +1,111 @@
+// --- EmitterStore.h ---
+// Spatial state of every sound and voice in structure-of-arrays layout, and the per-block
+// pass that turns it into the gain, pan gains and doppler factor each one plays with.
+//
+// An emitter is where a sound is and how it fades with distance: position, velocity,
+// distance range and rolloff. Each field is its own array, so MixKernels::spatialize can
+// load a vector of emitters' x coordinates, then their y coordinates, and so on, and work
+// out a whole vector of results per step with no gathering. Emitters are kept packed with
+// the active ones (those whose sound is playing) first, and Update only runs over those,
+// so a pass costs a few nanoseconds per playing sound however many sounds are loaded.
+//
+// Emitters are named by ids that stay the same while the arrays are reordered. The store
+// isn't thread safe; the sound system only touches it with g_registryMutex held.
+
+#ifndef EMITTERSTORE_H
+#define EMITTERSTORE_H
+
+#include "MixKernels.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class EmitterStore {
+public:
+    static const uint32_t kNoEmitter = 0xFFFFFFFFu;
+
+    // Range and rolloff of new emitters, as miniaudio gives new sounds.
+    static const float kDefaultMinDistance;
+    static const float kDefaultMaxDistance;
+    static const float kDefaultRolloff;
+
+    // Adds an inactive emitter at the origin, at rest, with the default range. Returns its
+    // id, or kNoEmitter if memory runs out.
+    uint32_t Add();
+
+    // Removes an emitter; its id may be handed out again.
+    void Remove(uint32_t id);
+
+    // Removes every emitter.
+    void Clear();
+
+    // Emitters that exist, and those that are active.
+    size_t Size() const { return m_x.size(); }
+    size_t ActiveCount() const { return m_activeCount; }
+
+    // Includes the emitter in Update, or leaves it out.
+    void SetActive(uint32_t id, bool active);
+
+    void SetPosition(uint32_t id, float x, float y, float z);
+    void SetVelocity(uint32_t id, float x, float y, float z);
+
+    // A 'minDistance' of 0 or more than 'maxDistance' turns distance attenuation off.
+    void SetRange(uint32_t id, float minDistance, float maxDistance, float rolloff);
+
+    // Gives 'to' the position, velocity, range and rolloff of 'from'.
+    void CopyEmitter(uint32_t to, uint32_t from);
+
+    void GetPosition(uint32_t id, float& x, float& y, float& z) const;
+
+    // The attenuation the emitter has at 'distance' from the listener: the formula of
+    // MixKernels::spatialize, for the odd emitter that is needed before the next pass.
+    float Attenuation(uint32_t id, float distance) const;
+
+    // Spatializes every active emitter relative to 'listener' with the active kernels.
+    void Update(const MixKernels::ListenerFrame& listener);
+
+    // True once an emitter has moved, changed range or become active since the last
+    // Update, so its results are out of date. The sound system also marks the store stale
+    // for what it keeps outside it (the listener, the doppler factor), and skips the pass
+    // in blocks where nothing has changed.
+    bool Stale() const { return m_stale; }
+    void MarkStale() { m_stale = true; }
+
+    // Spatializes one emitter, active or not, with the scalar kernel: for a sound about to
+    // start, which must not play its first block with the results of its last pass.
+    void UpdateOne(uint32_t id, const MixKernels::ListenerFrame& listener);
+
+    // Results of the last Update or UpdateOne that covered the emitter (see MixKernels.h).
+    float Gain(uint32_t id) const { return m_gain[m_slotOf[id]]; }
+    float GainLeft(uint32_t id) const { return m_gainLeft[m_slotOf[id]]; }
+    float GainRight(uint32_t id) const { return m_gainRight[m_slotOf[id]]; }
+    float Doppler(uint32_t id) const { return m_doppler[m_slotOf[id]]; }
+
+    // Memory held by the arrays.
+    size_t MemoryBytes() const;
+
+private:
+    static const size_t kFloatArrays = 13;
+
+    // Every per-emitter float array, for the operations that treat them all alike.
+    std::array<std::vector<float>*, kFloatArrays> FloatArrays();
+
+    // Exchanges the emitters at array positions 'a' and 'b', fixing up their ids.
+    void Swap(size_t a, size_t b);
+    MixKernels::EmitterArrays Arrays(size_t first);
+
+    // The per-emitter arrays, in the same order; positions [0, m_activeCount) are active.
+    std::vector<float> m_x, m_y, m_z;
+    std::vector<float> m_vx, m_vy, m_vz;
+    std::vector<float> m_minDistance, m_maxDistance, m_rolloff;
+    std::vector<float> m_gain, m_gainLeft, m_gainRight, m_doppler;
+    std::vector<uint32_t> m_idAt;       // Id of the emitter at each array position
+    size_t m_activeCount = 0;
+
+    std::vector<uint32_t> m_slotOf;     // Array position of each id; kNoEmitter if the id is free
+    std::vector<uint32_t> m_freeIds;
+    bool m_stale = false;
+};
+
+#endif // EMITTERSTORE_H
@@ -0,0 +1,398 @@
+// --- Hrtf.cpp ---
+// HRTF tables, filter blending and caching, and the per-voice binaural renderer (see Hrtf.h).
+
+#include "Hrtf.h"
+#include "HrtfFormat.h"
+#include "MixKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+const uint32_t Hrtf::kMaxFilterFrames;
+const uint32_t Hrtf::kAzimuthBuckets;
+const uint32_t Hrtf::kElevationBuckets;
+const uint32_t Hrtf::kBucketCount;
+const uint32_t Hrtf::kCacheSets;
+const uint32_t Hrtf::kCacheWays;
+const uint32_t Hrtf::kNoBucket;
+const uint32_t HrtfRenderer::kChunkFrames;
+
+namespace {
+
+    const double kPi = 3.14159265358979323846;
+    const float kDegreesPerBucket = 5.0f;
+
+    float Degrees(double radians) {
+        return static_cast<float>(radians * 180.0 / kPi);
+    }
+
+    float Radians(float degrees) {
+        return static_cast<float>(degrees * kPi / 180.0);
+    }
+
+    // Unit vector of a SOFA direction: x ahead, y to the left, z up.
+    void DirectionVector(float azimuth, float elevation, float* vector) {
+        float a = Radians(azimuth);
+        float e = Radians(elevation);
+        vector[0] = std::cos(e) * std::cos(a);
+        vector[1] = std::cos(e) * std::sin(a);
+        vector[2] = std::sin(e);
+    }
+
+    // Source frames of the sinc kept ahead of a response's first frame when resampling.
+    // Responses start right at their onset, so without this the part of the onset that
+    // rings ahead of it would be cut off, and with it some of the response's gain.
+    const double kLeadFrames = 6.0;
+
+    // Converts an impulse response to a new rate with a windowed sinc, cut off just below
+    // the lower of the two Nyquist frequencies. The 1 / ratio scale keeps the response's
+    // gain: at a higher rate the same response is spread over more taps. The output starts
+    // 'lead' frames before the input does.
+    void Resample(const float* in, uint32_t inTaps, double ratio, uint32_t lead, float* out, uint32_t outTaps) {
+        const double kCutoff = 0.95;
+        const double kLobes = 16.0;
+        double cutoff = std::min(1.0, ratio) * kCutoff;
+        double halfWidth = kLobes / cutoff;
+        for (uint32_t n = 0; n < outTaps; ++n) {
+            double position = (static_cast<double>(n) - lead) / ratio;
+            int64_t first = std::max<int64_t>(0, static_cast<int64_t>(std::ceil(position - halfWidth)));
+            int64_t last = std::min<int64_t>(inTaps - 1, static_cast<int64_t>(std::floor(position + halfWidth)));
+            double sum = 0.0;
+            for (int64_t k = first; k <= last; ++k) {
+                double t = position - static_cast<double>(k);
+                double x = kPi * cutoff * t;
+                double sinc = std::fabs(x) < 1e-9 ? 1.0 : std::sin(x) / x;
+                double window = 0.5 + 0.5 * std::cos(kPi * t / halfWidth);
+                sum += in[k] * cutoff * sinc * window;
+            }
+            out[n] = static_cast<float>(sum / ratio);
+        }
+    }
+
+} // namespace
+
+Hrtf::Hrtf() = default;
+Hrtf::~Hrtf() = default;
+
+bool Hrtf::Init(const void* table, size_t size, uint32_t sampleRate) {
+    const HrtfTable::Header* header = nullptr;
+    if (!table || sampleRate == 0 || !HrtfTable::ReadHeader(table, size, header)) {
+        return false;
+    }
+    double ratio = static_cast<double>(sampleRate) / header->sampleRate;
+    uint32_t lead = header->sampleRate == sampleRate ? 0 : static_cast<uint32_t>(std::ceil(kLeadFrames * ratio));
+    uint64_t taps = header->sampleRate == sampleRate ? header->taps : static_cast<uint64_t>(std::ceil(header->taps * ratio)) + lead;
+    if (taps == 0 || taps > kMaxFilterFrames) {
+        return false;
+    }
+
+    // Records are only float-aligned if the table is, so copy fields out rather than cast.
+    const unsigned char* record = static_cast<const unsigned char*>(table) + sizeof(HrtfTable::Header);
+    const uint64_t recordSize = HrtfTable::RecordSize(header->taps);
+    float maxDelay = 0.0f;
+    try {
+        m_directions.assign(3 * static_cast<size_t>(header->measurementCount), 0.0f);
+        m_delays.assign(2 * static_cast<size_t>(header->measurementCount), 0.0f);
+        m_responses.assign(2 * static_cast<size_t>(header->measurementCount) * taps, 0.0f);
+        std::vector<float> source(header->taps);
+        for (uint32_t i = 0; i < header->measurementCount; ++i, record += recordSize) {
+            HrtfTable::Measurement measurement;
+            std::memcpy(&measurement, record, sizeof(measurement));
+            if (!std::isfinite(measurement.azimuth) || !std::isfinite(measurement.elevation) ||
+                !(measurement.delayLeft >= 0.0f) || !(measurement.delayRight >= 0.0f) ||
+                measurement.delayLeft > kMaxFilterFrames || measurement.delayRight > kMaxFilterFrames) {
+                return false;
+            }
+            DirectionVector(measurement.azimuth, measurement.elevation, &m_directions[3 * static_cast<size_t>(i)]);
+            const float delays[2] = { measurement.delayLeft, measurement.delayRight };
+            for (uint32_t ear = 0; ear < 2; ++ear) {
+                std::memcpy(source.data(), record + sizeof(measurement) + ear * header->taps * sizeof(float), header->taps * sizeof(float));
+                float* response = &m_responses[(2 * static_cast<size_t>(i) + ear) * taps];
+                if (header->sampleRate == sampleRate) {
+                    std::copy(source.begin(), source.end(), response);
+                }
+                else {
+                    Resample(source.data(), header->taps, ratio, lead, response, static_cast<uint32_t>(taps));
+                }
+                m_delays[2 * static_cast<size_t>(i) + ear] = static_cast<float>(delays[ear] * ratio);
+                maxDelay = std::max(maxDelay, m_delays[2 * static_cast<size_t>(i) + ear]);
+            }
+        }
+        uint64_t filterFrames = (taps + static_cast<uint64_t>(std::ceil(maxDelay)) + 7) / 8 * 8;
+        if (filterFrames > kMaxFilterFrames) {
+            return false;
+        }
+        m_filterFrames = static_cast<uint32_t>(filterFrames);
+        m_cacheFilters.assign(static_cast<size_t>(kCacheSets) * kCacheWays * 2 * m_filterFrames, 0.0f);
+    }
+    catch (const std::bad_alloc&) {
+        return false;
+    }
+    m_measurementCount = header->measurementCount;
+    m_taps = static_cast<uint32_t>(taps);
+    for (CacheEntry& entry : m_cache) {
+        entry = CacheEntry();
+    }
+    return true;
+}
+
+uint32_t Hrtf::BucketOf(float x, float y, float z) {
+    // SOFA azimuth runs counterclockwise seen from above, so towards the left (-x).
+    float azimuth = Degrees(std::atan2(-x, z));
+    float elevation = Degrees(std::atan2(y, std::sqrt(x * x + z * z)));
+    int column = static_cast<int>(std::lround(azimuth / kDegreesPerBucket));
+    int row = static_cast<int>(std::lround((elevation + 90.0f) / kDegreesPerBucket));
+    row = std::clamp(row, 0, static_cast<int>(kElevationBuckets) - 1);
+    column = (column % static_cast<int>(kAzimuthBuckets) + static_cast<int>(kAzimuthBuckets)) % static_cast<int>(kAzimuthBuckets);
+    if (row == 0 || row == static_cast<int>(kElevationBuckets) - 1) {
+        column = 0; // Straight up or down, azimuth means nothing
+    }
+    return static_cast<uint32_t>(row) * kAzimuthBuckets + static_cast<uint32_t>(column);
+}
+
+const float* Hrtf::Filter(uint32_t bucket) {
+    uint32_t set = bucket % kCacheSets;
+    CacheEntry* ways = &m_cache[set * kCacheWays];
+    ++m_useClock;
+    uint32_t victim = 0;
+    for (uint32_t way = 0; way < kCacheWays; ++way) {
+        if (ways[way].bucket == bucket) {
+            ways[way].lastUse = m_useClock;
+            m_cacheHits.fetch_add(1, std::memory_order_relaxed);
+            return &m_cacheFilters[static_cast<size_t>(set * kCacheWays + way) * 2 * m_filterFrames];
+        }
+        if (ways[victim].bucket != kNoBucket && (ways[way].bucket == kNoBucket || ways[way].lastUse < ways[victim].lastUse)) {
+            victim = way;
+        }
+    }
+    float* filter = &m_cacheFilters[static_cast<size_t>(set * kCacheWays + victim) * 2 * m_filterFrames];
+    Blend(bucket, filter);
+    ways[victim].bucket = bucket;
+    ways[victim].lastUse = m_useClock;
+    m_cacheMisses.fetch_add(1, std::memory_order_relaxed);
+    return filter;
+}
+
+// Blends the filter pair for the centre of 'bucket' from the three nearest measurements,
+// weighted by inverse angular distance. Responses and delays are blended separately (see
+// HrtfFormat.h); each ear's delay is then rounded to a whole frame and put back as leading
+// zeros, which at 44.1 kHz and up is finer than the interaural time differences we can hear.
+void Hrtf::Blend(uint32_t bucket, float* filter) const {
+    float direction[3];
+    DirectionVector(static_cast<float>(bucket % kAzimuthBuckets) * kDegreesPerBucket,
+                    static_cast<float>(bucket / kAzimuthBuckets) * kDegreesPerBucket - 90.0f, direction);
+    const uint32_t kNearest = 3;
+    uint32_t nearest[kNearest] = {};
+    float closeness[kNearest] = { -2.0f, -2.0f, -2.0f }; // Cosine of the angle; -1 is opposite
+    for (uint32_t i = 0; i < m_measurementCount; ++i) {
+        const float* measured = &m_directions[3 * static_cast<size_t>(i)];
+        float dot = direction[0] * measured[0] + direction[1] * measured[1] + direction[2] * measured[2];
+        for (uint32_t rank = 0; rank < kNearest; ++rank) {
+            if (dot > closeness[rank]) {
+                for (uint32_t shift = kNearest - 1; shift > rank; --shift) {
+                    closeness[shift] = closeness[shift - 1];
+                    nearest[shift] = nearest[shift - 1];
+                }
+                closeness[rank] = dot;
+                nearest[rank] = i;
+                break;
+            }
+        }
+    }
+
+    float weights[kNearest] = {};
+    uint32_t used = std::min(kNearest, m_measurementCount);
+    float angle0 = std::acos(std::min(closeness[0], 1.0f));
+    if (angle0 < 1e-3f) {
+        weights[0] = 1.0f; // On a measurement
+        used = 1;
+    }
+    else {
+        float total = 0.0f;
+        for (uint32_t rank = 0; rank < used; ++rank) {
+            weights[rank] = 1.0f / std::acos(std::clamp(closeness[rank], -1.0f, 1.0f));
+            total += weights[rank];
+        }
+        for (uint32_t rank = 0; rank < used; ++rank) {
+            weights[rank] /= total;
+        }
+    }
+
+    std::fill(filter, filter + 2 * static_cast<size_t>(m_filterFrames), 0.0f);
+    for (uint32_t ear = 0; ear < 2; ++ear) {
+        float delay = 0.0f;
+        for (uint32_t rank = 0; rank < used; ++rank) {
+            delay += weights[rank] * m_delays[2 * static_cast<size_t>(nearest[rank]) + ear];
+        }
+        uint32_t offset = std::min(static_cast<uint32_t>(std::lround(delay)), m_filterFrames - m_taps);
+        // Time-reversed: response frame k lands at m_filterFrames - 1 - (offset + k).
+        float* reversed = filter + static_cast<size_t>(ear) * m_filterFrames + (m_filterFrames - 1 - offset);
+        for (uint32_t rank = 0; rank < used; ++rank) {
+            const float* response = &m_responses[(2 * static_cast<size_t>(nearest[rank]) + ear) * m_taps];
+            for (uint32_t k = 0; k < m_taps; ++k) {
+                *(reversed - k) += weights[rank] * response[k];
+            }
+        }
+    }
+}
+
+void Hrtf::ResetCacheStats() {
+    m_cacheHits.store(0, std::memory_order_relaxed);
+    m_cacheMisses.store(0, std::memory_order_relaxed);
+}
+
+size_t Hrtf::MemoryBytes() const {
+    return (m_directions.size() + m_delays.size() + m_responses.size() + m_cacheFilters.size()) * sizeof(float) + sizeof(m_cache);
+}
+
+HrtfRenderer::HrtfRenderer() = default;
+HrtfRenderer::~HrtfRenderer() = default;
+
+bool HrtfRenderer::Init(Hrtf* hrtf) {
+    if (!hrtf || hrtf->FilterFrames() == 0) {
+        return false;
+    }
+    try {
+        m_filterFrames = hrtf->FilterFrames();
+        m_history.assign(m_filterFrames - 1 + kChunkFrames, 0.0f);
+        m_filter.assign(2 * static_cast<size_t>(m_filterFrames), 0.0f);
+        m_nextFilter.assign(2 * static_cast<size_t>(m_filterFrames), 0.0f);
+        m_dry.assign(2 * kChunkFrames, 0.0f);
+        m_wet.assign(2 * kChunkFrames, 0.0f);
+        m_fade.assign(2 * kChunkFrames, 0.0f);
+        m_left.assign(kChunkFrames, 0.0f);
+        m_right.assign(kChunkFrames, 0.0f);
+    }
+    catch (const std::bad_alloc&) {
+        return false;
+    }
+    m_hrtf = hrtf;
+    m_restart.store(true, std::memory_order_release);
+    return true;
+}
+
+// Mode in bits 16-23, bucket in the low 16, the pan's float bits in the top 32: one atomic
+// word, so Process never sees the mode of one SetTarget with the direction of another.
+uint64_t HrtfRenderer::Pack(Mode mode, uint32_t bucket, float pan) {
+    uint32_t panBits = 0;
+    std::memcpy(&panBits, &pan, sizeof(panBits));
+    return (static_cast<uint64_t>(panBits) << 32) | (static_cast<uint64_t>(mode) << 16) | (bucket & 0xFFFFu);
+}
+
+HrtfRenderer::State HrtfRenderer::Unpack(uint64_t packed) {
+    State state;
+    state.mode = static_cast<Mode>((packed >> 16) & 0xFFu);
+    state.bucket = static_cast<uint32_t>(packed & 0xFFFFu);
+    uint32_t panBits = static_cast<uint32_t>(packed >> 32);
+    std::memcpy(&state.pan, &panBits, sizeof(panBits));
+    return state;
+}
+
+bool HrtfRenderer::SameState(const State& a, const State& b) {
+    if (a.mode != b.mode) {
+        return false;
+    }
+    switch (a.mode) {
+    case Mode::Binaural:
+        return a.bucket == b.bucket;
+    case Mode::Pan:
+        return a.pan == b.pan;
+    default:
+        return true;
+    }
+}
+
+void HrtfRenderer::SetTarget(Mode mode, uint32_t bucket, float pan, float gain) {
+    m_target.store(Pack(mode, std::min(bucket, Hrtf::kBucketCount - 1), std::clamp(pan, -1.0f, 1.0f)), std::memory_order_release);
+    m_targetGain.store(gain, std::memory_order_relaxed);
+}
+
+HrtfRenderer::Mode HrtfRenderer::TargetMode() const {
+    return Unpack(m_target.load(std::memory_order_relaxed)).mode;
+}
+
+void HrtfRenderer::Restart() {
+    m_restart.store(true, std::memory_order_release);
+}
+
+// Renders one chunk at 'state' into 'out' (interleaved stereo). 'dry' is the chunk's input
+// and 'mono' its downmix, the newest frames of m_history.
+void HrtfRenderer::Render(const State& state, const float* filter, const float* dry, const float* mono, uint32_t frames, float* out) {
+    const MixKernels::Table& kernels = MixKernels::Active();
+    switch (state.mode) {
+    case Mode::Direct:
+        std::memcpy(out, dry, sizeof(float) * 2 * frames);
+        break;
+    case Mode::Pan: {
+        // Constant power, scaled so a centred sound keeps the level of the stereo input.
+        float angle = static_cast<float>((state.pan + 1.0f) * kPi / 4.0);
+        std::fill(out, out + 2 * static_cast<size_t>(frames), 0.0f);
+        kernels.spreadMonoToStereo(out, mono, frames, std::sqrt(2.0f) * std::cos(angle), std::sqrt(2.0f) * std::sin(angle));
+        break;
+    }
+    case Mode::Binaural:
+        kernels.firStereo(m_left.data(), m_right.data(), m_history.data(), filter, filter + m_filterFrames, m_filterFrames, frames);
+        for (uint32_t i = 0; i < frames; ++i) {
+            out[2 * i] = m_left[i];
+            out[2 * i + 1] = m_right[i];
+        }
+        break;
+    }
+}
+
+void HrtfRenderer::Process(const float* in, float* out, uint32_t frames) {
+    if (!m_hrtf) {
+        if (in != out) {
+            std::memcpy(out, in, sizeof(float) * 2 * frames); // Not initialized
+        }
+        return;
+    }
+    const MixKernels::Table& kernels = MixKernels::Active();
+    float* mono = m_history.data() + m_filterFrames - 1;
+    for (uint32_t done = 0; done < frames;) {
+        uint32_t chunk = std::min(kChunkFrames, frames - done);
+        State target = Unpack(m_target.load(std::memory_order_acquire));
+        float gain = m_targetGain.load(std::memory_order_relaxed);
+        if (m_restart.exchange(false, std::memory_order_acq_rel)) {
+            std::fill(m_history.begin(), m_history.end(), 0.0f);
+            m_state = target;
+            m_gain = gain;
+            if (m_state.mode == Mode::Binaural) {
+                std::memcpy(m_filter.data(), m_hrtf->Filter(m_state.bucket), sizeof(float) * m_filter.size());
+            }
+        }
+
+        // The gain ramps over the chunk, before the mode's rendering, so it applies the same
+        // way in every mode. Reading the input before 'out' is written makes in == out safe.
+        std::fill(m_dry.begin(), m_dry.begin() + 2 * chunk, 0.0f);
+        kernels.mixRamp(m_dry.data(), in + static_cast<size_t>(done) * 2, chunk, 2, m_gain, gain);
+        for (uint32_t i = 0; i < chunk; ++i) {
+            mono[i] = 0.5f * (m_dry[2 * i] + m_dry[2 * i + 1]);
+        }
+
+        Render(m_state, m_filter.data(), m_dry.data(), mono, chunk, m_wet.data());
+        if (!SameState(target, m_state)) {
+            const float* filter = m_filter.data();
+            bool newFilter = target.mode == Mode::Binaural && (m_state.mode != Mode::Binaural || target.bucket != m_state.bucket);
+            if (newFilter) {
+                std::memcpy(m_nextFilter.data(), m_hrtf->Filter(target.bucket), sizeof(float) * m_nextFilter.size());
+                filter = m_nextFilter.data();
+            }
+            // wet += (new - wet) * ramp, the ramp rising from 0 to 1 over the chunk.
+            Render(target, filter, m_dry.data(), mono, chunk, m_fade.data());
+            kernels.mixRamp(m_fade.data(), m_wet.data(), chunk, 2, -1.0f, -1.0f);
+            kernels.mixRamp(m_wet.data(), m_fade.data(), chunk, 2, 0.0f, 1.0f);
+            if (newFilter) {
+                m_filter.swap(m_nextFilter);
+            }
+            m_state = target;
+        }
+        std::memcpy(out + static_cast<size_t>(done) * 2, m_wet.data(), sizeof(float) * 2 * chunk);
+
+        m_gain = gain;
+        // Keep the newest m_filterFrames - 1 frames as the next chunk's history.
+        std::memmove(m_history.data(), m_history.data() + chunk, sizeof(float) * (m_filterFrames - 1));
+        done += chunk;
+    }
+}
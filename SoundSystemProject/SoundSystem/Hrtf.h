@@ -0,0 +1,162 @@
+// --- Hrtf.h ---
+// Head-related transfer functions for binaural voices: the filters that make a sound played
+// over headphones seem to come from a direction, and the per-voice renderer that applies them.
+//
+// Hrtf holds a table of impulse response pairs measured around a head (HrtfFormat.h),
+// converted to the mixing rate at load. Directions are quantized into 5 degree buckets of
+// azimuth and elevation, and a bucket's filter pair is blended from the three measurements
+// nearest to it the first time a voice points there. Blended filters are kept in a small
+// cache, so voices that stay put or keep returning to the same directions cost no more
+// blending; a moving voice only crosses into a new bucket every few degrees.
+//
+// HrtfRenderer is one voice's state: the mono input history and the filter pair in use. It
+// runs on the audio thread. The command batch tells it where the voice is (SetTarget), and
+// when that changes it renders a chunk with both the old and the new filter and crossfades
+// between them, so moving sources don't click. Far voices are given a plain constant-power
+// pan instead of the filters, and a voice at the listener's position is passed through.
+
+#ifndef HRTF_H
+#define HRTF_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Hrtf {
+public:
+    // Longest filter accepted, response plus onset delay, in frames at the mixing rate.
+    // Filtering costs grow with the length; tables are normally trimmed to 128-256 taps.
+    static const uint32_t kMaxFilterFrames = 1024;
+
+    // 5 degree buckets: 72 around, 37 from straight down to straight up.
+    static const uint32_t kAzimuthBuckets = 72;
+    static const uint32_t kElevationBuckets = 37;
+    static const uint32_t kBucketCount = kAzimuthBuckets * kElevationBuckets;
+
+    Hrtf();
+    ~Hrtf();
+    Hrtf(const Hrtf&) = delete;
+    Hrtf& operator=(const Hrtf&) = delete;
+
+    // Reads a table laid out as in HrtfFormat.h and converts it to 'sampleRate'. Returns
+    // false if the table is malformed, its filters would be longer than kMaxFilterFrames,
+    // or memory runs out.
+    bool Init(const void* table, size_t size, uint32_t sampleRate);
+
+    // Length of every filter Filter returns, a multiple of 8.
+    uint32_t FilterFrames() const { return m_filterFrames; }
+    uint32_t MeasurementCount() const { return m_measurementCount; }
+
+    // The bucket of a direction in listener space: x to the right, y up, z ahead. The
+    // vector needn't be normalized but mustn't be zero.
+    static uint32_t BucketOf(float x, float y, float z);
+
+    // The filter pair for 'bucket': FilterFrames() taps for the left ear, then as many for
+    // the right, time-reversed as MixKernels::firStereo takes them, each with its ear's
+    // delay built in. Valid until the next call. Only called by the thread that mixes.
+    const float* Filter(uint32_t bucket);
+
+    // Filter calls answered from the cache, and those that had to blend a new filter.
+    uint64_t CacheHits() const { return m_cacheHits.load(std::memory_order_relaxed); }
+    uint64_t CacheMisses() const { return m_cacheMisses.load(std::memory_order_relaxed); }
+    void ResetCacheStats();
+
+    // Memory held for the table and the cache.
+    size_t MemoryBytes() const;
+
+private:
+    // The cache is 4-way set associative, indexed by bucket, with least recently used
+    // replacement within a set.
+    static const uint32_t kCacheSets = 64;
+    static const uint32_t kCacheWays = 4;
+    static const uint32_t kNoBucket = 0xFFFFFFFFu;
+
+    struct CacheEntry {
+        uint32_t bucket = kNoBucket;
+        uint32_t lastUse = 0;
+    };
+
+    void Blend(uint32_t bucket, float* filter) const;
+
+    uint32_t m_measurementCount = 0;
+    uint32_t m_taps = 0;                // Response length at the mixing rate
+    uint32_t m_filterFrames = 0;
+    std::vector<float> m_directions;    // Unit vector per measurement (x ahead, y left, z up)
+    std::vector<float> m_delays;        // Left and right onset delay per measurement, in frames
+    std::vector<float> m_responses;     // Left then right response per measurement
+    CacheEntry m_cache[kCacheSets * kCacheWays];
+    std::vector<float> m_cacheFilters;  // 2 * m_filterFrames floats per cache entry
+    uint32_t m_useClock = 0;
+    std::atomic<uint64_t> m_cacheHits{ 0 };
+    std::atomic<uint64_t> m_cacheMisses{ 0 };
+};
+
+// Renders one stereo voice through an Hrtf. SetTarget and Restart are called by the command
+// batch and may overlap Process, which runs on the audio thread; everything else is
+// Process's own.
+class HrtfRenderer {
+public:
+    enum class Mode : uint8_t {
+        Direct,   // At the listener: the input passes through
+        Pan,      // Beyond the binaural distance: mono, panned
+        Binaural, // Mono, through the filters of a direction bucket
+    };
+
+    HrtfRenderer();
+    ~HrtfRenderer();
+    HrtfRenderer(const HrtfRenderer&) = delete;
+    HrtfRenderer& operator=(const HrtfRenderer&) = delete;
+
+    // Prepares to render through 'hrtf', which must outlive the renderer. Returns false if
+    // memory runs out.
+    bool Init(Hrtf* hrtf);
+
+    // Where the voice is as of the latest command batch: the mode, the direction bucket
+    // (Binaural), the pan from -1 (left) to 1 (right) (Pan) and the distance gain, which
+    // applies in every mode. Changes are crossfaded over one chunk.
+    void SetTarget(Mode mode, uint32_t bucket, float pan, float gain);
+
+    // The mode last passed to SetTarget, for the caller's hysteresis.
+    Mode TargetMode() const;
+
+    // Makes the next Process start at the target without fading from what played before
+    // and without the old input's tail. For a voice starting a new sound.
+    void Restart();
+
+    // Renders 'frames' interleaved stereo frames. 'in' and 'out' may be the same buffer.
+    void Process(const float* in, float* out, uint32_t frames);
+
+private:
+    static const uint32_t kChunkFrames = 128;
+
+    struct State {
+        Mode mode = Mode::Direct;
+        uint32_t bucket = 0;
+        float pan = 0.0f;
+    };
+
+    static uint64_t Pack(Mode mode, uint32_t bucket, float pan);
+    static State Unpack(uint64_t packed);
+    static bool SameState(const State& a, const State& b);
+
+    void Render(const State& state, const float* filter, const float* dry, const float* mono, uint32_t frames, float* out);
+
+    Hrtf* m_hrtf = nullptr;
+    uint32_t m_filterFrames = 0;
+    std::atomic<uint64_t> m_target{ 0 };  // Mode, bucket and pan of SetTarget, packed
+    std::atomic<float> m_targetGain{ 1.0f };
+    std::atomic<bool> m_restart{ true };
+    State m_state;
+    float m_gain = 1.0f;
+    std::vector<float> m_history;       // Mono input: m_filterFrames - 1 older frames, then the chunk
+    std::vector<float> m_filter;        // Filter pair of m_state (Binaural)
+    std::vector<float> m_nextFilter;    // Filter pair being faded to
+    std::vector<float> m_dry;           // The chunk's input, gain applied, interleaved
+    std::vector<float> m_wet;           // The chunk rendered at the old state, then the new
+    std::vector<float> m_fade;
+    std::vector<float> m_left;          // firStereo outputs
+    std::vector<float> m_right;
+};
+
+#endif // HRTF_H
@@ -0,0 +1,78 @@
+// --- HrtfFormat.h ---
+// File layout of HRTF tables: head-related impulse responses measured around a listener,
+// written by Tools/HrtfTablePacker (from WAV files exported from a SOFA dataset or any
+// other source) and loaded by LoadHrtf. Not exported from the DLL; the packer includes it
+// directly.
+//
+// A table is laid out as:
+//   Header
+//   measurementCount records, each:
+//     Measurement
+//     float left[taps]     - left ear impulse response, onset delay removed
+//     float right[taps]    - right ear
+// Each ear's onset delay (the interaural time difference, plus any common lead-in) is
+// stored apart from its impulse response so that responses of neighbouring directions can
+// be blended without smearing two arrival times into one filter; the loader blends the
+// delays separately and puts them back.
+//
+// Directions follow the SOFA convention: azimuth in degrees counterclockwise from straight
+// ahead (90 is the listener's left), elevation in degrees up from the horizontal plane.
+//
+// Integers and floats are little-endian, which both the packer and the loader assume the
+// host is.
+
+#ifndef HRTFFORMAT_H
+#define HRTFFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace HrtfTable {
+
+    static const char kMagic[4] = { 'S', 'S', 'H', 'R' };
+    static const uint32_t kVersion = 1;
+
+    struct Header {
+        char magic[4];              // kMagic
+        uint32_t version;           // kVersion
+        uint32_t sampleRate;        // Rate the responses and delays were measured at
+        uint32_t measurementCount;
+        uint32_t taps;              // Length of every impulse response, in frames
+        uint32_t reserved[3];       // 0
+    };
+
+    struct Measurement {
+        float azimuth;              // Degrees, counterclockwise from ahead
+        float elevation;            // Degrees, up from the horizontal plane
+        float delayLeft;            // Onset delay of each ear, in frames at 'sampleRate'
+        float delayRight;
+    };
+
+    static_assert(sizeof(Header) == 32, "HRTF table header layout changed");
+    static_assert(sizeof(Measurement) == 16, "HRTF table measurement layout changed");
+
+    // Bytes one record takes: the measurement and both impulse responses.
+    inline uint64_t RecordSize(uint32_t taps) {
+        return sizeof(Measurement) + 2ull * taps * sizeof(float);
+    }
+
+    // Checks the header and that the records fill a table of 'size' bytes exactly. On
+    // success points 'header' at the table; record i starts RecordSize(taps) * i bytes
+    // after the header.
+    inline bool ReadHeader(const void* table, size_t size, const Header*& header) {
+        if (size < sizeof(Header)) {
+            return false;
+        }
+        header = static_cast<const Header*>(table);
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion ||
+            header->sampleRate == 0 || header->measurementCount == 0 || header->taps == 0) {
+            return false;
+        }
+        uint64_t records = size - sizeof(Header);
+        return records % RecordSize(header->taps) == 0 && records / RecordSize(header->taps) == header->measurementCount;
+    }
+
+} // namespace HrtfTable
+
+#endif // HRTFFORMAT_H
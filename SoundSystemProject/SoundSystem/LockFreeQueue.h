@@ -0,0 +1,93 @@
+// --- LockFreeQueue.h ---
+// A bounded multi-producer/multi-consumer queue used internally by the sound system.
+// Producers and consumers never take a lock: each cell carries a sequence number that
+// tells a thread whether the cell is ready to be written or read (Dmitry Vyukov's
+// bounded MPMC queue). TryPush fails instead of blocking when the queue is full.
+
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+template <typename T, size_t Capacity>
+class BoundedMpmcQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    BoundedMpmcQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+    BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+    // Copies 'value' into the queue. Returns false if the queue is full.
+    bool TryPush(const T& value) {
+        size_t position = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[position & (Capacity - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Full
+            }
+            else {
+                position = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Moves the oldest value into 'out'. Returns false if the queue is empty.
+    bool TryPop(T& out) {
+        size_t position = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[position & (Capacity - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    out = cell.value;
+                    cell.sequence.store(position + Capacity, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Empty
+            }
+            else {
+                position = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate number of queued values. Exact only when no other thread is pushing or popping.
+    size_t SizeApprox() const {
+        size_t enqueued = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t dequeued = m_dequeuePos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // The two cursors sit on separate cache lines so producers and consumers don't false-share.
+    alignas(64) Cell m_cells[Capacity];
+    alignas(64) std::atomic<size_t> m_enqueuePos{ 0 };
+    alignas(64) std::atomic<size_t> m_dequeuePos{ 0 };
+};
+
+#endif // LOCKFREEQUEUE_H
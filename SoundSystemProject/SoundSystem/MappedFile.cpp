@@ -0,0 +1,154 @@
+// --- MappedFile.cpp ---
+// Implementation of the pack file mappings declared in MappedFile.h.
+
+#include "MappedFile.h"
+#include "SoundLog.h"
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    // Every mapped file. Packs are few, so lookups are a linear scan.
+    std::vector<std::unique_ptr<MappedFile::View>> g_views;
+
+    // Guards g_views and the reference counts. SoundCache releases views with its own lock
+    // held, so this lock is always taken after that one.
+    std::mutex g_viewsMutex;
+
+    ma_result MapWholeFile(const char* path, MappedFile::View& view) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return MA_DOES_NOT_EXIST;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) {
+            CloseHandle(file);
+            return MA_INVALID_FILE;
+        }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            CloseHandle(file);
+            return MA_ERROR;
+        }
+        const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return MA_OUT_OF_MEMORY;
+        }
+        view.fileHandle = file;
+        view.mappingHandle = mapping;
+        view.data = data;
+        view.size = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return MA_DOES_NOT_EXIST;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            close(fd);
+            return MA_INVALID_FILE;
+        }
+        void* data = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping keeps the file open
+        if (data == MAP_FAILED) {
+            return MA_OUT_OF_MEMORY;
+        }
+        view.data = data;
+        view.size = static_cast<size_t>(info.st_size);
+#endif
+        return MA_SUCCESS;
+    }
+
+    void UnmapFile(MappedFile::View& view) {
+#ifdef _WIN32
+        UnmapViewOfFile(view.data);
+        CloseHandle(static_cast<HANDLE>(view.mappingHandle));
+        CloseHandle(static_cast<HANDLE>(view.fileHandle));
+#else
+        munmap(const_cast<void*>(view.data), view.size);
+#endif
+    }
+
+} // namespace
+
+namespace MappedFile {
+
+    const View* Open(const char* path, ma_result& result) {
+        std::lock_guard<std::mutex> lock(g_viewsMutex);
+        for (auto& view : g_views) {
+            if (view->path == path) {
+                ++view->refCount;
+                result = MA_SUCCESS;
+                return view.get();
+            }
+        }
+
+        // Mapping only reserves address space, so doing it under the lock is cheap.
+        std::unique_ptr<View> view(new (std::nothrow) View());
+        if (!view) {
+            result = MA_OUT_OF_MEMORY;
+            return nullptr;
+        }
+        result = MapWholeFile(path, *view);
+        if (result != MA_SUCCESS) {
+            return nullptr;
+        }
+        view->path = path;
+        view->refCount = 1;
+        SOUND_LOG_DEBUG("SoundSystem: Mapped pack '%s' (%zu bytes).", path, view->size);
+        g_views.push_back(std::move(view));
+        return g_views.back().get();
+    }
+
+    void Retain(const View* view) {
+        std::lock_guard<std::mutex> lock(g_viewsMutex);
+        ++const_cast<View*>(view)->refCount;
+    }
+
+    void Prefetch(const View* view) {
+        // Advisory only: if it fails the pages are still read on first touch.
+#ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = const_cast<void*>(view->data);
+        range.NumberOfBytes = view->size;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        madvise(const_cast<void*>(view->data), view->size, MADV_WILLNEED);
+#endif
+    }
+
+    void Release(const View* view) {
+        if (!view) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_viewsMutex);
+        for (size_t i = 0; i < g_views.size(); ++i) {
+            if (g_views[i].get() != view) {
+                continue;
+            }
+            if (--g_views[i]->refCount == 0) {
+                SOUND_LOG_DEBUG("SoundSystem: Unmapped pack '%s'.", view->path.c_str());
+                UnmapFile(*g_views[i]);
+                g_views[i] = std::move(g_views.back());
+                g_views.pop_back();
+            }
+            return;
+        }
+    }
+
+} // namespace MappedFile
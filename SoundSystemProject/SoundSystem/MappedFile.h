@@ -0,0 +1,47 @@
+// --- MappedFile.h ---
+// Read-only memory mappings of pack files, shared by every sound loaded from the same pack.
+//
+// A sound loaded from a pack reads its bytes straight out of the mapping: nothing is copied
+// into the process, and the OS pages the file in as the decoder touches it. A pack is mapped
+// by the first load that needs it and unmapped when the last reference goes.
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include "miniaudio.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace MappedFile {
+
+    // A mapped file. 'data' and 'size' never change while a reference is held.
+    struct View {
+        const void* data = nullptr;
+        size_t size = 0;
+        std::string path;
+
+        // Bookkeeping, only touched by MappedFile.cpp under its lock.
+        uint32_t refCount = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    };
+
+    // Maps 'path' read-only, or takes another reference to it if it is already mapped.
+    // Returns nullptr on failure and writes the reason to 'result'.
+    const View* Open(const char* path, ma_result& result);
+
+    // Takes another reference to a view returned by Open.
+    void Retain(const View* view);
+
+    // Asks the OS to start reading the whole file in, for callers about to read all of it.
+    void Prefetch(const View* view);
+
+    // Drops a reference, unmapping the file with the last one.
+    void Release(const View* view);
+
+} // namespace MappedFile
+
+#endif // MAPPEDFILE_H
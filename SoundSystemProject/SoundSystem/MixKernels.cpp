@@ -0,0 +1,829 @@
+// --- MixKernels.cpp ---
+// Scalar and x86 SIMD versions of the mixing kernels, and the CPU check that picks one set.
+//
+// All levels live in this one file. The SIMD functions are compiled for their instruction
+// set with a per-function target attribute on GCC and Clang (MSVC accepts the intrinsics
+// without any flag), so the rest of the DLL keeps the baseline instruction set and runs on
+// any x86-64 CPU. A function for a level is only ever called after DetectLevel has found
+// that level usable.
+//
+// Each SIMD loop handles whole vectors and leaves the tail to the scalar code, which
+// computes the same per-sample formula.
+
+#include "MixKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MIXKERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MIXKERNELS_TARGET(isa)
+#else
+#include <cpuid.h>
+#define MIXKERNELS_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define MIXKERNELS_X86 0
+#endif
+
+namespace MixKernels {
+
+    namespace {
+
+        const float kS16Scale = 1.0f / 32768.0f;
+
+        // --- Scalar ---
+
+        // Gain at frame i of a ramp, shared by every level so they agree sample for sample.
+        inline float RampGain(float gainStart, float gainStep, size_t frame) {
+            return gainStart + gainStep * static_cast<float>(frame);
+        }
+
+        inline float RampStep(float gainStart, float gainEnd, size_t frames) {
+            return frames > 0 ? (gainEnd - gainStart) / static_cast<float>(frames) : 0.0f;
+        }
+
+        // Finishes a ramp from frame 'first' on; the SIMD versions call this for their tail.
+        void MixRampFrom(float* dst, const float* src, size_t first, size_t frames, uint32_t channels, float gainStart, float gainStep) {
+            for (size_t frame = first; frame < frames; ++frame) {
+                float gain = RampGain(gainStart, gainStep, frame);
+                size_t base = frame * channels;
+                for (uint32_t c = 0; c < channels; ++c) {
+                    dst[base + c] += src[base + c] * gain;
+                }
+            }
+        }
+
+        void MixRampScalar(float* dst, const float* src, size_t frames, uint32_t channels, float gainStart, float gainEnd) {
+            MixRampFrom(dst, src, 0, frames, channels, gainStart, RampStep(gainStart, gainEnd, frames));
+        }
+
+        void PanStereoFrom(float* samples, size_t first, size_t frames, float leftGain, float rightGain) {
+            for (size_t frame = first; frame < frames; ++frame) {
+                samples[frame * 2] *= leftGain;
+                samples[frame * 2 + 1] *= rightGain;
+            }
+        }
+
+        void PanStereoScalar(float* samples, size_t frames, float leftGain, float rightGain) {
+            PanStereoFrom(samples, 0, frames, leftGain, rightGain);
+        }
+
+        void SpreadFrom(float* dst, const float* src, size_t first, size_t frames, float leftGain, float rightGain) {
+            for (size_t frame = first; frame < frames; ++frame) {
+                dst[frame * 2] += src[frame] * leftGain;
+                dst[frame * 2 + 1] += src[frame] * rightGain;
+            }
+        }
+
+        void SpreadMonoToStereoScalar(float* dst, const float* src, size_t frames, float leftGain, float rightGain) {
+            SpreadFrom(dst, src, 0, frames, leftGain, rightGain);
+        }
+
+        void S16ToF32From(float* dst, const int16_t* src, size_t first, size_t count) {
+            for (size_t i = first; i < count; ++i) {
+                dst[i] = static_cast<float>(src[i]) * kS16Scale;
+            }
+        }
+
+        void S16ToF32Scalar(float* dst, const int16_t* src, size_t count) {
+            S16ToF32From(dst, src, 0, count);
+        }
+
+        // Written as compare-and-select in the same operand order as the SSE max/min
+        // instructions, so a NaN comes out as -1 here exactly as it does in the SIMD code.
+        void ClipFrom(float* samples, size_t first, size_t count) {
+            for (size_t i = first; i < count; ++i) {
+                float value = samples[i] > -1.0f ? samples[i] : -1.0f;
+                samples[i] = value < 1.0f ? value : 1.0f;
+            }
+        }
+
+        void ClipScalar(float* samples, size_t count) {
+            ClipFrom(samples, 0, count);
+        }
+
+        void ComplexMulAccFrom(float* accRe, float* accIm, const float* aRe, const float* aIm, const float* bRe, const float* bIm, size_t first, size_t count) {
+            for (size_t i = first; i < count; ++i) {
+                accRe[i] += aRe[i] * bRe[i] - aIm[i] * bIm[i];
+                accIm[i] += aRe[i] * bIm[i] + aIm[i] * bRe[i];
+            }
+        }
+
+        void ComplexMulAccScalar(float* accRe, float* accIm, const float* aRe, const float* aIm, const float* bRe, const float* bIm, size_t count) {
+            ComplexMulAccFrom(accRe, accIm, aRe, aIm, bRe, bIm, 0, count);
+        }
+
+        void FirStereoFrom(float* outLeft, float* outRight, const float* input, const float* left, const float* right, size_t taps, size_t first, size_t frames) {
+            for (size_t n = first; n < frames; ++n) {
+                float sumLeft = 0.0f;
+                float sumRight = 0.0f;
+                for (size_t k = 0; k < taps; ++k) {
+                    sumLeft += input[n + k] * left[k];
+                    sumRight += input[n + k] * right[k];
+                }
+                outLeft[n] = sumLeft;
+                outRight[n] = sumRight;
+            }
+        }
+
+        void FirStereoScalar(float* outLeft, float* outRight, const float* input, const float* left, const float* right, size_t taps, size_t frames) {
+            FirStereoFrom(outLeft, outRight, input, left, right, taps, 0, frames);
+        }
+
+        // Closer to the listener than this, an emitter has no direction.
+        const float kMinEmitterDistance = 1e-6f;
+
+        // The min/max pairs are in the operand order of the SIMD versions' max/min, and the
+        // dot products add in the same order, so the levels without FMA agree exactly.
+        void SpatializeFrom(const ListenerFrame& listener, const EmitterArrays& emitters, size_t first, size_t count) {
+            float maxSpeed = listener.speedOfSound * kMaxDopplerSpeed;
+            for (size_t i = first; i < count; ++i) {
+                float dx = emitters.x[i] - listener.position[0];
+                float dy = emitters.y[i] - listener.position[1];
+                float dz = emitters.z[i] - listener.position[2];
+                float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+                float inverse = distance > kMinEmitterDistance ? 1.0f / distance : 0.0f;
+
+                float minDistance = emitters.minDistance[i];
+                float maxDistance = emitters.maxDistance[i];
+                float gain = 1.0f;
+                if (minDistance > 0.0f && minDistance < maxDistance) {
+                    float clamped = std::min(std::max(distance, minDistance), maxDistance);
+                    gain = minDistance / (minDistance + emitters.rolloff[i] * (clamped - minDistance));
+                    gain = std::min(std::max(gain, 0.0f), 1.0f);
+                }
+                float pan = (dx * listener.right[0] + dy * listener.right[1] + dz * listener.right[2]) * inverse;
+                pan = std::min(std::max(pan, -1.0f), 1.0f);
+                emitters.gain[i] = gain;
+                emitters.gainLeft[i] = gain * std::sqrt(std::min(1.0f - pan, 1.0f));
+                emitters.gainRight[i] = gain * std::sqrt(std::min(1.0f + pan, 1.0f));
+
+                // Speeds along the line from the listener out to the emitter: the listener's is
+                // positive when it closes in, the emitter's when it moves away.
+                float scale = inverse * listener.dopplerFactor;
+                float listenerSpeed = (dx * listener.velocity[0] + dy * listener.velocity[1] + dz * listener.velocity[2]) * scale;
+                float emitterSpeed = (dx * emitters.vx[i] + dy * emitters.vy[i] + dz * emitters.vz[i]) * scale;
+                listenerSpeed = std::min(std::max(listenerSpeed, -maxSpeed), maxSpeed);
+                emitterSpeed = std::min(std::max(emitterSpeed, -maxSpeed), maxSpeed);
+                emitters.doppler[i] = (listener.speedOfSound + listenerSpeed) / (listener.speedOfSound + emitterSpeed);
+            }
+        }
+
+        void SpatializeScalar(const ListenerFrame& listener, const EmitterArrays& emitters, size_t count) {
+            SpatializeFrom(listener, emitters, 0, count);
+        }
+
+        const Table kScalar = {
+            Level::Scalar, MixRampScalar, PanStereoScalar, SpreadMonoToStereoScalar, S16ToF32Scalar, ClipScalar, ComplexMulAccScalar, FirStereoScalar, SpatializeScalar
+        };
+
+#if MIXKERNELS_X86
+
+        // --- SSE2 ---
+        // The ramp loops build the per-lane frame index as a float vector and step it, and
+        // only vectorize mono and stereo (what the mixer produces); other layouts use the
+        // scalar loop.
+
+        MIXKERNELS_TARGET("sse2")
+        void MixRampSSE2(float* dst, const float* src, size_t frames, uint32_t channels, float gainStart, float gainEnd) {
+            float gainStep = RampStep(gainStart, gainEnd, frames);
+            if (channels != 1 && channels != 2) {
+                MixRampFrom(dst, src, 0, frames, channels, gainStart, gainStep);
+                return;
+            }
+            // 4 samples are 4 mono frames or 2 stereo frames.
+            size_t framesPerVector = 4 / channels;
+            __m128 frameIndex = channels == 1 ? _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f) : _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+            __m128 indexStep = _mm_set1_ps(static_cast<float>(framesPerVector));
+            __m128 start = _mm_set1_ps(gainStart);
+            __m128 step = _mm_set1_ps(gainStep);
+            size_t frame = 0;
+            for (; frame + framesPerVector <= frames; frame += framesPerVector) {
+                size_t i = frame * channels;
+                __m128 gain = _mm_add_ps(start, _mm_mul_ps(step, frameIndex));
+                __m128 sum = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), gain));
+                _mm_storeu_ps(dst + i, sum);
+                frameIndex = _mm_add_ps(frameIndex, indexStep);
+            }
+            MixRampFrom(dst, src, frame, frames, channels, gainStart, gainStep);
+        }
+
+        MIXKERNELS_TARGET("sse2")
+        void PanStereoSSE2(float* samples, size_t frames, float leftGain, float rightGain) {
+            __m128 gains = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+            size_t frame = 0;
+            for (; frame + 2 <= frames; frame += 2) {
+                _mm_storeu_ps(samples + frame * 2, _mm_mul_ps(_mm_loadu_ps(samples + frame * 2), gains));
+            }
+            PanStereoFrom(samples, frame, frames, leftGain, rightGain);
+        }
+
+        MIXKERNELS_TARGET("sse2")
+        void SpreadMonoToStereoSSE2(float* dst, const float* src, size_t frames, float leftGain, float rightGain) {
+            __m128 gains = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+            size_t frame = 0;
+            for (; frame + 4 <= frames; frame += 4) {
+                __m128 mono = _mm_loadu_ps(src + frame);
+                __m128 low = _mm_unpacklo_ps(mono, mono);   // s0 s0 s1 s1
+                __m128 high = _mm_unpackhi_ps(mono, mono);  // s2 s2 s3 s3
+                float* out = dst + frame * 2;
+                _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(low, gains)));
+                _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_mul_ps(high, gains)));
+            }
+            SpreadFrom(dst, src, frame, frames, leftGain, rightGain);
+        }
+
+        MIXKERNELS_TARGET("sse2")
+        void S16ToF32SSE2(float* dst, const int16_t* src, size_t count) {
+            __m128 scale = _mm_set1_ps(kS16Scale);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                // Sign-extend by placing each sample in the top half of a 32-bit lane and
+                // shifting it back down.
+                __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+                __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+            }
+            S16ToF32From(dst, src, i, count);
+        }
+
+        MIXKERNELS_TARGET("sse2")
+        void ClipSSE2(float* samples, size_t count) {
+            __m128 low = _mm_set1_ps(-1.0f);
+            __m128 high = _mm_set1_ps(1.0f);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 value = _mm_max_ps(_mm_loadu_ps(samples + i), low);
+                _mm_storeu_ps(samples + i, _mm_min_ps(value, high));
+            }
+            ClipFrom(samples, i, count);
+        }
+
+        MIXKERNELS_TARGET("sse2")
+        void ComplexMulAccSSE2(float* accRe, float* accIm, const float* aRe, const float* aIm, const float* bRe, const float* bIm, size_t count) {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 ar = _mm_loadu_ps(aRe + i);
+                __m128 ai = _mm_loadu_ps(aIm + i);
+                __m128 br = _mm_loadu_ps(bRe + i);
+                __m128 bi = _mm_loadu_ps(bIm + i);
+                __m128 re = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+                __m128 im = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+                _mm_storeu_ps(accRe + i, _mm_add_ps(_mm_loadu_ps(accRe + i), re));
+                _mm_storeu_ps(accIm + i, _mm_add_ps(_mm_loadu_ps(accIm + i), im));
+            }
+            ComplexMulAccFrom(accRe, accIm, aRe, aIm, bRe, bIm, i, count);
+        }
+
+        // The FIR loops run across outputs rather than taps: each tap is broadcast and
+        // multiplied into a run of consecutive outputs, so there is no horizontal sum, and two
+        // runs at once keep four independent accumulator chains in flight.
+        MIXKERNELS_TARGET("sse2")
+        void FirStereoSSE2(float* outLeft, float* outRight, const float* input, const float* left, const float* right, size_t taps, size_t frames) {
+            size_t n = 0;
+            for (; n + 8 <= frames; n += 8) {
+                __m128 left0 = _mm_setzero_ps(), left1 = _mm_setzero_ps();
+                __m128 right0 = _mm_setzero_ps(), right1 = _mm_setzero_ps();
+                for (size_t k = 0; k < taps; ++k) {
+                    __m128 x0 = _mm_loadu_ps(input + n + k);
+                    __m128 x1 = _mm_loadu_ps(input + n + k + 4);
+                    __m128 l = _mm_set1_ps(left[k]);
+                    __m128 r = _mm_set1_ps(right[k]);
+                    left0 = _mm_add_ps(left0, _mm_mul_ps(x0, l));
+                    left1 = _mm_add_ps(left1, _mm_mul_ps(x1, l));
+                    right0 = _mm_add_ps(right0, _mm_mul_ps(x0, r));
+                    right1 = _mm_add_ps(right1, _mm_mul_ps(x1, r));
+                }
+                _mm_storeu_ps(outLeft + n, left0);
+                _mm_storeu_ps(outLeft + n + 4, left1);
+                _mm_storeu_ps(outRight + n, right0);
+                _mm_storeu_ps(outRight + n + 4, right1);
+            }
+            FirStereoFrom(outLeft, outRight, input, left, right, taps, n, frames);
+        }
+
+        // The emitter loops take a vector of emitters at a time, one per lane, and select
+        // with masks where the scalar code branches.
+        MIXKERNELS_TARGET("sse2")
+        void SpatializeSSE2(const ListenerFrame& listener, const EmitterArrays& emitters, size_t count) {
+            __m128 listenerX = _mm_set1_ps(listener.position[0]);
+            __m128 listenerY = _mm_set1_ps(listener.position[1]);
+            __m128 listenerZ = _mm_set1_ps(listener.position[2]);
+            __m128 rightX = _mm_set1_ps(listener.right[0]);
+            __m128 rightY = _mm_set1_ps(listener.right[1]);
+            __m128 rightZ = _mm_set1_ps(listener.right[2]);
+            __m128 velocityX = _mm_set1_ps(listener.velocity[0]);
+            __m128 velocityY = _mm_set1_ps(listener.velocity[1]);
+            __m128 velocityZ = _mm_set1_ps(listener.velocity[2]);
+            __m128 speedOfSound = _mm_set1_ps(listener.speedOfSound);
+            __m128 dopplerFactor = _mm_set1_ps(listener.dopplerFactor);
+            __m128 maxSpeed = _mm_set1_ps(listener.speedOfSound * kMaxDopplerSpeed);
+            __m128 minSpeed = _mm_set1_ps(-(listener.speedOfSound * kMaxDopplerSpeed));
+            __m128 minEmitterDistance = _mm_set1_ps(kMinEmitterDistance);
+            __m128 zero = _mm_setzero_ps();
+            __m128 one = _mm_set1_ps(1.0f);
+            __m128 minusOne = _mm_set1_ps(-1.0f);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 dx = _mm_sub_ps(_mm_loadu_ps(emitters.x + i), listenerX);
+                __m128 dy = _mm_sub_ps(_mm_loadu_ps(emitters.y + i), listenerY);
+                __m128 dz = _mm_sub_ps(_mm_loadu_ps(emitters.z + i), listenerZ);
+                __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+                __m128 inverse = _mm_and_ps(_mm_cmpgt_ps(distance, minEmitterDistance), _mm_div_ps(one, distance));
+
+                __m128 minDistance = _mm_loadu_ps(emitters.minDistance + i);
+                __m128 maxDistance = _mm_loadu_ps(emitters.maxDistance + i);
+                __m128 clamped = _mm_min_ps(_mm_max_ps(distance, minDistance), maxDistance);
+                __m128 falloff = _mm_add_ps(minDistance, _mm_mul_ps(_mm_loadu_ps(emitters.rolloff + i), _mm_sub_ps(clamped, minDistance)));
+                __m128 gain = _mm_min_ps(_mm_max_ps(_mm_div_ps(minDistance, falloff), zero), one);
+                __m128 ranged = _mm_and_ps(_mm_cmpgt_ps(minDistance, zero), _mm_cmplt_ps(minDistance, maxDistance));
+                gain = _mm_or_ps(_mm_and_ps(ranged, gain), _mm_andnot_ps(ranged, one));
+
+                __m128 pan = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, rightX), _mm_mul_ps(dy, rightY)), _mm_mul_ps(dz, rightZ));
+                pan = _mm_min_ps(_mm_max_ps(_mm_mul_ps(pan, inverse), minusOne), one);
+                _mm_storeu_ps(emitters.gain + i, gain);
+                _mm_storeu_ps(emitters.gainLeft + i, _mm_mul_ps(gain, _mm_sqrt_ps(_mm_min_ps(_mm_sub_ps(one, pan), one))));
+                _mm_storeu_ps(emitters.gainRight + i, _mm_mul_ps(gain, _mm_sqrt_ps(_mm_min_ps(_mm_add_ps(one, pan), one))));
+
+                __m128 scale = _mm_mul_ps(inverse, dopplerFactor);
+                __m128 listenerSpeed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, velocityX), _mm_mul_ps(dy, velocityY)), _mm_mul_ps(dz, velocityZ));
+                __m128 emitterSpeed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(emitters.vx + i)), _mm_mul_ps(dy, _mm_loadu_ps(emitters.vy + i))),
+                                                 _mm_mul_ps(dz, _mm_loadu_ps(emitters.vz + i)));
+                listenerSpeed = _mm_min_ps(_mm_max_ps(_mm_mul_ps(listenerSpeed, scale), minSpeed), maxSpeed);
+                emitterSpeed = _mm_min_ps(_mm_max_ps(_mm_mul_ps(emitterSpeed, scale), minSpeed), maxSpeed);
+                _mm_storeu_ps(emitters.doppler + i, _mm_div_ps(_mm_add_ps(speedOfSound, listenerSpeed), _mm_add_ps(speedOfSound, emitterSpeed)));
+            }
+            SpatializeFrom(listener, emitters, i, count);
+        }
+
+        const Table kSSE2 = {
+            Level::SSE2, MixRampSSE2, PanStereoSSE2, SpreadMonoToStereoSSE2, S16ToF32SSE2, ClipSSE2, ComplexMulAccSSE2, FirStereoSSE2, SpatializeSSE2
+        };
+
+        // --- AVX2 + FMA ---
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void MixRampAVX2(float* dst, const float* src, size_t frames, uint32_t channels, float gainStart, float gainEnd) {
+            float gainStep = RampStep(gainStart, gainEnd, frames);
+            if (channels != 1 && channels != 2) {
+                MixRampFrom(dst, src, 0, frames, channels, gainStart, gainStep);
+                return;
+            }
+            size_t framesPerVector = 8 / channels;
+            __m256 frameIndex = channels == 1 ? _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7) : _mm256_setr_ps(0, 0, 1, 1, 2, 2, 3, 3);
+            __m256 indexStep = _mm256_set1_ps(static_cast<float>(framesPerVector));
+            __m256 start = _mm256_set1_ps(gainStart);
+            __m256 step = _mm256_set1_ps(gainStep);
+            size_t frame = 0;
+            for (; frame + framesPerVector <= frames; frame += framesPerVector) {
+                size_t i = frame * channels;
+                __m256 gain = _mm256_fmadd_ps(step, frameIndex, start);
+                _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), gain, _mm256_loadu_ps(dst + i)));
+                frameIndex = _mm256_add_ps(frameIndex, indexStep);
+            }
+            MixRampFrom(dst, src, frame, frames, channels, gainStart, gainStep);
+        }
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void PanStereoAVX2(float* samples, size_t frames, float leftGain, float rightGain) {
+            __m256 gains = _mm256_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+            size_t frame = 0;
+            for (; frame + 4 <= frames; frame += 4) {
+                _mm256_storeu_ps(samples + frame * 2, _mm256_mul_ps(_mm256_loadu_ps(samples + frame * 2), gains));
+            }
+            PanStereoFrom(samples, frame, frames, leftGain, rightGain);
+        }
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void SpreadMonoToStereoAVX2(float* dst, const float* src, size_t frames, float leftGain, float rightGain) {
+            __m256 gains = _mm256_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+            // Duplicates each of 4 mono samples into an L/R pair.
+            __m256i lowPairs = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+            __m256i highPairs = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+            size_t frame = 0;
+            for (; frame + 8 <= frames; frame += 8) {
+                __m256 mono = _mm256_loadu_ps(src + frame);
+                float* out = dst + frame * 2;
+                __m256 low = _mm256_permutevar8x32_ps(mono, lowPairs);
+                __m256 high = _mm256_permutevar8x32_ps(mono, highPairs);
+                _mm256_storeu_ps(out, _mm256_fmadd_ps(low, gains, _mm256_loadu_ps(out)));
+                _mm256_storeu_ps(out + 8, _mm256_fmadd_ps(high, gains, _mm256_loadu_ps(out + 8)));
+            }
+            SpreadFrom(dst, src, frame, frames, leftGain, rightGain);
+        }
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void S16ToF32AVX2(float* dst, const int16_t* src, size_t count) {
+            __m256 scale = _mm256_set1_ps(kS16Scale);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256i wide = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(wide), scale));
+            }
+            S16ToF32From(dst, src, i, count);
+        }
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void ClipAVX2(float* samples, size_t count) {
+            __m256 low = _mm256_set1_ps(-1.0f);
+            __m256 high = _mm256_set1_ps(1.0f);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 value = _mm256_max_ps(_mm256_loadu_ps(samples + i), low);
+                _mm256_storeu_ps(samples + i, _mm256_min_ps(value, high));
+            }
+            ClipFrom(samples, i, count);
+        }
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void ComplexMulAccAVX2(float* accRe, float* accIm, const float* aRe, const float* aIm, const float* bRe, const float* bIm, size_t count) {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 ar = _mm256_loadu_ps(aRe + i);
+                __m256 ai = _mm256_loadu_ps(aIm + i);
+                __m256 br = _mm256_loadu_ps(bRe + i);
+                __m256 bi = _mm256_loadu_ps(bIm + i);
+                __m256 re = _mm256_fnmadd_ps(ai, bi, _mm256_fmadd_ps(ar, br, _mm256_loadu_ps(accRe + i)));
+                __m256 im = _mm256_fmadd_ps(ai, br, _mm256_fmadd_ps(ar, bi, _mm256_loadu_ps(accIm + i)));
+                _mm256_storeu_ps(accRe + i, re);
+                _mm256_storeu_ps(accIm + i, im);
+            }
+            ComplexMulAccFrom(accRe, accIm, aRe, aIm, bRe, bIm, i, count);
+        }
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void FirStereoAVX2(float* outLeft, float* outRight, const float* input, const float* left, const float* right, size_t taps, size_t frames) {
+            size_t n = 0;
+            for (; n + 16 <= frames; n += 16) {
+                __m256 left0 = _mm256_setzero_ps(), left1 = _mm256_setzero_ps();
+                __m256 right0 = _mm256_setzero_ps(), right1 = _mm256_setzero_ps();
+                for (size_t k = 0; k < taps; ++k) {
+                    __m256 x0 = _mm256_loadu_ps(input + n + k);
+                    __m256 x1 = _mm256_loadu_ps(input + n + k + 8);
+                    __m256 l = _mm256_set1_ps(left[k]);
+                    __m256 r = _mm256_set1_ps(right[k]);
+                    left0 = _mm256_fmadd_ps(x0, l, left0);
+                    left1 = _mm256_fmadd_ps(x1, l, left1);
+                    right0 = _mm256_fmadd_ps(x0, r, right0);
+                    right1 = _mm256_fmadd_ps(x1, r, right1);
+                }
+                _mm256_storeu_ps(outLeft + n, left0);
+                _mm256_storeu_ps(outLeft + n + 8, left1);
+                _mm256_storeu_ps(outRight + n, right0);
+                _mm256_storeu_ps(outRight + n + 8, right1);
+            }
+            FirStereoFrom(outLeft, outRight, input, left, right, taps, n, frames);
+        }
+
+        MIXKERNELS_TARGET("avx2,fma")
+        void SpatializeAVX2(const ListenerFrame& listener, const EmitterArrays& emitters, size_t count) {
+            __m256 listenerX = _mm256_set1_ps(listener.position[0]);
+            __m256 listenerY = _mm256_set1_ps(listener.position[1]);
+            __m256 listenerZ = _mm256_set1_ps(listener.position[2]);
+            __m256 rightX = _mm256_set1_ps(listener.right[0]);
+            __m256 rightY = _mm256_set1_ps(listener.right[1]);
+            __m256 rightZ = _mm256_set1_ps(listener.right[2]);
+            __m256 velocityX = _mm256_set1_ps(listener.velocity[0]);
+            __m256 velocityY = _mm256_set1_ps(listener.velocity[1]);
+            __m256 velocityZ = _mm256_set1_ps(listener.velocity[2]);
+            __m256 speedOfSound = _mm256_set1_ps(listener.speedOfSound);
+            __m256 dopplerFactor = _mm256_set1_ps(listener.dopplerFactor);
+            __m256 maxSpeed = _mm256_set1_ps(listener.speedOfSound * kMaxDopplerSpeed);
+            __m256 minSpeed = _mm256_set1_ps(-(listener.speedOfSound * kMaxDopplerSpeed));
+            __m256 minEmitterDistance = _mm256_set1_ps(kMinEmitterDistance);
+            __m256 zero = _mm256_setzero_ps();
+            __m256 one = _mm256_set1_ps(1.0f);
+            __m256 minusOne = _mm256_set1_ps(-1.0f);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(emitters.x + i), listenerX);
+                __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(emitters.y + i), listenerY);
+                __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(emitters.z + i), listenerZ);
+                __m256 distance = _mm256_sqrt_ps(_mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx))));
+                __m256 inverse = _mm256_and_ps(_mm256_cmp_ps(distance, minEmitterDistance, _CMP_GT_OQ), _mm256_div_ps(one, distance));
+
+                __m256 minDistance = _mm256_loadu_ps(emitters.minDistance + i);
+                __m256 maxDistance = _mm256_loadu_ps(emitters.maxDistance + i);
+                __m256 clamped = _mm256_min_ps(_mm256_max_ps(distance, minDistance), maxDistance);
+                __m256 falloff = _mm256_fmadd_ps(_mm256_loadu_ps(emitters.rolloff + i), _mm256_sub_ps(clamped, minDistance), minDistance);
+                __m256 gain = _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(minDistance, falloff), zero), one);
+                __m256 ranged = _mm256_and_ps(_mm256_cmp_ps(minDistance, zero, _CMP_GT_OQ), _mm256_cmp_ps(minDistance, maxDistance, _CMP_LT_OQ));
+                gain = _mm256_blendv_ps(one, gain, ranged);
+
+                __m256 pan = _mm256_fmadd_ps(dz, rightZ, _mm256_fmadd_ps(dy, rightY, _mm256_mul_ps(dx, rightX)));
+                pan = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(pan, inverse), minusOne), one);
+                _mm256_storeu_ps(emitters.gain + i, gain);
+                _mm256_storeu_ps(emitters.gainLeft + i, _mm256_mul_ps(gain, _mm256_sqrt_ps(_mm256_min_ps(_mm256_sub_ps(one, pan), one))));
+                _mm256_storeu_ps(emitters.gainRight + i, _mm256_mul_ps(gain, _mm256_sqrt_ps(_mm256_min_ps(_mm256_add_ps(one, pan), one))));
+
+                __m256 scale = _mm256_mul_ps(inverse, dopplerFactor);
+                __m256 listenerSpeed = _mm256_fmadd_ps(dz, velocityZ, _mm256_fmadd_ps(dy, velocityY, _mm256_mul_ps(dx, velocityX)));
+                __m256 emitterSpeed = _mm256_fmadd_ps(dz, _mm256_loadu_ps(emitters.vz + i),
+                                                      _mm256_fmadd_ps(dy, _mm256_loadu_ps(emitters.vy + i), _mm256_mul_ps(dx, _mm256_loadu_ps(emitters.vx + i))));
+                listenerSpeed = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(listenerSpeed, scale), minSpeed), maxSpeed);
+                emitterSpeed = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(emitterSpeed, scale), minSpeed), maxSpeed);
+                _mm256_storeu_ps(emitters.doppler + i, _mm256_div_ps(_mm256_add_ps(speedOfSound, listenerSpeed), _mm256_add_ps(speedOfSound, emitterSpeed)));
+            }
+            SpatializeFrom(listener, emitters, i, count);
+        }
+
+        const Table kAVX2 = {
+            Level::AVX2, MixRampAVX2, PanStereoAVX2, SpreadMonoToStereoAVX2, S16ToF32AVX2, ClipAVX2, ComplexMulAccAVX2, FirStereoAVX2, SpatializeAVX2
+        };
+
+        // --- AVX-512F ---
+        // GCC's AVX-512 headers trip -Wmaybe-uninitialized inside their own inline functions
+        // when compiled through a target attribute; the warning is about the header, not this code.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+        MIXKERNELS_TARGET("avx512f")
+        void MixRampAVX512(float* dst, const float* src, size_t frames, uint32_t channels, float gainStart, float gainEnd) {
+            float gainStep = RampStep(gainStart, gainEnd, frames);
+            if (channels != 1 && channels != 2) {
+                MixRampFrom(dst, src, 0, frames, channels, gainStart, gainStep);
+                return;
+            }
+            size_t framesPerVector = 16 / channels;
+            __m512 frameIndex = channels == 1
+                ? _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+                : _mm512_setr_ps(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+            __m512 indexStep = _mm512_set1_ps(static_cast<float>(framesPerVector));
+            __m512 start = _mm512_set1_ps(gainStart);
+            __m512 step = _mm512_set1_ps(gainStep);
+            size_t frame = 0;
+            for (; frame + framesPerVector <= frames; frame += framesPerVector) {
+                size_t i = frame * channels;
+                __m512 gain = _mm512_fmadd_ps(step, frameIndex, start);
+                _mm512_storeu_ps(dst + i, _mm512_fmadd_ps(_mm512_loadu_ps(src + i), gain, _mm512_loadu_ps(dst + i)));
+                frameIndex = _mm512_add_ps(frameIndex, indexStep);
+            }
+            MixRampFrom(dst, src, frame, frames, channels, gainStart, gainStep);
+        }
+
+        MIXKERNELS_TARGET("avx512f")
+        void PanStereoAVX512(float* samples, size_t frames, float leftGain, float rightGain) {
+            __m512 gains = _mm512_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain,
+                                          leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+            size_t frame = 0;
+            for (; frame + 8 <= frames; frame += 8) {
+                _mm512_storeu_ps(samples + frame * 2, _mm512_mul_ps(_mm512_loadu_ps(samples + frame * 2), gains));
+            }
+            PanStereoFrom(samples, frame, frames, leftGain, rightGain);
+        }
+
+        MIXKERNELS_TARGET("avx512f")
+        void SpreadMonoToStereoAVX512(float* dst, const float* src, size_t frames, float leftGain, float rightGain) {
+            __m512 gains = _mm512_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain,
+                                          leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+            __m512i lowPairs = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+            __m512i highPairs = _mm512_setr_epi32(8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15);
+            size_t frame = 0;
+            for (; frame + 16 <= frames; frame += 16) {
+                __m512 mono = _mm512_loadu_ps(src + frame);
+                float* out = dst + frame * 2;
+                __m512 low = _mm512_permutexvar_ps(lowPairs, mono);
+                __m512 high = _mm512_permutexvar_ps(highPairs, mono);
+                _mm512_storeu_ps(out, _mm512_fmadd_ps(low, gains, _mm512_loadu_ps(out)));
+                _mm512_storeu_ps(out + 16, _mm512_fmadd_ps(high, gains, _mm512_loadu_ps(out + 16)));
+            }
+            SpreadFrom(dst, src, frame, frames, leftGain, rightGain);
+        }
+
+        MIXKERNELS_TARGET("avx512f")
+        void S16ToF32AVX512(float* dst, const int16_t* src, size_t count) {
+            __m512 scale = _mm512_set1_ps(kS16Scale);
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m512i wide = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+                _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(wide), scale));
+            }
+            S16ToF32From(dst, src, i, count);
+        }
+
+        MIXKERNELS_TARGET("avx512f")
+        void ClipAVX512(float* samples, size_t count) {
+            __m512 low = _mm512_set1_ps(-1.0f);
+            __m512 high = _mm512_set1_ps(1.0f);
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m512 value = _mm512_max_ps(_mm512_loadu_ps(samples + i), low);
+                _mm512_storeu_ps(samples + i, _mm512_min_ps(value, high));
+            }
+            ClipFrom(samples, i, count);
+        }
+
+        MIXKERNELS_TARGET("avx512f")
+        void ComplexMulAccAVX512(float* accRe, float* accIm, const float* aRe, const float* aIm, const float* bRe, const float* bIm, size_t count) {
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m512 ar = _mm512_loadu_ps(aRe + i);
+                __m512 ai = _mm512_loadu_ps(aIm + i);
+                __m512 br = _mm512_loadu_ps(bRe + i);
+                __m512 bi = _mm512_loadu_ps(bIm + i);
+                __m512 re = _mm512_fnmadd_ps(ai, bi, _mm512_fmadd_ps(ar, br, _mm512_loadu_ps(accRe + i)));
+                __m512 im = _mm512_fmadd_ps(ai, br, _mm512_fmadd_ps(ar, bi, _mm512_loadu_ps(accIm + i)));
+                _mm512_storeu_ps(accRe + i, re);
+                _mm512_storeu_ps(accIm + i, im);
+            }
+            ComplexMulAccFrom(accRe, accIm, aRe, aIm, bRe, bIm, i, count);
+        }
+
+        MIXKERNELS_TARGET("avx512f")
+        void FirStereoAVX512(float* outLeft, float* outRight, const float* input, const float* left, const float* right, size_t taps, size_t frames) {
+            size_t n = 0;
+            for (; n + 32 <= frames; n += 32) {
+                __m512 left0 = _mm512_setzero_ps(), left1 = _mm512_setzero_ps();
+                __m512 right0 = _mm512_setzero_ps(), right1 = _mm512_setzero_ps();
+                for (size_t k = 0; k < taps; ++k) {
+                    __m512 x0 = _mm512_loadu_ps(input + n + k);
+                    __m512 x1 = _mm512_loadu_ps(input + n + k + 16);
+                    __m512 l = _mm512_set1_ps(left[k]);
+                    __m512 r = _mm512_set1_ps(right[k]);
+                    left0 = _mm512_fmadd_ps(x0, l, left0);
+                    left1 = _mm512_fmadd_ps(x1, l, left1);
+                    right0 = _mm512_fmadd_ps(x0, r, right0);
+                    right1 = _mm512_fmadd_ps(x1, r, right1);
+                }
+                _mm512_storeu_ps(outLeft + n, left0);
+                _mm512_storeu_ps(outLeft + n + 16, left1);
+                _mm512_storeu_ps(outRight + n, right0);
+                _mm512_storeu_ps(outRight + n + 16, right1);
+            }
+            FirStereoFrom(outLeft, outRight, input, left, right, taps, n, frames);
+        }
+
+        MIXKERNELS_TARGET("avx512f")
+        void SpatializeAVX512(const ListenerFrame& listener, const EmitterArrays& emitters, size_t count) {
+            __m512 listenerX = _mm512_set1_ps(listener.position[0]);
+            __m512 listenerY = _mm512_set1_ps(listener.position[1]);
+            __m512 listenerZ = _mm512_set1_ps(listener.position[2]);
+            __m512 rightX = _mm512_set1_ps(listener.right[0]);
+            __m512 rightY = _mm512_set1_ps(listener.right[1]);
+            __m512 rightZ = _mm512_set1_ps(listener.right[2]);
+            __m512 velocityX = _mm512_set1_ps(listener.velocity[0]);
+            __m512 velocityY = _mm512_set1_ps(listener.velocity[1]);
+            __m512 velocityZ = _mm512_set1_ps(listener.velocity[2]);
+            __m512 speedOfSound = _mm512_set1_ps(listener.speedOfSound);
+            __m512 dopplerFactor = _mm512_set1_ps(listener.dopplerFactor);
+            __m512 maxSpeed = _mm512_set1_ps(listener.speedOfSound * kMaxDopplerSpeed);
+            __m512 minSpeed = _mm512_set1_ps(-(listener.speedOfSound * kMaxDopplerSpeed));
+            __m512 minEmitterDistance = _mm512_set1_ps(kMinEmitterDistance);
+            __m512 zero = _mm512_setzero_ps();
+            __m512 one = _mm512_set1_ps(1.0f);
+            __m512 minusOne = _mm512_set1_ps(-1.0f);
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(emitters.x + i), listenerX);
+                __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(emitters.y + i), listenerY);
+                __m512 dz = _mm512_sub_ps(_mm512_loadu_ps(emitters.z + i), listenerZ);
+                __m512 distance = _mm512_sqrt_ps(_mm512_fmadd_ps(dz, dz, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx))));
+                __m512 inverse = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(distance, minEmitterDistance, _CMP_GT_OQ), one, distance);
+
+                __m512 minDistance = _mm512_loadu_ps(emitters.minDistance + i);
+                __m512 maxDistance = _mm512_loadu_ps(emitters.maxDistance + i);
+                __m512 clamped = _mm512_min_ps(_mm512_max_ps(distance, minDistance), maxDistance);
+                __m512 falloff = _mm512_fmadd_ps(_mm512_loadu_ps(emitters.rolloff + i), _mm512_sub_ps(clamped, minDistance), minDistance);
+                __mmask16 ranged = _mm512_cmp_ps_mask(minDistance, zero, _CMP_GT_OQ) & _mm512_cmp_ps_mask(minDistance, maxDistance, _CMP_LT_OQ);
+                __m512 gain = _mm512_min_ps(_mm512_max_ps(_mm512_div_ps(minDistance, falloff), zero), one);
+                gain = _mm512_mask_blend_ps(ranged, one, gain);
+
+                __m512 pan = _mm512_fmadd_ps(dz, rightZ, _mm512_fmadd_ps(dy, rightY, _mm512_mul_ps(dx, rightX)));
+                pan = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(pan, inverse), minusOne), one);
+                _mm512_storeu_ps(emitters.gain + i, gain);
+                _mm512_storeu_ps(emitters.gainLeft + i, _mm512_mul_ps(gain, _mm512_sqrt_ps(_mm512_min_ps(_mm512_sub_ps(one, pan), one))));
+                _mm512_storeu_ps(emitters.gainRight + i, _mm512_mul_ps(gain, _mm512_sqrt_ps(_mm512_min_ps(_mm512_add_ps(one, pan), one))));
+
+                __m512 scale = _mm512_mul_ps(inverse, dopplerFactor);
+                __m512 listenerSpeed = _mm512_fmadd_ps(dz, velocityZ, _mm512_fmadd_ps(dy, velocityY, _mm512_mul_ps(dx, velocityX)));
+                __m512 emitterSpeed = _mm512_fmadd_ps(dz, _mm512_loadu_ps(emitters.vz + i),
+                                                      _mm512_fmadd_ps(dy, _mm512_loadu_ps(emitters.vy + i), _mm512_mul_ps(dx, _mm512_loadu_ps(emitters.vx + i))));
+                listenerSpeed = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(listenerSpeed, scale), minSpeed), maxSpeed);
+                emitterSpeed = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(emitterSpeed, scale), minSpeed), maxSpeed);
+                _mm512_storeu_ps(emitters.doppler + i, _mm512_div_ps(_mm512_add_ps(speedOfSound, listenerSpeed), _mm512_add_ps(speedOfSound, emitterSpeed)));
+            }
+            SpatializeFrom(listener, emitters, i, count);
+        }
+
+        const Table kAVX512 = {
+            Level::AVX512, MixRampAVX512, PanStereoAVX512, SpreadMonoToStereoAVX512, S16ToF32AVX512, ClipAVX512, ComplexMulAccAVX512, FirStereoAVX512, SpatializeAVX512
+        };
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+        // --- CPU detection ---
+
+        void CpuId(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+            for (int i = 0; i < 4; ++i) {
+                regs[i] = static_cast<uint32_t>(info[i]);
+            }
+#else
+            if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3])) {
+                regs[0] = regs[1] = regs[2] = regs[3] = 0;
+            }
+#endif
+        }
+
+        // Which register state the OS saves on a context switch (XCR0). Without it the wider
+        // registers can't be used even if the CPU has them.
+        uint64_t EnabledStateMask() {
+#if defined(_MSC_VER) && !defined(__clang__)
+            return _xgetbv(0);
+#else
+            uint32_t low, high;
+            __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+            return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+        }
+
+#endif // MIXKERNELS_X86
+
+        std::atomic<const Table*> g_active{ &kScalar };
+
+    } // namespace
+
+    const Table* GetTable(Level level) {
+        if (level > DetectLevel()) {
+            return nullptr;
+        }
+        switch (level) {
+        case Level::Scalar: return &kScalar;
+#if MIXKERNELS_X86
+        case Level::SSE2: return &kSSE2;
+        case Level::AVX2: return &kAVX2;
+        case Level::AVX512: return &kAVX512;
+#endif
+        default: return nullptr;
+        }
+    }
+
+    Level DetectLevel() {
+#if MIXKERNELS_X86
+        static const Level detected = [] {
+            uint32_t regs[4];
+            CpuId(0, 0, regs);
+            uint32_t maxLeaf = regs[0];
+            CpuId(1, 0, regs);
+            bool sse2 = (regs[3] & (1u << 26)) != 0;
+            bool fma = (regs[2] & (1u << 12)) != 0;
+            bool osxsave = (regs[2] & (1u << 27)) != 0;
+            bool avx = (regs[2] & (1u << 28)) != 0;
+            if (!sse2) {
+                return Level::Scalar;
+            }
+            if (!osxsave || !avx || maxLeaf < 7) {
+                return Level::SSE2;
+            }
+            uint64_t state = EnabledStateMask();
+            bool ymmEnabled = (state & 0x6) == 0x6;     // SSE and AVX state
+            bool zmmEnabled = (state & 0xE6) == 0xE6;   // Plus opmask and the upper ZMM registers
+            CpuId(7, 0, regs);
+            bool avx2 = (regs[1] & (1u << 5)) != 0;
+            bool avx512f = (regs[1] & (1u << 16)) != 0;
+            if (!ymmEnabled || !avx2 || !fma) {
+                return Level::SSE2;
+            }
+            if (!zmmEnabled || !avx512f) {
+                return Level::AVX2;
+            }
+            return Level::AVX512;
+        }();
+        return detected;
+#else
+        return Level::Scalar;
+#endif
+    }
+
+    void Select(Level maxLevel) {
+        Level level = DetectLevel() < maxLevel ? DetectLevel() : maxLevel;
+        g_active.store(GetTable(level), std::memory_order_release);
+    }
+
+    const Table& Active() {
+        return *g_active.load(std::memory_order_acquire);
+    }
+
+    const char* LevelName(Level level) {
+        switch (level) {
+        case Level::Scalar: return "Scalar";
+        case Level::SSE2: return "SSE2";
+        case Level::AVX2: return "AVX2";
+        case Level::AVX512: return "AVX-512";
+        default: return "Unknown";
+        }
+    }
+
+} // namespace MixKernels
@@ -0,0 +1,125 @@
+// --- MixKernels.h ---
+// Vectorized inner loops for the parts of the mix the sound system does itself: placing
+// and summing the voices of PlaySoundInstance into their buses (VoiceMixer.h), format
+// conversion, the final clip, the spectrum products of the convolution reverb, the HRTF
+// filters of binaural voices and the distance, pan and doppler of every emitter
+// (EmitterStore.h).
+//
+// Each kernel has a scalar version and SSE2, AVX2 and AVX-512 versions on x86. Select()
+// picks the widest set the CPU and OS support, once, when the sound system starts; after
+// that Active() is a plain pointer read, safe on the audio thread. Every version computes
+// the same formula per sample, so results match the scalar path to within a rounding step
+// (the AVX2 and AVX-512 versions fuse multiply-adds). Benchmarks/MixKernelBenchmark checks
+// this for every level the machine supports.
+//
+// Buffers are interleaved 32-bit float unless stated otherwise and need no alignment.
+
+#ifndef MIXKERNELS_H
+#define MIXKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MixKernels {
+
+    enum class Level : uint8_t {
+        Scalar,
+        SSE2,
+        AVX2,   // With FMA
+        AVX512, // AVX-512F
+        Count
+    };
+
+    // The listener as 'spatialize' sees it.
+    struct ListenerFrame {
+        float position[3];
+        float right[3];         // Unit vector to the listener's right
+        float velocity[3];      // In position units per second
+        float speedOfSound;     // In position units per second
+        float dopplerFactor;    // Scales both velocities; 0 turns the doppler shift off
+    };
+
+    // Emitters in structure-of-arrays layout: element i of every array belongs to emitter i,
+    // so the kernel reads each field for a whole vector of emitters with one load.
+    struct EmitterArrays {
+        const float* x;         // Position
+        const float* y;
+        const float* z;
+        const float* vx;        // Velocity, in position units per second
+        const float* vy;
+        const float* vz;
+        const float* minDistance;
+        const float* maxDistance;
+        const float* rolloff;
+        float* gain;            // Out: distance attenuation, in [0, 1]
+        float* gainLeft;        // Out: attenuation times the left and right pan gains
+        float* gainRight;
+        float* doppler;         // Out: pitch factor of the doppler shift
+    };
+
+    // Largest speed, as a fraction of the speed of sound, that 'spatialize' lets an emitter or
+    // the listener approach or recede at. Bounds the doppler factor to [1/3, 3].
+    static const float kMaxDopplerSpeed = 0.5f;
+
+    struct Table {
+        Level level;
+
+        // dst += src * gain, for 'frames' frames of 'channels' channels. The gain moves
+        // linearly from 'gainStart' at the first frame towards 'gainEnd' (reached at frame
+        // 'frames'), so a volume change spread over a block doesn't click.
+        void (*mixRamp)(float* dst, const float* src, size_t frames, uint32_t channels, float gainStart, float gainEnd);
+
+        // Scales a stereo buffer in place: left samples by 'leftGain', right by 'rightGain'.
+        void (*panStereo)(float* samples, size_t frames, float leftGain, float rightGain);
+
+        // dst (stereo) += src (mono) * (leftGain, rightGain).
+        void (*spreadMonoToStereo)(float* dst, const float* src, size_t frames, float leftGain, float rightGain);
+
+        // Converts 16-bit signed samples to float in [-1, 1).
+        void (*s16ToF32)(float* dst, const int16_t* src, size_t count);
+
+        // Clamps samples to [-1, 1] in place. NaN becomes -1, so garbage can't reach the DAC.
+        void (*clip)(float* samples, size_t count);
+
+        // acc += a * b for 'count' complex numbers, each array holding only the real or only
+        // the imaginary parts (split layout, so every lane does the same arithmetic).
+        void (*complexMulAcc)(float* accRe, float* accIm, const float* aRe, const float* aIm, const float* bRe, const float* bIm, size_t count);
+
+        // outLeft[n] = sum over k of input[n + k] * left[k], and outRight likewise with 'right',
+        // for 'frames' outputs; 'input' holds frames + taps - 1 samples. With time-reversed
+        // taps this filters one mono signal through a pair of short FIRs (binaural rendering).
+        void (*firStereo)(float* outLeft, float* outRight, const float* input, const float* left, const float* right, size_t taps, size_t frames);
+
+        // Spatializes 'count' emitters relative to the listener. Attenuation follows the
+        // inverse distance model (miniaudio's default): minDistance / (minDistance + rolloff *
+        // (distance - minDistance)), with the distance clamped to the emitter's range, and 1 for
+        // an emitter whose range is empty. The pan is the cosine of the angle between the
+        // direction to the emitter and the listener's right, p in [-1, 1], and the pan gains
+        // are sqrt(min(1 - p, 1)) and sqrt(min(1 + p, 1)): unity in the centre and on the near
+        // side, so no side ever plays louder than the sound itself, with the far side fading
+        // out by power as the emitter moves round to the other side. The doppler
+        // factor is (c - vl) / (c - ve), with vl and ve the listener's and the emitter's speed
+        // along the line from the emitter to the listener. An emitter at the listener's
+        // position is centred and unshifted.
+        void (*spatialize)(const ListenerFrame& listener, const EmitterArrays& emitters, size_t count);
+    };
+
+    // The kernels for 'level', or nullptr if this CPU (or build) can't run them.
+    const Table* GetTable(Level level);
+
+    // The widest level this CPU and OS support.
+    Level DetectLevel();
+
+    // Makes the kernels for 'level', or the widest supported level below it, the active ones.
+    // Called by InitializeSoundSystem; not while audio is being mixed.
+    void Select(Level maxLevel);
+
+    // The kernels chosen by Select (scalar before the first call).
+    const Table& Active();
+
+    // "Scalar", "SSE2", "AVX2" or "AVX-512".
+    const char* LevelName(Level level);
+
+} // namespace MixKernels
+
+#endif // MIXKERNELS_H
@@ -0,0 +1,89 @@
+// --- SoundBankFormat.h ---
+// File layout of sound banks: many sounds packed into one file behind an index, written by
+// Tools/SoundBankPacker and loaded by LoadSoundBank. Not exported from the DLL; the packer
+// includes it directly.
+//
+// A bank is laid out as:
+//   Header
+//   Entry[entryCount]   - in the order the sounds were packed, which is also data order
+//   ID strings          - not null-terminated; entries give offset and length
+//   sound data          - each sound starts on a 16 byte boundary
+// so loading a whole bank reads the file front to back once. A sound's data is either the
+// source file's bytes unchanged (any format miniaudio decodes) or PCM decoded at pack time:
+// 32-bit float plays with no decode at all, 16-bit takes half the space and is only
+// converted to float at load.
+//
+// Integers are little-endian, which both the packer and the loader assume the host is.
+
+#ifndef SOUNDBANKFORMAT_H
+#define SOUNDBANKFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace SoundBank {
+
+    static const char kMagic[4] = { 'S', 'S', 'B', 'K' };
+    static const uint32_t kVersion = 1;
+    static const uint64_t kDataAlignment = 16;
+
+    // How an entry's data is stored.
+    enum Encoding : uint32_t {
+        kEncodingFile = 0,   // The source file's bytes; decoded at load or while playing
+        kEncodingPcmF32 = 1, // Interleaved 32-bit float PCM at 'channels' and 'sampleRate'
+        kEncodingPcmS16 = 2, // Interleaved 16-bit signed PCM at 'channels' and 'sampleRate'
+    };
+
+    struct Header {
+        char magic[4];          // kMagic
+        uint32_t version;       // kVersion
+        uint32_t entryCount;
+        uint32_t reserved;      // 0
+        uint64_t stringsOffset; // Start of the ID strings, from the start of the file
+        uint64_t stringsSize;
+    };
+
+    struct Entry {
+        uint64_t offset;        // Start of the sound's data, from the start of the file
+        uint64_t size;          // Size of the data in bytes
+        uint32_t idOffset;      // Start of the ID, from stringsOffset
+        uint32_t idLength;
+        uint32_t encoding;      // Encoding
+        uint32_t channels;      // PCM encodings only, else 0
+        uint32_t sampleRate;    // PCM encodings only, else 0
+        uint32_t reserved;      // 0
+    };
+
+    static_assert(sizeof(Header) == 32, "Sound bank header layout changed");
+    static_assert(sizeof(Entry) == 40, "Sound bank entry layout changed");
+
+    // Checks the header and that the index and ID strings lie inside a bank of 'size' bytes.
+    // Entries' data ranges are checked when each sound is loaded. On success points 'header'
+    // and 'entries' into the bank.
+    inline bool ReadIndex(const void* bank, size_t size, const Header*& header, const Entry*& entries) {
+        if (size < sizeof(Header)) {
+            return false;
+        }
+        header = static_cast<const Header*>(bank);
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion) {
+            return false;
+        }
+        uint64_t indexEnd = sizeof(Header) + static_cast<uint64_t>(header->entryCount) * sizeof(Entry);
+        if (indexEnd > size || header->stringsOffset < indexEnd ||
+            header->stringsOffset > size || header->stringsSize > size - header->stringsOffset) {
+            return false;
+        }
+        entries = reinterpret_cast<const Entry*>(header + 1);
+        for (uint32_t i = 0; i < header->entryCount; ++i) {
+            if (entries[i].idLength == 0 || entries[i].idOffset > header->stringsSize ||
+                entries[i].idLength > header->stringsSize - entries[i].idOffset) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace SoundBank
+
+#endif // SOUNDBANKFORMAT_H
@@ -0,0 +1,400 @@
+// --- SoundCache.cpp ---
+// Implementation of the decoded-audio cache declared in SoundCache.h.
+
+#include "SoundCache.h"
+#include "SoundTable.h"
+#include "SoundLog.h"
+#include "MixKernels.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+    // Entries live in a slab so the pointers handed out by Acquire stay valid while the
+    // cache grows; freed entries are reused through g_freeEntries.
+    SlabArray<SoundCache::Entry> g_entries;
+    std::vector<uint32_t> g_freeEntries;
+    SoundIdTable g_entriesByPath;
+
+    // Guards everything above. Never held while a file decodes. SoundSystem.cpp may call
+    // Release with its registry lock held, so this lock is always taken after that one.
+    std::mutex g_cacheMutex;
+
+    // Signalled when a decode finishes, for callers waiting on the same file.
+    std::condition_variable g_decodeFinished;
+
+    // Guarded by g_cacheMutex, like the entries they describe.
+    SoundCache::Stats g_stats;
+
+    // Builds the lookup key for a path: one separator style, and case-folded on Windows
+    // where the file system ignores case.
+    std::string NormalizePath(const char* filePath) {
+        std::string key(filePath);
+        for (char& c : key) {
+            if (c == '\\') {
+                c = '/';
+            }
+#ifdef _WIN32
+            else if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+#endif
+        }
+        return key;
+    }
+
+    SoundCache::Entry* FindEntry(const std::string& key, uint64_t keyHash) {
+        uint32_t index = g_entriesByPath.Find(keyHash, [&](uint32_t candidate) {
+            return g_entries[candidate].key == key;
+        });
+        return index != SoundIdTable::kEmpty ? &g_entries[index] : nullptr;
+    }
+
+    // Returns a free entry, or nullptr if none could be allocated.
+    SoundCache::Entry* AllocateEntry() {
+        if (!g_freeEntries.empty()) {
+            uint32_t index = g_freeEntries.back();
+            g_freeEntries.pop_back();
+            return &g_entries[index];
+        }
+        SoundCache::Entry* entry = g_entries.EmplaceBack();
+        if (entry) {
+            entry->index = static_cast<uint32_t>(g_entries.Size() - 1);
+        }
+        return entry;
+    }
+
+    // Frees the entry's data, removes its key and returns it to the free list.
+    void FreeEntry(SoundCache::Entry& entry) {
+        g_entriesByPath.Erase(entry.keyHash, [&entry](uint32_t candidate) { return candidate == entry.index; });
+        if (entry.frames && !entry.pack) {
+            ma_free(entry.frames, NULL);
+            g_stats.decodedBytes -= entry.sizeInBytes;
+        }
+        if (entry.ownsEncoded) {
+            ma_free(const_cast<void*>(entry.encoded), NULL);
+            g_stats.encodedBytes -= entry.sizeInBytes;
+        }
+        MappedFile::Release(entry.pack);
+        uint32_t index = entry.index;
+        entry = SoundCache::Entry();
+        entry.index = index;
+        g_freeEntries.push_back(index);
+    }
+
+    // Decode to 32-bit float at the file's own channel count, the same format
+    // MA_SOUND_FLAG_DECODE produced. Unless a rate was requested the sample rate is the
+    // file's too, and the engine resamples at playback.
+    ma_decoder_config MakeDecoderConfig(ma_uint32 sampleRate) {
+        ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, 0, sampleRate);
+        if (sampleRate != 0) {
+            // Converting here is paid once per file rather than per voice per callback, so
+            // use the strongest anti-aliasing filter miniaudio's resampler has.
+            decoderConfig.resampling.linear.lpfOrder = MA_MAX_FILTER_ORDER;
+        }
+        return decoderConfig;
+    }
+
+    // Records the PCM produced by ma_decode_file or ma_decode_memory.
+    void SetDecoded(const ma_decoder_config& decoderConfig, ma_uint64 frameCount, void* frames, SoundCache::Entry& out) {
+        out.format = decoderConfig.format;
+        out.channels = decoderConfig.channels;
+        out.sampleRate = decoderConfig.sampleRate;
+        out.frameCount = frameCount;
+        out.frames = frames;
+        out.sizeInBytes = static_cast<size_t>(frameCount * ma_get_bytes_per_frame(decoderConfig.format, decoderConfig.channels));
+    }
+
+    ma_result DecodeFile(const char* filePath, ma_uint32 sampleRate, SoundCache::Entry& out) {
+        ma_decoder_config decoderConfig = MakeDecoderConfig(sampleRate);
+        ma_uint64 frameCount = 0;
+        void* frames = NULL;
+        ma_result result = ma_decode_file(filePath, &decoderConfig, &frameCount, &frames);
+        if (result == MA_SUCCESS) {
+            SetDecoded(decoderConfig, frameCount, frames, out);
+        }
+        return result;
+    }
+
+    ma_result DecodeMemory(const void* data, size_t size, ma_uint32 sampleRate, SoundCache::Entry& out) {
+        ma_decoder_config decoderConfig = MakeDecoderConfig(sampleRate);
+        ma_uint64 frameCount = 0;
+        void* frames = NULL;
+        ma_result result = ma_decode_memory(data, size, &decoderConfig, &frameCount, &frames);
+        if (result == MA_SUCCESS) {
+            SetDecoded(decoderConfig, frameCount, frames, out);
+        }
+        return result;
+    }
+
+    // Opens a decoder over encoded bytes once, to check they can be played and to learn the
+    // format voices will decode them to. Sets 'encoded' but not who owns it.
+    ma_result ProbeEncoded(const void* data, size_t size, SoundCache::Entry& out) {
+        ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, 0, 0);
+        ma_decoder decoder;
+        ma_result result = ma_decoder_init_memory(data, size, &decoderConfig, &decoder);
+        if (result != MA_SUCCESS) {
+            return result;
+        }
+        result = ma_decoder_get_data_format(&decoder, &out.format, &out.channels, &out.sampleRate, NULL, 0);
+        if (result == MA_SUCCESS) {
+            // Some formats can't report a length without scanning; 0 then means unknown.
+            if (ma_decoder_get_length_in_pcm_frames(&decoder, &out.frameCount) != MA_SUCCESS) {
+                out.frameCount = 0;
+            }
+            out.encoded = data;
+            out.sizeInBytes = size;
+        }
+        ma_decoder_uninit(&decoder);
+        return result;
+    }
+
+    // Reads a file into memory without decoding it.
+    ma_result ReadEncodedFile(const char* filePath, SoundCache::Entry& out) {
+        void* data = NULL;
+        size_t size = 0;
+        ma_result result = ma_vfs_open_and_read_file(NULL, filePath, &data, &size, NULL);
+        if (result != MA_SUCCESS) {
+            return result;
+        }
+        result = ProbeEncoded(data, size, out);
+        if (result != MA_SUCCESS) {
+            ma_free(data, NULL);
+            return result;
+        }
+        out.ownsEncoded = true;
+        return MA_SUCCESS;
+    }
+
+    // Returns the entry for 'key' with one reference taken, calling load(entry) to fill in a
+    // new one if no other sound holds it. An empty key makes an entry no later call can
+    // share, for data the cache can't identify (a caller's buffer may change after the load).
+    template <typename Load>
+    const SoundCache::Entry* AcquireShared(std::string key, const char* description, ma_result& result, Load&& load) {
+        using SoundCache::Entry;
+        uint64_t keyHash = HashSoundId(key.data(), key.size());
+
+        std::unique_lock<std::mutex> lock(g_cacheMutex);
+        Entry* entry = key.empty() ? nullptr : FindEntry(key, keyHash);
+        if (entry) {
+            // Another sound already holds (or is decoding) this file: share it.
+            ++entry->refCount;
+            ++g_stats.hits;
+            g_decodeFinished.wait(lock, [entry] { return entry->state != Entry::State::Decoding; });
+            if (entry->state == Entry::State::Failed) {
+                result = entry->result;
+                lock.unlock();
+                SoundCache::Release(entry);
+                return nullptr;
+            }
+            SOUND_LOG_DEBUG("SoundSystem: Reusing decoded data for '%s' (%u users).", description, entry->refCount);
+            result = MA_SUCCESS;
+            return entry;
+        }
+
+        entry = AllocateEntry();
+        if (!entry) {
+            result = MA_OUT_OF_MEMORY;
+            return nullptr;
+        }
+        if (!key.empty() && !g_entriesByPath.Insert(keyHash, entry->index)) {
+            g_freeEntries.push_back(entry->index);
+            result = MA_OUT_OF_MEMORY;
+            return nullptr;
+        }
+        entry->state = Entry::State::Decoding;
+        entry->refCount = 1;
+        entry->keyHash = keyHash;
+        entry->key = std::move(key);
+        ++g_stats.misses;
+        lock.unlock();
+
+        Entry loaded;
+        auto decodeStart = std::chrono::steady_clock::now();
+        result = load(loaded);
+        auto decodeTime = std::chrono::steady_clock::now() - decodeStart;
+
+        lock.lock();
+        g_stats.decodeTimeNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(decodeTime).count());
+        if (result == MA_SUCCESS) {
+            entry->format = loaded.format;
+            entry->channels = loaded.channels;
+            entry->sampleRate = loaded.sampleRate;
+            entry->frameCount = loaded.frameCount;
+            entry->frames = loaded.frames;
+            entry->encoded = loaded.encoded;
+            entry->ownsEncoded = loaded.ownsEncoded;
+            entry->pack = loaded.pack;
+            entry->sizeInBytes = loaded.sizeInBytes;
+            if (entry->frames && !entry->pack) {
+                g_stats.decodedBytes += entry->sizeInBytes;
+            }
+            else if (entry->ownsEncoded) {
+                g_stats.encodedBytes += entry->sizeInBytes;
+            }
+            entry->state = Entry::State::Ready;
+        }
+        else {
+            entry->state = Entry::State::Failed;
+            entry->result = result;
+        }
+        g_decodeFinished.notify_all();
+        if (result != MA_SUCCESS) {
+            lock.unlock();
+            SoundCache::Release(entry);
+            return nullptr;
+        }
+        return entry;
+    }
+
+    // Appends what distinguishes one cached form of a source from another to its key.
+    // '|' can't appear in a path on Windows, and is vanishingly rare elsewhere.
+    void AppendFormKey(std::string& key, ma_uint32 sampleRate, bool keepEncoded) {
+        if (keepEncoded) {
+            key += "|encoded";
+        }
+        else if (sampleRate != 0) {
+            key += '|';
+            key += std::to_string(sampleRate);
+        }
+    }
+
+} // namespace
+
+namespace SoundCache {
+
+    const Entry* Acquire(const char* filePath, ma_uint32 sampleRate, bool keepEncoded, ma_result& result) {
+        std::string key = NormalizePath(filePath);
+        AppendFormKey(key, sampleRate, keepEncoded);
+        return AcquireShared(std::move(key), filePath, result, [&](Entry& loaded) {
+            return keepEncoded ? ReadEncodedFile(filePath, loaded) : DecodeFile(filePath, sampleRate, loaded);
+        });
+    }
+
+    const Entry* AcquireMemory(const void* data, size_t size, ma_uint32 sampleRate, MemoryMode mode, ma_result& result) {
+        return AcquireShared(std::string(), "memory", result, [&](Entry& loaded) {
+            if (mode == MemoryMode::Decode) {
+                return DecodeMemory(data, size, sampleRate, loaded);
+            }
+            if (mode == MemoryMode::Reference) {
+                return ProbeEncoded(data, size, loaded);
+            }
+            void* copy = ma_malloc(size, NULL);
+            if (!copy) {
+                return MA_OUT_OF_MEMORY;
+            }
+            std::memcpy(copy, data, size);
+            ma_result probed = ProbeEncoded(copy, size, loaded);
+            if (probed != MA_SUCCESS) {
+                ma_free(copy, NULL);
+                return probed;
+            }
+            loaded.ownsEncoded = true;
+            return MA_SUCCESS;
+        });
+    }
+
+    const Entry* AcquirePacked(const MappedFile::View& pack, uint64_t offset, uint64_t size, ma_uint32 sampleRate, bool keepEncoded, ma_result& result) {
+        if (size == 0 || offset > pack.size || size > pack.size - offset) {
+            result = MA_INVALID_ARGS;
+            return nullptr;
+        }
+        const void* data = static_cast<const unsigned char*>(pack.data) + offset;
+
+        std::string key = NormalizePath(pack.path.c_str());
+        key += '|';
+        key += std::to_string(offset);
+        key += '+';
+        key += std::to_string(size);
+        AppendFormKey(key, sampleRate, keepEncoded);
+        return AcquireShared(std::move(key), pack.path.c_str(), result, [&](Entry& loaded) {
+            if (!keepEncoded) {
+                return DecodeMemory(data, static_cast<size_t>(size), sampleRate, loaded);
+            }
+            ma_result probed = ProbeEncoded(data, static_cast<size_t>(size), loaded);
+            if (probed == MA_SUCCESS) {
+                // Compressed sounds decode straight out of the mapping, so it must outlive them.
+                MappedFile::Retain(&pack);
+                loaded.pack = &pack;
+            }
+            return probed;
+        });
+    }
+
+    const Entry* AcquirePackedPcm(const MappedFile::View& pack, uint64_t offset, uint64_t size, ma_format format, ma_uint32 channels, ma_uint32 sampleRate, ma_result& result) {
+        size_t bytesPerFrame = ma_get_bytes_per_frame(format, channels);
+        if ((format != ma_format_f32 && format != ma_format_s16) || channels == 0 || sampleRate == 0 ||
+            offset > pack.size || size > pack.size - offset || size % bytesPerFrame != 0 ||
+            offset % ma_get_bytes_per_sample(format) != 0) {
+            result = MA_INVALID_ARGS;
+            return nullptr;
+        }
+
+        std::string key = NormalizePath(pack.path.c_str());
+        key += '|';
+        key += std::to_string(offset);
+        key += "|pcm";
+        return AcquireShared(std::move(key), pack.path.c_str(), result, [&](Entry& loaded) {
+            const unsigned char* stored = static_cast<const unsigned char*>(pack.data) + offset;
+            loaded.format = ma_format_f32;
+            loaded.channels = channels;
+            loaded.sampleRate = sampleRate;
+            loaded.frameCount = size / bytesPerFrame;
+            if (format == ma_format_f32) {
+                // Nothing to decode: the buffer refs read the samples out of the mapping.
+                MappedFile::Retain(&pack);
+                loaded.pack = &pack;
+                loaded.frames = const_cast<unsigned char*>(stored);
+                loaded.sizeInBytes = static_cast<size_t>(size);
+                return MA_SUCCESS;
+            }
+
+            // 16-bit PCM is widened to float once, here, so voices play it like any decoded
+            // sound. A straight conversion, much cheaper than decoding.
+            size_t sampleCount = static_cast<size_t>(loaded.frameCount) * channels;
+            float* frames = static_cast<float*>(ma_malloc(sampleCount * sizeof(float), NULL));
+            if (!frames) {
+                return MA_OUT_OF_MEMORY;
+            }
+            MixKernels::Active().s16ToF32(frames, reinterpret_cast<const int16_t*>(stored), sampleCount);
+            loaded.frames = frames;
+            loaded.sizeInBytes = sampleCount * sizeof(float);
+            return MA_SUCCESS;
+        });
+    }
+
+    const Entry* AddRef(const Entry* entry) {
+        std::lock_guard<std::mutex> lock(g_cacheMutex);
+        ++g_entries[entry->index].refCount;
+        return entry;
+    }
+
+    void Release(const Entry* entry) {
+        if (!entry) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_cacheMutex);
+        Entry& mutableEntry = g_entries[entry->index];
+        if (--mutableEntry.refCount == 0) {
+            FreeEntry(mutableEntry);
+        }
+    }
+
+    Stats GetStats() {
+        std::lock_guard<std::mutex> lock(g_cacheMutex);
+        return g_stats;
+    }
+
+    void ResetStats() {
+        std::lock_guard<std::mutex> lock(g_cacheMutex);
+        uint64_t decodedBytes = g_stats.decodedBytes;
+        uint64_t encodedBytes = g_stats.encodedBytes;
+        g_stats = Stats();
+        g_stats.decodedBytes = decodedBytes;
+        g_stats.encodedBytes = encodedBytes;
+    }
+
+} // namespace SoundCache
@@ -0,0 +1,107 @@
+// --- SoundCache.h ---
+// Reference-counted cache of decoded audio, keyed by file path.
+//
+// Every sound ID loaded from the same file shares one decoded PCM buffer: the first load
+// decodes the file, later loads only take a reference, and the buffer is freed when the
+// last sound using it is unloaded. Each sound plays the shared buffer through its own
+// ma_audio_buffer_ref, so every ID keeps an independent cursor, volume, pitch and position.
+//
+// Paths are compared after normalization (separators, and case on Windows), so
+// "Sounds\\gun.wav" and "sounds/gun.wav" share an entry there. A file decoded at its own
+// sample rate and the same file converted to another rate are separate entries.
+//
+// A file can also be held compressed: the entry then keeps the file's bytes as they are on
+// disk instead of PCM, and each sound or voice playing it runs its own ma_decoder over them.
+// The compressed and decoded forms of one file are separate entries too.
+//
+// Besides files, entries can hold a caller's buffer (never shared, since the cache can't
+// tell whether two buffers hold the same sound) or a range of a memory-mapped pack file
+// (shared by pack path and range, like files).
+
+#ifndef SOUNDCACHE_H
+#define SOUNDCACHE_H
+
+#include "miniaudio.h"
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace SoundCache {
+
+    // A loaded file. The data and format fields never change while a reference is held.
+    // Exactly one of 'frames' and 'encoded' is set; the format fields describe the PCM a
+    // decoder produces from 'encoded' (32-bit float at the file's channels and rate).
+    struct Entry {
+        ma_format format = ma_format_unknown;
+        ma_uint32 channels = 0;
+        ma_uint32 sampleRate = 0;
+        ma_uint64 frameCount = 0;
+        void* frames = nullptr;     // Interleaved PCM, allocated by miniaudio unless 'pack' is set
+        const void* encoded = nullptr; // The file's bytes, for sounds kept compressed
+        size_t sizeInBytes = 0;     // Size of whichever of the two buffers is held
+        bool ownsEncoded = false;   // 'encoded' was allocated by the cache and is freed with the entry
+        const MappedFile::View* pack = nullptr; // Mapping 'frames' or 'encoded' points into, released with the entry
+
+        // Bookkeeping, only touched by SoundCache.cpp under its lock.
+        enum class State : uint8_t { Free, Decoding, Ready, Failed } state = State::Free;
+        ma_result result = MA_SUCCESS;
+        uint32_t refCount = 0;
+        uint32_t index = 0;
+        uint64_t keyHash = 0;
+        std::string key;
+    };
+
+    // Returns the decoded data for 'filePath' with one reference taken, decoding the file if
+    // no other sound holds it. Concurrent requests for a file that is still decoding wait
+    // for that decode instead of starting another one. 'sampleRate' is the rate to convert
+    // the audio to while decoding, or 0 to keep the file's own. With 'keepEncoded' the file
+    // is read but not decoded ('sampleRate' must then be 0). Returns nullptr on failure and
+    // writes the decoder's result to 'result'.
+    const Entry* Acquire(const char* filePath, ma_uint32 sampleRate, bool keepEncoded, ma_result& result);
+
+    // How AcquireMemory treats the caller's buffer.
+    enum class MemoryMode : uint8_t {
+        Decode,     // Decode to PCM now; the buffer is only read during the call
+        Reference,  // Keep it compressed and decode it in place; the caller keeps it valid
+        Copy,       // Keep it compressed, in a copy owned by the cache
+    };
+
+    // Like Acquire, for encoded audio in a caller's buffer. The entry is never shared.
+    const Entry* AcquireMemory(const void* data, size_t size, ma_uint32 sampleRate, MemoryMode mode, ma_result& result);
+
+    // Like Acquire, for the 'size' bytes at 'offset' in a mapped pack. Compressed entries
+    // read the mapping in place and hold a reference to it. Fails with MA_INVALID_ARGS if
+    // the range isn't inside the pack.
+    const Entry* AcquirePacked(const MappedFile::View& pack, uint64_t offset, uint64_t size, ma_uint32 sampleRate, bool keepEncoded, ma_result& result);
+
+    // Like AcquirePacked, for PCM stored in the pack. 32-bit float ('format' ma_format_f32)
+    // is played straight out of the mapping; 16-bit (ma_format_s16) is converted to float
+    // into memory the cache owns. Fails with MA_INVALID_ARGS for any other format, or if the
+    // range isn't inside the pack or isn't whole frames.
+    const Entry* AcquirePackedPcm(const MappedFile::View& pack, uint64_t offset, uint64_t size, ma_format format, ma_uint32 channels, ma_uint32 sampleRate, ma_result& result);
+
+    // Takes another reference to an entry the caller already holds one to, e.g. to keep a
+    // sound's data alive while reading it without the sound system's lock. Returns 'entry'.
+    const Entry* AddRef(const Entry* entry);
+
+    // Drops a reference taken by one of the Acquire functions or AddRef, freeing the data with the last one.
+    void Release(const Entry* entry);
+
+    // Running totals reported by GetSoundSystemStats.
+    struct Stats {
+        uint64_t decodedBytes = 0;  // PCM currently held by the cache
+        uint64_t encodedBytes = 0;  // Compressed data the cache allocated (not caller buffers or mapped packs)
+        uint64_t hits = 0;          // Acquires served by data another sound already held
+        uint64_t misses = 0;        // Acquires that had to decode the file
+        uint64_t decodeTimeNs = 0;  // Total time spent in those decodes
+    };
+
+    Stats GetStats();
+
+    // Zeroes the hit, miss and decode time totals. The byte counts are current values and stay.
+    void ResetStats();
+
+} // namespace SoundCache
+
+#endif // SOUNDCACHE_H
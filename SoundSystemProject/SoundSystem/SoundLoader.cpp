@@ -0,0 +1,86 @@
+// --- SoundLoader.cpp ---
+// Implementation of the loader thread pool declared in SoundLoader.h.
+
+#include "SoundLoader.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    std::mutex g_jobMutex;
+    std::condition_variable g_jobAvailable;
+    std::deque<SoundLoader::Job> g_jobs;
+    std::vector<std::thread> g_workers;
+    bool g_stopping = false;
+
+    void WorkerMain() {
+        for (;;) {
+            SoundLoader::Job job;
+            {
+                std::unique_lock<std::mutex> lock(g_jobMutex);
+                g_jobAvailable.wait(lock, [] { return g_stopping || !g_jobs.empty(); });
+                if (g_stopping) {
+                    return;
+                }
+                job = std::move(g_jobs.front());
+                g_jobs.pop_front();
+            }
+            job(false);
+        }
+    }
+
+} // namespace
+
+namespace SoundLoader {
+
+    void Start(unsigned threadCount) {
+        std::lock_guard<std::mutex> lock(g_jobMutex);
+        if (!g_workers.empty()) {
+            return;
+        }
+        if (threadCount == 0) {
+            // Leave a core for the game thread; decoding is I/O and CPU bound, so a few workers suffice.
+            unsigned cores = std::thread::hardware_concurrency();
+            threadCount = std::clamp(cores > 1 ? cores - 1 : 1u, 1u, 4u);
+        }
+        g_stopping = false;
+        for (unsigned i = 0; i < threadCount; ++i) {
+            g_workers.emplace_back(WorkerMain);
+        }
+    }
+
+    void Stop() {
+        std::deque<Job> cancelled;
+        std::vector<std::thread> workers;
+        {
+            std::lock_guard<std::mutex> lock(g_jobMutex);
+            g_stopping = true;
+            cancelled.swap(g_jobs);
+            workers.swap(g_workers);
+        }
+        g_jobAvailable.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        for (Job& job : cancelled) {
+            job(true);
+        }
+    }
+
+    bool Submit(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(g_jobMutex);
+            if (g_workers.empty() || g_stopping) {
+                return false;
+            }
+            g_jobs.push_back(std::move(job));
+        }
+        g_jobAvailable.notify_one();
+        return true;
+    }
+
+} // namespace SoundLoader
@@ -0,0 +1,27 @@
+// --- SoundLoader.h ---
+// A small pool of worker threads that decode sounds in the background for
+// LoadSoundAsync. Jobs run in submission order across the workers.
+
+#ifndef SOUNDLOADER_H
+#define SOUNDLOADER_H
+
+#include <functional>
+
+namespace SoundLoader {
+
+    // A unit of work. 'cancelled' is true when the pool is stopped before the job ran;
+    // the job should then only report failure, not touch the engine.
+    typedef std::function<void(bool cancelled)> Job;
+
+    // Starts the worker threads. A count of 0 picks one based on the CPU count.
+    void Start(unsigned threadCount);
+
+    // Cancels jobs that haven't started, waits for running ones and joins the workers.
+    void Stop();
+
+    // Queues a job. Returns false if the pool isn't running.
+    bool Submit(Job job);
+
+} // namespace SoundLoader
+
+#endif // SOUNDLOADER_H
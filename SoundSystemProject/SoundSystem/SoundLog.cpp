@@ -0,0 +1,171 @@
+// --- SoundLog.cpp ---
+// Implementation of the ring-buffered logger declared in SoundLog.h.
+
+#include "SoundLog.h"
+#include "LockFreeQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Include Windows API header for MessageBox if compiling on Windows
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+
+    // One queued message. Longer messages are truncated.
+    struct LogRecord {
+        int level;
+        char text[248];
+    };
+
+    // 1024 records (256 KB) absorb bursts such as a level load; when the buffer is
+    // full, new messages are dropped and counted rather than blocking the caller.
+    BoundedMpmcQueue<LogRecord, 1024> g_records;
+    std::atomic<uint32_t> g_droppedRecords{ 0 };
+
+    std::atomic<int> g_runtimeLevel{ SOUNDSYSTEM_LOG_LEVEL };
+
+    // The sink is read by the thread delivering messages and replaced by SetCallback, under
+    // g_sinkMutex. The lock only covers reading or swapping the pointers, never the call,
+    // so replacing the sink can't wait behind a slow callback or a MessageBox.
+    std::mutex g_sinkMutex;
+    SoundLogCallback g_callback = nullptr;
+    void* g_callbackUserData = nullptr;
+
+    std::thread g_drainThread;
+    std::atomic<bool> g_running{ false };
+
+    // Default sink: the console, plus a MessageBox for errors on Windows. While the log
+    // thread runs, the MessageBox blocks only it, never the thread that reported the error.
+    void WriteToConsole(int level, const char* text) {
+        if (level >= SOUNDSYSTEM_LOG_LEVEL_WARNING) {
+            std::cerr << text << '\n';
+        }
+        else {
+            std::cout << text << '\n';
+        }
+#ifdef _WIN32
+        if (level >= SOUNDSYSTEM_LOG_LEVEL_ERROR) {
+            MessageBoxA(NULL, text, "Sound System Error", MB_ICONERROR | MB_OK);
+        }
+#endif
+    }
+
+    void Deliver(const LogRecord& record) {
+        SoundLogCallback callback;
+        void* userData;
+        {
+            std::lock_guard<std::mutex> lock(g_sinkMutex);
+            callback = g_callback;
+            userData = g_callbackUserData;
+        }
+        if (callback) {
+            callback(record.level, record.text, userData);
+        }
+        else {
+            WriteToConsole(record.level, record.text);
+        }
+    }
+
+    // Delivers everything currently queued. Returns true if anything was delivered.
+    bool Drain() {
+        bool delivered = false;
+        LogRecord record;
+        while (g_records.TryPop(record)) {
+            Deliver(record);
+            delivered = true;
+        }
+
+        uint32_t dropped = g_droppedRecords.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            LogRecord notice;
+            notice.level = SOUNDSYSTEM_LOG_LEVEL_WARNING;
+            std::snprintf(notice.text, sizeof(notice.text), "SoundSystem WARNING: %u log messages were dropped (log buffer full).", dropped);
+            Deliver(notice);
+            delivered = true;
+        }
+
+        if (delivered) {
+            bool console;
+            {
+                std::lock_guard<std::mutex> lock(g_sinkMutex);
+                console = !g_callback;
+            }
+            if (console) {
+                std::cout.flush();
+            }
+        }
+        return delivered;
+    }
+
+    void DrainThreadMain() {
+        while (g_running.load(std::memory_order_acquire)) {
+            if (!Drain()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+        Drain();
+    }
+
+} // namespace
+
+namespace SoundLog {
+
+    void Start() {
+        if (g_running.exchange(true)) {
+            return;
+        }
+        g_drainThread = std::thread(DrainThreadMain);
+    }
+
+    void Stop() {
+        if (!g_running.exchange(false)) {
+            return;
+        }
+        if (g_drainThread.joinable()) {
+            g_drainThread.join();
+        }
+    }
+
+    bool IsEnabled(int level) {
+        return level >= g_runtimeLevel.load(std::memory_order_relaxed);
+    }
+
+    void SetLevel(int level) {
+        g_runtimeLevel.store(level < SOUNDSYSTEM_LOG_LEVEL ? SOUNDSYSTEM_LOG_LEVEL : level, std::memory_order_relaxed);
+    }
+
+    void SetCallback(SoundLogCallback callback, void* userData) {
+        // Only swap the sink: messages still queued go to the new one when the log thread
+        // gets to them. Delivering them here would run the sink on the caller's thread.
+        std::lock_guard<std::mutex> lock(g_sinkMutex);
+        g_callback = callback;
+        g_callbackUserData = userData;
+    }
+
+    void Write(int level, const char* format, ...) {
+        LogRecord record;
+        record.level = level;
+        va_list args;
+        va_start(args, format);
+        std::vsnprintf(record.text, sizeof(record.text), format, args);
+        va_end(args);
+
+        if (!g_running.load(std::memory_order_acquire)) {
+            // No log thread yet (e.g. before InitializeSoundSystem): deliver directly, on
+            // this thread. SoundSystem.h documents this.
+            Deliver(record);
+            return;
+        }
+        if (!g_records.TryPush(record)) {
+            g_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+} // namespace SoundLog
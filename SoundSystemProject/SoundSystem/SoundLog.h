@@ -0,0 +1,69 @@
+// --- SoundLog.h ---
+// Internal logging for the sound system.
+//
+// Log calls format their message into a fixed-size record and push it onto a lock-free
+// ring buffer; a background thread drains the buffer and hands each record to the sink
+// (the callback registered through SetSoundLogCallback, or the console by default).
+// While that thread runs, the calling thread never blocks on console I/O or a MessageBox.
+//
+// SOUNDSYSTEM_LOG_LEVEL sets the lowest level that is compiled in. Calls below it
+// are removed entirely, so per-frame TRACE logs in setters cost nothing in release builds.
+
+#ifndef SOUNDLOG_H
+#define SOUNDLOG_H
+
+#include "SoundSystem.h" // For the SOUNDSYSTEM_LOG_LEVEL_* values and SoundLogCallback
+
+#ifndef SOUNDSYSTEM_LOG_LEVEL
+#ifdef NDEBUG
+#define SOUNDSYSTEM_LOG_LEVEL SOUNDSYSTEM_LOG_LEVEL_INFO
+#else
+#define SOUNDSYSTEM_LOG_LEVEL SOUNDSYSTEM_LOG_LEVEL_TRACE
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SOUNDLOG_PRINTF_FORMAT(fmtIndex, argIndex) __attribute__((format(printf, fmtIndex, argIndex)))
+#else
+#define SOUNDLOG_PRINTF_FORMAT(fmtIndex, argIndex)
+#endif
+
+namespace SoundLog {
+
+    // Starts the background thread that delivers queued messages.
+    // Until it runs, messages are delivered synchronously on the calling thread.
+    void Start();
+
+    // Delivers every queued message and stops the background thread.
+    void Stop();
+
+    // Returns true if messages at 'level' pass the runtime level set by SetLevel.
+    bool IsEnabled(int level);
+
+    // Sets the runtime level. It can only raise the bar above SOUNDSYSTEM_LOG_LEVEL.
+    void SetLevel(int level);
+
+    // Replaces the sink. A null callback restores the console sink. Messages still queued
+    // go to the new sink; one the log thread is delivering at the time may still reach
+    // the old one.
+    void SetCallback(SoundLogCallback callback, void* userData);
+
+    // Formats a message (printf-style) and queues it for delivery.
+    void Write(int level, const char* format, ...) SOUNDLOG_PRINTF_FORMAT(2, 3);
+
+} // namespace SoundLog
+
+#define SOUND_LOG(level, ...) \
+    do { \
+        if ((level) >= SOUNDSYSTEM_LOG_LEVEL && SoundLog::IsEnabled(level)) { \
+            SoundLog::Write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define SOUND_LOG_TRACE(...)   SOUND_LOG(SOUNDSYSTEM_LOG_LEVEL_TRACE, __VA_ARGS__)
+#define SOUND_LOG_DEBUG(...)   SOUND_LOG(SOUNDSYSTEM_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define SOUND_LOG_INFO(...)    SOUND_LOG(SOUNDSYSTEM_LOG_LEVEL_INFO, __VA_ARGS__)
+#define SOUND_LOG_WARNING(...) SOUND_LOG(SOUNDSYSTEM_LOG_LEVEL_WARNING, __VA_ARGS__)
+#define SOUND_LOG_ERROR(...)   SOUND_LOG(SOUNDSYSTEM_LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif // SOUNDLOG_H
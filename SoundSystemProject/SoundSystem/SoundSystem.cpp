@@ -1,468 +1,4190 @@
-// --- SoundSystem.cpp ---
-// This file contains the implementation of the sound system functions
-// using the miniaudio library.
-
-// Define SOUNDSYSTEM_EXPORTS before including SoundSystem.h in the DLL project
-// so that functions are marked for export.
-#define SOUNDSYSTEM_EXPORTS
-
-#include "SoundSystem.h" // Include our own header for the API definition
-#include <iostream>      // For logging to console
-#include <map>           // To store and manage loaded sounds
-#include <sstream>       // For building string messages for MessageBox
-#include <algorithm>     // For std::clamp
-
-// Include Windows API header for MessageBox if compiling on Windows
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
-// Miniaudio header. IMPORTANT: Define MA_NO_DECODER_WAV, MA_NO_DECODER_MP3, etc.
-// if you only want to support specific formats to reduce library size.
-// For broad support, just include it as is.
-#define MINIAUDIO_IMPLEMENTATION
-#include "miniaudio.h"
-
-// Global miniaudio engine instance. This manages the audio device and playback.
-static ma_engine g_engine;
-
-// A map to store pointers to ma_sound objects, indexed by their string IDs.
-// This allows us to manage multiple loaded and playing sounds.
-static std::map<std::string, ma_sound*> g_loadedSounds;
-
-extern "C" {
-
-    SOUNDSYSTEM_API bool InitializeSoundSystem() {
-        // Configure the miniaudio engine.
-        ma_engine_config engineConfig = ma_engine_config_init();
-        // You can customize the engine config here if needed, e.g., sample rate, channels.
-        // For 3D audio, miniaudio automatically handles listener and sound properties.
-        // No specific engine flags are needed for 3D init, it's handled by sound flags.
-
-        // Initialize the miniaudio engine.
-        // This will find and open the default audio device.
-        ma_result result = ma_engine_init(&engineConfig, &g_engine);
-        if (result != MA_SUCCESS) {
-            std::ostringstream oss;
-            oss << "SoundSystem ERROR: Failed to initialize miniaudio engine. Result: " << result;
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-            return false;
-        }
-
-        std::cout << "SoundSystem: Initialized successfully." << std::endl;
-        return true;
-    }
-
-    SOUNDSYSTEM_API void ShutdownSoundSystem() {
-        // Iterate through all loaded sounds and uninitialize them to free resources.
-        for (auto const& [soundId, soundPtr] : g_loadedSounds) {
-            if (soundPtr) {
-                ma_sound_uninit(soundPtr); // Uninitialize the sound
-                delete soundPtr;            // Free the dynamically allocated ma_sound object
-            }
-        }
-        g_loadedSounds.clear(); // Clear the map
-
-        // Uninitialize the miniaudio engine.
-        ma_engine_uninit(&g_engine);
-        std::cout << "SoundSystem: Shut down successfully." << std::endl;
-    }
-
-    SOUNDSYSTEM_API bool LoadSound(const char* filePath, const char* soundId) {
-        if (!filePath || !soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: LoadSound received null filePath or soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: LoadSound received null filePath or soundId." << std::endl;
-            return false;
-        }
-        std::string s_soundId = soundId;
-
-        // Check if the sound ID already exists to prevent duplicates.
-        if (g_loadedSounds.count(s_soundId)) {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Sound ID '" << s_soundId << "' already loaded. Ignoring.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-            return true; // Already loaded, consider it successful for idempotence
-        }
-
-        // Dynamically allocate a new ma_sound object.
-        ma_sound* pSound = new (std::nothrow) ma_sound();
-        if (!pSound) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: Failed to allocate memory for new sound.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: Failed to allocate memory for new sound." << std::endl;
-            return false;
-        }
-
-        // Initialize the sound with flags for decoding. Pitch and 3D are handled by default
-        // or set via their respective functions after initialization.
-        ma_result result = ma_sound_init_from_file(&g_engine, filePath, MA_SOUND_FLAG_DECODE, NULL, NULL, pSound);
-        if (result != MA_SUCCESS) {
-            std::ostringstream oss;
-            oss << "SoundSystem ERROR: Failed to load sound '" << filePath << "'. Result: " << result;
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-            delete pSound; // Clean up allocated memory on failure
-            return false;
-        }
-
-        // Store the newly loaded sound in our map.
-        g_loadedSounds[s_soundId] = pSound;
-        std::cout << "SoundSystem: Loaded sound '" << filePath << "' as ID '" << s_soundId << "'." << std::endl;
-        return true;
-    }
-
-    SOUNDSYSTEM_API void UnloadSound(const char* soundId) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: UnloadSound received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: UnloadSound received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            // Stop the sound if it's playing before uninitializing.
-            if (ma_sound_is_playing(it->second)) {
-                ma_sound_stop(it->second);
-            }
-            ma_sound_uninit(it->second); // Uninitialize the miniaudio sound object
-            delete it->second;           // Free the dynamically allocated memory
-            g_loadedSounds.erase(it);    // Remove from the map
-            std::cout << "SoundSystem: Unloaded sound with ID '" << s_soundId << "'." << std::endl;
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to unload non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void SndPlaySound(const char* soundId, bool loop) { // Renamed from PlaySound
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: SndPlaySound received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: SndPlaySound received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-
-            // Stop the sound if it's already playing before restarting,
-            // to allow for re-triggering one-shot sounds or resetting loops.
-            if (ma_sound_is_playing(pSound)) {
-                ma_sound_stop(pSound);
-                // Reset cursor to start for immediate replay
-                ma_sound_seek_to_pcm_frame(pSound, 0);
-            }
-
-            ma_sound_set_looping(pSound, loop); // Set looping state
-            ma_result result = ma_sound_start(pSound); // Start playing the sound
-            if (result != MA_SUCCESS) {
-                std::ostringstream oss;
-                oss << "SoundSystem ERROR: Failed to play sound with ID '" << s_soundId << "'. Result: " << result;
-#ifdef _WIN32
-                MessageBoxA(NULL, oss.str().c_str(), "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-                std::cerr << oss.str() << std::endl;
-            }
-            else {
-                std::cout << "SoundSystem: Playing sound ID '" << s_soundId << "' (Looping: " << (loop ? "Yes" : "No") << ")." << std::endl;
-            }
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to play non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void StopSound(const char* soundId) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: StopSound received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: StopSound received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-            if (ma_sound_is_playing(pSound)) {
-                ma_result result = ma_sound_stop(pSound); // Stop the sound
-                if (result != MA_SUCCESS) {
-                    std::ostringstream oss;
-                    oss << "SoundSystem ERROR: Failed to stop sound with ID '" << s_soundId << "'. Result: " << result;
-#ifdef _WIN32
-                    MessageBoxA(NULL, oss.str().c_str(), "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-                    std::cerr << oss.str() << std::endl;
-                }
-                else {
-                    // Reset cursor to start when stopping, so it's ready for replay.
-                    ma_sound_seek_to_pcm_frame(pSound, 0);
-                    std::cout << "SoundSystem: Stopped sound ID '" << s_soundId << "'." << std::endl;
-                }
-            }
-            else {
-                std::cout << "SoundSystem: Sound ID '" << s_soundId << "' is not playing. No action needed." << std::endl;
-            }
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to stop non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void PauseSound(const char* soundId) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: PauseSound received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: PauseSound received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-            ma_result result = ma_sound_stop(pSound); // In miniaudio, stop and start are used for pause/resume as well.
-            if (result != MA_SUCCESS) {
-                std::ostringstream oss;
-                oss << "SoundSystem ERROR: Failed to pause sound with ID '" << s_soundId << "'. Result: " << result;
-#ifdef _WIN32
-                MessageBoxA(NULL, oss.str().c_str(), "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-                std::cerr << oss.str() << std::endl;
-            }
-            else {
-                std::cout << "SoundSystem: Paused sound ID '" << s_soundId << "'." << std::endl;
-            }
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to pause non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void ResumeSound(const char* soundId) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: ResumeSound received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: ResumeSound received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-            ma_result result = ma_sound_start(pSound);
-            if (result != MA_SUCCESS) {
-                std::ostringstream oss;
-                oss << "SoundSystem ERROR: Failed to resume sound with ID '" << s_soundId << "'. Result: " << result;
-#ifdef _WIN32
-                MessageBoxA(NULL, oss.str().c_str(), "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-                std::cerr << oss.str() << std::endl;
-            }
-            else {
-                std::cout << "SoundSystem: Resumed sound ID '" << s_soundId << "'." << std::endl;
-            }
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to resume non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void SetMasterVolume(float volume) {
-        // Clamp volume to be within 0.0 and 1.0
-        volume = std::clamp(volume, 0.0f, 1.0f);
-
-        // No need to capture return value, as ma_engine_set_volume returns void
-        ma_engine_set_volume(&g_engine, volume);
-        std::cout << "SoundSystem: Master volume set to " << volume << "." << std::endl;
-    }
-
-    SOUNDSYSTEM_API void SetSoundVolume(const char* soundId, float volume) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: SetSoundVolume received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: SetSoundVolume received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-            // Clamp volume to be within 0.0 and 1.0
-            volume = std::clamp(volume, 0.0f, 1.0f);
-            // No need to capture return value, as ma_sound_set_volume returns void
-            ma_sound_set_volume(pSound, volume);
-            std::cout << "SoundSystem: Volume for sound ID '" << s_soundId << "' set to " << volume << "." << std::endl;
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to set volume for non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void SetSoundPan(const char* soundId, float pan) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: SetSoundPan received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: SetSoundPan received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-            // Clamp pan to be within -1.0 and 1.0
-            pan = std::clamp(pan, -1.0f, 1.0f);
-            // No need to capture return value, as ma_sound_set_pan returns void
-            ma_sound_set_pan(pSound, pan);
-            std::cout << "SoundSystem: Pan for sound ID '" << s_soundId << "' set to " << pan << "." << std::endl;
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to set pan for non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void SetSoundPitch(const char* soundId, float pitch) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: SetSoundPitch received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: SetSoundPitch received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-            // Pitch should generally be positive. If 0 or negative, miniaudio might behave unexpectedly.
-            if (pitch <= 0.0f) pitch = 0.001f; // Ensure a small positive value to avoid issues
-            // No need to capture return value, as ma_sound_set_pitch returns void
-            ma_sound_set_pitch(pSound, pitch);
-            std::cout << "SoundSystem: Pitch for sound ID '" << s_soundId << "' set to " << pitch << "." << std::endl;
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to set pitch for non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void SetSoundPosition(const char* soundId, float x, float y, float z) {
-        if (!soundId) {
-#ifdef _WIN32
-            MessageBoxA(NULL, "SoundSystem ERROR: SetSoundPosition received null soundId.", "Sound System Error", MB_ICONERROR | MB_OK);
-#endif
-            std::cerr << "SoundSystem ERROR: SetSoundPosition received null soundId." << std::endl;
-            return;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            ma_sound* pSound = it->second;
-            // No need to capture return value, as ma_sound_set_position returns void
-            ma_sound_set_position(pSound, x, y, z);
-            std::cout << "SoundSystem: Position for sound ID '" << s_soundId << "' set to (" << x << ", " << y << ", " << z << ")." << std::endl;
-        }
-        else {
-            std::ostringstream oss;
-            oss << "SoundSystem WARNING: Attempted to set position for non-existent sound ID '" << s_soundId << "'.";
-#ifdef _WIN32
-            MessageBoxA(NULL, oss.str().c_str(), "Sound System Warning", MB_ICONWARNING | MB_OK);
-#endif
-            std::cerr << oss.str() << std::endl;
-        }
-    }
-
-    SOUNDSYSTEM_API void SetListenerPosition(float x, float y, float z) {
-        // No need to capture return value, as ma_engine_listener_set_position returns void
-        ma_engine_listener_set_position(&g_engine, 0, x, y, z); // Listener 0 is the default
-        std::cout << "SoundSystem: Listener position set to (" << x << ", " << y << ", " << z << ")." << std::endl;
-    }
-
-    SOUNDSYSTEM_API void SetListenerOrientation(float forwardX, float forwardY, float forwardZ) { // Simplified signature
-        // The ma_engine_listener_set_direction function (with 4 arguments) sets the "at" (forward) vector.
-        // If your miniaudio.h does not define ma_engine_listener_set_up,
-        // then the up vector is either implicitly handled or not directly settable via an API.
-        ma_engine_listener_set_direction(&g_engine, 0, forwardX, forwardY, forwardZ);
-
-        std::cout << "SoundSystem: Listener orientation set (Forward: (" << forwardX << ", " << forwardY << ", " << forwardZ << "))." << std::endl;
-    }
-
-    SOUNDSYSTEM_API bool IsSoundPlaying(const char* soundId) {
-        if (!soundId) {
-            return false;
-        }
-        std::string s_soundId = soundId;
-
-        auto it = g_loadedSounds.find(s_soundId);
-        if (it != g_loadedSounds.end()) {
-            return ma_sound_is_playing(it->second);
-        }
-        return false;
-    }
-
-} // extern "C"
+// --- SoundSystem.cpp ---
+// This file contains the implementation of the sound system functions
+// using the miniaudio library.
+
+// Define SOUNDSYSTEM_EXPORTS before including SoundSystem.h in the DLL project
+// so that functions are marked for export.
+#define SOUNDSYSTEM_EXPORTS
+
+#include "SoundSystem.h" // Include our own header for the API definition
+#include "SoundTable.h"  // Slab storage and the ID hash table for loaded sounds
+#include "SoundLog.h"    // Ring-buffered logging (SOUND_LOG_* macros)
+#include "LockFreeQueue.h" // The command queue between API callers and the audio thread
+#include "SoundLoader.h" // Loader threads for LoadSoundAsync
+#include "SoundCache.h"  // Decoded audio shared by sounds loaded from the same file
+#include "MappedFile.h"  // Memory-mapped pack files for LoadSoundFromPack and sound banks
+#include "SoundBankFormat.h" // The index at the start of a sound bank
+#include "MixKernels.h"   // SIMD loops for the mixing the sound system does itself
+#include "Convolver.h"    // Partitioned FFT convolution for reverb buses
+#include "Hrtf.h"         // HRTF filters and the renderer of binaural voices
+#include "EmitterStore.h" // Positions and spatialization of every sound and voice
+#include "VoiceMixer.h"   // Plays the voice pool into the buses with the mixing kernels
+#include <vector>        // For the free slot list
+#include <memory>        // For the voice pool
+#include <mutex>         // For the registry mutex
+#include <condition_variable> // For WaitForSound
+#include <chrono>        // For WaitForSound timeouts and callback timing
+#include <atomic>        // For the audio callback statistics
+#include <algorithm>     // For std::clamp
+#include <cstring>       // For strlen/memcmp when matching IDs
+#include <cmath>         // For distance attenuation when ranking voices
+
+// Miniaudio header. IMPORTANT: Define MA_NO_DECODER_WAV, MA_NO_DECODER_MP3, etc.
+// if you only want to support specific formats to reduce library size.
+// For broad support, just include it as is.
+#define MINIAUDIO_IMPLEMENTATION
+
+// Streamed sounds (SOUNDSYSTEM_LOAD_STREAM) keep two pages of decoded audio in memory and
+// refill one on miniaudio's resource manager job thread while the other plays. miniaudio's
+// default page is 1 second; 250 ms keeps a 48 kHz stereo stream at ~190 KB and makes a
+// track's cold start a single short page.
+#define MA_RESOURCE_MANAGER_PAGE_SIZE_IN_MILLISECONDS 250
+#include "miniaudio.h"
+
+// Global miniaudio engine instance. This manages the audio device and playback.
+static ma_engine g_engine;
+
+// True when the engine was initialized without a device (SOUNDSYSTEM_INIT_NO_DEVICE):
+// nothing drives the mixer and the caller pulls audio with ReadMixedFrames.
+static bool g_noDevice = false;
+
+// The playback device. StartSoundSystem creates it and hands it to ma_engine_init rather
+// than letting the engine open one, because ma_engine_config has no way to choose the
+// performance profile or the device's resampler. Unused in no-device mode.
+static ma_device g_device;
+
+// The configuration the sound system was started with, with every value replaced by the
+// one actually in effect. Reported by GetSoundSystemConfig.
+static SoundSystemConfig g_effectiveConfig;
+
+// Counts InitializeSoundSystem calls. Exports that drop g_registryMutex for a slow step
+// compare it afterwards to tell whether the system was shut down (and maybe started
+// again) in the meantime. Guarded by g_registryMutex.
+static uint64_t g_systemGeneration = 0;
+
+// Handle layout: the low 20 bits index into g_soundSlots and the high 12 bits hold
+// the slot's generation at the time the handle was issued.
+static const uint32_t kHandleIndexBits = 20;
+static const uint32_t kHandleIndexMask = (1u << kHandleIndexBits) - 1u;
+static const uint32_t kHandleGenerationMask = 0xFFFu;
+
+// Lifecycle of a slot. A slot is Loading from the moment its ID is registered until
+// its file has been decoded, which for LoadSoundAsync happens on a loader thread.
+enum class SlotState : uint8_t {
+    Free,
+    Loading,
+    Loaded,
+};
+
+// Where a virtual voice (see "Virtual voices") would be. While virtual, the sound is
+// stopped in the mixer and its position is derived from the engine clock when needed.
+struct VirtualPlayback {
+    bool active = false;        // Logically playing, but not mixed
+    ma_uint64 cursor = 0;       // Source frame the sound was at when it went virtual
+    ma_uint64 engineTime = 0;   // Engine time, in output frames, when it went virtual
+};
+
+// A sound's binaural renderer as a miniaudio node, between the sound and its bus. See
+// "Binaural voices".
+struct BinauralNode {
+    ma_node_base base;          // Must come first: miniaudio treats the node as an ma_node_base
+    HrtfRenderer renderer;
+};
+
+// Priority given to sounds until SetSoundPriority changes it.
+static const int kDefaultSoundPriority = 128;
+
+// One entry of the sound table. A slot is reused after its sound is unloaded;
+// its generation is bumped so handles issued for the old sound stop resolving.
+// The ma_sound is stored inline: slots live in a SlabArray, so its address never changes.
+struct SoundSlot {
+    ma_sound sound;             // Only initialized while the state is Loaded
+    ma_audio_buffer_ref source; // This sound's cursor over 'decoded' (unused for streamed and compressed sounds)
+    ma_decoder decoder;         // Decodes 'decoded' for compressed sounds
+    const SoundCache::Entry* decoded = nullptr; // Shared cached data, or nullptr for streamed sounds
+    SlotState state = SlotState::Free;
+    uint32_t index = 0;         // This slot's position in g_soundSlots
+    uint32_t generation = 1;    // Never 0, so a valid handle is never SOUNDSYSTEM_INVALID_HANDLE
+    uint32_t loadFlags = 0;     // SOUNDSYSTEM_LOAD_* flags the sound was loaded with
+    uint64_t idHash = 0;        // HashSoundId(id), kept so unloading doesn't rehash
+    std::string id;             // The string ID the sound was loaded under (used for logging and unloading)
+
+    // Voice limiting (see "Voice limits" below).
+    int priority = kDefaultSoundPriority; // Voices of lower-priority sounds are stolen first
+    uint32_t maxInstances = 0;  // Cap on this sound's playing voices; 0 means no cap
+    uint32_t voiceGroup = 0;    // Group whose limit this sound's voices count against
+    uint32_t bus = 0;           // Bus the sound and its instances play through (see "Buses"); 0 is Master
+    uint32_t activeVoices = 0;  // Playing voices: the sound itself plus its instances
+    bool playing = false;       // The sound's own ma_sound is playing, really or virtually
+    uint64_t startSequence = 0; // When the sound's own ma_sound was last started, for tie-breaking
+    VirtualPlayback virtualPlayback;
+    std::unique_ptr<BinauralNode> binaural; // Set while binaural rendering is on
+
+    // Spatialization (see "Emitters" below).
+    uint32_t emitter = EmitterStore::kNoEmitter; // Set while Loaded, unless memory ran out
+    float pan = 0.0f;           // As set by SetSoundPan, before the emitter's pan
+    float pitch = 1.0f;         // As set by SetSoundPitch, before the doppler shift
+
+    // Memory budget (see "Memory budget" below).
+    std::string sourcePath;     // File the PCM was decoded from; empty if it can't be decoded again
+    uint64_t lastUsed = 0;      // g_useClock when the sound was last loaded or played
+    bool pinned = false;        // Never evicted
+    bool evicted = false;       // PCM released; 'decoded' is nullptr and 'source' points at nothing
+    bool reloadRequested = false; // Waiting for SubmitRequestedReloadsLocked to start decoding it
+    bool reloading = false;     // A loader job is decoding the evicted PCM again
+    bool playOnReload = false;  // Start the sound when the reload finishes
+    bool loopOnReload = false;
+};
+
+// All sound slots, indexed by the low bits of a SoundHandle.
+static SlabArray<SoundSlot> g_soundSlots;
+
+// The emitters of loaded sounds and pool voices. See "Emitters".
+static EmitterStore g_emitters;
+
+// Indices of free slots in g_soundSlots, reused before the array grows.
+static std::vector<uint32_t> g_freeSlots;
+
+// Slots whose own ma_sound is playing (really or virtually), so finished ones can be
+// found without walking the whole sound table. AllocateSlot keeps its capacity at the
+// number of slots, so adding to it never allocates.
+static std::vector<uint32_t> g_playingSlots;
+
+// Hash table from string IDs to slot indices, used by the string-ID API.
+static SoundIdTable g_loadedSounds;
+
+// Guards g_soundSlots, g_freeSlots and g_loadedSounds. See "Command queue" below.
+static std::mutex g_registryMutex;
+
+// Signalled (with g_registryMutex) whenever a load finishes, for WaitForSound.
+static std::condition_variable g_loadFinished;
+
+// Builds the handle for the sound currently stored in the slot at 'index'.
+static SoundHandle MakeHandle(uint32_t index) {
+    return (g_soundSlots[index].generation << kHandleIndexBits) | index;
+}
+
+// Returns the slot a handle refers to, or nullptr if the handle is invalid or stale.
+static SoundSlot* ResolveHandle(SoundHandle handle) {
+    uint32_t index = handle & kHandleIndexMask;
+    uint32_t generation = handle >> kHandleIndexBits;
+    if (index >= g_soundSlots.Size()) {
+        return nullptr;
+    }
+    SoundSlot& slot = g_soundSlots[index];
+    if (slot.state != SlotState::Loaded || slot.generation != generation) {
+        return nullptr;
+    }
+    return &slot;
+}
+
+// Returns the slot index for a string ID whose hash has already been computed,
+// or -1 if no sound has that ID.
+static int64_t FindSlotIndex(const char* soundId, size_t length, uint64_t hash) {
+    uint32_t index = g_loadedSounds.Find(hash, [&](uint32_t candidate) {
+        const std::string& id = g_soundSlots[candidate].id;
+        return id.size() == length && std::memcmp(id.data(), soundId, length) == 0;
+    });
+    return index != SoundIdTable::kEmpty ? static_cast<int64_t>(index) : -1;
+}
+
+// Returns the slot index for a string ID, or -1 if no sound has that ID.
+static int64_t FindSlotIndex(const char* soundId) {
+    size_t length = std::strlen(soundId);
+    return FindSlotIndex(soundId, length, HashSoundId(soundId, length));
+}
+
+// Reserves a free slot (reusing one from the free list if possible) and returns its index,
+// or -1 if every index a handle can address is in use.
+static int64_t AllocateSlot() {
+    if (!g_freeSlots.empty()) {
+        uint32_t index = g_freeSlots.back();
+        g_freeSlots.pop_back();
+        return index;
+    }
+    // Every slot could be playing at once; make room now so tracking one never allocates
+    // in a command batch, which may run on the audio thread.
+    if (g_playingSlots.capacity() <= g_soundSlots.Size()) {
+        try {
+            g_playingSlots.reserve(std::max<size_t>(g_soundSlots.Size() + 1, g_playingSlots.capacity() * 2));
+        }
+        catch (const std::bad_alloc&) {
+            return -1;
+        }
+    }
+    SoundSlot* slot = g_soundSlots.Size() <= kHandleIndexMask ? g_soundSlots.EmplaceBack() : nullptr;
+    if (!slot) {
+        return -1;
+    }
+    slot->index = static_cast<uint32_t>(g_soundSlots.Size() - 1);
+    return slot->index;
+}
+
+// Removes the slot's ID and returns the slot to the free list. The sound must already
+// be uninitialized (or never have been initialized).
+static void FreeSlot(SoundSlot& slot) {
+    g_loadedSounds.Erase(slot.idHash, [&slot](uint32_t candidate) { return candidate == slot.index; });
+    slot.priority = kDefaultSoundPriority;
+    slot.maxInstances = 0;
+    slot.voiceGroup = 0;
+    slot.bus = 0;
+    slot.pan = 0.0f;
+    slot.pitch = 1.0f;
+    slot.state = SlotState::Free;
+    slot.id.clear();
+    slot.sourcePath.clear();
+    slot.loadFlags = 0;
+    slot.activeVoices = 0;
+    slot.playing = false;
+    slot.startSequence = 0;
+    slot.virtualPlayback = VirtualPlayback();
+    slot.lastUsed = 0;
+    slot.pinned = false;
+    slot.evicted = false;
+    slot.reloadRequested = false;
+    slot.reloading = false;
+    slot.playOnReload = false;
+    slot.loopOnReload = false;
+
+    // Advance the generation so outstanding handles to this slot become stale.
+    slot.generation = (slot.generation + 1) & kHandleGenerationMask;
+    if (slot.generation == 0) {
+        slot.generation = 1;
+    }
+    g_freeSlots.push_back(slot.index);
+}
+
+// --- Voice accounting ---
+// Every playing voice, whether a sound's own ma_sound (SndPlaySound) or an instance from
+// the voice pool (PlaySoundInstance), is counted against three limits: the global limit
+// (SetMaxVoices), its sound's limit (SetSoundMaxInstances) and its sound's voice group
+// limit (SetVoiceGroupLimit). The counters are kept up to date as voices start and stop,
+// so checking a limit is a comparison; only a voice that would exceed one pays for a
+// search of the playing voices (see "Voice limits").
+
+// Default for SetMaxVoices: enough for busy scenes while bounding the mixer's worst case.
+static const uint32_t kDefaultMaxVoices = 128;
+
+// Number of voice groups; SetSoundVoiceGroup takes 0 to kVoiceGroupCount - 1.
+static const uint32_t kVoiceGroupCount = 16;
+
+static uint32_t g_maxVoices = kDefaultMaxVoices;           // 0 means no global limit
+static uint32_t g_activeVoices = 0;
+static uint32_t g_voiceGroupLimits[kVoiceGroupCount] = {}; // 0 means no limit for the group
+static uint32_t g_voiceGroupActive[kVoiceGroupCount] = {};
+static uint64_t g_startSequence = 0;                       // Orders voice starts, oldest first
+static uint32_t g_virtualVoices = 0;                       // Playing but virtual; not in the counts above
+
+static void CountVoice(SoundSlot& slot) {
+    ++slot.activeVoices;
+    ++g_voiceGroupActive[slot.voiceGroup];
+    ++g_activeVoices;
+}
+
+static void UncountVoice(SoundSlot& slot) {
+    --slot.activeVoices;
+    --g_voiceGroupActive[slot.voiceGroup];
+    --g_activeVoices;
+}
+
+// Records that the slot's own ma_sound started playing, if it isn't already.
+static void TrackSlotPlaying(SoundSlot& slot) {
+    if (slot.playing) {
+        return;
+    }
+    slot.playing = true;
+    slot.startSequence = ++g_startSequence;
+    CountVoice(slot);
+    g_playingSlots.push_back(slot.index);
+    if (slot.emitter != EmitterStore::kNoEmitter) {
+        g_emitters.SetActive(slot.emitter, true);
+    }
+}
+
+// Records that the slot's own ma_sound stopped, paused or ended, real or virtual.
+static void UntrackSlotPlaying(SoundSlot& slot) {
+    if (!slot.playing) {
+        return;
+    }
+    slot.playing = false;
+    if (slot.virtualPlayback.active) {
+        slot.virtualPlayback.active = false;
+        --g_virtualVoices;
+    }
+    else {
+        UncountVoice(slot);
+    }
+    auto it = std::find(g_playingSlots.begin(), g_playingSlots.end(), slot.index);
+    if (it != g_playingSlots.end()) {
+        *it = g_playingSlots.back();
+        g_playingSlots.pop_back();
+    }
+    if (slot.emitter != EmitterStore::kNoEmitter) {
+        g_emitters.SetActive(slot.emitter, false);
+    }
+}
+
+// --- Voice pool ---
+// PlaySoundInstance plays sounds on voices: a fixed pool of them, played by g_voiceMixer
+// (VoiceMixer.h) rather than by miniaudio sounds. Each bus has a node that asks the mixer
+// for its voices once per block (see "Buses"), so the voices are read, resampled, panned
+// and summed by the mixing kernels instead of each going through its own engine node.
+// A voice reads a loaded sound's shared decoded PCM in place, whatever its sample format,
+// channel count or rate, so starting one only points it at the data. Compressed sounds
+// need a decoder, which is initialized (and allocated) when a voice plays a compressed sound
+// it didn't play last; it is kept until the voice plays another one. Voices go back to the
+// pool when they reach the end of their sound, when they are stopped, or when their sound
+// is unloaded.
+
+// How many instances can play at once.
+static const uint32_t kVoicePoolSize = 256;
+
+struct Voice {
+    ma_decoder decoder;         // Reads the sound being played if it is compressed
+    const SoundCache::Entry* boundEncoded = nullptr; // Compressed data 'decoder' reads, if any
+    bool playing = false;       // Taken from the pool; false while the voice is free
+    ma_uint32 sampleRate = 0;   // Of the sound being played
+    ma_uint64 length = 0;       // Frames in the sound being played; 0 if not known yet
+    uint32_t index = 0;         // This voice's position in g_voices and in g_voiceMixer
+    uint32_t generation = 1;    // Bumped on recycle so old VoiceHandles go stale
+    uint32_t soundIndex = 0;    // Slot of the sound being played
+    uint32_t bus = 0xFFFFFFFFu; // Bus the voice plays on
+    uint64_t startSequence = 0; // When the voice was started, for tie-breaking
+    VirtualPlayback virtualPlayback;
+    std::unique_ptr<HrtfRenderer> renderer; // Set for every voice while binaural rendering is on
+    uint32_t emitter = EmitterStore::kNoEmitter; // Added with the pool; active while playing
+    float volume = 1.0f;        // As given to PlaySoundInstance or SetVoiceVolume
+    float pan = 0.0f;           // As set by SetVoicePan
+    float pitch = 1.0f;         // As given to PlaySoundInstance or SetVoicePitch
+};
+
+// The pool, allocated by InitializeSoundSystem. Guarded by g_registryMutex.
+static std::unique_ptr<Voice[]> g_voices;
+
+// Plays the pool's voices, indexed like g_voices. Initialized with the engine. Its control
+// side is called with g_registryMutex held; the bus nodes mix from it on the audio thread.
+static VoiceMixer g_voiceMixer;
+
+// Indices of free voices. Reserved to kVoicePoolSize up front so pushes never allocate.
+static std::vector<uint32_t> g_freeVoices;
+
+static VoiceHandle MakeVoiceHandle(const Voice& voice) {
+    return (voice.generation << kHandleIndexBits) | voice.index;
+}
+
+// Returns the voice a handle refers to, or nullptr if it has finished or the handle is invalid.
+static Voice* ResolveVoice(VoiceHandle handle) {
+    uint32_t index = handle & kHandleIndexMask;
+    if (!g_voices || index >= kVoicePoolSize) {
+        return nullptr;
+    }
+    Voice& voice = g_voices[index];
+    if (!voice.playing || voice.generation != (handle >> kHandleIndexBits)) {
+        return nullptr;
+    }
+    return &voice;
+}
+
+// Stops a voice and returns it to the pool. A decoder it has stays initialized for reuse.
+static void RecycleVoice(Voice& voice) {
+    g_voiceMixer.Stop(voice.index);
+    voice.playing = false;
+    g_emitters.SetActive(voice.emitter, false);
+    if (voice.virtualPlayback.active) {
+        voice.virtualPlayback.active = false;
+        --g_virtualVoices;
+    }
+    else {
+        UncountVoice(g_soundSlots[voice.soundIndex]);
+    }
+    voice.generation = (voice.generation + 1) & kHandleGenerationMask;
+    if (voice.generation == 0) {
+        voice.generation = 1;
+    }
+    g_freeVoices.push_back(voice.index);
+}
+
+// Initializes a cursor over cached data: a buffer ref over decoded PCM, or a decoder over the
+// bytes of a compressed sound. 'source' receives whichever one the ma_sound should read.
+static ma_result InitSharedSource(const SoundCache::Entry& data, ma_audio_buffer_ref& buffer, ma_decoder& decoder, ma_data_source*& source) {
+    if (data.encoded) {
+        // Decode to the format the cache probed at load, so every decoder of a file agrees.
+        ma_decoder_config decoderConfig = ma_decoder_config_init(data.format, data.channels, data.sampleRate);
+        ma_result result = ma_decoder_init_memory(data.encoded, data.sizeInBytes, &decoderConfig, &decoder);
+        source = &decoder;
+        return result;
+    }
+    ma_result result = ma_audio_buffer_ref_init(data.format, data.channels, data.frames, data.frameCount, &buffer);
+    if (result == MA_SUCCESS) {
+        // ma_audio_buffer_ref_init has no sample rate parameter; without one the engine would
+        // assume the data is already at its own rate.
+        buffer.sampleRate = data.sampleRate;
+    }
+    source = &buffer;
+    return result;
+}
+
+static void UninitSharedSource(const SoundCache::Entry& data, ma_audio_buffer_ref& buffer, ma_decoder& decoder) {
+    if (data.encoded) {
+        ma_decoder_uninit(&decoder);
+    }
+    else {
+        ma_audio_buffer_ref_uninit(&buffer);
+    }
+}
+
+// Frees the decoder of a free voice that last played a compressed sound, so it holds no
+// pointer into cached data.
+static void UnbindVoice(Voice& voice) {
+    if (voice.boundEncoded) {
+        ma_decoder_uninit(&voice.decoder);
+        voice.boundEncoded = nullptr;
+    }
+}
+
+// Stops every instance of the sound in the slot at 'soundIndex', before its data is released.
+static void StopVoicesOfSlot(uint32_t soundIndex) {
+    if (!g_voices) {
+        return;
+    }
+    for (uint32_t i = 0; i < kVoicePoolSize; ++i) {
+        Voice& voice = g_voices[i];
+        if (voice.soundIndex != soundIndex) {
+            continue;
+        }
+        if (voice.playing) {
+            RecycleVoice(voice);
+        }
+        // A decoder keeps pointing at the compressed bytes after its voice is freed.
+        UnbindVoice(voice);
+    }
+}
+
+// The mixer reads compressed sounds through these, on the audio thread.
+static uint64_t ReadVoiceDecoder(void* user, float* out, uint64_t frames) {
+    ma_uint64 read = 0;
+    ma_decoder_read_pcm_frames(static_cast<ma_decoder*>(user), out, frames, &read);
+    return read;
+}
+
+static void SeekVoiceDecoder(void* user, uint64_t frame) {
+    ma_decoder_seek_to_pcm_frame(static_cast<ma_decoder*>(user), frame);
+}
+
+// Points a free voice at the slot's cached data and describes it for the mixer in 'source'.
+// Decoded PCM is read in place; a compressed sound needs a decoder of its own unless the
+// voice last played it.
+static ma_result BindVoice(Voice& voice, const SoundCache::Entry& decoded, VoiceMixer::Source& source) {
+    if (decoded.format != ma_format_f32 || decoded.channels == 0 || decoded.channels > VoiceMixer::kMaxChannels) {
+        return MA_FORMAT_NOT_SUPPORTED; // The cache decodes to float; only the channel count can be out of range
+    }
+    if (decoded.encoded) {
+        if (voice.boundEncoded != &decoded) {
+            UnbindVoice(voice);
+            ma_decoder_config decoderConfig = ma_decoder_config_init(decoded.format, decoded.channels, decoded.sampleRate);
+            ma_result result = ma_decoder_init_memory(decoded.encoded, decoded.sizeInBytes, &decoderConfig, &voice.decoder);
+            if (result != MA_SUCCESS) {
+                return result;
+            }
+            voice.boundEncoded = &decoded;
+        }
+        // The mixer seeks back to the start, which rewinds a reused decoder too.
+        source.read = ReadVoiceDecoder;
+        source.seek = SeekVoiceDecoder;
+        source.user = &voice.decoder;
+    }
+    else {
+        source.frames = static_cast<const float*>(decoded.frames);
+    }
+    source.frameCount = decoded.frameCount;
+    source.channels = decoded.channels;
+    source.sampleRate = decoded.sampleRate;
+    voice.sampleRate = decoded.sampleRate;
+    voice.length = decoded.frameCount;
+    return MA_SUCCESS;
+}
+
+// --- Emitters ---
+// Sounds are placed by the sound system rather than by miniaudio. Every loaded sound and
+// every pool voice has an emitter in g_emitters (EmitterStore.h) holding its position,
+// velocity, distance range and rolloff, one array per field, and every ma_sound has
+// miniaudio's spatialization turned off. Once a block, after the command batch, a single
+// vectorized pass (MixKernels::spatialize) works out the distance attenuation, pan gains
+// and doppler factor of every playing sound and instance relative to the listener. A
+// sound's are applied as the gain of its output bus, which miniaudio keeps apart from the
+// volume SetSoundVolume sets inside the sound, its balance and a factor on its pitch. An
+// instance's go to the voice mixer as its two side gains and its pitch. miniaudio would
+// otherwise work all of that out sound by sound in every callback, from state spread over
+// the sounds' own objects.
+//
+// The pan and pitch set with SetSoundPan and SetSoundPitch (or their voice versions) are
+// kept in the slot or voice and combined with the emitter's. An instance starts with its
+// sound's emitter and moves on its own after. A sound that starts or resumes is
+// spatialized by itself first, so its first block isn't mixed with what its emitter said
+// when it last played.
+
+// Speed of sound for the doppler shift, in position units per second: metres in air.
+static const float kSpeedOfSound = 343.3f;
+
+static float g_dopplerFactor = 1.0f; // 0 turns the doppler shift off
+
+// The listener's axes in world space, from its direction and the world's up: right and
+// up are perpendicular to forward, all three unit length.
+static void GetListenerAxes(ma_vec3f& right, ma_vec3f& up, ma_vec3f& forward) {
+    forward = ma_engine_listener_get_direction(&g_engine, 0);
+    ma_vec3f worldUp = ma_engine_listener_get_world_up(&g_engine, 0);
+    float length = std::sqrt(forward.x * forward.x + forward.y * forward.y + forward.z * forward.z);
+    if (length < 1e-6f) {
+        forward = { 0.0f, 0.0f, -1.0f };
+        length = 1.0f;
+    }
+    forward = { forward.x / length, forward.y / length, forward.z / length };
+    // Right is forward x up; looking straight along the world's up, any right will do.
+    right = { forward.y * worldUp.z - forward.z * worldUp.y, forward.z * worldUp.x - forward.x * worldUp.z,
+              forward.x * worldUp.y - forward.y * worldUp.x };
+    length = std::sqrt(right.x * right.x + right.y * right.y + right.z * right.z);
+    right = length < 1e-6f ? ma_vec3f{ 1.0f, 0.0f, 0.0f } : ma_vec3f{ right.x / length, right.y / length, right.z / length };
+    up = { right.y * forward.z - right.z * forward.y, right.z * forward.x - right.x * forward.z,
+           right.x * forward.y - right.y * forward.x };
+}
+
+// The listener as MixKernels::spatialize takes it: miniaudio's listener 0, which the
+// listener setters still keep.
+static MixKernels::ListenerFrame CurrentListener() {
+    MixKernels::ListenerFrame listener;
+    ma_vec3f position = ma_engine_listener_get_position(&g_engine, 0);
+    ma_vec3f velocity = ma_engine_listener_get_velocity(&g_engine, 0);
+    ma_vec3f right, up, forward;
+    GetListenerAxes(right, up, forward);
+    listener.position[0] = position.x;
+    listener.position[1] = position.y;
+    listener.position[2] = position.z;
+    listener.right[0] = right.x;
+    listener.right[1] = right.y;
+    listener.right[2] = right.z;
+    listener.velocity[0] = velocity.x;
+    listener.velocity[1] = velocity.y;
+    listener.velocity[2] = velocity.z;
+    listener.speedOfSound = kSpeedOfSound;
+    listener.dopplerFactor = g_dopplerFactor;
+    return listener;
+}
+
+// Applies the latest results of a slot's emitter to its sound, together with its own pan
+// and pitch. The emitter's pan gains and the balance of the sound's pan are multiplied per
+// side and played as one output gain and one balance, which reproduces any pair of side
+// gains exactly. Binaural sounds are placed by their renderer, which also takes the
+// attenuation (see SteerBinaural), so they only get the doppler shift here.
+static void ApplyEmitter(SoundSlot& owner) {
+    ma_sound* pSound = &owner.sound;
+    if (owner.emitter == EmitterStore::kNoEmitter) {
+        // Out of memory when it was loaded: miniaudio still spatializes it.
+        ma_sound_set_pitch(pSound, owner.pitch);
+        ma_sound_set_pan(pSound, owner.pan);
+        return;
+    }
+    ma_sound_set_pitch(pSound, owner.pitch * g_emitters.Doppler(owner.emitter));
+    if (owner.binaural) {
+        ma_node_set_output_bus_volume(pSound, 0, 1.0f);
+        ma_sound_set_pan(pSound, owner.pan);
+        return;
+    }
+    float left = g_emitters.GainLeft(owner.emitter) * (owner.pan > 0.0f ? 1.0f - owner.pan : 1.0f);
+    float right = g_emitters.GainRight(owner.emitter) * (owner.pan < 0.0f ? 1.0f + owner.pan : 1.0f);
+    float peak = std::max(left, right);
+    float balance = 0.0f;
+    if (peak > 0.0f) {
+        balance = right >= left ? 1.0f - left / peak : right / peak - 1.0f;
+    }
+    ma_node_set_output_bus_volume(pSound, 0, peak);
+    ma_sound_set_pan(pSound, balance);
+}
+
+// As above for a pool voice, whose side gains, volume included, and pitch go to the mixer
+// as they are. Voices always have an emitter.
+static void ApplyEmitter(Voice& voice) {
+    float left = voice.pan > 0.0f ? 1.0f - voice.pan : 1.0f;
+    float right = voice.pan < 0.0f ? 1.0f + voice.pan : 1.0f;
+    if (!voice.renderer) {
+        left *= g_emitters.GainLeft(voice.emitter);
+        right *= g_emitters.GainRight(voice.emitter);
+    }
+    g_voiceMixer.SetGains(voice.index, voice.volume * left, voice.volume * right);
+    g_voiceMixer.SetPitch(voice.index, voice.pitch * g_emitters.Doppler(voice.emitter));
+}
+
+// Spatializes one sound or voice by itself and applies the result, for one about to start.
+template <typename Owner>
+static void SpatializeNow(Owner& owner) {
+    if (owner.emitter != EmitterStore::kNoEmitter) {
+        g_emitters.UpdateOne(owner.emitter, CurrentListener());
+        ApplyEmitter(owner);
+    }
+}
+
+// Spatializes every playing sound and instance in one pass and applies the results, after
+// a batch may have moved them or the listener. Virtual ones are included: their results
+// are in place if they become real again. Called with g_registryMutex held.
+static void UpdateEmittersLocked() {
+    g_emitters.Update(CurrentListener());
+    for (uint32_t index : g_playingSlots) {
+        ApplyEmitter(g_soundSlots[index]);
+    }
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        if (g_voices[i].playing) {
+            ApplyEmitter(g_voices[i]);
+        }
+    }
+}
+
+// --- Buses ---
+// Every sound plays through a bus: a miniaudio sound group that mixes the sounds and buses
+// attached to it and applies one volume to the sum, so changing a whole category is one
+// gain in the mixer instead of an update per voice. Buses form a tree under Master, which
+// feeds the engine's endpoint; InitializeSoundSystem creates Master with Music, SFX and
+// Voice under it, and CreateBus adds more. Sounds start on Master. A sound's instances play
+// on the sound's bus, and move with it when it is reassigned: each bus has a VoiceBusNode
+// attached to its group that mixes the pool voices on it (see "Voice pool"). Pausing a bus
+// stops its sound group, which stops pulling audio from everything under it, its voice node
+// included, so those sounds hold their place until the bus resumes.
+//
+// A reverb bus (CreateReverbBus) passes its mix through a convolution node on the way to
+// its parent, so everything reaching it comes out as reverb only. Other buses send to one
+// with SetBusSend: a splitter node after the bus's group feeds the parent as before and
+// the reverb bus at the send level, so any number of sounds share one convolution instead
+// of each carrying its own. The chain from a bus to its parent is therefore
+// group -> reverb node (reverb buses) or group -> splitter (buses with a send).
+
+static const uint32_t kMaxBuses = 64;
+static const uint32_t kNoBus = 0xFFFFFFFFu;
+static const uint32_t kMasterBus = 0;
+
+// Partition length of reverb buses' convolution, which is also the delay it adds to the
+// reverb: 5.3 ms at 48 kHz. Longer IRs cost little more (see Convolver.h).
+static const uint32_t kReverbBlockFrames = 256;
+
+// Longest impulse response a reverb bus takes; the rest is cut off. Bounds the memory a
+// stray music file passed as an IR can take (about 3 MB per second of stereo IR).
+static const uint32_t kMaxImpulseSeconds = 20;
+
+// A miniaudio node that convolves its input with an impulse response.
+struct ReverbNode {
+    ma_node_base base;          // Must come first: miniaudio treats the node as an ma_node_base
+    Convolver convolver;
+};
+
+static void OnReverbProcess(ma_node* pNode, const float** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut) {
+    (void)pFrameCountIn; // One frame out per frame in
+    ReverbNode* reverb = static_cast<ReverbNode*>(pNode);
+    ma_uint32 frameCount = *pFrameCountOut;
+    const float* input = ppFramesIn ? ppFramesIn[0] : NULL;
+    if (!input) {
+        // Nothing is attached, but the tail keeps ringing out.
+        std::memset(ppFramesOut[0], 0, sizeof(float) * frameCount * reverb->convolver.Channels());
+        input = ppFramesOut[0];
+    }
+    reverb->convolver.Process(input, ppFramesOut[0], frameCount);
+}
+
+// Processed even with nothing attached, so a reverb's tail isn't cut off when its last
+// send goes quiet or is removed.
+static ma_node_vtable g_reverbNodeVTable = {
+    OnReverbProcess,
+    NULL,
+    1, // One input bus
+    1, // One output bus
+    MA_NODE_FLAG_CONTINUOUS_PROCESSING | MA_NODE_FLAG_ALLOW_NULL_INPUT
+};
+
+// A miniaudio node with no inputs that plays the pool voices on one bus into its group.
+struct VoiceBusNode {
+    ma_node_base base;          // Must come first: miniaudio treats the node as an ma_node_base
+    uint32_t bus = 0;
+};
+
+static void OnVoiceBusProcess(ma_node* pNode, const float** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut) {
+    (void)ppFramesIn;
+    (void)pFrameCountIn; // No inputs
+    ma_uint32 frameCount = *pFrameCountOut;
+    std::memset(ppFramesOut[0], 0, sizeof(float) * frameCount * g_voiceMixer.Channels());
+    g_voiceMixer.Mix(static_cast<VoiceBusNode*>(pNode)->bus, ppFramesOut[0], frameCount);
+}
+
+static ma_node_vtable g_voiceBusNodeVTable = {
+    OnVoiceBusProcess,
+    NULL,
+    0, // No input buses
+    1, // One output bus
+    0
+};
+
+struct Bus {
+    ma_sound_group group;       // Only initialized while 'inUse' is set
+    std::unique_ptr<VoiceBusNode> voices; // Feeds 'group'; set while 'inUse' is set
+    std::string name;
+    uint32_t parent = kNoBus;   // kNoBus for Master
+    float volume = 1.0f;        // The bus's own volume, before its parents'
+    bool paused = false;
+    bool inUse = false;
+    std::unique_ptr<ReverbNode> reverb;        // Set for reverb buses
+    std::unique_ptr<ma_splitter_node> sendSplitter; // Set while the bus sends to a reverb bus
+    uint32_t sendTarget = kNoBus;
+    float sendLevel = 0.0f;
+};
+
+// Allocated by InitializeSoundSystem, so the groups never move. Guarded by g_registryMutex,
+// except that Master is read without it by loads initializing their sounds: it exists from
+// initialization to shutdown and is never reassigned.
+static std::unique_ptr<Bus[]> g_buses;
+
+// Returns the index of the bus called 'name', or -1. Buses are few, so this is a linear scan.
+static int64_t FindBus(const char* name) {
+    for (uint32_t i = 0; g_buses && i < kMaxBuses; ++i) {
+        if (g_buses[i].inUse && g_buses[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static ma_sound_group* BusGroup(uint32_t bus) {
+    return &g_buses[bus].group;
+}
+
+// The last node of a bus's chain, the one attached to its parent's group.
+static ma_node* BusOutput(uint32_t bus) {
+    Bus& entry = g_buses[bus];
+    if (entry.sendSplitter) {
+        return entry.sendSplitter.get();
+    }
+    if (entry.reverb) {
+        return &entry.reverb->base;
+    }
+    return &entry.group;
+}
+
+// The gain a bus applies to its sounds: its volume times that of every bus above it.
+// Pausing doesn't count, so sounds on a paused bus keep their place under the voice limits.
+static float BusGain(uint32_t bus) {
+    float gain = 1.0f;
+    for (; bus != kNoBus; bus = g_buses[bus].parent) {
+        gain *= g_buses[bus].volume;
+    }
+    return gain;
+}
+
+// The node a sound reaches its bus through: its binaural node if it has one (see "Binaural
+// voices"), otherwise the sound itself.
+static ma_node* SoundOutput(ma_sound* pSound, const std::unique_ptr<BinauralNode>& binaural) {
+    return binaural ? static_cast<ma_node*>(&binaural->base) : static_cast<ma_node*>(pSound);
+}
+
+// Moves a playing voice to 'bus'; the bus's node mixes it from its next block.
+static void RouteVoice(Voice& voice, uint32_t bus) {
+    voice.bus = bus;
+    g_voiceMixer.SetBus(voice.index, bus);
+}
+
+// Moves a loaded sound and its playing instances to 'bus'.
+static void MoveSlotToBus(SoundSlot& slot, uint32_t bus) {
+    slot.bus = bus;
+    ma_node_attach_output_bus(SoundOutput(&slot.sound, slot.binaural), 0, BusGroup(bus), 0);
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        Voice& voice = g_voices[i];
+        if (voice.playing && voice.soundIndex == slot.index) {
+            RouteVoice(voice, bus);
+        }
+    }
+}
+
+// Creates a bus under 'parent' in a free entry. With 'reverb' (already holding its
+// impulse response) it becomes a reverb bus and takes ownership of it. Called with
+// g_registryMutex held.
+static bool CreateBusLocked(const char* name, uint32_t parent, std::unique_ptr<ReverbNode> reverb = nullptr) {
+    for (uint32_t i = 0; i < kMaxBuses; ++i) {
+        Bus& bus = g_buses[i];
+        if (bus.inUse) {
+            continue;
+        }
+        std::unique_ptr<VoiceBusNode> voices(new (std::nothrow) VoiceBusNode());
+        if (!voices) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Out of memory creating bus '%s'.", name);
+            return false;
+        }
+        ma_sound_group* parentGroup = parent == kNoBus ? NULL : BusGroup(parent);
+        ma_result result = ma_sound_group_init(&g_engine, 0, parentGroup, &bus.group);
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to create bus '%s'. Result: %d", name, result);
+            return false;
+        }
+        ma_uint32 channels = ma_engine_get_channels(&g_engine);
+        ma_node_config voiceConfig = ma_node_config_init();
+        voiceConfig.vtable = &g_voiceBusNodeVTable;
+        voiceConfig.pOutputChannels = &channels;
+        result = ma_node_init(ma_engine_get_node_graph(&g_engine), &voiceConfig, NULL, &voices->base);
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to create the voice mixer of bus '%s'. Result: %d", name, result);
+            ma_sound_group_uninit(&bus.group);
+            return false;
+        }
+        voices->bus = i;
+        ma_node_attach_output_bus(&voices->base, 0, &bus.group, 0);
+        if (reverb) {
+            ma_node_config nodeConfig = ma_node_config_init();
+            nodeConfig.vtable = &g_reverbNodeVTable;
+            nodeConfig.pInputChannels = &channels;
+            nodeConfig.pOutputChannels = &channels;
+            result = ma_node_init(ma_engine_get_node_graph(&g_engine), &nodeConfig, NULL, &reverb->base);
+            if (result != MA_SUCCESS) {
+                SOUND_LOG_ERROR("SoundSystem ERROR: Failed to create the reverb of bus '%s'. Result: %d", name, result);
+                ma_node_uninit(&voices->base, NULL);
+                ma_sound_group_uninit(&bus.group);
+                return false;
+            }
+            // Connect the reverb to the parent before putting it after the group, so the
+            // group's output is never left hanging.
+            ma_node_attach_output_bus(&reverb->base, 0, parentGroup, 0);
+            ma_node_attach_output_bus(&bus.group, 0, &reverb->base, 0);
+            bus.reverb = std::move(reverb);
+        }
+        ma_sound_group_start(&bus.group);
+        bus.voices = std::move(voices);
+        bus.name = name;
+        bus.parent = parent;
+        bus.volume = 1.0f;
+        bus.paused = false;
+        bus.inUse = true;
+        SOUND_LOG_DEBUG("SoundSystem: Created bus '%s' under '%s'.", name, parent == kNoBus ? "the endpoint" : g_buses[parent].name.c_str());
+        return true;
+    }
+    SOUND_LOG_ERROR("SoundSystem ERROR: Can't create bus '%s'; all %u buses are in use.", name, kMaxBuses);
+    return false;
+}
+
+// Stops a bus sending to a reverb bus, joining its group straight to its parent again.
+// Called with g_registryMutex held.
+static void RemoveBusSendLocked(uint32_t index) {
+    Bus& bus = g_buses[index];
+    if (!bus.sendSplitter) {
+        return;
+    }
+    ma_node_attach_output_bus(&bus.group, 0, BusGroup(bus.parent), 0);
+    ma_splitter_node_uninit(bus.sendSplitter.get(), NULL);
+    bus.sendSplitter.reset();
+    bus.sendTarget = kNoBus;
+    bus.sendLevel = 0.0f;
+}
+
+// Whether the output of bus 'from' reaches bus 'to', following parents and sends. Called
+// with g_registryMutex held.
+static bool BusReaches(uint32_t from, uint32_t to) {
+    static_assert(kMaxBuses <= 64, "Visited buses are kept in one 64-bit mask");
+    uint32_t pending[kMaxBuses]; // Each bus is pushed at most once
+    uint32_t count = 0;
+    uint64_t visited = 1ull << from;
+    pending[count++] = from;
+    while (count > 0) {
+        uint32_t bus = pending[--count];
+        if (bus == to) {
+            return true;
+        }
+        for (uint32_t next : { g_buses[bus].parent, g_buses[bus].sendTarget }) {
+            if (next != kNoBus && !(visited & (1ull << next))) {
+                visited |= 1ull << next;
+                pending[count++] = next;
+            }
+        }
+    }
+    return false;
+}
+
+// Sends bus 'index' to reverb bus 'target' at 'level', adding the splitter if the bus
+// doesn't send yet. Called with g_registryMutex held; the caller has checked that the
+// send can't feed back into itself.
+static bool SetBusSendLocked(uint32_t index, uint32_t target, float level) {
+    Bus& bus = g_buses[index];
+    if (!bus.sendSplitter) {
+        std::unique_ptr<ma_splitter_node> splitter(new (std::nothrow) ma_splitter_node());
+        if (!splitter) {
+            return false;
+        }
+        ma_splitter_node_config splitterConfig = ma_splitter_node_config_init(ma_engine_get_channels(&g_engine));
+        ma_result result = ma_splitter_node_init(ma_engine_get_node_graph(&g_engine), &splitterConfig, NULL, splitter.get());
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to create the send of bus '%s'. Result: %d", bus.name.c_str(), result);
+            return false;
+        }
+        // Output 0 carries on to the parent; output 1 is the send.
+        ma_node_attach_output_bus(splitter.get(), 0, BusGroup(bus.parent), 0);
+        ma_node_attach_output_bus(&bus.group, 0, splitter.get(), 0);
+        bus.sendSplitter = std::move(splitter);
+    }
+    ma_node_set_output_bus_volume(bus.sendSplitter.get(), 1, level);
+    if (bus.sendTarget != target) {
+        ma_node_attach_output_bus(bus.sendSplitter.get(), 1, BusGroup(target), 0);
+        bus.sendTarget = target;
+    }
+    bus.sendLevel = level;
+    return true;
+}
+
+// Uninitializes a bus's nodes, upstream first. Called with g_registryMutex held.
+static void UninitBusNodes(Bus& bus) {
+    if (bus.voices) {
+        ma_node_uninit(&bus.voices->base, NULL);
+        bus.voices.reset();
+    }
+    ma_sound_group_uninit(&bus.group); // Detaches it from its parent and children
+    if (bus.reverb) {
+        ma_node_uninit(&bus.reverb->base, NULL);
+        bus.reverb.reset();
+    }
+    if (bus.sendSplitter) {
+        ma_splitter_node_uninit(bus.sendSplitter.get(), NULL);
+        bus.sendSplitter.reset();
+    }
+    bus.sendTarget = kNoBus;
+    bus.sendLevel = 0.0f;
+}
+
+// Removes a bus other than Master. Its sounds and child buses move to its parent, and sends
+// to it are removed. Called with g_registryMutex held.
+static void DestroyBusLocked(uint32_t index) {
+    Bus& bus = g_buses[index];
+    for (uint32_t i = 0; i < kMaxBuses; ++i) {
+        if (!g_buses[i].inUse) {
+            continue;
+        }
+        if (g_buses[i].sendTarget == index) {
+            RemoveBusSendLocked(i);
+        }
+        if (g_buses[i].parent == index) {
+            ma_node_attach_output_bus(BusOutput(i), 0, BusGroup(bus.parent), 0);
+            g_buses[i].parent = bus.parent;
+        }
+    }
+    g_soundSlots.ForEach([&](SoundSlot& slot) {
+        if (slot.state == SlotState::Loaded && slot.bus == index) {
+            MoveSlotToBus(slot, bus.parent);
+        }
+    });
+    UninitBusNodes(bus);
+    SOUND_LOG_INFO("SoundSystem: Destroyed bus '%s'.", bus.name.c_str());
+    bus.name.clear();
+    bus.inUse = false;
+}
+
+// Reads a loaded sound's whole PCM as interleaved float at 'engineRate', for use as an
+// impulse response. The caller holds a reference to 'data'; g_registryMutex needn't be
+// held, and isn't, since long IRs take a while to decode and resample.
+static ma_result ReadImpulseResponse(const SoundCache::Entry& data, ma_uint32 engineRate, std::vector<float>& frames, ma_uint32& channels) {
+    ma_audio_buffer_ref buffer;
+    ma_decoder decoder;
+    ma_data_source* source = NULL;
+    ma_result result = InitSharedSource(data, buffer, decoder, source);
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+    channels = data.channels;
+    const ma_uint64 maxFrames = static_cast<ma_uint64>(kMaxImpulseSeconds) * data.sampleRate;
+    const ma_uint64 kChunkFrames = 4096;
+    ma_uint64 total = 0;
+    frames.clear();
+    while (total < maxFrames) {
+        frames.resize(static_cast<size_t>((total + kChunkFrames) * channels));
+        ma_uint64 read = 0;
+        result = ma_data_source_read_pcm_frames(source, &frames[static_cast<size_t>(total * channels)], kChunkFrames, &read);
+        total += read;
+        if (read < kChunkFrames || result != MA_SUCCESS) {
+            break;
+        }
+    }
+    UninitSharedSource(data, buffer, decoder);
+    if (total >= maxFrames) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Impulse response cut off at %u seconds.", kMaxImpulseSeconds);
+        total = maxFrames;
+    }
+    frames.resize(static_cast<size_t>(total * channels));
+    if (total == 0) {
+        return MA_INVALID_DATA;
+    }
+
+    if (data.sampleRate == engineRate) {
+        return MA_SUCCESS;
+    }
+    ma_resampler_config resamplerConfig = ma_resampler_config_init(ma_format_f32, channels, data.sampleRate, engineRate, ma_resample_algorithm_linear);
+    ma_resampler resampler;
+    result = ma_resampler_init(&resamplerConfig, NULL, &resampler);
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+    ma_uint64 outFrames = 0;
+    ma_resampler_get_expected_output_frame_count(&resampler, total, &outFrames);
+    std::vector<float> converted(static_cast<size_t>(outFrames * channels));
+    ma_uint64 inFrames = total;
+    result = ma_resampler_process_pcm_frames(&resampler, frames.data(), &inFrames, converted.data(), &outFrames);
+    ma_resampler_uninit(&resampler, NULL);
+    converted.resize(static_cast<size_t>(outFrames * channels));
+    frames.swap(converted);
+    return result == MA_SUCCESS && outFrames > 0 ? MA_SUCCESS : MA_INVALID_DATA;
+}
+
+// Creates Master and the default buses under it. Called by InitializeSoundSystem once the
+// engine exists.
+static bool StartBuses() {
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    g_buses.reset(new (std::nothrow) Bus[kMaxBuses]);
+    if (!g_buses || !CreateBusLocked("Master", kNoBus)) {
+        g_buses.reset();
+        return false;
+    }
+    for (const char* name : { "Music", "SFX", "Voice" }) {
+        CreateBusLocked(name, kMasterBus);
+    }
+    return true;
+}
+
+// Uninitializes every bus. Called by ShutdownSoundSystem once no sound is attached to one.
+static void StopBuses() {
+    for (uint32_t i = kMaxBuses; g_buses && i-- > 0;) {
+        if (g_buses[i].inUse) {
+            UninitBusNodes(g_buses[i]);
+        }
+    }
+    g_buses.reset();
+}
+
+// --- Binaural voices ---
+// With an HRTF loaded (LoadHrtf) and binaural rendering on (SetBinauralEnabled), sounds and
+// voices are placed around the listener with head-related transfer functions instead of
+// miniaudio's panner: over headphones they can then be heard in front, behind, above or
+// below, not only to the left or right. Each sound gets a BinauralNode between its ma_sound
+// and its bus, and each pool voice a renderer the voice mixer runs it through. The renderer
+// filters the sound, downmixed to mono, with the filter pair of its direction and applies
+// its emitter's distance attenuation (see Hrtf.h).
+//
+// The block's update works out where every playing sound is relative to the listener and
+// passes the direction and distance gain to its renderer, which crossfades to a new
+// direction over one chunk. Filters are blended on the audio thread the first time a sound
+// points into a 5 degree bucket and cached, so still sounds and sounds that circle through
+// the same directions don't blend again. Sounds beyond the binaural distance
+// (SetBinauralLodDistance) are only panned, which costs a small fraction of filtering, and
+// a sound at the listener's position is passed through as it is.
+//
+// Nodes are created when binaural rendering is turned on or a sound is loaded while it is
+// on, and freed when it is turned off. Turning it on also gives every voice in the pool a
+// renderer, so playing an instance never has to create one; a voice keeps its renderer
+// across the sounds it plays.
+
+static std::unique_ptr<Hrtf> g_hrtf;        // Loaded by LoadHrtf, at the engine's rate
+static bool g_binauralEnabled = false;
+
+// Distance from the listener beyond which binaural sounds are panned instead of filtered,
+// in the units of SetSoundPosition. 0 filters sounds at any distance.
+static const float kDefaultBinauralLodDistance = 30.0f;
+static float g_binauralLodDistance = kDefaultBinauralLodDistance;
+
+// A panned sound goes back to the filters only once it is this much closer than the
+// binaural distance, so one hovering around it doesn't switch back and forth.
+static const float kBinauralLodHysteresis = 0.9f;
+
+// Closer than this, a sound is at the listener's position and has no direction.
+static const float kBinauralMinDistance = 1e-3f;
+
+static void OnBinauralProcess(ma_node* pNode, const float** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut) {
+    (void)pFrameCountIn; // One frame out per frame in
+    static_cast<BinauralNode*>(pNode)->renderer.Process(ppFramesIn[0], ppFramesOut[0], *pFrameCountOut);
+}
+
+static ma_node_vtable g_binauralNodeVTable = {
+    OnBinauralProcess,
+    NULL,
+    1, // One input bus
+    1, // One output bus
+    0
+};
+
+// Tells a binaural sound's renderer where its emitter is as of now: its direction from the
+// listener, in the listener's own frame, and its distance attenuation.
+static void SteerBinaural(uint32_t emitter, HrtfRenderer& renderer) {
+    if (emitter == EmitterStore::kNoEmitter) {
+        renderer.SetTarget(HrtfRenderer::Mode::Direct, 0, 0.0f, 1.0f);
+        return;
+    }
+    ma_vec3f position;
+    g_emitters.GetPosition(emitter, position.x, position.y, position.z);
+    ma_vec3f listener = ma_engine_listener_get_position(&g_engine, 0);
+    ma_vec3f right, up, forward;
+    GetListenerAxes(right, up, forward);
+    float dx = position.x - listener.x;
+    float dy = position.y - listener.y;
+    float dz = position.z - listener.z;
+    float x = dx * right.x + dy * right.y + dz * right.z; // Listener space: x to the right, y up, z ahead
+    float y = dx * up.x + dy * up.y + dz * up.z;
+    float z = dx * forward.x + dy * forward.y + dz * forward.z;
+
+    float distance = std::sqrt(x * x + y * y + z * z);
+    float gain = g_emitters.Attenuation(emitter, distance);
+    if (distance < kBinauralMinDistance) {
+        renderer.SetTarget(HrtfRenderer::Mode::Direct, 0, 0.0f, gain);
+        return;
+    }
+    float lodDistance = g_binauralLodDistance;
+    if (renderer.TargetMode() == HrtfRenderer::Mode::Pan) {
+        lodDistance *= kBinauralLodHysteresis;
+    }
+    if (g_binauralLodDistance > 0.0f && distance > lodDistance) {
+        renderer.SetTarget(HrtfRenderer::Mode::Pan, 0, x / distance, gain);
+    }
+    else {
+        renderer.SetTarget(HrtfRenderer::Mode::Binaural, Hrtf::BucketOf(x, y, z), 0.0f, gain);
+    }
+}
+
+// The renderer of a sound or voice, or nullptr if it isn't binaural.
+static HrtfRenderer* BinauralRenderer(SoundSlot& slot) {
+    return slot.binaural ? &slot.binaural->renderer : nullptr;
+}
+
+static HrtfRenderer* BinauralRenderer(Voice& voice) {
+    return voice.renderer.get();
+}
+
+// Steers a binaural sound that is about to start and makes its renderer start there,
+// without fading in from where it last played or ringing out what it played before.
+template <typename Owner>
+static void RestartBinaural(Owner& owner) {
+    if (HrtfRenderer* renderer = BinauralRenderer(owner)) {
+        SteerBinaural(owner.emitter, *renderer);
+        renderer->Restart();
+    }
+}
+
+// Puts a binaural node between an initialized sound and 'bus' (kNoBus if the sound isn't
+// routed yet), creating the node if 'binaural' holds none and steering it to 'emitter'.
+// Called with g_registryMutex held and g_hrtf loaded. Returns false if the node can't be
+// created; the sound is left as it was.
+static bool AttachBinaural(ma_sound* pSound, uint32_t emitter, std::unique_ptr<BinauralNode>& binaural, uint32_t bus) {
+    if (!binaural) {
+        std::unique_ptr<BinauralNode> node(new (std::nothrow) BinauralNode());
+        if (!node || !node->renderer.Init(g_hrtf.get())) {
+            return false;
+        }
+        ma_uint32 channels = 2;
+        ma_node_config nodeConfig = ma_node_config_init();
+        nodeConfig.vtable = &g_binauralNodeVTable;
+        nodeConfig.pInputChannels = &channels;
+        nodeConfig.pOutputChannels = &channels;
+        if (ma_node_init(ma_engine_get_node_graph(&g_engine), &nodeConfig, NULL, &node->base) != MA_SUCCESS) {
+            return false;
+        }
+        // Steered before anything reaches it, so its first chunk is already in place.
+        SteerBinaural(emitter, node->renderer);
+        if (bus != kNoBus) {
+            ma_node_attach_output_bus(&node->base, 0, BusGroup(bus), 0);
+        }
+        binaural = std::move(node);
+    }
+    ma_node_attach_output_bus(pSound, 0, &binaural->base, 0);
+    return true;
+}
+
+// Takes a sound's binaural node out and frees it, attaching the sound straight to 'bus'
+// again; the next emitter pass pans it. 'pSound' is nullptr if the sound is already
+// uninitialized. Called with g_registryMutex held.
+static void DetachBinaural(ma_sound* pSound, std::unique_ptr<BinauralNode>& binaural, uint32_t bus) {
+    if (!binaural) {
+        return;
+    }
+    if (pSound) {
+        if (bus != kNoBus) {
+            ma_node_attach_output_bus(pSound, 0, BusGroup(bus), 0);
+        }
+    }
+    ma_node_uninit(&binaural->base, NULL);
+    binaural.reset();
+    g_emitters.MarkStale();
+}
+
+// Gives every loaded sound a binaural node and every voice a renderer. Called with
+// g_registryMutex held and g_hrtf loaded.
+static void EnableBinauralLocked() {
+    g_binauralEnabled = true;
+    g_emitters.MarkStale(); // Binaural sounds take their gains from the renderer instead
+    g_soundSlots.ForEach([](SoundSlot& slot) {
+        if (slot.state == SlotState::Loaded && !AttachBinaural(&slot.sound, slot.emitter, slot.binaural, slot.bus)) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Out of memory; sound ID '%s' won't be binaural.", slot.id.c_str());
+        }
+    });
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        Voice& voice = g_voices[i];
+        std::unique_ptr<HrtfRenderer> renderer(new (std::nothrow) HrtfRenderer());
+        if (!renderer || !renderer->Init(g_hrtf.get())) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Out of memory; voice %u won't be binaural.", voice.index);
+            continue;
+        }
+        SteerBinaural(voice.emitter, *renderer);
+        g_voiceMixer.SetRenderer(voice.index, renderer.get());
+        voice.renderer = std::move(renderer);
+    }
+}
+
+// Takes every sound and voice off binaural rendering. Called with g_registryMutex held.
+static void DisableBinauralLocked() {
+    g_binauralEnabled = false;
+    g_soundSlots.ForEach([](SoundSlot& slot) {
+        DetachBinaural(slot.state == SlotState::Loaded ? &slot.sound : nullptr, slot.binaural, slot.bus);
+    });
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        Voice& voice = g_voices[i];
+        if (voice.renderer) {
+            g_voiceMixer.SetRenderer(voice.index, nullptr);
+            voice.renderer.reset();
+        }
+    }
+    g_emitters.MarkStale(); // Voices that were binaural are panned again
+}
+
+// Steers every playing binaural sound and voice, after a batch may have moved them or the
+// listener. Called with g_registryMutex held.
+static void SteerBinauralSoundsLocked() {
+    if (!g_binauralEnabled) {
+        return;
+    }
+    for (uint32_t index : g_playingSlots) {
+        SoundSlot& slot = g_soundSlots[index];
+        if (slot.binaural) {
+            SteerBinaural(slot.emitter, slot.binaural->renderer);
+        }
+    }
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        Voice& voice = g_voices[i];
+        if (voice.playing && voice.renderer) {
+            SteerBinaural(voice.emitter, *voice.renderer);
+        }
+    }
+}
+
+// Playing sounds and voices, not virtual, that are being filtered rather than panned or
+// passed through. Called with g_registryMutex held.
+static uint32_t CountBinauralVoicesLocked() {
+    uint32_t count = 0;
+    for (uint32_t index : g_playingSlots) {
+        const SoundSlot& slot = g_soundSlots[index];
+        count += slot.binaural && !slot.virtualPlayback.active && slot.binaural->renderer.TargetMode() == HrtfRenderer::Mode::Binaural;
+    }
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        const Voice& voice = g_voices[i];
+        count += voice.playing && voice.renderer && !voice.virtualPlayback.active && voice.renderer->TargetMode() == HrtfRenderer::Mode::Binaural;
+    }
+    return count;
+}
+
+// --- Voice limits ---
+// When starting a voice would exceed a limit, the least important voice in that limit's
+// scope is stolen (stopped, or made virtual if it loops) to make room. Importance is the sound's priority first, then
+// its audibility at the listener (volume times distance attenuation), then age: among
+// equals the oldest voice goes. If every candidate is more important than the new voice,
+// the new voice is not started instead.
+
+// Estimates how loud a sound is at the listener: 'volume' times the gain of the owning
+// sound's bus times the distance attenuation of 'emitter', the emitter of the sound or
+// the instance. Worked out here rather than taken from the last pass, which may be a
+// batch behind the emitter.
+static float ComputeAudibility(uint32_t emitter, float volume, const SoundSlot& owner) {
+    volume *= BusGain(owner.bus);
+    if (emitter == EmitterStore::kNoEmitter) {
+        return volume;
+    }
+    ma_vec3f position;
+    g_emitters.GetPosition(emitter, position.x, position.y, position.z);
+    ma_vec3f listener = ma_engine_listener_get_position(&g_engine, 0);
+    float dx = position.x - listener.x;
+    float dy = position.y - listener.y;
+    float dz = position.z - listener.z;
+    return volume * g_emitters.Attenuation(emitter, std::sqrt(dx * dx + dy * dy + dz * dz));
+}
+
+// A playing voice considered for stealing: one of the pool's voices, or a sound's own ma_sound.
+struct VoiceCandidate {
+    Voice* voice = nullptr;     // Set for pool voices
+    SoundSlot* slot = nullptr;  // The sound the voice plays
+    int priority = 0;
+    float audibility = 0.0f;
+    uint64_t startSequence = 0;
+};
+
+// Returns true if 'a' should be stolen before 'b'.
+static bool IsLessImportant(const VoiceCandidate& a, const VoiceCandidate& b) {
+    if (a.priority != b.priority) {
+        return a.priority < b.priority;
+    }
+    if (a.audibility != b.audibility) {
+        return a.audibility < b.audibility;
+    }
+    return a.startSequence < b.startSequence;
+}
+
+// Finds the least important playing voice accepted by inScope(slot, isPoolVoice). Virtual
+// voices aren't mixed, so they only count when 'includeVirtual' is set. Returns false if
+// there is none.
+template <typename InScope>
+static bool FindLeastImportantVoice(InScope&& inScope, bool includeVirtual, VoiceCandidate& out) {
+    bool found = false;
+    auto consider = [&](const VoiceCandidate& candidate) {
+        if (!found || IsLessImportant(candidate, out)) {
+            out = candidate;
+            found = true;
+        }
+    };
+    for (uint32_t index : g_playingSlots) {
+        SoundSlot& slot = g_soundSlots[index];
+        if ((includeVirtual || !slot.virtualPlayback.active) && inScope(slot, false)) {
+            VoiceCandidate candidate;
+            candidate.slot = &slot;
+            candidate.priority = slot.priority;
+            candidate.audibility = ComputeAudibility(slot.emitter, ma_sound_get_volume(&slot.sound), slot);
+            candidate.startSequence = slot.startSequence;
+            consider(candidate);
+        }
+    }
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        Voice& voice = g_voices[i];
+        if (!voice.playing || (voice.virtualPlayback.active && !includeVirtual)) {
+            continue;
+        }
+        SoundSlot& slot = g_soundSlots[voice.soundIndex];
+        if (inScope(slot, true)) {
+            VoiceCandidate candidate;
+            candidate.voice = &voice;
+            candidate.slot = &slot;
+            candidate.priority = slot.priority;
+            // A virtual voice is inaudible by definition; rank it below every real one.
+            candidate.audibility = voice.virtualPlayback.active ? -1.0f : ComputeAudibility(voice.emitter, voice.volume, slot);
+            candidate.startSequence = voice.startSequence;
+            consider(candidate);
+        }
+    }
+    return found;
+}
+
+template <typename Player>
+static void Virtualize(Player& player, SoundSlot& owner);
+
+// Takes the voice chosen by FindLeastImportantVoice away from the mixer. Looping voices are
+// made virtual so they come back once there is room again; one-shots, which include every
+// pool voice, are stopped.
+static void StealVoice(const VoiceCandidate& victim, const SoundSlot& forSlot) {
+    if (victim.voice) {
+        SOUND_LOG_DEBUG("SoundSystem: Voice limit reached; stopping a voice of sound ID '%s' to play sound ID '%s'.",
+            victim.slot->id.c_str(), forSlot.id.c_str());
+        RecycleVoice(*victim.voice);
+        return;
+    }
+    SoundSlot& slot = *victim.slot;
+    if (!slot.virtualPlayback.active && ma_sound_is_looping(&slot.sound)) {
+        SOUND_LOG_DEBUG("SoundSystem: Voice limit reached; virtualizing a voice of sound ID '%s' to play sound ID '%s'.",
+            slot.id.c_str(), forSlot.id.c_str());
+        Virtualize(slot, slot);
+        return;
+    }
+    SOUND_LOG_DEBUG("SoundSystem: Voice limit reached; stopping a voice of sound ID '%s' to play sound ID '%s'.",
+        slot.id.c_str(), forSlot.id.c_str());
+    ma_sound_stop(&slot.sound);
+    ma_sound_seek_to_pcm_frame(&slot.sound, 0);
+    UntrackSlotPlaying(slot);
+}
+
+// Makes room under one limit for a new voice described by 'incoming'. Returns false if the
+// scope is full of voices that are all more important than the new one. 'freePoolVoice'
+// is set when the limit is the size of the voice pool itself.
+template <typename InScope>
+static bool MakeRoom(const VoiceCandidate& incoming, InScope&& inScope, bool freePoolVoice = false) {
+    VoiceCandidate victim;
+    if (!FindLeastImportantVoice(inScope, freePoolVoice, victim) || IsLessImportant(incoming, victim)) {
+        return false;
+    }
+    StealVoice(victim, *incoming.slot);
+    return true;
+}
+
+// Checks every limit the slot's new voice counts against, stealing voices where one is full.
+// 'audibility' is the new voice's ComputeAudibility value and 'needsPoolVoice' is true for
+// instances, which also need a free voice from the pool. A virtual voice becoming real
+// passes its original 'startSequence'; new voices pass 0. Returns false if the voice must
+// not start.
+static bool AdmitVoice(SoundSlot& slot, float audibility, bool needsPoolVoice, uint64_t startSequence = 0) {
+    VoiceCandidate incoming;
+    incoming.slot = &slot;
+    incoming.priority = slot.priority;
+    incoming.audibility = audibility;
+    incoming.startSequence = startSequence != 0 ? startSequence : g_startSequence + 1;
+
+    if (slot.maxInstances != 0 && slot.activeVoices >= slot.maxInstances) {
+        if (!MakeRoom(incoming, [&slot](const SoundSlot& other, bool) { return &other == &slot; })) {
+            return false;
+        }
+    }
+    uint32_t group = slot.voiceGroup;
+    if (g_voiceGroupLimits[group] != 0 && g_voiceGroupActive[group] >= g_voiceGroupLimits[group]) {
+        if (!MakeRoom(incoming, [group](const SoundSlot& other, bool) { return other.voiceGroup == group; })) {
+            return false;
+        }
+    }
+    if (g_maxVoices != 0 && g_activeVoices >= g_maxVoices) {
+        if (!MakeRoom(incoming, [](const SoundSlot&, bool) { return true; })) {
+            return false;
+        }
+    }
+    if (needsPoolVoice && g_freeVoices.empty()) {
+        if (!MakeRoom(incoming, [](const SoundSlot&, bool isPoolVoice) { return isPoolVoice; }, true)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Virtual voices ---
+// A playing voice whose audibility drops below the virtualization threshold is stopped in
+// the mixer, so it costs no decoding, resampling or spatialization, but stays logically
+// playing: IsSoundPlaying and IsVoicePlaying keep reporting it, parameter changes still
+// apply, and its position keeps advancing with the engine clock. Once it is audible
+// again it resumes at the position it would have reached, if the voice limits allow.
+// One-shots that would have finished while virtual simply end.
+
+// Default for SetVirtualVoiceThreshold: -60 dB, below anything audible in a mix.
+static const float kDefaultVirtualThreshold = 0.001f;
+
+// A virtual voice must be this much louder than the threshold (+6 dB) to become real
+// again, so voices hovering around the threshold don't flip every batch.
+static const float kVirtualHysteresis = 2.0f;
+
+static float g_virtualThreshold = kDefaultVirtualThreshold; // 0 disables virtualization
+
+// What the functions below need from a player: a sound's own ma_sound, or a pool voice in
+// g_voiceMixer. A voice never loops; its length is 0 until known.
+static bool IsPlaybackRunning(SoundSlot& slot) {
+    return ma_sound_is_playing(&slot.sound) && !ma_sound_at_end(&slot.sound);
+}
+
+static bool IsPlaybackRunning(Voice& voice) {
+    return g_voiceMixer.IsPlaying(voice.index);
+}
+
+static void HaltPlayback(SoundSlot& slot) {
+    ma_sound_stop(&slot.sound);
+}
+
+static void HaltPlayback(Voice& voice) {
+    g_voiceMixer.Pause(voice.index);
+}
+
+static ma_uint64 PlaybackCursor(SoundSlot& slot) {
+    ma_uint64 cursor = 0;
+    if (!ma_sound_at_end(&slot.sound)) {
+        ma_sound_get_cursor_in_pcm_frames(&slot.sound, &cursor);
+    }
+    return cursor;
+}
+
+static ma_uint64 PlaybackCursor(Voice& voice) {
+    return g_voiceMixer.Cursor(voice.index);
+}
+
+static bool ResumePlaybackAt(SoundSlot& slot, ma_uint64 cursor) {
+    ma_sound_seek_to_pcm_frame(&slot.sound, cursor);
+    return ma_sound_start(&slot.sound) == MA_SUCCESS;
+}
+
+static bool ResumePlaybackAt(Voice& voice, ma_uint64 cursor) {
+    g_voiceMixer.Resume(voice.index, cursor);
+    return true;
+}
+
+static float PlaybackVolume(SoundSlot& slot) {
+    return ma_sound_get_volume(&slot.sound);
+}
+
+static float PlaybackVolume(Voice& voice) {
+    return voice.volume;
+}
+
+// Source frames played per engine frame.
+static double PlaybackSpeed(SoundSlot& slot) {
+    ma_uint32 sampleRate = 0;
+    ma_sound_get_data_format(&slot.sound, NULL, NULL, &sampleRate, NULL, 0);
+    ma_uint32 engineRate = ma_engine_get_sample_rate(&g_engine);
+    if (sampleRate == 0 || engineRate == 0) {
+        sampleRate = engineRate = 1;
+    }
+    return static_cast<double>(ma_sound_get_pitch(&slot.sound)) * sampleRate / engineRate;
+}
+
+static double PlaybackSpeed(Voice& voice) {
+    ma_uint32 engineRate = ma_engine_get_sample_rate(&g_engine);
+    double rate = voice.sampleRate != 0 && engineRate != 0 ? static_cast<double>(voice.sampleRate) / engineRate : 1.0;
+    return rate * voice.pitch * g_emitters.Doppler(voice.emitter);
+}
+
+static ma_uint64 PlaybackLength(SoundSlot& slot) {
+    ma_uint64 length = 0;
+    return ma_sound_get_length_in_pcm_frames(&slot.sound, &length) == MA_SUCCESS ? length : 0;
+}
+
+static ma_uint64 PlaybackLength(Voice& voice) {
+    return voice.length;
+}
+
+static bool PlaybackLoops(SoundSlot& slot) {
+    return ma_sound_is_looping(&slot.sound) != MA_FALSE;
+}
+
+static bool PlaybackLoops(Voice&) {
+    return false;
+}
+
+// Marks a stopped sound as virtual, playing on from its current position.
+template <typename Player>
+static void StartVirtual(Player& player) {
+    player.virtualPlayback.cursor = PlaybackCursor(player);
+    player.virtualPlayback.engineTime = ma_engine_get_time_in_pcm_frames(&g_engine);
+    player.virtualPlayback.active = true;
+    ++g_virtualVoices;
+}
+
+// Takes a real, playing voice out of the mix and makes it virtual. 'owner' is the sound
+// whose voice counts it was counted against.
+template <typename Player>
+static void Virtualize(Player& player, SoundSlot& owner) {
+    HaltPlayback(player);
+    StartVirtual(player);
+    UncountVoice(owner);
+}
+
+// Works out where a virtual voice would be now had it kept playing, from the engine time
+// elapsed, its pitch and its sample rate. Returns false if a non-looping sound would have
+// reached its end.
+template <typename Player>
+static bool GetVirtualCursor(Player& player, ma_uint64& cursor) {
+    const VirtualPlayback& playback = player.virtualPlayback;
+    ma_uint64 elapsed = ma_engine_get_time_in_pcm_frames(&g_engine) - playback.engineTime;
+    cursor = playback.cursor + static_cast<ma_uint64>(static_cast<double>(elapsed) * PlaybackSpeed(player));
+
+    ma_uint64 length = PlaybackLength(player);
+    if (length == 0) {
+        return true; // Unknown length (some streams): keep it going until it's audible again
+    }
+    if (cursor >= length) {
+        if (!PlaybackLoops(player)) {
+            return false;
+        }
+        cursor %= length;
+    }
+    return true;
+}
+
+// Puts a virtual voice back into the mix at 'cursor'.
+template <typename Player>
+static bool Devirtualize(Player& player, SoundSlot& owner, ma_uint64 cursor) {
+    if (!ResumePlaybackAt(player, cursor)) {
+        return false;
+    }
+    player.virtualPlayback.active = false;
+    --g_virtualVoices;
+    CountVoice(owner);
+    return true;
+}
+
+// Moves one playing voice between real and virtual as its audibility requires. Returns
+// false if the voice has finished, really or virtually.
+template <typename Player>
+static bool UpdateVoice(Player& player, SoundSlot& owner) {
+    if (!player.virtualPlayback.active) {
+        if (!IsPlaybackRunning(player)) {
+            return false;
+        }
+        if (g_virtualThreshold > 0.0f && ComputeAudibility(player.emitter, PlaybackVolume(player), owner) < g_virtualThreshold) {
+            Virtualize(player, owner);
+        }
+        return true;
+    }
+
+    ma_uint64 cursor = 0;
+    if (!GetVirtualCursor(player, cursor)) {
+        return false;
+    }
+    float audibility = ComputeAudibility(player.emitter, PlaybackVolume(player), owner);
+    if (audibility >= g_virtualThreshold * kVirtualHysteresis && AdmitVoice(owner, audibility, false, player.startSequence)) {
+        Devirtualize(player, owner, cursor);
+    }
+    return true;
+}
+
+// Runs at the start of every block's update: frees voices that finished (miniaudio stops a
+// non-looping sound at its end and keeps it flagged as at-end until it is started again,
+// and the mixer keeps a voice that reached its end until it is stopped), and virtualizes or
+// restores voices as their audibility changes.
+static void UpdateVoices() {
+    for (size_t i = g_playingSlots.size(); i-- > 0;) {
+        if (i >= g_playingSlots.size()) {
+            continue; // A voice restored below stole (and untracked) slots from the end of the list
+        }
+        SoundSlot& slot = g_soundSlots[g_playingSlots[i]];
+        if (!UpdateVoice(slot, slot)) {
+            if (slot.virtualPlayback.active) {
+                ma_sound_seek_to_pcm_frame(&slot.sound, 0); // It ended while virtual; replay from the start
+            }
+            UntrackSlotPlaying(slot);
+        }
+    }
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        Voice& voice = g_voices[i];
+        if (voice.playing && !UpdateVoice(voice, g_soundSlots[voice.soundIndex])) {
+            RecycleVoice(voice);
+        }
+    }
+}
+
+// --- Memory budget ---
+// Decoded PCM can be held to a budget. When loading a sound takes the cache over it, the
+// least recently used sounds that aren't in use are evicted: their PCM is released but the
+// sound stays loaded, keeping its ID, handle and settings. Playing an evicted sound decodes
+// it again, on a loader thread for SndPlaySound and friends (the sound starts when the
+// decode finishes) and on the calling thread for PlaySoundInstance. Queued commands may be
+// applied on the audio thread, which mustn't take the loader's lock or allocate, so they
+// only mark the sound; the loader job is submitted by the next call that applies the
+// queue from a game thread (UpdateSoundSystem, for one). Pinned sounds are never
+// evicted. Only sounds decoded from a file of their own can be evicted: streams and
+// compressed sounds hold no PCM, and sounds from memory or packs have no file to decode again.
+
+static uint64_t g_memoryBudget = 0; // Bytes of decoded PCM; 0 means no budget
+static uint64_t g_useClock = 0;     // Orders uses of sounds for LRU eviction
+static bool g_overBudget = false;   // The last enforcement couldn't get under the budget
+static bool g_reloadRequested = false; // Some slot has reloadRequested set
+static uint64_t g_evictions = 0;    // Totals for GetSoundSystemStats
+static uint64_t g_reloads = 0;
+
+// Candidates for eviction, kept between calls so enforcing the budget rarely allocates.
+static std::vector<std::pair<uint64_t, uint32_t>> g_evictionCandidates;
+
+static void EnforceMemoryBudgetLocked();
+static void RequestReload(SoundSlot& slot, bool play, bool loop);
+
+// Starts an instance of the slot's sound on a free voice. Called with g_registryMutex held.
+static VoiceHandle PlayInstance(SoundSlot& slot, float volume, float pitch) {
+    if (slot.evicted) {
+        // The API entry points decode evicted sounds before getting here; this is a fallback.
+        RequestReload(slot, false, false);
+        SOUND_LOG_DEBUG("SoundSystem: Sound ID '%s' is being decoded again; instance not played.", slot.id.c_str());
+        return SOUNDSYSTEM_INVALID_VOICE;
+    }
+    if (!slot.decoded) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Sound ID '%s' is streamed and can't be played as an instance.", slot.id.c_str());
+        return SOUNDSYSTEM_INVALID_VOICE;
+    }
+    volume = std::clamp(volume, 0.0f, 1.0f);
+    float audibility = ComputeAudibility(slot.emitter, volume, slot);
+
+    // An instance that starts inaudible starts virtual: it needs a pool voice, but no room in the mix.
+    bool startVirtual = g_virtualThreshold > 0.0f && audibility < g_virtualThreshold;
+    if (startVirtual ? g_freeVoices.empty() : !AdmitVoice(slot, audibility, true)) {
+        SOUND_LOG_DEBUG("SoundSystem: Voice limit reached; instance of sound ID '%s' not played.", slot.id.c_str());
+        return SOUNDSYSTEM_INVALID_VOICE;
+    }
+
+    slot.lastUsed = ++g_useClock;
+    Voice& voice = g_voices[g_freeVoices.back()];
+    VoiceMixer::Source source;
+    ma_result result = BindVoice(voice, *slot.decoded, source);
+    if (result != MA_SUCCESS) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to prepare a voice for sound ID '%s'. Result: %d", slot.id.c_str(), result);
+        return SOUNDSYSTEM_INVALID_VOICE;
+    }
+    g_freeVoices.pop_back();
+    voice.bus = slot.bus;
+
+    // The instance starts where the sound's emitter currently is, with its range.
+    if (slot.emitter != EmitterStore::kNoEmitter) {
+        g_emitters.CopyEmitter(voice.emitter, slot.emitter);
+    }
+    else {
+        g_emitters.SetPosition(voice.emitter, 0.0f, 0.0f, 0.0f);
+        g_emitters.SetVelocity(voice.emitter, 0.0f, 0.0f, 0.0f);
+        g_emitters.SetRange(voice.emitter, EmitterStore::kDefaultMinDistance, EmitterStore::kDefaultMaxDistance, EmitterStore::kDefaultRolloff);
+    }
+    voice.volume = volume;
+    voice.pan = 0.0f;
+    voice.pitch = pitch > 0.0f ? pitch : 0.001f;
+    RestartBinaural(voice);
+
+    voice.playing = true;
+    voice.soundIndex = slot.index;
+    voice.startSequence = ++g_startSequence;
+    g_emitters.SetActive(voice.emitter, true);
+    SpatializeNow(voice); // Gains and pitch first, so the first block already has them
+    g_voiceMixer.Start(voice.index, source, voice.bus, startVirtual);
+    if (startVirtual) {
+        StartVirtual(voice);
+        SOUND_LOG_DEBUG("SoundSystem: Instance of sound ID '%s' started virtual on voice %u.", slot.id.c_str(), voice.index);
+        return MakeVoiceHandle(voice);
+    }
+    CountVoice(slot);
+    SOUND_LOG_DEBUG("SoundSystem: Playing instance of sound ID '%s' on voice %u.", slot.id.c_str(), voice.index);
+    return MakeVoiceHandle(voice);
+}
+
+// Drops the slot's reference to its cached data. Other sounds loaded from the same file
+// keep it; the last one frees it. Called after the slot's ma_sound has been uninitialized.
+static void ReleaseDecodedData(SoundSlot& slot) {
+    if (slot.decoded) {
+        UninitSharedSource(*slot.decoded, slot.source, slot.decoder);
+        SoundCache::Release(slot.decoded);
+        slot.decoded = nullptr;
+    }
+    else if (slot.evicted) {
+        ma_audio_buffer_ref_uninit(&slot.source); // The data went already; the cursor is left
+    }
+}
+
+// Uninitializes the slot's sound, removes its ID and returns the slot to the free list.
+static void ReleaseSlot(uint32_t index) {
+    SoundSlot& slot = g_soundSlots[index];
+    // Stop the sound if it's playing before uninitializing.
+    if (ma_sound_is_playing(&slot.sound)) {
+        ma_sound_stop(&slot.sound);
+    }
+    StopVoicesOfSlot(index); // Instances read the data that is about to be released
+    UntrackSlotPlaying(slot);
+    if (slot.emitter != EmitterStore::kNoEmitter) {
+        g_emitters.Remove(slot.emitter);
+        slot.emitter = EmitterStore::kNoEmitter;
+    }
+    ma_sound_uninit(&slot.sound); // Uninitialize the miniaudio sound object; the slab keeps its storage
+    DetachBinaural(nullptr, slot.binaural, kNoBus);
+    ReleaseDecodedData(slot);
+    SOUND_LOG_INFO("SoundSystem: Unloaded sound with ID '%s'.", slot.id.c_str());
+    FreeSlot(slot);
+}
+
+// Registers 'soundId' in a new slot in the Loading state so the ID is taken while its file
+// decodes. Called with g_registryMutex held. Returns the slot, or nullptr if the ID is
+// already registered (its slot index is written to 'existing') or no slot is available.
+static SoundSlot* ReserveSlotLocked(const char* soundId, uint32_t loadFlags, int64_t& existing) {
+    size_t idLength = std::strlen(soundId);
+    uint64_t idHash = HashSoundId(soundId, idLength);
+
+    // Check if the sound ID already exists to prevent duplicates.
+    existing = FindSlotIndex(soundId, idLength, idHash);
+    if (existing >= 0) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Sound ID '%s' already loaded. Ignoring.", soundId);
+        return nullptr;
+    }
+
+    // Take a slot from the slab; its ma_sound storage is reused across loads.
+    int64_t index = AllocateSlot();
+    if (index < 0) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to allocate a slot for new sound.");
+        return nullptr;
+    }
+    SoundSlot& slot = g_soundSlots[static_cast<size_t>(index)];
+    if (!g_loadedSounds.Insert(idHash, slot.index)) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to allocate memory for the sound ID table.");
+        g_freeSlots.push_back(slot.index);
+        return nullptr;
+    }
+    slot.state = SlotState::Loading;
+    slot.loadFlags = loadFlags;
+    slot.idHash = idHash;
+    slot.id.assign(soundId, idLength);
+    return &slot;
+}
+
+// The rate to convert a sound to while decoding it, or 0 to keep its own. Converting to
+// the engine's rate at load leaves nothing to resample at pitch 1.0. Compressed sounds
+// decode while playing, at their own rate.
+static ma_uint32 LoadSampleRate(uint32_t loadFlags) {
+    if (loadFlags & SOUNDSYSTEM_LOAD_COMPRESSED) {
+        return 0;
+    }
+    if ((loadFlags & SOUNDSYSTEM_LOAD_RESAMPLE) || (g_effectiveConfig.flags & SOUNDSYSTEM_INIT_RESAMPLE_ON_LOAD)) {
+        return ma_engine_get_sample_rate(&g_engine);
+    }
+    return 0;
+}
+
+// Gives a reserved slot its own cursor (or decoder) over cached data and initializes its
+// ma_sound on it. Takes over the reference to 'data', dropping it on failure.
+static ma_result BindSlotData(SoundSlot& slot, const SoundCache::Entry* data) {
+    ma_data_source* source = NULL;
+    ma_result result = InitSharedSource(*data, slot.source, slot.decoder, source);
+    if (result == MA_SUCCESS) {
+        result = ma_sound_init_from_data_source(&g_engine, source, 0, BusGroup(kMasterBus), &slot.sound);
+        if (result != MA_SUCCESS) {
+            UninitSharedSource(*data, slot.source, slot.decoder);
+        }
+    }
+    if (result != MA_SUCCESS) {
+        SoundCache::Release(data);
+        return result;
+    }
+    slot.decoded = data;
+    return MA_SUCCESS;
+}
+
+// Decodes the file into a slot reserved by ReserveSlotLocked. Runs without the registry
+// lock: nothing else touches a Loading slot's ma_sound.
+static ma_result DecodeIntoSlot(SoundSlot& slot, const char* filePath) {
+    // Streamed sounds read the file incrementally, so there is nothing to share.
+    // Pitch and 3D are handled by default or set via their respective functions after initialization.
+    if (slot.loadFlags & SOUNDSYSTEM_LOAD_STREAM) {
+        return ma_sound_init_from_file(&g_engine, filePath, MA_SOUND_FLAG_STREAM, BusGroup(kMasterBus), NULL, &slot.sound);
+    }
+
+    // Sounds share one cached buffer per file. Only the first ID loaded from a file reads
+    // it; later IDs just get their own cursor (or decoder) over the same data.
+    ma_result result = MA_SUCCESS;
+    bool keepEncoded = (slot.loadFlags & SOUNDSYSTEM_LOAD_COMPRESSED) != 0;
+    const SoundCache::Entry* decoded = SoundCache::Acquire(filePath, LoadSampleRate(slot.loadFlags), keepEncoded, result);
+    if (!decoded) {
+        return result;
+    }
+    if (!keepEncoded) {
+        slot.sourcePath = filePath; // Lets the memory budget evict the PCM and decode it again later
+    }
+    return BindSlotData(slot, decoded);
+}
+
+// Publishes the outcome of a load and wakes WaitForSound callers. Called with
+// g_registryMutex held. Returns the sound's handle, or SOUNDSYSTEM_INVALID_HANDLE if
+// decoding failed, in which case the ID is released again.
+static SoundHandle FinishLoadLocked(SoundSlot& slot, const char* filePath, ma_result result) {
+    SoundHandle handle = SOUNDSYSTEM_INVALID_HANDLE;
+    if (result != MA_SUCCESS) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to load sound '%s'. Result: %d", filePath, result);
+        FreeSlot(slot);
+    }
+    else {
+        slot.state = SlotState::Loaded;
+        slot.lastUsed = ++g_useClock;
+        handle = MakeHandle(slot.index);
+        // Placed by its emitter rather than by miniaudio (see "Emitters"), unless there's
+        // no memory for one.
+        slot.emitter = g_emitters.Add();
+        if (slot.emitter != EmitterStore::kNoEmitter) {
+            ma_sound_set_spatialization_enabled(&slot.sound, MA_FALSE);
+        }
+        else {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Out of memory; sound ID '%s' will be spatialized by miniaudio.", slot.id.c_str());
+        }
+        if (g_binauralEnabled && !AttachBinaural(&slot.sound, slot.emitter, slot.binaural, slot.bus)) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Out of memory; sound ID '%s' won't be binaural.", slot.id.c_str());
+        }
+        SOUND_LOG_INFO("SoundSystem: Loaded sound '%s' as ID '%s'.", filePath, slot.id.c_str());
+        EnforceMemoryBudgetLocked();
+    }
+    g_loadFinished.notify_all();
+    return handle;
+}
+
+// Loads a sound into a new slot on the calling thread and returns its handle, or
+// SOUNDSYSTEM_INVALID_HANDLE on failure. The registry is locked only to reserve and
+// publish the slot, not while the file is decoded.
+static SoundHandle LoadSoundInternal(const char* filePath, const char* soundId, uint32_t loadFlags) {
+    SoundSlot* slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t existing = -1;
+        slot = ReserveSlotLocked(soundId, loadFlags, existing);
+        if (!slot) {
+            // Already loaded, consider it successful for idempotence
+            return existing >= 0 ? MakeHandle(static_cast<uint32_t>(existing)) : SOUNDSYSTEM_INVALID_HANDLE;
+        }
+    }
+
+    ma_result result = DecodeIntoSlot(*slot, filePath);
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    return FinishLoadLocked(*slot, filePath, result);
+}
+
+// Loads a sound whose data doesn't come from a file of its own (a caller's buffer or a
+// range of a pack) into a new slot. acquire(sampleRate, result) returns the data with a
+// reference taken. As in LoadSoundInternal, the registry is only locked to reserve and
+// publish the slot.
+template <typename Acquire>
+static SoundHandle LoadSharedDataInternal(const char* description, const char* soundId, uint32_t loadFlags, Acquire&& acquire) {
+    SoundSlot* slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t existing = -1;
+        slot = ReserveSlotLocked(soundId, loadFlags, existing);
+        if (!slot) {
+            return existing >= 0 ? MakeHandle(static_cast<uint32_t>(existing)) : SOUNDSYSTEM_INVALID_HANDLE;
+        }
+    }
+
+    ma_result result = MA_SUCCESS;
+    const SoundCache::Entry* data = acquire(LoadSampleRate(loadFlags), result);
+    if (data) {
+        result = BindSlotData(*slot, data);
+    }
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    return FinishLoadLocked(*slot, description, result);
+}
+
+// Data in memory has no file to stream from; decoding it while it plays is the equivalent.
+static uint32_t MemoryLoadFlags(uint32_t loadFlags) {
+    if (loadFlags & SOUNDSYSTEM_LOAD_STREAM) {
+        loadFlags = (loadFlags & ~SOUNDSYSTEM_LOAD_STREAM) | SOUNDSYSTEM_LOAD_COMPRESSED;
+    }
+    return loadFlags;
+}
+
+// The operations below are shared by the string-ID and handle-based exports.
+// They receive a slot that is known to hold a loaded sound.
+
+// Starts the slot's stopped or paused sound as a virtual voice, for sounds that start inaudible.
+static void StartSlotVirtual(SoundSlot& slot) {
+    TrackSlotPlaying(slot);
+    Virtualize(slot, slot);
+}
+
+// Returns true if a sound about to start is below the virtualization threshold.
+static bool StartsInaudible(SoundSlot& slot) {
+    return g_virtualThreshold > 0.0f && ComputeAudibility(slot.emitter, ma_sound_get_volume(&slot.sound), slot) < g_virtualThreshold;
+}
+
+static void PlaySlot(SoundSlot& slot, bool loop) {
+    ma_sound* pSound = &slot.sound;
+    slot.lastUsed = ++g_useClock;
+    if (slot.evicted) {
+        RequestReload(slot, true, loop);
+        return;
+    }
+
+    // A virtual sound is restarted like a stopped one.
+    if (slot.virtualPlayback.active) {
+        UntrackSlotPlaying(slot);
+        ma_sound_seek_to_pcm_frame(pSound, 0);
+    }
+
+    // Stop the sound if it's already playing before restarting,
+    // to allow for re-triggering one-shot sounds or resetting loops.
+    // A restart reuses the sound's voice; otherwise it needs room under the voice limits.
+    if (ma_sound_is_playing(pSound)) {
+        ma_sound_stop(pSound);
+        // Reset cursor to start for immediate replay
+        ma_sound_seek_to_pcm_frame(pSound, 0);
+    }
+    else if (!slot.playing && StartsInaudible(slot)) {
+        ma_sound_set_looping(pSound, loop);
+        StartSlotVirtual(slot);
+        SOUND_LOG_DEBUG("SoundSystem: Playing sound ID '%s' as a virtual voice (Looping: %s).", slot.id.c_str(), loop ? "Yes" : "No");
+        return;
+    }
+    else if (!slot.playing && !AdmitVoice(slot, ComputeAudibility(slot.emitter, ma_sound_get_volume(pSound), slot), false)) {
+        SOUND_LOG_DEBUG("SoundSystem: Voice limit reached; sound ID '%s' not played.", slot.id.c_str());
+        return;
+    }
+
+    ma_sound_set_looping(pSound, loop); // Set looping state
+    RestartBinaural(slot);
+    SpatializeNow(slot);
+    ma_result result = ma_sound_start(pSound); // Start playing the sound
+    if (result != MA_SUCCESS) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to play sound with ID '%s'. Result: %d", slot.id.c_str(), result);
+        UntrackSlotPlaying(slot);
+    }
+    else {
+        TrackSlotPlaying(slot);
+        SOUND_LOG_DEBUG("SoundSystem: Playing sound ID '%s' (Looping: %s).", slot.id.c_str(), loop ? "Yes" : "No");
+    }
+}
+
+static void StopSlot(SoundSlot& slot) {
+    ma_sound* pSound = &slot.sound;
+    slot.playOnReload = false; // Waiting to be decoded again counts as playing
+    if (slot.virtualPlayback.active) {
+        // Nothing to stop in miniaudio; just rewind it for replay.
+        UntrackSlotPlaying(slot);
+        ma_sound_seek_to_pcm_frame(pSound, 0);
+        SOUND_LOG_DEBUG("SoundSystem: Stopped sound ID '%s'.", slot.id.c_str());
+    }
+    else if (ma_sound_is_playing(pSound)) {
+        ma_result result = ma_sound_stop(pSound); // Stop the sound
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to stop sound with ID '%s'. Result: %d", slot.id.c_str(), result);
+        }
+        else {
+            // Reset cursor to start when stopping, so it's ready for replay.
+            ma_sound_seek_to_pcm_frame(pSound, 0);
+            UntrackSlotPlaying(slot);
+            SOUND_LOG_DEBUG("SoundSystem: Stopped sound ID '%s'.", slot.id.c_str());
+        }
+    }
+    else {
+        SOUND_LOG_DEBUG("SoundSystem: Sound ID '%s' is not playing. No action needed.", slot.id.c_str());
+    }
+}
+
+static void PauseSlot(SoundSlot& slot) {
+    slot.playOnReload = false;
+    if (slot.virtualPlayback.active) {
+        // Park the sound where it would have been, so it resumes from there.
+        ma_uint64 cursor = 0;
+        bool finished = !GetVirtualCursor(slot, cursor);
+        ma_sound_seek_to_pcm_frame(&slot.sound, finished ? 0 : cursor);
+        UntrackSlotPlaying(slot);
+        SOUND_LOG_DEBUG("SoundSystem: Paused sound ID '%s'.", slot.id.c_str());
+        return;
+    }
+    ma_result result = ma_sound_stop(&slot.sound); // In miniaudio, stop and start are used for pause/resume as well.
+    if (result != MA_SUCCESS) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to pause sound with ID '%s'. Result: %d", slot.id.c_str(), result);
+    }
+    else {
+        UntrackSlotPlaying(slot); // A paused sound isn't mixed, so it doesn't count as a voice
+        SOUND_LOG_DEBUG("SoundSystem: Paused sound ID '%s'.", slot.id.c_str());
+    }
+}
+
+static void ResumeSlot(SoundSlot& slot) {
+    if (slot.playing) {
+        return; // Already playing, really or virtually
+    }
+    if (slot.evicted) {
+        // Only stopped sounds are evicted, so resuming one starts it from the beginning.
+        RequestReload(slot, true, ma_sound_is_looping(&slot.sound) != MA_FALSE);
+        return;
+    }
+    if (StartsInaudible(slot)) {
+        StartSlotVirtual(slot);
+        SOUND_LOG_DEBUG("SoundSystem: Resumed sound ID '%s' as a virtual voice.", slot.id.c_str());
+        return;
+    }
+    if (!AdmitVoice(slot, ComputeAudibility(slot.emitter, ma_sound_get_volume(&slot.sound), slot), false)) {
+        SOUND_LOG_DEBUG("SoundSystem: Voice limit reached; sound ID '%s' stays paused.", slot.id.c_str());
+        return;
+    }
+    SpatializeNow(slot);
+    ma_result result = ma_sound_start(&slot.sound);
+    if (result != MA_SUCCESS) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to resume sound with ID '%s'. Result: %d", slot.id.c_str(), result);
+    }
+    else {
+        TrackSlotPlaying(slot);
+        SOUND_LOG_DEBUG("SoundSystem: Resumed sound ID '%s'.", slot.id.c_str());
+    }
+}
+
+static void SetSlotVolume(SoundSlot& slot, float volume) {
+    // Clamp volume to be within 0.0 and 1.0
+    volume = std::clamp(volume, 0.0f, 1.0f);
+    // No need to capture return value, as ma_sound_set_volume returns void
+    ma_sound_set_volume(&slot.sound, volume);
+    SOUND_LOG_TRACE("SoundSystem: Volume for sound ID '%s' set to %g.", slot.id.c_str(), volume);
+}
+
+static void SetSlotPan(SoundSlot& slot, float pan) {
+    // Clamp pan to be within -1.0 and 1.0
+    pan = std::clamp(pan, -1.0f, 1.0f);
+    // Combined with the emitter's pan gains (see "Emitters").
+    slot.pan = pan;
+    ApplyEmitter(slot);
+    SOUND_LOG_TRACE("SoundSystem: Pan for sound ID '%s' set to %g.", slot.id.c_str(), pan);
+}
+
+static void SetSlotPitch(SoundSlot& slot, float pitch) {
+    // Pitch should generally be positive. If 0 or negative, miniaudio might behave unexpectedly.
+    if (pitch <= 0.0f) pitch = 0.001f; // Ensure a small positive value to avoid issues
+    // Multiplied by the emitter's doppler factor (see "Emitters").
+    slot.pitch = pitch;
+    ApplyEmitter(slot);
+    SOUND_LOG_TRACE("SoundSystem: Pitch for sound ID '%s' set to %g.", slot.id.c_str(), pitch);
+}
+
+static void SetSlotPosition(SoundSlot& slot, float x, float y, float z) {
+    // Takes effect at the next block's emitter pass.
+    if (slot.emitter != EmitterStore::kNoEmitter) {
+        g_emitters.SetPosition(slot.emitter, x, y, z);
+    }
+    else {
+        ma_sound_set_position(&slot.sound, x, y, z);
+    }
+    SOUND_LOG_TRACE("SoundSystem: Position for sound ID '%s' set to (%g, %g, %g).", slot.id.c_str(), x, y, z);
+}
+
+static void SetSlotVelocity(SoundSlot& slot, float x, float y, float z) {
+    // Only used for the doppler shift, which a sound without an emitter doesn't get.
+    if (slot.emitter != EmitterStore::kNoEmitter) {
+        g_emitters.SetVelocity(slot.emitter, x, y, z);
+    }
+    SOUND_LOG_TRACE("SoundSystem: Velocity for sound ID '%s' set to (%g, %g, %g).", slot.id.c_str(), x, y, z);
+}
+
+// True if the slot's PCM can be released now: the sound and all of its instances are
+// stopped, and it isn't paused part way through (resuming needs the data where it left off).
+static bool IsEvictable(SoundSlot& slot) {
+    if (slot.state != SlotState::Loaded || slot.pinned || slot.evicted || slot.reloading ||
+        slot.sourcePath.empty() || !slot.decoded || !slot.decoded->frames ||
+        slot.playing || slot.activeVoices != 0 || ma_sound_is_playing(&slot.sound)) {
+        return false;
+    }
+    ma_uint64 cursor = 0;
+    ma_sound_get_cursor_in_pcm_frames(&slot.sound, &cursor);
+    if (cursor != 0 && !ma_sound_at_end(&slot.sound)) {
+        return false;
+    }
+    // Virtual instances aren't counted in activeVoices but still need the data.
+    for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+        if (g_voices[i].playing && g_voices[i].soundIndex == slot.index) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Releases the slot's PCM, leaving its ma_sound initialized over an empty buffer.
+static void EvictSlot(SoundSlot& slot) {
+    ma_audio_buffer_ref_set_data(&slot.source, NULL, 0);
+    SoundCache::Release(slot.decoded);
+    slot.decoded = nullptr;
+    slot.evicted = true;
+    ++g_evictions;
+    SOUND_LOG_DEBUG("SoundSystem: Evicted decoded data of sound ID '%s'.", slot.id.c_str());
+}
+
+// Evicts least recently used sounds until the cache's PCM fits the budget, or no more can
+// be evicted. Shared PCM is only freed once every sound using it is evicted.
+static void EnforceMemoryBudgetLocked() {
+    if (g_memoryBudget == 0) {
+        g_overBudget = false;
+        return;
+    }
+    uint64_t used = SoundCache::GetStats().decodedBytes;
+    if (used <= g_memoryBudget) {
+        g_overBudget = false;
+        return;
+    }
+    g_evictionCandidates.clear();
+    g_soundSlots.ForEach([](SoundSlot& slot) {
+        if (IsEvictable(slot)) {
+            g_evictionCandidates.emplace_back(slot.lastUsed, slot.index);
+        }
+    });
+    std::sort(g_evictionCandidates.begin(), g_evictionCandidates.end());
+    for (const auto& candidate : g_evictionCandidates) {
+        EvictSlot(g_soundSlots[candidate.second]);
+        used = SoundCache::GetStats().decodedBytes;
+        if (used <= g_memoryBudget) {
+            break;
+        }
+    }
+    // Sounds in use now may stop later; UpdateSoundSystem tries again while this is set.
+    g_overBudget = used > g_memoryBudget;
+}
+
+// Gives an evicted slot the PCM decoded for it again, or drops 'data' if the slot no longer
+// needs it (another reload got there first). Called with g_registryMutex held.
+static void AttachReloadedData(SoundSlot& slot, const SoundCache::Entry* data, ma_result result) {
+    if (!slot.evicted) {
+        SoundCache::Release(data);
+        return;
+    }
+    if (!data) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to decode sound ID '%s' again. Result: %d", slot.id.c_str(), result);
+        slot.playOnReload = false;
+        return;
+    }
+    // Same file, flags and engine rate as the first decode, so the format matches the
+    // one the ma_sound was initialized for.
+    ma_audio_buffer_ref_set_data(&slot.source, data->frames, data->frameCount);
+    slot.decoded = data;
+    slot.evicted = false;
+    ++g_reloads;
+    SOUND_LOG_DEBUG("SoundSystem: Decoded sound ID '%s' again.", slot.id.c_str());
+    if (slot.playOnReload) {
+        slot.playOnReload = false;
+        PlaySlot(slot, slot.loopOnReload);
+    }
+}
+
+// Asks for an evicted sound to be decoded again on a loader thread. 'play' starts it when
+// done. May run on the audio thread (commands), so it only marks the slot for
+// SubmitRequestedReloadsLocked.
+static void RequestReload(SoundSlot& slot, bool play, bool loop) {
+    if (play) {
+        slot.playOnReload = true;
+        slot.loopOnReload = loop;
+    }
+    if (!slot.reloading) {
+        slot.reloadRequested = true;
+        g_reloadRequested = true;
+    }
+}
+
+// Hands the loader a job to decode the slot's file again. Takes the loader's lock, so
+// never called on the audio thread.
+static void SubmitReload(SoundSlot& slot) {
+    slot.reloadRequested = false;
+    slot.reloading = true;
+    uint32_t index = slot.index;
+    uint32_t generation = slot.generation;
+    std::string path = slot.sourcePath;
+    uint32_t loadFlags = slot.loadFlags;
+    bool submitted = SoundLoader::Submit([index, generation, path, loadFlags](bool cancelled) {
+        if (cancelled) {
+            return; // Shutting down; the slot goes with everything else
+        }
+        ma_result result = MA_SUCCESS;
+        const SoundCache::Entry* data = SoundCache::Acquire(path.c_str(), LoadSampleRate(loadFlags), false, result);
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        SoundSlot& current = g_soundSlots[index];
+        if (current.generation != generation || current.state != SlotState::Loaded) {
+            SoundCache::Release(data); // Unloaded while decoding
+            return;
+        }
+        current.reloading = false;
+        AttachReloadedData(current, data, result);
+        EnforceMemoryBudgetLocked();
+    });
+    if (!submitted) {
+        slot.reloading = false;
+        slot.playOnReload = false;
+    }
+}
+
+// Submits the reloads RequestReload has asked for since the last call. Called with
+// g_registryMutex held, from game threads only.
+static void SubmitRequestedReloadsLocked() {
+    if (!g_reloadRequested) {
+        return;
+    }
+    g_reloadRequested = false;
+    g_soundSlots.ForEach([](SoundSlot& slot) {
+        if (slot.reloadRequested) {
+            if (slot.state == SlotState::Loaded && slot.evicted) {
+                SubmitReload(slot);
+            }
+            slot.reloadRequested = false;
+        }
+    });
+}
+
+// Decodes an evicted sound again on the calling thread, with 'lock' (on g_registryMutex)
+// released while the file decodes. Returns the slot, or nullptr if it was unloaded in the
+// meantime or the decode failed.
+static SoundSlot* ReloadNow(std::unique_lock<std::mutex>& lock, SoundSlot& slot) {
+    uint32_t index = slot.index;
+    uint32_t generation = slot.generation;
+    std::string path = slot.sourcePath;
+    uint32_t loadFlags = slot.loadFlags;
+    lock.unlock();
+    ma_result result = MA_SUCCESS;
+    const SoundCache::Entry* data = SoundCache::Acquire(path.c_str(), LoadSampleRate(loadFlags), false, result);
+    lock.lock();
+    SoundSlot& current = g_soundSlots[index];
+    if (current.generation != generation || current.state != SlotState::Loaded) {
+        SoundCache::Release(data);
+        return nullptr;
+    }
+    AttachReloadedData(current, data, result);
+    return current.evicted ? nullptr : &current;
+}
+
+// Whether a loaded sound is playing as far as the caller is concerned: really, virtually,
+// or waiting to start once its evicted data has been decoded again.
+static bool IsSlotPlaying(SoundSlot& slot) {
+    return slot.virtualPlayback.active || slot.playOnReload || ma_sound_is_playing(&slot.sound);
+}
+
+// Pins or unpins a sound; pinning an evicted sound brings its PCM back.
+static void SetSlotPinned(SoundSlot& slot, bool pinned) {
+    slot.pinned = pinned;
+    if (pinned && slot.evicted) {
+        RequestReload(slot, false, false);
+        SubmitRequestedReloadsLocked(); // Only called by the pinning exports, never on the audio thread
+    }
+    else if (!pinned) {
+        EnforceMemoryBudgetLocked();
+    }
+}
+
+// Resolves a string ID for a queued command, reporting unknown IDs and sounds that are
+// still loading. 'action' describes the command for the warning (e.g. "play").
+static SoundSlot* ResolveId(const char* soundId, const char* action) {
+    int64_t index = FindSlotIndex(soundId);
+    if (index < 0) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to %s non-existent sound ID '%s'.", action, soundId);
+        return nullptr;
+    }
+    SoundSlot& slot = g_soundSlots[static_cast<size_t>(index)];
+    if (slot.state != SlotState::Loaded) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to %s sound ID '%s' before it finished loading.", action, soundId);
+        return nullptr;
+    }
+    return &slot;
+}
+
+// Resolves a handle for a queued command, reporting invalid or stale handles.
+static SoundSlot* ResolveHandleChecked(SoundHandle handle, const char* action) {
+    SoundSlot* slot = ResolveHandle(handle);
+    if (!slot) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to %s invalid sound handle %u.", action, static_cast<unsigned>(handle));
+    }
+    return slot;
+}
+
+// Applies one SetSoundParametersBatch entry, with the same clamping as the individual
+// setters. Called with g_registryMutex held.
+// Sets the volume of a sound, as SetSoundVolume does, or of a voice.
+static void SetPlaybackVolume(SoundSlot& slot, float volume) {
+    ma_sound_set_volume(&slot.sound, volume);
+}
+
+static void SetPlaybackVolume(Voice& voice, float volume) {
+    voice.volume = volume;
+    ApplyEmitter(voice);
+}
+
+// Positions a sound that got no emitter, which miniaudio then spatializes. Voices always
+// have one.
+static void PlaceUnspatialized(SoundSlot& slot, float x, float y, float z) {
+    ma_sound_set_position(&slot.sound, x, y, z);
+}
+
+static void PlaceUnspatialized(Voice&, float, float, float) {
+}
+
+// Applies the fields of an update to a sound or voice. Positions go to the emitter, and
+// pan and pitch are combined with its results (see "Emitters").
+template <typename Owner>
+static void ApplyParamsTo(Owner& owner, const SoundParamUpdate& update) {
+    if (update.flags & SOUNDSYSTEM_PARAM_POSITION) {
+        if (owner.emitter != EmitterStore::kNoEmitter) {
+            g_emitters.SetPosition(owner.emitter, update.x, update.y, update.z);
+        }
+        else {
+            PlaceUnspatialized(owner, update.x, update.y, update.z);
+        }
+    }
+    if (update.flags & SOUNDSYSTEM_PARAM_VOLUME) {
+        SetPlaybackVolume(owner, std::clamp(update.volume, 0.0f, 1.0f));
+    }
+    if (update.flags & SOUNDSYSTEM_PARAM_PAN) {
+        owner.pan = std::clamp(update.pan, -1.0f, 1.0f);
+    }
+    if (update.flags & SOUNDSYSTEM_PARAM_PITCH) {
+        owner.pitch = update.pitch > 0.0f ? update.pitch : 0.001f;
+    }
+    if (update.flags & (SOUNDSYSTEM_PARAM_PAN | SOUNDSYSTEM_PARAM_PITCH)) {
+        ApplyEmitter(owner);
+    }
+}
+
+static void ApplyParamUpdate(const SoundParamUpdate& update) {
+    if (update.flags & SOUNDSYSTEM_PARAM_VOICE) {
+        // As with the voice commands, a finished instance is expected and ignored.
+        Voice* voice = ResolveVoice(update.handle);
+        if (!voice) {
+            SOUND_LOG_TRACE("SoundSystem: Ignoring update for finished voice %u.", static_cast<unsigned>(update.handle));
+            return;
+        }
+        ApplyParamsTo(*voice, update);
+    }
+    else {
+        SoundSlot* slot = ResolveHandleChecked(update.handle, "update");
+        if (!slot) {
+            return;
+        }
+        ApplyParamsTo(*slot, update);
+    }
+}
+
+// --- Command queue ---
+// Exports that change playback state don't call miniaudio themselves. They push a
+// SoundCommand onto g_commands, which never blocks the caller, and the queued commands
+// are applied in one batch under g_registryMutex: by UpdateSoundSystem(), or at the end
+// of every audio callback if the mutex is free at that moment. Both also sweep the voices
+// and run the emitter pass (UpdatePlaybackLocked); queries only apply the queue.
+//
+// g_registryMutex guards the sound table (slots, ID table, free list). It is only taken
+// by loads, unloads, queries and whoever applies the command batch; the audio thread
+// only ever try-locks it.
+
+enum class CommandType : uint8_t {
+    Play,
+    Stop,
+    Pause,
+    Resume,
+    SetVolume,
+    SetPan,
+    SetPitch,
+    SetPosition,
+    SetMasterVolume,
+    SetListenerPosition,
+    SetListenerOrientation,
+    StopVoice,
+    SetVoiceVolume,
+    SetVoicePan,
+    SetVoicePitch,
+    SetVoicePosition,
+    SetVelocity,
+    SetVoiceVelocity,
+    SetListenerVelocity,
+    SetBusVolume,
+    PauseBus,
+    ResumeBus,
+};
+
+// IDs up to this length are copied into the command and resolved when it is applied.
+// Longer IDs are resolved to a handle by the caller.
+static const size_t kMaxQueuedIdLength = 63;
+
+struct SoundCommand {
+    CommandType type;
+    bool loop = false;                  // Play: looping state
+    SoundHandle handle = SOUNDSYSTEM_INVALID_HANDLE; // Target sound when 'id' is empty, or the VoiceHandle for voice commands
+    float values[3] = { 0.0f, 0.0f, 0.0f }; // Volume/pan/pitch in [0], positions and vectors in [0..2]
+    char id[kMaxQueuedIdLength + 1] = {};   // Target sound's string ID, or empty; the bus name for bus commands
+};
+
+static const size_t kCommandQueueCapacity = 8192;
+static BoundedMpmcQueue<SoundCommand, kCommandQueueCapacity> g_commands;
+
+// The most commands a single batch has had to apply, for GetSoundSystemStats.
+// Guarded by g_registryMutex.
+static size_t g_commandQueuePeak = 0;
+
+// Describes a command for warnings about its target.
+static const char* DescribeCommand(CommandType type) {
+    switch (type) {
+    case CommandType::Play:        return "play";
+    case CommandType::Stop:        return "stop";
+    case CommandType::Pause:       return "pause";
+    case CommandType::Resume:      return "resume";
+    case CommandType::SetVolume:   return "set volume for";
+    case CommandType::SetPan:      return "set pan for";
+    case CommandType::SetPitch:    return "set pitch for";
+    case CommandType::SetPosition: return "set position for";
+    case CommandType::SetVelocity: return "set velocity for";
+    default:                       return "update";
+    }
+}
+
+// Applies a command addressed to a voice. Voices recycle themselves when they finish, so
+// a command for a voice that has already finished is expected and silently ignored.
+static void ApplyVoiceCommand(const SoundCommand& command) {
+    Voice* voice = ResolveVoice(command.handle);
+    if (!voice) {
+        SOUND_LOG_TRACE("SoundSystem: Ignoring command for finished voice %u.", static_cast<unsigned>(command.handle));
+        return;
+    }
+    switch (command.type) {
+    case CommandType::StopVoice:
+        RecycleVoice(*voice);
+        SOUND_LOG_DEBUG("SoundSystem: Stopped voice %u.", voice->index);
+        break;
+    case CommandType::SetVoiceVolume:
+        SetPlaybackVolume(*voice, std::clamp(command.values[0], 0.0f, 1.0f));
+        break;
+    case CommandType::SetVoicePan:
+        voice->pan = std::clamp(command.values[0], -1.0f, 1.0f);
+        ApplyEmitter(*voice);
+        break;
+    case CommandType::SetVoicePitch:
+        voice->pitch = command.values[0] > 0.0f ? command.values[0] : 0.001f;
+        ApplyEmitter(*voice);
+        break;
+    case CommandType::SetVoicePosition:
+        g_emitters.SetPosition(voice->emitter, command.values[0], command.values[1], command.values[2]);
+        break;
+    case CommandType::SetVoiceVelocity:
+        g_emitters.SetVelocity(voice->emitter, command.values[0], command.values[1], command.values[2]);
+        break;
+    default:
+        break;
+    }
+}
+
+// Applies a command addressed to a bus by name.
+static void ApplyBusCommand(const SoundCommand& command) {
+    int64_t index = FindBus(command.id);
+    if (index < 0) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to update non-existent bus '%s'.", command.id);
+        return;
+    }
+    Bus& bus = g_buses[static_cast<size_t>(index)];
+    switch (command.type) {
+    case CommandType::SetBusVolume:
+        bus.volume = std::max(command.values[0], 0.0f);
+        ma_sound_group_set_volume(&bus.group, bus.volume);
+        SOUND_LOG_DEBUG("SoundSystem: Bus '%s' volume set to %g.", bus.name.c_str(), bus.volume);
+        break;
+    case CommandType::PauseBus:
+        if (!bus.paused) {
+            ma_sound_group_stop(&bus.group);
+            bus.paused = true;
+            SOUND_LOG_DEBUG("SoundSystem: Paused bus '%s'.", bus.name.c_str());
+        }
+        break;
+    case CommandType::ResumeBus:
+        if (bus.paused) {
+            ma_sound_group_start(&bus.group);
+            bus.paused = false;
+            SOUND_LOG_DEBUG("SoundSystem: Resumed bus '%s'.", bus.name.c_str());
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Applies one command. Called with g_registryMutex held.
+static void ApplyCommand(const SoundCommand& command) {
+    // Engine-wide commands have no target sound.
+    switch (command.type) {
+    case CommandType::SetMasterVolume:
+        // No need to capture return value, as ma_engine_set_volume returns void
+        ma_engine_set_volume(&g_engine, command.values[0]);
+        SOUND_LOG_DEBUG("SoundSystem: Master volume set to %g.", command.values[0]);
+        return;
+    case CommandType::SetListenerPosition:
+        // No need to capture return value, as ma_engine_listener_set_position returns void
+        ma_engine_listener_set_position(&g_engine, 0, command.values[0], command.values[1], command.values[2]); // Listener 0 is the default
+        g_emitters.MarkStale();
+        SOUND_LOG_TRACE("SoundSystem: Listener position set to (%g, %g, %g).", command.values[0], command.values[1], command.values[2]);
+        return;
+    case CommandType::SetListenerOrientation:
+        // The ma_engine_listener_set_direction function (with 4 arguments) sets the "at" (forward) vector.
+        // If your miniaudio.h does not define ma_engine_listener_set_up,
+        // then the up vector is either implicitly handled or not directly settable via an API.
+        ma_engine_listener_set_direction(&g_engine, 0, command.values[0], command.values[1], command.values[2]);
+        g_emitters.MarkStale();
+        SOUND_LOG_TRACE("SoundSystem: Listener orientation set (Forward: (%g, %g, %g)).", command.values[0], command.values[1], command.values[2]);
+        return;
+    case CommandType::SetListenerVelocity:
+        // Only read for the doppler shift, by the emitter pass.
+        ma_engine_listener_set_velocity(&g_engine, 0, command.values[0], command.values[1], command.values[2]);
+        g_emitters.MarkStale();
+        SOUND_LOG_TRACE("SoundSystem: Listener velocity set to (%g, %g, %g).", command.values[0], command.values[1], command.values[2]);
+        return;
+    case CommandType::StopVoice:
+    case CommandType::SetVoiceVolume:
+    case CommandType::SetVoicePan:
+    case CommandType::SetVoicePitch:
+    case CommandType::SetVoicePosition:
+    case CommandType::SetVoiceVelocity:
+        ApplyVoiceCommand(command);
+        return;
+    case CommandType::SetBusVolume:
+    case CommandType::PauseBus:
+    case CommandType::ResumeBus:
+        ApplyBusCommand(command);
+        return;
+    default:
+        break;
+    }
+
+    const char* action = DescribeCommand(command.type);
+    SoundSlot* slot = command.id[0] != '\0' ? ResolveId(command.id, action) : ResolveHandleChecked(command.handle, action);
+    if (!slot) {
+        return;
+    }
+
+    switch (command.type) {
+    case CommandType::Play:        PlaySlot(*slot, command.loop); break;
+    case CommandType::Stop:        StopSlot(*slot); break;
+    case CommandType::Pause:       PauseSlot(*slot); break;
+    case CommandType::Resume:      ResumeSlot(*slot); break;
+    case CommandType::SetVolume:   SetSlotVolume(*slot, command.values[0]); break;
+    case CommandType::SetPan:      SetSlotPan(*slot, command.values[0]); break;
+    case CommandType::SetPitch:    SetSlotPitch(*slot, command.values[0]); break;
+    case CommandType::SetPosition: SetSlotPosition(*slot, command.values[0], command.values[1], command.values[2]); break;
+    case CommandType::SetVelocity: SetSlotVelocity(*slot, command.values[0], command.values[1], command.values[2]); break;
+    default: break;
+    }
+}
+
+// Applies the commands queued so far. Called with g_registryMutex held. Commands pushed
+// while the batch is being applied wait for the next batch, so a busy producer can't keep
+// the audio thread in here indefinitely.
+static void ApplyCommandBatchLocked() {
+    size_t count = g_commands.SizeApprox();
+    g_commandQueuePeak = std::max(g_commandQueuePeak, count);
+    SoundCommand command;
+    for (size_t i = 0; i < count && g_commands.TryPop(command); ++i) {
+        ApplyCommand(command);
+    }
+}
+
+// Applies the queued commands from a game thread: the batch, then the work the audio
+// thread had to leave to one (starting reloads). Queries and loads only need the queue
+// applied, so this is all they run. Called with g_registryMutex held.
+static void ApplyPendingCommandsLocked() {
+    ApplyCommandBatchLocked();
+    SubmitRequestedReloadsLocked();
+}
+
+// The once-a-block update, run by the audio callback and by UpdateSoundSystem: frees the
+// voices that finished since the last one (so commands in the batch can't reach them and
+// new instances can use them), applies the batch, then spatializes every playing sound.
+// This is the part the audio thread runs, so queries never pay for the voice sweep or the
+// emitter pass, however often they're called. The pass only runs when something it reads
+// has changed since the last one; a block whose try-lock failed leaves that flagged, so
+// the next block that gets the lock catches up. Called with g_registryMutex held.
+static void UpdatePlaybackLocked() {
+    UpdateVoices();
+    ApplyCommandBatchLocked();
+    if (g_emitters.Stale()) {
+        UpdateEmittersLocked();
+        SteerBinauralSoundsLocked();
+    }
+}
+
+// Queues a command for the next batch.
+static void EnqueueCommand(const SoundCommand& command) {
+    while (!g_commands.TryPush(command)) {
+        // The queue only fills up if nothing has applied it for a long time (no audio
+        // callback and no UpdateSoundSystem calls). Apply the backlog here instead of
+        // dropping the command.
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        ApplyPendingCommandsLocked();
+    }
+}
+
+// Queues a command for the sound with the given string ID. 'function' names the export
+// for the null-ID error.
+static void EnqueueIdCommand(SoundCommand& command, const char* soundId, const char* function) {
+    if (!soundId) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: %s received null soundId.", function);
+        return;
+    }
+    size_t length = std::strlen(soundId);
+    if (length <= kMaxQueuedIdLength) {
+        std::memcpy(command.id, soundId, length + 1);
+    }
+    else {
+        // Too long to copy into the command; resolve it to a handle now.
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (!ResolveId(soundId, DescribeCommand(command.type))) {
+            return;
+        }
+        command.handle = MakeHandle(static_cast<uint32_t>(FindSlotIndex(soundId)));
+    }
+    EnqueueCommand(command);
+}
+
+// Queues a command for the bus called 'busName', which is looked up when the command is
+// applied. Bus names always fit in the command (CreateBus enforces it).
+static void EnqueueBusCommand(SoundCommand& command, const char* busName, const char* function) {
+    if (!busName) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: %s received null busName.", function);
+        return;
+    }
+    size_t length = std::strlen(busName);
+    if (length > kMaxQueuedIdLength) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: %s: no bus is called '%s'.", function, busName);
+        return;
+    }
+    std::memcpy(command.id, busName, length + 1);
+    EnqueueCommand(command);
+}
+
+// Queues a command for the sound with the given handle. Handles are validated when
+// the command is applied.
+static void EnqueueHandleCommand(SoundCommand& command, SoundHandle handle) {
+    command.handle = handle;
+    EnqueueCommand(command);
+}
+
+static SoundCommand MakeCommand(CommandType type, float x = 0.0f, float y = 0.0f, float z = 0.0f) {
+    SoundCommand command;
+    command.type = type;
+    command.values[0] = x;
+    command.values[1] = y;
+    command.values[2] = z;
+    return command;
+}
+
+// --- Statistics ---
+// Counters behind GetSoundSystemStats. Callback timings are only written by the thread
+// that mixes (the device's audio thread, or the caller of ReadMixedFrames) using relaxed,
+// uncontended atomic adds, so leaving them on costs two clock reads and a handful of adds
+// per period. Everything else is read from state the sound system keeps anyway.
+
+// Callback durations go into log-linear buckets, 8 per power of two of nanoseconds (each
+// about 9% wide), so percentiles can be read without storing individual samples.
+static const uint32_t kStatsSubBuckets = 8;
+static const uint32_t kStatsBuckets = 40 * kStatsSubBuckets; // The last one ends near 2^42 ns, over an hour
+
+static std::atomic<uint64_t> g_callbackCount{ 0 };
+static std::atomic<uint64_t> g_callbackTotalNs{ 0 };
+static std::atomic<uint64_t> g_callbackMaxNs{ 0 };
+static std::atomic<uint64_t> g_callbackOverruns{ 0 };
+static std::atomic<uint64_t> g_skippedCommandBatches{ 0 };
+static std::atomic<uint32_t> g_callbackHistogram[kStatsBuckets];
+
+static uint32_t StatsBucket(uint64_t ns) {
+    if (ns < kStatsSubBuckets) {
+        return static_cast<uint32_t>(ns);
+    }
+    uint32_t msb = 0;
+    for (uint64_t v = ns; v > 1; v >>= 1) {
+        ++msb;
+    }
+    // The three bits below the leading one pick the sub-bucket within its power of two.
+    uint32_t sub = static_cast<uint32_t>(ns >> (msb - 3)) & (kStatsSubBuckets - 1);
+    return std::min((msb - 2) * kStatsSubBuckets + sub, kStatsBuckets - 1);
+}
+
+// The largest duration (in ns) that lands in 'bucket'; percentiles report this bound.
+static uint64_t StatsBucketUpperBound(uint32_t bucket) {
+    if (bucket < kStatsSubBuckets) {
+        return bucket;
+    }
+    uint32_t msb = bucket / kStatsSubBuckets + 2;
+    uint64_t sub = bucket % kStatsSubBuckets;
+    return ((kStatsSubBuckets + sub + 1) << (msb - 3)) - 1;
+}
+
+// Records one mix of 'frameCount' frames that took 'ns' nanoseconds.
+static void RecordCallback(uint64_t ns, ma_uint64 frameCount) {
+    g_callbackCount.fetch_add(1, std::memory_order_relaxed);
+    g_callbackTotalNs.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > g_callbackMaxNs.load(std::memory_order_relaxed)) {
+        g_callbackMaxNs.store(ns, std::memory_order_relaxed); // Only the mixing thread writes it
+    }
+    g_callbackHistogram[StatsBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    // Taking longer than the audio it produced means the device will run dry if it repeats.
+    uint64_t periodNs = frameCount * 1000000000ull / ma_engine_get_sample_rate(&g_engine);
+    if (ns > periodNs) {
+        g_callbackOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Zeroes the callback counters. A callback running concurrently may lose its sample.
+static void ResetCallbackStats() {
+    g_callbackCount.store(0, std::memory_order_relaxed);
+    g_callbackTotalNs.store(0, std::memory_order_relaxed);
+    g_callbackMaxNs.store(0, std::memory_order_relaxed);
+    g_callbackOverruns.store(0, std::memory_order_relaxed);
+    g_skippedCommandBatches.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint32_t>& bucket : g_callbackHistogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Returns the duration (in microseconds) below which 'fraction' of the recorded callbacks fall.
+static float CallbackPercentileUs(const uint32_t* histogram, uint64_t total, double fraction) {
+    if (total == 0) {
+        return 0.0f;
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kStatsBuckets; ++i) {
+        seen += histogram[i];
+        if (seen >= target) {
+            return static_cast<float>(StatsBucketUpperBound(i) / 1000.0);
+        }
+    }
+    return static_cast<float>(StatsBucketUpperBound(kStatsBuckets - 1) / 1000.0);
+}
+
+// Runs on the audio thread after each period has been mixed.
+static void OnEngineProcess(void* pUserData, float* pFramesOut, ma_uint64 frameCount) {
+    (void)pUserData;
+    (void)pFramesOut;
+    (void)frameCount;
+
+    // Never wait on the audio thread: if a loader or the game thread holds the registry,
+    // leave the batch for the next callback.
+    std::unique_lock<std::mutex> lock(g_registryMutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        UpdatePlaybackLocked();
+    }
+    else {
+        g_skippedCommandBatches.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Mixes the next frames and records how long that took, including the command batch
+// OnEngineProcess applies at the end. The mix is clipped here rather than by the device
+// (which is opened with noClip) so the clip runs on the SIMD kernels and the output of
+// ReadMixedFrames is the same as what the device plays.
+static ma_result MixFrames(void* pFramesOut, ma_uint64 frameCount, ma_uint64* pFramesRead) {
+    auto start = std::chrono::steady_clock::now();
+    ma_uint64 framesRead = 0;
+    ma_result result = ma_engine_read_pcm_frames(&g_engine, pFramesOut, frameCount, &framesRead);
+    MixKernels::Active().clip(static_cast<float*>(pFramesOut), static_cast<size_t>(framesRead * ma_engine_get_channels(&g_engine)));
+    if (pFramesRead) {
+        *pFramesRead = framesRead;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    RecordCallback(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), frameCount);
+    return result;
+}
+
+// The device's data callback. Does what miniaudio's default one does, timed.
+static void OnDeviceData(ma_device* pDevice, void* pFramesOut, const void* pFramesIn, ma_uint32 frameCount) {
+    (void)pDevice;
+    (void)pFramesIn;
+    MixFrames(pFramesOut, frameCount, NULL);
+}
+
+// Low-pass filter order for miniaudio's linear resampler at each SOUNDSYSTEM_RESAMPLER_* level.
+static ma_uint32 ResamplerFilterOrder(uint32_t quality) {
+    switch (quality) {
+    case SOUNDSYSTEM_RESAMPLER_FAST: return 0; // No filter: cheapest, but high notes can alias
+    case SOUNDSYSTEM_RESAMPLER_HIGH: return 8; // MA_MAX_FILTER_ORDER
+    default:                         return 4; // miniaudio's default
+    }
+}
+
+// Opens the playback device for 'config' and fills in the values the device settled on.
+static ma_result OpenDevice(SoundSystemConfig& config) {
+    // The same settings ma_engine_init uses for the device it would open itself,
+    // plus the profile and resampler it doesn't expose.
+    ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
+    deviceConfig.playback.format = ma_format_f32; // The engine mixes in 32-bit float
+    deviceConfig.playback.channels = config.channels;
+    deviceConfig.sampleRate = config.sampleRate;
+    deviceConfig.periodSizeInFrames = config.periodSizeInFrames;
+    deviceConfig.periodSizeInMilliseconds = config.periodSizeInMilliseconds;
+    deviceConfig.performanceProfile = config.latencyProfile == SOUNDSYSTEM_LATENCY_POWER_SAVING
+        ? ma_performance_profile_conservative : ma_performance_profile_low_latency;
+    deviceConfig.resampling.linear.lpfOrder = ResamplerFilterOrder(config.resamplerQuality);
+    deviceConfig.dataCallback = OnDeviceData;
+    deviceConfig.noPreSilencedOutputBuffer = MA_TRUE; // The engine writes every frame
+    deviceConfig.noClip = MA_TRUE;                    // MixFrames clips
+    ma_result result = ma_device_init(NULL, &deviceConfig, &g_device);
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+
+    // The backend may not grant what was asked for. The period is reported at the
+    // engine's rate, which differs from the hardware's when the device resamples.
+    ma_uint32 hardwareRate = g_device.playback.internalSampleRate;
+    ma_uint32 hardwarePeriod = g_device.playback.internalPeriodSizeInFrames;
+    config.sampleRate = g_device.sampleRate;
+    config.channels = g_device.playback.channels;
+    if (hardwareRate > 0) {
+        config.periodSizeInFrames = static_cast<uint32_t>(static_cast<uint64_t>(hardwarePeriod) * config.sampleRate / hardwareRate);
+        config.periodSizeInMilliseconds = static_cast<uint32_t>((static_cast<uint64_t>(hardwarePeriod) * 1000 + hardwareRate / 2) / hardwareRate);
+    }
+    return MA_SUCCESS;
+}
+
+// Starts the log and loader threads, allocates the voice pool, opens the device and
+// initializes g_engine. Shared by every initializer.
+static bool StartSoundSystem(const SoundSystemConfig& requested) {
+    // Start delivering log messages from the background thread.
+    SoundLog::Start();
+
+    SoundSystemConfig config = requested;
+    if (config.latencyProfile > SOUNDSYSTEM_LATENCY_POWER_SAVING) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Unknown latency profile %u; using low latency.", config.latencyProfile);
+        config.latencyProfile = SOUNDSYSTEM_LATENCY_LOW;
+    }
+    if (config.resamplerQuality > SOUNDSYSTEM_RESAMPLER_HIGH) {
+        SOUND_LOG_WARNING("SoundSystem WARNING: Unknown resampler quality %u; using the default.", config.resamplerQuality);
+        config.resamplerQuality = SOUNDSYSTEM_RESAMPLER_DEFAULT;
+    }
+    bool noDevice = (config.flags & SOUNDSYSTEM_INIT_NO_DEVICE) != 0;
+
+    // Allocate the voice pool for PlaySoundInstance up front, so playing an instance only
+    // takes a voice from it. The mixer that plays the voices is sized with the engine below.
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_voices.reset(new (std::nothrow) Voice[kVoicePoolSize]);
+        if (!g_voices) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to allocate the voice pool.");
+            SoundLog::Stop();
+            return false;
+        }
+        ++g_systemGeneration;
+        g_freeVoices.clear();
+        g_freeVoices.reserve(kVoicePoolSize);
+        g_emitters.Clear();
+        g_dopplerFactor = 1.0f;
+        for (uint32_t i = kVoicePoolSize; i-- > 0;) {
+            g_voices[i].index = i;
+            g_voices[i].emitter = g_emitters.Add();
+            if (g_voices[i].emitter == EmitterStore::kNoEmitter) {
+                SOUND_LOG_ERROR("SoundSystem ERROR: Failed to allocate the voice pool.");
+                g_voices.reset();
+                g_freeVoices.clear();
+                g_emitters.Clear();
+                SoundLog::Stop();
+                return false;
+            }
+            g_freeVoices.push_back(i); // Voice 0 is handed out first
+        }
+    }
+
+    // Pick the mixing kernels once, before anything can mix: the widest SIMD set this CPU
+    // supports unless the caller asked for the scalar ones.
+    MixKernels::Select((config.flags & SOUNDSYSTEM_INIT_SCALAR_MIX) ? MixKernels::Level::Scalar : MixKernels::Level::AVX512);
+
+    // Start the threads that decode sounds for LoadSoundAsync.
+    SoundLoader::Start(0);
+
+    // Statistics describe this session only.
+    ResetCallbackStats();
+    SoundCache::ResetStats();
+    g_commandQueuePeak = 0;
+
+    // 3D audio needs no engine flags: sounds are spatialized by their emitters (see
+    // "Emitters"), relative to miniaudio's listener 0.
+    ma_engine_config engineConfig = ma_engine_config_init();
+
+    // Apply queued commands from the audio thread after every period.
+    engineConfig.onProcess = OnEngineProcess;
+
+    ma_result result;
+    if (noDevice) {
+        // Without a device nothing picks a format, so default to 48 kHz stereo. There is no
+        // period either: each ReadMixedFrames call mixes as many frames as it asks for.
+        config.sampleRate = config.sampleRate ? config.sampleRate : 48000;
+        config.channels = config.channels ? config.channels : 2;
+        config.periodSizeInFrames = 0;
+        config.periodSizeInMilliseconds = 0;
+        engineConfig.noDevice = MA_TRUE;
+        engineConfig.sampleRate = config.sampleRate;
+        engineConfig.channels = config.channels;
+        result = MA_SUCCESS;
+    }
+    else {
+        // Find and open the default audio device; the engine starts it once initialized.
+        result = OpenDevice(config);
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to open the audio device. Result: %d", result);
+        }
+        engineConfig.pDevice = &g_device;
+    }
+
+    // Initialize the miniaudio engine.
+    if (result == MA_SUCCESS) {
+        result = ma_engine_init(&engineConfig, &g_engine);
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to initialize miniaudio engine. Result: %d", result);
+            if (!noDevice) {
+                ma_device_uninit(&g_device);
+            }
+        }
+    }
+
+    // The voice mixer mixes at the engine's format, so it can only be sized now.
+    if (result == MA_SUCCESS && !g_voiceMixer.Init(kVoicePoolSize, ma_engine_get_channels(&g_engine), ma_engine_get_sample_rate(&g_engine))) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to allocate the voice mixer.");
+        if (!noDevice) {
+            ma_device_uninit(&g_device);
+        }
+        ma_engine_uninit(&g_engine);
+        result = MA_OUT_OF_MEMORY;
+    }
+    if (result == MA_SUCCESS && !StartBuses()) {
+        SOUND_LOG_ERROR("SoundSystem ERROR: Failed to create the master bus.");
+        if (!noDevice) {
+            ma_device_uninit(&g_device);
+        }
+        ma_engine_uninit(&g_engine);
+        g_voiceMixer.Shutdown();
+        result = MA_OUT_OF_MEMORY;
+    }
+    if (result != MA_SUCCESS) {
+        SoundLoader::Stop();
+        {
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            g_voices.reset();
+            g_freeVoices.clear();
+            g_emitters.Clear();
+        }
+        SoundLog::Stop();
+        return false;
+    }
+    g_noDevice = noDevice;
+    g_effectiveConfig = config;
+
+    SOUND_LOG_INFO("SoundSystem: Initialized successfully (%u Hz, %u channels, %s).",
+        config.sampleRate, config.channels, noDevice ? "no device" : "device");
+    SOUND_LOG_INFO("SoundSystem: Mixing kernels: %s.", MixKernels::LevelName(MixKernels::Active().level));
+    if (!noDevice) {
+        SOUND_LOG_INFO("SoundSystem: Device period is %u frames (%u ms), %s profile.", config.periodSizeInFrames,
+            config.periodSizeInMilliseconds, config.latencyProfile == SOUNDSYSTEM_LATENCY_POWER_SAVING ? "power saving" : "low latency");
+    }
+    return true;
+}
+
+extern "C" {
+
+    SOUNDSYSTEM_API bool InitializeSoundSystem() {
+        // All defaults: the device's native format and miniaudio's low-latency period.
+        SoundSystemConfig config = {};
+        return StartSoundSystem(config);
+    }
+
+    SOUNDSYSTEM_API bool InitializeSoundSystemEx(const SoundSystemConfig* config) {
+        SoundSystemConfig defaults = {};
+        return StartSoundSystem(config ? *config : defaults);
+    }
+
+    SOUNDSYSTEM_API bool GetSoundSystemConfig(SoundSystemConfig* out) {
+        if (!out) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: GetSoundSystemConfig received null out.");
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (!g_voices) {
+            return false; // Not initialized
+        }
+        *out = g_effectiveConfig;
+        return true;
+    }
+
+    SOUNDSYSTEM_API bool InitializeSoundSystemNoDevice(uint32_t sampleRate, uint32_t channels) {
+        if (sampleRate == 0 || channels == 0) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: InitializeSoundSystemNoDevice needs a sample rate and channel count.");
+            return false;
+        }
+        SoundSystemConfig config = {};
+        config.sampleRate = sampleRate;
+        config.channels = channels;
+        config.flags = SOUNDSYSTEM_INIT_NO_DEVICE;
+        return StartSoundSystem(config);
+    }
+
+    SOUNDSYSTEM_API uint64_t ReadMixedFrames(float* out, uint64_t frameCount) {
+        if (!g_noDevice) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: ReadMixedFrames needs SOUNDSYSTEM_INIT_NO_DEVICE; the device is mixing.");
+            return 0;
+        }
+        if (!out) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: ReadMixedFrames received null out.");
+            return 0;
+        }
+        // The caller stands in for the audio thread: this mixes the frames and then runs
+        // OnEngineProcess, which applies queued commands just as a device callback would.
+        ma_uint64 framesRead = 0;
+        ma_result result = MixFrames(out, frameCount, &framesRead);
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to mix frames. Result: %d", result);
+        }
+        return framesRead;
+    }
+
+    SOUNDSYSTEM_API void ShutdownSoundSystem() {
+        // Finish the loads already decoding and cancel the rest before tearing down the table.
+        SoundLoader::Stop();
+
+        {
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+
+            // Binaural nodes go first, while the sounds in front of them still exist.
+            DisableBinauralLocked();
+            g_hrtf.reset();
+
+            // Stop the voices before the sounds whose data they read.
+            for (uint32_t i = 0; g_voices && i < kVoicePoolSize; ++i) {
+                g_voiceMixer.Stop(i);
+                UnbindVoice(g_voices[i]);
+            }
+            g_voices.reset();
+            g_freeVoices.clear();
+            g_playingSlots.clear();
+            g_emitters.Clear();
+            g_activeVoices = 0;
+            g_virtualVoices = 0;
+            std::fill(std::begin(g_voiceGroupActive), std::end(g_voiceGroupActive), 0u);
+
+            // Walk the slab and uninitialize every loaded sound to free resources.
+            g_soundSlots.ForEach([](SoundSlot& slot) {
+                if (slot.state == SlotState::Loaded) {
+                    ma_sound_uninit(&slot.sound); // Uninitialize the sound
+                    ReleaseDecodedData(slot);
+                }
+            });
+            g_soundSlots.Clear(); // Release the slab; every handle issued so far is now invalid
+            g_freeSlots.clear();
+            g_loadedSounds.Clear();
+
+            // Nothing plays through the buses any more.
+            StopBuses();
+        }
+
+        // Close the device first: the engine doesn't stop a device it didn't open, and the
+        // device's callback reads from the engine.
+        if (!g_noDevice) {
+            ma_device_uninit(&g_device);
+        }
+
+        // Uninitialize the miniaudio engine. Its bus nodes were the mixer's only callers.
+        ma_engine_uninit(&g_engine);
+        g_voiceMixer.Shutdown();
+        g_noDevice = false;
+
+        // Discard commands that were queued but never applied; their targets are gone.
+        SoundCommand discarded;
+        while (g_commands.TryPop(discarded)) {
+        }
+        SOUND_LOG_INFO("SoundSystem: Shut down successfully.");
+
+        // Deliver any remaining messages and stop the log thread.
+        SoundLog::Stop();
+    }
+
+    SOUNDSYSTEM_API void UpdateSoundSystem() {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        UpdatePlaybackLocked();
+        SubmitRequestedReloadsLocked();
+        if (g_overBudget) {
+            EnforceMemoryBudgetLocked();
+        }
+    }
+
+    SOUNDSYSTEM_API bool LoadSound(const char* filePath, const char* soundId) {
+        if (!filePath || !soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSound received null filePath or soundId.");
+            return false;
+        }
+        return LoadSoundInternal(filePath, soundId, SOUNDSYSTEM_LOAD_DEFAULT) != SOUNDSYSTEM_INVALID_HANDLE;
+    }
+
+    SOUNDSYSTEM_API bool LoadSoundStream(const char* filePath, const char* soundId) {
+        if (!filePath || !soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundStream received null filePath or soundId.");
+            return false;
+        }
+        return LoadSoundInternal(filePath, soundId, SOUNDSYSTEM_LOAD_STREAM) != SOUNDSYSTEM_INVALID_HANDLE;
+    }
+
+    SOUNDSYSTEM_API bool LoadSoundAsync(const char* filePath, const char* soundId, SoundLoadCallback callback, void* userData) {
+        if (!filePath || !soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundAsync received null filePath or soundId.");
+            return false;
+        }
+
+        SoundSlot* slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            int64_t existing = -1;
+            slot = ReserveSlotLocked(soundId, SOUNDSYSTEM_LOAD_DEFAULT, existing);
+            if (!slot) {
+                if (existing < 0 || g_soundSlots[existing].state != SlotState::Loaded) {
+                    return false; // Out of slots, or the ID is still loading
+                }
+                // Already loaded: report it right away, as LoadSound would.
+                SoundHandle handle = MakeHandle(static_cast<uint32_t>(existing));
+                if (callback) {
+                    callback(handle, soundId, true, userData);
+                }
+                return true;
+            }
+        }
+
+        std::string path = filePath;
+        std::string id = soundId;
+        bool submitted = SoundLoader::Submit([slot, path, id, callback, userData](bool cancelled) {
+            SoundHandle handle = SOUNDSYSTEM_INVALID_HANDLE;
+            if (cancelled) {
+                std::lock_guard<std::mutex> lock(g_registryMutex);
+                SOUND_LOG_WARNING("SoundSystem WARNING: Load of sound ID '%s' was cancelled by shutdown.", id.c_str());
+                FreeSlot(*slot);
+                g_loadFinished.notify_all();
+            }
+            else {
+                ma_result result = DecodeIntoSlot(*slot, path.c_str());
+                std::lock_guard<std::mutex> lock(g_registryMutex);
+                handle = FinishLoadLocked(*slot, path.c_str(), result);
+            }
+            if (callback) {
+                callback(handle, id.c_str(), handle != SOUNDSYSTEM_INVALID_HANDLE, userData);
+            }
+        });
+        if (!submitted) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundAsync called before InitializeSoundSystem.");
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            FreeSlot(*slot);
+            return false;
+        }
+        return true;
+    }
+
+    SOUNDSYSTEM_API int GetSoundLoadState(const char* soundId) {
+        if (!soundId) {
+            return SOUNDSYSTEM_LOAD_STATE_NOT_LOADED;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t index = FindSlotIndex(soundId);
+        if (index < 0) {
+            return SOUNDSYSTEM_LOAD_STATE_NOT_LOADED;
+        }
+        return g_soundSlots[index].state == SlotState::Loaded ? SOUNDSYSTEM_LOAD_STATE_LOADED : SOUNDSYSTEM_LOAD_STATE_LOADING;
+    }
+
+    SOUNDSYSTEM_API bool WaitForSound(const char* soundId, uint32_t timeoutMs) {
+        if (!soundId) {
+            return false;
+        }
+        // The ID's slot is looked up again on every wake-up: a failed load frees it.
+        auto finished = [soundId] {
+            int64_t index = FindSlotIndex(soundId);
+            return index < 0 || g_soundSlots[index].state != SlotState::Loading;
+        };
+        std::unique_lock<std::mutex> lock(g_registryMutex);
+        if (timeoutMs == SOUNDSYSTEM_WAIT_INFINITE) {
+            g_loadFinished.wait(lock, finished);
+        }
+        else {
+            g_loadFinished.wait_for(lock, std::chrono::milliseconds(timeoutMs), finished);
+        }
+        int64_t index = FindSlotIndex(soundId);
+        return index >= 0 && g_soundSlots[index].state == SlotState::Loaded;
+    }
+
+    SOUNDSYSTEM_API void UnloadSound(const char* soundId) {
+        if (!soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: UnloadSound received null soundId.");
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        // Apply commands queued before the unload while their target still exists.
+        ApplyPendingCommandsLocked();
+        if (SoundSlot* slot = ResolveId(soundId, "unload")) {
+            ReleaseSlot(slot->index);
+        }
+    }
+
+    SOUNDSYSTEM_API void SndPlaySound(const char* soundId, bool loop) { // Renamed from PlaySound
+        SoundCommand command = MakeCommand(CommandType::Play);
+        command.loop = loop;
+        EnqueueIdCommand(command, soundId, "SndPlaySound");
+    }
+
+    SOUNDSYSTEM_API void StopSound(const char* soundId) {
+        SoundCommand command = MakeCommand(CommandType::Stop);
+        EnqueueIdCommand(command, soundId, "StopSound");
+    }
+
+    SOUNDSYSTEM_API void PauseSound(const char* soundId) {
+        SoundCommand command = MakeCommand(CommandType::Pause);
+        EnqueueIdCommand(command, soundId, "PauseSound");
+    }
+
+    SOUNDSYSTEM_API void ResumeSound(const char* soundId) {
+        SoundCommand command = MakeCommand(CommandType::Resume);
+        EnqueueIdCommand(command, soundId, "ResumeSound");
+    }
+
+    SOUNDSYSTEM_API void SetMasterVolume(float volume) {
+        // Clamp volume to be within 0.0 and 1.0
+        volume = std::clamp(volume, 0.0f, 1.0f);
+        EnqueueCommand(MakeCommand(CommandType::SetMasterVolume, volume));
+    }
+
+    SOUNDSYSTEM_API void SetSoundVolume(const char* soundId, float volume) {
+        SoundCommand command = MakeCommand(CommandType::SetVolume, volume);
+        EnqueueIdCommand(command, soundId, "SetSoundVolume");
+    }
+
+    SOUNDSYSTEM_API void SetSoundPan(const char* soundId, float pan) {
+        SoundCommand command = MakeCommand(CommandType::SetPan, pan);
+        EnqueueIdCommand(command, soundId, "SetSoundPan");
+    }
+
+    SOUNDSYSTEM_API void SetSoundPitch(const char* soundId, float pitch) {
+        SoundCommand command = MakeCommand(CommandType::SetPitch, pitch);
+        EnqueueIdCommand(command, soundId, "SetSoundPitch");
+    }
+
+    SOUNDSYSTEM_API void SetSoundPosition(const char* soundId, float x, float y, float z) {
+        SoundCommand command = MakeCommand(CommandType::SetPosition, x, y, z);
+        EnqueueIdCommand(command, soundId, "SetSoundPosition");
+    }
+
+    SOUNDSYSTEM_API void SetSoundVelocity(const char* soundId, float x, float y, float z) {
+        SoundCommand command = MakeCommand(CommandType::SetVelocity, x, y, z);
+        EnqueueIdCommand(command, soundId, "SetSoundVelocity");
+    }
+
+    SOUNDSYSTEM_API void SetListenerPosition(float x, float y, float z) {
+        EnqueueCommand(MakeCommand(CommandType::SetListenerPosition, x, y, z));
+    }
+
+    SOUNDSYSTEM_API void SetListenerVelocity(float x, float y, float z) {
+        EnqueueCommand(MakeCommand(CommandType::SetListenerVelocity, x, y, z));
+    }
+
+    SOUNDSYSTEM_API void SetListenerOrientation(float forwardX, float forwardY, float forwardZ) { // Simplified signature
+        EnqueueCommand(MakeCommand(CommandType::SetListenerOrientation, forwardX, forwardY, forwardZ));
+    }
+
+    SOUNDSYSTEM_API bool IsSoundPlaying(const char* soundId) {
+        if (!soundId) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        // Apply queued commands first so a sound started just before this call reports as playing.
+        ApplyPendingCommandsLocked();
+        int64_t index = FindSlotIndex(soundId);
+        if (index >= 0 && g_soundSlots[index].state == SlotState::Loaded) {
+            return IsSlotPlaying(g_soundSlots[index]);
+        }
+        return false;
+    }
+
+    // --- Logging ---
+
+    SOUNDSYSTEM_API void SetSoundLogCallback(SoundLogCallback callback, void* userData) {
+        SoundLog::SetCallback(callback, userData);
+    }
+
+    SOUNDSYSTEM_API void SetSoundLogLevel(int level) {
+        SoundLog::SetLevel(level);
+    }
+
+    // --- Handle-based API ---
+
+    SOUNDSYSTEM_API SoundHandle LoadSoundWithHandle(const char* filePath, const char* soundId) {
+        if (!filePath || !soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundWithHandle received null filePath or soundId.");
+            return SOUNDSYSTEM_INVALID_HANDLE;
+        }
+        return LoadSoundInternal(filePath, soundId, SOUNDSYSTEM_LOAD_DEFAULT);
+    }
+
+    SOUNDSYSTEM_API SoundHandle LoadSoundEx(const char* filePath, const char* soundId, uint32_t loadFlags) {
+        if (!filePath || !soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundEx received null filePath or soundId.");
+            return SOUNDSYSTEM_INVALID_HANDLE;
+        }
+        return LoadSoundInternal(filePath, soundId, loadFlags);
+    }
+
+    SOUNDSYSTEM_API bool LoadSoundFromMemory(const void* data, size_t size, const char* soundId, bool copy) {
+        uint32_t loadFlags = SOUNDSYSTEM_LOAD_COMPRESSED | (copy ? SOUNDSYSTEM_LOAD_COPY_DATA : 0u);
+        return LoadSoundFromMemoryEx(data, size, soundId, loadFlags) != SOUNDSYSTEM_INVALID_HANDLE;
+    }
+
+    SOUNDSYSTEM_API SoundHandle LoadSoundFromMemoryEx(const void* data, size_t size, const char* soundId, uint32_t loadFlags) {
+        if (!data || size == 0 || !soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundFromMemory received null data, zero size or null soundId.");
+            return SOUNDSYSTEM_INVALID_HANDLE;
+        }
+        loadFlags = MemoryLoadFlags(loadFlags);
+        SoundCache::MemoryMode mode = SoundCache::MemoryMode::Decode;
+        if (loadFlags & SOUNDSYSTEM_LOAD_COMPRESSED) {
+            mode = (loadFlags & SOUNDSYSTEM_LOAD_COPY_DATA) ? SoundCache::MemoryMode::Copy : SoundCache::MemoryMode::Reference;
+        }
+        return LoadSharedDataInternal("<memory>", soundId, loadFlags, [&](ma_uint32 sampleRate, ma_result& result) {
+            return SoundCache::AcquireMemory(data, size, sampleRate, mode, result);
+        });
+    }
+
+    SOUNDSYSTEM_API SoundHandle LoadSoundFromPack(const char* packPath, uint64_t offset, uint64_t size, const char* soundId, uint32_t loadFlags) {
+        if (!packPath || !soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundFromPack received null packPath or soundId.");
+            return SOUNDSYSTEM_INVALID_HANDLE;
+        }
+        loadFlags = MemoryLoadFlags(loadFlags);
+        return LoadSharedDataInternal(packPath, soundId, loadFlags, [&](ma_uint32 sampleRate, ma_result& result) -> const SoundCache::Entry* {
+            // The load holds the mapping only while it runs; compressed sounds take their own
+            // reference, and decoded ones don't need the pack once they have their PCM.
+            const MappedFile::View* pack = MappedFile::Open(packPath, result);
+            if (!pack) {
+                return nullptr;
+            }
+            bool keepEncoded = (loadFlags & SOUNDSYSTEM_LOAD_COMPRESSED) != 0;
+            const SoundCache::Entry* data = SoundCache::AcquirePacked(*pack, offset, size, sampleRate, keepEncoded, result);
+            MappedFile::Release(pack);
+            return data;
+        });
+    }
+
+    SOUNDSYSTEM_API int LoadSoundBank(const char* bankPath) {
+        return LoadSoundBankEx(bankPath, SOUNDSYSTEM_LOAD_DEFAULT);
+    }
+
+    SOUNDSYSTEM_API int LoadSoundBankEx(const char* bankPath, uint32_t loadFlags) {
+        if (!bankPath) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadSoundBank received null bankPath.");
+            return -1;
+        }
+        // Hold the mapping for the whole bank so the sounds don't map and unmap it in turn.
+        ma_result result = MA_SUCCESS;
+        const MappedFile::View* bank = MappedFile::Open(bankPath, result);
+        if (!bank) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to open sound bank '%s'. Result: %d", bankPath, result);
+            return -1;
+        }
+        const SoundBank::Header* header = nullptr;
+        const SoundBank::Entry* entries = nullptr;
+        if (!SoundBank::ReadIndex(bank->data, bank->size, header, entries)) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: '%s' is not a valid sound bank.", bankPath);
+            MappedFile::Release(bank);
+            return -1;
+        }
+
+        // Sounds are stored in index order, so reading ahead turns the loads below into one
+        // sequential pass over the file.
+        MappedFile::Prefetch(bank);
+        loadFlags = MemoryLoadFlags(loadFlags);
+        bool keepEncoded = (loadFlags & SOUNDSYSTEM_LOAD_COMPRESSED) != 0;
+        const char* strings = static_cast<const char*>(bank->data) + header->stringsOffset;
+        std::string id;
+        int loaded = 0;
+        for (uint32_t i = 0; i < header->entryCount; ++i) {
+            const SoundBank::Entry& entry = entries[i];
+            id.assign(strings + entry.idOffset, entry.idLength);
+            SoundHandle handle = LoadSharedDataInternal(bankPath, id.c_str(), loadFlags, [&](ma_uint32 sampleRate, ma_result& acquireResult) {
+                if (entry.encoding == SoundBank::kEncodingPcmF32 || entry.encoding == SoundBank::kEncodingPcmS16) {
+                    // Already PCM: played as stored (float straight from the mapping), whatever the flags say.
+                    ma_format format = entry.encoding == SoundBank::kEncodingPcmF32 ? ma_format_f32 : ma_format_s16;
+                    return SoundCache::AcquirePackedPcm(*bank, entry.offset, entry.size, format, entry.channels, entry.sampleRate, acquireResult);
+                }
+                if (entry.encoding != SoundBank::kEncodingFile) {
+                    acquireResult = MA_INVALID_DATA;
+                    return static_cast<const SoundCache::Entry*>(nullptr);
+                }
+                return SoundCache::AcquirePacked(*bank, entry.offset, entry.size, sampleRate, keepEncoded, acquireResult);
+            });
+            if (handle != SOUNDSYSTEM_INVALID_HANDLE) {
+                ++loaded;
+            }
+        }
+        SOUND_LOG_INFO("SoundSystem: Loaded %d of %u sounds from bank '%s'.", loaded, header->entryCount, bankPath);
+        MappedFile::Release(bank); // Unmaps the bank if every sound in it was decoded
+        return loaded;
+    }
+
+    SOUNDSYSTEM_API void UnloadSoundBank(const char* bankPath) {
+        if (!bankPath) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: UnloadSoundBank received null bankPath.");
+            return;
+        }
+        // The index is the only record of which IDs came from the bank. The bank is normally
+        // still mapped by its compressed or pre-decoded sounds, so this maps nothing new.
+        ma_result result = MA_SUCCESS;
+        const MappedFile::View* bank = MappedFile::Open(bankPath, result);
+        if (!bank) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to open sound bank '%s'. Result: %d", bankPath, result);
+            return;
+        }
+        const SoundBank::Header* header = nullptr;
+        const SoundBank::Entry* entries = nullptr;
+        if (SoundBank::ReadIndex(bank->data, bank->size, header, entries)) {
+            const char* strings = static_cast<const char*>(bank->data) + header->stringsOffset;
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            ApplyPendingCommandsLocked();
+            for (uint32_t i = 0; i < header->entryCount; ++i) {
+                int64_t index = FindSlotIndex(strings + entries[i].idOffset, entries[i].idLength,
+                                              HashSoundId(strings + entries[i].idOffset, entries[i].idLength));
+                // A sound still loading belongs to whoever is loading it.
+                if (index >= 0 && g_soundSlots[index].state == SlotState::Loaded) {
+                    ReleaseSlot(static_cast<uint32_t>(index));
+                }
+            }
+        }
+        else {
+            SOUND_LOG_ERROR("SoundSystem ERROR: '%s' is not a valid sound bank.", bankPath);
+        }
+        MappedFile::Release(bank);
+    }
+
+    SOUNDSYSTEM_API SoundHandle GetSoundHandle(const char* soundId) {
+        if (!soundId) {
+            return SOUNDSYSTEM_INVALID_HANDLE;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t index = FindSlotIndex(soundId);
+        return index >= 0 ? MakeHandle(static_cast<uint32_t>(index)) : SOUNDSYSTEM_INVALID_HANDLE;
+    }
+
+    SOUNDSYSTEM_API bool IsSoundHandleValid(SoundHandle handle) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        return ResolveHandle(handle) != nullptr;
+    }
+
+    SOUNDSYSTEM_API void UnloadSoundByHandle(SoundHandle handle) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        // Apply commands queued before the unload while their target still exists.
+        ApplyPendingCommandsLocked();
+        if (SoundSlot* slot = ResolveHandleChecked(handle, "unload")) {
+            ReleaseSlot(slot->index);
+        }
+    }
+
+    SOUNDSYSTEM_API void SndPlaySoundByHandle(SoundHandle handle, bool loop) {
+        SoundCommand command = MakeCommand(CommandType::Play);
+        command.loop = loop;
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void StopSoundByHandle(SoundHandle handle) {
+        SoundCommand command = MakeCommand(CommandType::Stop);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void PauseSoundByHandle(SoundHandle handle) {
+        SoundCommand command = MakeCommand(CommandType::Pause);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void ResumeSoundByHandle(SoundHandle handle) {
+        SoundCommand command = MakeCommand(CommandType::Resume);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void SetSoundVolumeByHandle(SoundHandle handle, float volume) {
+        SoundCommand command = MakeCommand(CommandType::SetVolume, volume);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void SetSoundPanByHandle(SoundHandle handle, float pan) {
+        SoundCommand command = MakeCommand(CommandType::SetPan, pan);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void SetSoundPitchByHandle(SoundHandle handle, float pitch) {
+        SoundCommand command = MakeCommand(CommandType::SetPitch, pitch);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void SetSoundPositionByHandle(SoundHandle handle, float x, float y, float z) {
+        SoundCommand command = MakeCommand(CommandType::SetPosition, x, y, z);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API void SetSoundVelocityByHandle(SoundHandle handle, float x, float y, float z) {
+        SoundCommand command = MakeCommand(CommandType::SetVelocity, x, y, z);
+        EnqueueHandleCommand(command, handle);
+    }
+
+    SOUNDSYSTEM_API bool IsSoundPlayingByHandle(SoundHandle handle) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        // Apply queued commands first so a sound started just before this call reports as playing.
+        ApplyPendingCommandsLocked();
+        SoundSlot* slot = ResolveHandle(handle);
+        return slot ? IsSlotPlaying(*slot) : false;
+    }
+
+    // --- Voices ---
+
+    SOUNDSYSTEM_API VoiceHandle PlaySoundInstance(const char* soundId, float volume, float pitch) {
+        if (!soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: PlaySoundInstance received null soundId.");
+            return SOUNDSYSTEM_INVALID_VOICE;
+        }
+        std::unique_lock<std::mutex> lock(g_registryMutex);
+        // Apply queued commands first so the instance starts at the sound's latest position.
+        ApplyPendingCommandsLocked();
+        SoundSlot* slot = ResolveId(soundId, "play an instance of");
+        bool reloaded = slot && slot->evicted;
+        if (reloaded) {
+            slot = ReloadNow(lock, *slot);
+        }
+        VoiceHandle voice = slot ? PlayInstance(*slot, volume, pitch) : SOUNDSYSTEM_INVALID_VOICE;
+        if (reloaded) {
+            EnforceMemoryBudgetLocked(); // Once the instance holds the data it can't be evicted again
+        }
+        return voice;
+    }
+
+    SOUNDSYSTEM_API VoiceHandle PlaySoundInstanceByHandle(SoundHandle handle, float volume, float pitch) {
+        std::unique_lock<std::mutex> lock(g_registryMutex);
+        ApplyPendingCommandsLocked();
+        SoundSlot* slot = ResolveHandleChecked(handle, "play an instance of");
+        bool reloaded = slot && slot->evicted;
+        if (reloaded) {
+            slot = ReloadNow(lock, *slot);
+        }
+        VoiceHandle voice = slot ? PlayInstance(*slot, volume, pitch) : SOUNDSYSTEM_INVALID_VOICE;
+        if (reloaded) {
+            EnforceMemoryBudgetLocked(); // Once the instance holds the data it can't be evicted again
+        }
+        return voice;
+    }
+
+    SOUNDSYSTEM_API void StopVoice(VoiceHandle voice) {
+        SoundCommand command = MakeCommand(CommandType::StopVoice);
+        EnqueueHandleCommand(command, voice);
+    }
+
+    SOUNDSYSTEM_API void SetVoiceVolume(VoiceHandle voice, float volume) {
+        SoundCommand command = MakeCommand(CommandType::SetVoiceVolume, volume);
+        EnqueueHandleCommand(command, voice);
+    }
+
+    SOUNDSYSTEM_API void SetVoicePan(VoiceHandle voice, float pan) {
+        SoundCommand command = MakeCommand(CommandType::SetVoicePan, pan);
+        EnqueueHandleCommand(command, voice);
+    }
+
+    SOUNDSYSTEM_API void SetVoicePitch(VoiceHandle voice, float pitch) {
+        SoundCommand command = MakeCommand(CommandType::SetVoicePitch, pitch);
+        EnqueueHandleCommand(command, voice);
+    }
+
+    SOUNDSYSTEM_API void SetVoicePosition(VoiceHandle voice, float x, float y, float z) {
+        SoundCommand command = MakeCommand(CommandType::SetVoicePosition, x, y, z);
+        EnqueueHandleCommand(command, voice);
+    }
+
+    SOUNDSYSTEM_API void SetVoiceVelocity(VoiceHandle voice, float x, float y, float z) {
+        SoundCommand command = MakeCommand(CommandType::SetVoiceVelocity, x, y, z);
+        EnqueueHandleCommand(command, voice);
+    }
+
+    SOUNDSYSTEM_API bool IsVoicePlaying(VoiceHandle voice) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        ApplyPendingCommandsLocked();
+        // A voice that reached its end is only freed by the next block's sweep; report it
+        // finished already. A virtual one ends in that sweep.
+        Voice* resolved = ResolveVoice(voice);
+        return resolved && (resolved->virtualPlayback.active || IsPlaybackRunning(*resolved));
+    }
+
+    // --- Voice limits ---
+
+    SOUNDSYSTEM_API void SetMaxVoices(uint32_t maxVoices) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_maxVoices = maxVoices;
+        SOUND_LOG_INFO("SoundSystem: Voice limit set to %u.", maxVoices);
+    }
+
+    SOUNDSYSTEM_API void SetSoundPriority(const char* soundId, int priority) {
+        if (!soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: SetSoundPriority received null soundId.");
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (SoundSlot* slot = ResolveId(soundId, "set priority for")) {
+            slot->priority = std::clamp(priority, 0, 255);
+        }
+    }
+
+    SOUNDSYSTEM_API void SetSoundMaxInstances(const char* soundId, uint32_t maxInstances) {
+        if (!soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: SetSoundMaxInstances received null soundId.");
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (SoundSlot* slot = ResolveId(soundId, "set the instance limit for")) {
+            slot->maxInstances = maxInstances;
+        }
+    }
+
+    SOUNDSYSTEM_API void SetSoundVoiceGroup(const char* soundId, uint32_t group) {
+        if (!soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: SetSoundVoiceGroup received null soundId.");
+            return;
+        }
+        if (group >= kVoiceGroupCount) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Voice group %u is out of range (0-%u).", group, kVoiceGroupCount - 1);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (SoundSlot* slot = ResolveId(soundId, "set the voice group for")) {
+            // Move the sound's playing voices over to the new group's count.
+            g_voiceGroupActive[slot->voiceGroup] -= slot->activeVoices;
+            g_voiceGroupActive[group] += slot->activeVoices;
+            slot->voiceGroup = group;
+        }
+    }
+
+    SOUNDSYSTEM_API void SetVoiceGroupLimit(uint32_t group, uint32_t maxVoices) {
+        if (group >= kVoiceGroupCount) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Voice group %u is out of range (0-%u).", group, kVoiceGroupCount - 1);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_voiceGroupLimits[group] = maxVoices;
+    }
+
+    SOUNDSYSTEM_API uint32_t GetPlayingVoiceCount() {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        ApplyPendingCommandsLocked();
+        return g_activeVoices;
+    }
+
+    // --- Virtual voices ---
+
+    SOUNDSYSTEM_API void SetVirtualVoiceThreshold(float audibility) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_virtualThreshold = std::max(audibility, 0.0f);
+        SOUND_LOG_INFO("SoundSystem: Virtual voice threshold set to %g.", g_virtualThreshold);
+    }
+
+    SOUNDSYSTEM_API uint32_t GetVirtualVoiceCount() {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        ApplyPendingCommandsLocked();
+        return g_virtualVoices;
+    }
+
+    // --- Memory budget ---
+
+    SOUNDSYSTEM_API void SetSoundMemoryBudget(uint64_t bytes) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_memoryBudget = bytes;
+        SOUND_LOG_INFO("SoundSystem: Decoded audio memory budget set to %llu bytes.", static_cast<unsigned long long>(bytes));
+        EnforceMemoryBudgetLocked();
+    }
+
+    SOUNDSYSTEM_API uint64_t GetSoundMemoryBudget() {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        return g_memoryBudget;
+    }
+
+    SOUNDSYSTEM_API void SetSoundPinned(const char* soundId, bool pinned) {
+        if (!soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: SetSoundPinned received null soundId.");
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (SoundSlot* slot = ResolveId(soundId, "pin")) {
+            SetSlotPinned(*slot, pinned);
+        }
+    }
+
+    SOUNDSYSTEM_API void SetSoundPinnedByHandle(SoundHandle handle, bool pinned) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (SoundSlot* slot = ResolveHandleChecked(handle, "pin")) {
+            SetSlotPinned(*slot, pinned);
+        }
+    }
+
+    SOUNDSYSTEM_API bool IsSoundResident(const char* soundId) {
+        if (!soundId) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t index = FindSlotIndex(soundId);
+        return index >= 0 && g_soundSlots[index].state == SlotState::Loaded && !g_soundSlots[index].evicted;
+    }
+
+    // --- Buses ---
+
+    SOUNDSYSTEM_API bool CreateBus(const char* busName, const char* parentBus) {
+        if (!busName || busName[0] == '\0') {
+            SOUND_LOG_ERROR("SoundSystem ERROR: CreateBus received a null or empty busName.");
+            return false;
+        }
+        if (std::strlen(busName) > kMaxQueuedIdLength) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Bus name '%s' is longer than %u characters.", busName, static_cast<unsigned>(kMaxQueuedIdLength));
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (!g_buses) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: CreateBus called before InitializeSoundSystem.");
+            return false;
+        }
+        if (FindBus(busName) >= 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Bus '%s' already exists. Ignoring.", busName);
+            return true;
+        }
+        int64_t parent = parentBus ? FindBus(parentBus) : static_cast<int64_t>(kMasterBus);
+        if (parent < 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Can't create bus '%s' under non-existent bus '%s'.", busName, parentBus);
+            return false;
+        }
+        return CreateBusLocked(busName, static_cast<uint32_t>(parent));
+    }
+
+    SOUNDSYSTEM_API void DestroyBus(const char* busName) {
+        if (!busName) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: DestroyBus received null busName.");
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t index = FindBus(busName);
+        if (index < 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to destroy non-existent bus '%s'.", busName);
+            return;
+        }
+        if (index == kMasterBus) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: The master bus can't be destroyed.");
+            return;
+        }
+        DestroyBusLocked(static_cast<uint32_t>(index));
+    }
+
+    SOUNDSYSTEM_API bool AssignSoundToBus(const char* soundId, const char* busName) {
+        if (!soundId || !busName) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: AssignSoundToBus received null soundId or busName.");
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t bus = FindBus(busName);
+        if (bus < 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to assign sound ID '%s' to non-existent bus '%s'.", soundId, busName);
+            return false;
+        }
+        SoundSlot* slot = ResolveId(soundId, "assign a bus to");
+        if (!slot) {
+            return false;
+        }
+        MoveSlotToBus(*slot, static_cast<uint32_t>(bus));
+        SOUND_LOG_DEBUG("SoundSystem: Sound ID '%s' now plays through bus '%s'.", soundId, busName);
+        return true;
+    }
+
+    SOUNDSYSTEM_API bool AssignSoundToBusByHandle(SoundHandle handle, const char* busName) {
+        if (!busName) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: AssignSoundToBusByHandle received null busName.");
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t bus = FindBus(busName);
+        if (bus < 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to assign a sound to non-existent bus '%s'.", busName);
+            return false;
+        }
+        SoundSlot* slot = ResolveHandleChecked(handle, "assign a bus to");
+        if (!slot) {
+            return false;
+        }
+        MoveSlotToBus(*slot, static_cast<uint32_t>(bus));
+        return true;
+    }
+
+    SOUNDSYSTEM_API void SetBusVolume(const char* busName, float volume) {
+        SoundCommand command = MakeCommand(CommandType::SetBusVolume, volume);
+        EnqueueBusCommand(command, busName, "SetBusVolume");
+    }
+
+    SOUNDSYSTEM_API void PauseBus(const char* busName) {
+        SoundCommand command = MakeCommand(CommandType::PauseBus);
+        EnqueueBusCommand(command, busName, "PauseBus");
+    }
+
+    SOUNDSYSTEM_API void ResumeBus(const char* busName) {
+        SoundCommand command = MakeCommand(CommandType::ResumeBus);
+        EnqueueBusCommand(command, busName, "ResumeBus");
+    }
+
+    SOUNDSYSTEM_API bool CreateReverbBus(const char* busName, const char* impulseSoundId, const char* parentBus) {
+        if (!busName || busName[0] == '\0' || !impulseSoundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: CreateReverbBus received a null or empty busName, or a null impulseSoundId.");
+            return false;
+        }
+        if (std::strlen(busName) > kMaxQueuedIdLength) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Bus name '%s' is longer than %u characters.", busName, static_cast<unsigned>(kMaxQueuedIdLength));
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(g_registryMutex);
+        if (!g_buses) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: CreateReverbBus called before InitializeSoundSystem.");
+            return false;
+        }
+        SoundSlot* slot = ResolveId(impulseSoundId, "use as an impulse response");
+        if (slot && slot->evicted) {
+            slot = ReloadNow(lock, *slot); // Unlocks while decoding, so everything below is checked after
+        }
+        if (!slot) {
+            return false;
+        }
+        if (!slot->decoded) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Sound ID '%s' is streamed and can't be used as an impulse response; load it without SOUNDSYSTEM_LOAD_STREAM.", impulseSoundId);
+            return false;
+        }
+        // Fail early on names; they are checked again below, once the IR is prepared.
+        if (FindBus(busName) >= 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Bus '%s' already exists. Ignoring.", busName);
+            return false;
+        }
+        if (parentBus && FindBus(parentBus) < 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Can't create bus '%s' under non-existent bus '%s'.", busName, parentBus);
+            return false;
+        }
+
+        // Decoding, resampling and transforming a long IR takes a while; do it without the
+        // lock, holding a reference so the sound can be unloaded meanwhile. The IR is only
+        // needed while its spectra are computed.
+        const SoundCache::Entry* data = SoundCache::AddRef(slot->decoded);
+        ma_uint32 engineRate = ma_engine_get_sample_rate(&g_engine);
+        ma_uint32 engineChannels = ma_engine_get_channels(&g_engine);
+        uint64_t generation = g_systemGeneration;
+        lock.unlock();
+        std::vector<float> impulse;
+        ma_uint32 irChannels = 0;
+        ma_result result = ReadImpulseResponse(*data, engineRate, impulse, irChannels);
+        SoundCache::Release(data);
+        if (result != MA_SUCCESS) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to read sound ID '%s' as an impulse response. Result: %d", impulseSoundId, result);
+            return false;
+        }
+        std::unique_ptr<ReverbNode> reverb(new (std::nothrow) ReverbNode());
+        uint64_t irFrames = impulse.size() / irChannels;
+        if (!reverb || !reverb->convolver.Init(engineChannels, kReverbBlockFrames, impulse.data(), irFrames, irChannels)) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Out of memory preparing the impulse response '%s'.", impulseSoundId);
+            return false;
+        }
+        size_t memoryBytes = reverb->convolver.MemoryBytes();
+
+        lock.lock();
+        if (!g_buses || g_systemGeneration != generation) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: The sound system was shut down while preparing reverb bus '%s'.", busName);
+            return false;
+        }
+        if (FindBus(busName) >= 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Bus '%s' already exists. Ignoring.", busName);
+            return false;
+        }
+        int64_t parent = parentBus ? FindBus(parentBus) : static_cast<int64_t>(kMasterBus);
+        if (parent < 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Can't create bus '%s' under non-existent bus '%s'.", busName, parentBus);
+            return false;
+        }
+        if (!CreateBusLocked(busName, static_cast<uint32_t>(parent), std::move(reverb))) {
+            return false;
+        }
+        SOUND_LOG_INFO("SoundSystem: Created reverb bus '%s' from sound ID '%s' (%llu frames, %llu KB).", busName, impulseSoundId,
+                       static_cast<unsigned long long>(irFrames), static_cast<unsigned long long>(memoryBytes / 1024));
+        return true;
+    }
+
+    SOUNDSYSTEM_API bool SetBusSend(const char* busName, const char* reverbBus, float level) {
+        if (!busName) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: SetBusSend received null busName.");
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        int64_t index = FindBus(busName);
+        if (index < 0) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Attempted to set the send of non-existent bus '%s'.", busName);
+            return false;
+        }
+        if (!reverbBus || level <= 0.0f) {
+            RemoveBusSendLocked(static_cast<uint32_t>(index));
+            return true;
+        }
+        int64_t target = FindBus(reverbBus);
+        if (target < 0 || !g_buses[static_cast<size_t>(target)].reverb) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Bus '%s' can't send to '%s', which isn't a reverb bus.", busName, reverbBus);
+            return false;
+        }
+        if (g_buses[static_cast<size_t>(index)].reverb) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Reverb bus '%s' can't send to another reverb bus.", busName);
+            return false;
+        }
+        // A send to a bus whose output comes back into this one, through its parents or
+        // another bus's send, would loop.
+        if (BusReaches(static_cast<uint32_t>(target), static_cast<uint32_t>(index))) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Bus '%s' can't send to '%s', which feeds back into it.", busName, reverbBus);
+            return false;
+        }
+        return SetBusSendLocked(static_cast<uint32_t>(index), static_cast<uint32_t>(target), level);
+    }
+
+    // --- Binaural voices ---
+
+    SOUNDSYSTEM_API bool LoadHrtf(const char* filePath) {
+        if (!filePath) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: LoadHrtf received null filePath.");
+            return false;
+        }
+        ma_uint32 sampleRate = 0;
+        uint64_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            if (!g_voices) {
+                SOUND_LOG_ERROR("SoundSystem ERROR: LoadHrtf called before InitializeSoundSystem.");
+                return false;
+            }
+            sampleRate = ma_engine_get_sample_rate(&g_engine);
+            generation = g_systemGeneration;
+        }
+
+        // Converting the table to the engine's rate takes a while; do it without the lock.
+        ma_result result = MA_SUCCESS;
+        const MappedFile::View* view = MappedFile::Open(filePath, result);
+        if (!view) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: Failed to open HRTF table '%s'. Result: %d", filePath, result);
+            return false;
+        }
+        std::unique_ptr<Hrtf> hrtf(new (std::nothrow) Hrtf());
+        bool valid = hrtf && hrtf->Init(view->data, view->size, sampleRate);
+        MappedFile::Release(view);
+        if (!valid) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: '%s' isn't a valid HRTF table, its filters are too long, or memory ran out.", filePath);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (!g_voices || g_systemGeneration != generation) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: The sound system was shut down while loading HRTF table '%s'.", filePath);
+            return false;
+        }
+        // Renderers point at the HRTF they were created with, so binaural sounds get new ones.
+        bool enabled = g_binauralEnabled;
+        if (enabled) {
+            DisableBinauralLocked();
+        }
+        g_hrtf = std::move(hrtf);
+        if (enabled) {
+            EnableBinauralLocked();
+        }
+        SOUND_LOG_INFO("SoundSystem: Loaded HRTF table '%s' (%u directions, %u-frame filters, %llu KB).", filePath,
+                       g_hrtf->MeasurementCount(), g_hrtf->FilterFrames(), static_cast<unsigned long long>(g_hrtf->MemoryBytes() / 1024));
+        return true;
+    }
+
+    SOUNDSYSTEM_API bool SetBinauralEnabled(bool enabled) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        if (!g_voices) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: SetBinauralEnabled called before InitializeSoundSystem.");
+            return false;
+        }
+        if (enabled == g_binauralEnabled) {
+            return true;
+        }
+        if (!enabled) {
+            DisableBinauralLocked();
+            SOUND_LOG_INFO("SoundSystem: Binaural rendering off.");
+            return true;
+        }
+        if (!g_hrtf) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Binaural rendering needs an HRTF; load one with LoadHrtf first.");
+            return false;
+        }
+        ma_uint32 channels = ma_engine_get_channels(&g_engine);
+        if (channels != 2) {
+            SOUND_LOG_WARNING("SoundSystem WARNING: Binaural rendering needs stereo output; the engine has %u channels.", channels);
+            return false;
+        }
+        EnableBinauralLocked();
+        SOUND_LOG_INFO("SoundSystem: Binaural rendering on.");
+        return true;
+    }
+
+    SOUNDSYSTEM_API void SetBinauralLodDistance(float distance) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_binauralLodDistance = std::max(distance, 0.0f);
+        g_emitters.MarkStale();
+        SOUND_LOG_INFO("SoundSystem: Binaural distance set to %g.", g_binauralLodDistance);
+    }
+
+    // --- Emitters ---
+
+    SOUNDSYSTEM_API void SetSoundDistanceRange(const char* soundId, float minDistance, float maxDistance, float rolloff) {
+        if (!soundId) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: SetSoundDistanceRange received null soundId.");
+            return;
+        }
+        rolloff = std::max(rolloff, 0.0f);
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        SoundSlot* slot = ResolveId(soundId, "set the distance range for");
+        if (!slot) {
+            return;
+        }
+        if (slot->emitter != EmitterStore::kNoEmitter) {
+            g_emitters.SetRange(slot->emitter, minDistance, maxDistance, rolloff);
+        }
+        else {
+            ma_sound_set_min_distance(&slot->sound, minDistance);
+            ma_sound_set_max_distance(&slot->sound, maxDistance);
+            ma_sound_set_rolloff(&slot->sound, rolloff);
+        }
+        SOUND_LOG_DEBUG("SoundSystem: Distance range for sound ID '%s' set to %g-%g (rolloff %g).", slot->id.c_str(), minDistance, maxDistance, rolloff);
+    }
+
+    SOUNDSYSTEM_API void SetDopplerFactor(float factor) {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_dopplerFactor = std::max(factor, 0.0f);
+        g_emitters.MarkStale();
+        SOUND_LOG_INFO("SoundSystem: Doppler factor set to %g.", g_dopplerFactor);
+    }
+
+    // --- Statistics ---
+
+    SOUNDSYSTEM_API bool GetSoundSystemStats(SoundSystemStats* out) {
+        if (!out) {
+            SOUND_LOG_ERROR("SoundSystem ERROR: GetSoundSystemStats received null out.");
+            return false;
+        }
+        *out = SoundSystemStats();
+
+        // Snapshot the histogram first so the percentiles and the count agree.
+        uint32_t histogram[kStatsBuckets];
+        uint64_t histogramTotal = 0;
+        for (uint32_t i = 0; i < kStatsBuckets; ++i) {
+            histogram[i] = g_callbackHistogram[i].load(std::memory_order_relaxed);
+            histogramTotal += histogram[i];
+        }
+        uint64_t callbackCount = g_callbackCount.load(std::memory_order_relaxed);
+        out->callbackCount = callbackCount;
+        out->callbackOverruns = g_callbackOverruns.load(std::memory_order_relaxed);
+        out->skippedCommandBatches = g_skippedCommandBatches.load(std::memory_order_relaxed);
+        if (callbackCount > 0) {
+            out->callbackAvgUs = static_cast<float>(g_callbackTotalNs.load(std::memory_order_relaxed) / 1000.0 / callbackCount);
+        }
+        out->callbackMaxUs = static_cast<float>(g_callbackMaxNs.load(std::memory_order_relaxed) / 1000.0);
+        // A bucket's upper bound can overshoot the slowest callback actually seen.
+        out->callbackP50Us = std::min(CallbackPercentileUs(histogram, histogramTotal, 0.50), out->callbackMaxUs);
+        out->callbackP95Us = std::min(CallbackPercentileUs(histogram, histogramTotal, 0.95), out->callbackMaxUs);
+        out->callbackP99Us = std::min(CallbackPercentileUs(histogram, histogramTotal, 0.99), out->callbackMaxUs);
+
+        SoundCache::Stats cache = SoundCache::GetStats();
+        out->decodedBytes = cache.decodedBytes;
+        out->encodedBytes = cache.encodedBytes;
+        out->cacheHits = cache.hits;
+        out->cacheMisses = cache.misses;
+        if (cache.misses > 0) {
+            out->decodeAvgMs = static_cast<float>(cache.decodeTimeNs / 1e6 / cache.misses);
+        }
+
+        // Read the queue before taking the lock: queries normally apply it, this one reports it.
+        out->commandQueueDepth = static_cast<uint32_t>(g_commands.SizeApprox());
+        out->commandQueueCapacity = static_cast<uint32_t>(kCommandQueueCapacity);
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        out->commandQueuePeak = static_cast<uint32_t>(g_commandQueuePeak);
+        out->activeVoices = g_activeVoices;
+        out->virtualVoices = g_virtualVoices;
+        out->loadedSounds = static_cast<uint32_t>(g_loadedSounds.Count());
+        out->evictions = g_evictions;
+        out->reloads = g_reloads;
+        out->binauralVoices = CountBinauralVoicesLocked();
+        if (g_hrtf) {
+            out->hrtfCacheHits = g_hrtf->CacheHits();
+            out->hrtfCacheMisses = g_hrtf->CacheMisses();
+        }
+        out->emitters = static_cast<uint32_t>(g_emitters.ActiveCount());
+        return true;
+    }
+
+    SOUNDSYSTEM_API void ResetSoundSystemStats() {
+        ResetCallbackStats();
+        SoundCache::ResetStats();
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_commandQueuePeak = 0;
+        g_evictions = 0;
+        g_reloads = 0;
+        if (g_hrtf) {
+            g_hrtf->ResetCacheStats();
+        }
+    }
+
+    // --- Batched updates ---
+
+    SOUNDSYSTEM_API void SetSoundParametersBatch(const SoundParamUpdate* updates, size_t count) {
+        if (!updates) {
+            if (count > 0) {
+                SOUND_LOG_ERROR("SoundSystem ERROR: SetSoundParametersBatch received null updates.");
+            }
+            return;
+        }
+        // Pushing every entry through the command queue would cost a queue slot per entry and
+        // could fill the queue with one large batch. Taking the lock once and applying the
+        // array in place is cheaper; applying the queue first keeps setters called before
+        // this in order.
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        ApplyPendingCommandsLocked();
+        for (size_t i = 0; i < count; ++i) {
+            ApplyParamUpdate(updates[i]);
+        }
+        SOUND_LOG_TRACE("SoundSystem: Applied %zu parameter updates.", count);
+    }
+
+} // extern "C"
@@ -1,140 +1,986 @@
-// --- SoundSystem.h ---
-// This file defines the public interface of the sound system DLL.
-// It declares the functions that will be exported and accessible
-// from other applications (like game engines).
-
-#ifndef SOUNDSYSTEM_H
-#define SOUNDSYSTEM_H
-
-#include <string>
-
-// On Windows, these macros are used to correctly export and import
-// functions from a DLL.
-#ifdef _WIN32
-#ifdef SOUNDSYSTEM_EXPORTS
-    // If compiling this DLL, export the functions
-#define SOUNDSYSTEM_API __declspec(dllexport)
-#else
-    // If linking to this DLL, import the functions
-#define SOUNDSYSTEM_API __declspec(dllimport)
-#endif
-#else
-    // For other platforms (Linux/macOS), use GCC's visibility attributes
-#define SOUNDSYSTEM_API __attribute__((visibility("default")))
-#endif
-
-// We use 'extern "C"' to prevent C++ name mangling, ensuring that
-// the function names are easily callable from other languages or C code.
-extern "C" {
-
-    /**
-     * @brief Initializes the sound engine.
-     * @return True if initialization was successful, false otherwise.
-     */
-    SOUNDSYSTEM_API bool InitializeSoundSystem();
-
-    /**
-     * @brief Deinitializes the sound engine and cleans up resources.
-     */
-    SOUNDSYSTEM_API void ShutdownSoundSystem();
-
-    /**
-     * @brief Loads an audio file into memory.
-     * @param filePath The path to the audio file.
-     * @param soundId A unique ID to refer to this sound later (e.g., "explosion_sound").
-     * @return True if the sound was loaded successfully, false otherwise.
-     */
-    SOUNDSYSTEM_API bool LoadSound(const char* filePath, const char* soundId);
-
-    /**
-     * @brief Unloads a sound from memory.
-     * @param soundId The unique ID of the sound to unload.
-     */
-    SOUNDSYSTEM_API void UnloadSound(const char* soundId);
-
-    /**
-     * @brief Plays a loaded sound.
-     * @param soundId The unique ID of the sound to play.
-     * @param loop If true, the sound will loop indefinitely.
-     */
-    SOUNDSYSTEM_API void SndPlaySound(const char* soundId, bool loop);
-
-    /**
-     * @brief Stops a currently playing sound.
-     * @param soundId The unique ID of the sound to stop.
-     */
-    SOUNDSYSTEM_API void StopSound(const char* soundId);
-
-    /**
-     * @brief Pauses a currently playing sound.
-     * @param soundId The unique ID of the sound to pause.
-     */
-    SOUNDSYSTEM_API void PauseSound(const char* soundId);
-
-    /**
-     * @brief Resumes a paused sound.
-     * @param soundId The unique ID of the sound to resume.
-     */
-    SOUNDSYSTEM_API void ResumeSound(const char* soundId);
-
-    /**
-     * @brief Sets the master volume for all sounds.
-     * @param volume A float value between 0.0 (mute) and 1.0 (full volume).
-     */
-    SOUNDSYSTEM_API void SetMasterVolume(float volume);
-
-    /**
-     * @brief Sets the volume for a specific loaded sound.
-     * @param soundId The unique ID of the sound.
-     * @param volume A float value between 0.0 (mute) and 1.0 (full volume).
-     */
-    SOUNDSYSTEM_API void SetSoundVolume(const char* soundId, float volume);
-
-    /**
-     * @brief Sets the panning for a specific loaded sound.
-     * @param soundId The unique ID of the sound.
-     * @param pan A float value between -1.0 (full left) and 1.0 (full right), 0.0 for center.
-     */
-    SOUNDSYSTEM_API void SetSoundPan(const char* soundId, float pan);
-
-    /**
-     * @brief Sets the pitch for a specific loaded sound.
-     * @param soundId The unique ID of the sound.
-     * @param pitch A float value where 1.0 is normal pitch, >1.0 is higher, <1.0 is lower.
-     */
-    SOUNDSYSTEM_API void SetSoundPitch(const char* soundId, float pitch);
-
-    /**
-     * @brief Sets the 3D position of a specific loaded sound.
-     * @param soundId The unique ID of the sound.
-     * @param x X-coordinate.
-     * @param y Y-coordinate.
-     * @param z Z-coordinate.
-     */
-    SOUNDSYSTEM_API void SetSoundPosition(const char* soundId, float x, float y, float z);
-
-    /**
-     * @brief Sets the 3D position of the audio listener.
-     * @param x X-coordinate.
-     * @param y Y-coordinate.
-     * @param z Z-coordinate.
-     */
-    SOUNDSYSTEM_API void SetListenerPosition(float x, float y, float z);
-
-    /**
-     * @brief Sets the 3D orientation of the audio listener (forward vector only).
-     * @param forwardX X-component of the forward vector.
-     * @param forwardY Y-component of the forward vector.
-     * @param forwardZ Z-component of the forward vector.
-     */
-    SOUNDSYSTEM_API void SetListenerOrientation(float forwardX, float forwardY, float forwardZ); // Simplified signature
-
-    /**
-     * @brief Checks if a sound is currently playing.
-     * @param soundId The unique ID of the sound to check.
-     * @return True if the sound is playing, false otherwise.
-     */
-    SOUNDSYSTEM_API bool IsSoundPlaying(const char* soundId);
-}
-
-#endif // SOUNDSYSTEM_H
+// --- SoundSystem.h ---
+// This file defines the public interface of the sound system DLL.
+// It declares the functions that will be exported and accessible
+// from other applications (like game engines).
+
+#ifndef SOUNDSYSTEM_H
+#define SOUNDSYSTEM_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// On Windows, these macros are used to correctly export and import
+// functions from a DLL.
+#ifdef _WIN32
+#ifdef SOUNDSYSTEM_EXPORTS
+    // If compiling this DLL, export the functions
+#define SOUNDSYSTEM_API __declspec(dllexport)
+#else
+    // If linking to this DLL, import the functions
+#define SOUNDSYSTEM_API __declspec(dllimport)
+#endif
+#else
+    // For other platforms (Linux/macOS), use GCC's visibility attributes
+#define SOUNDSYSTEM_API __attribute__((visibility("default")))
+#endif
+
+// A compact integer reference to a loaded sound. The low bits index a slot in the
+// sound table and the high bits carry that slot's generation, so a handle to a
+// sound that has since been unloaded is rejected instead of touching a new sound.
+typedef uint32_t SoundHandle;
+
+// Returned by the handle-based loaders on failure. Never refers to a valid sound.
+#define SOUNDSYSTEM_INVALID_HANDLE 0u
+
+// A reference to one playing instance of a sound, returned by PlaySoundInstance.
+// Uses the same index/generation layout as SoundHandle; once the instance finishes
+// and its voice is recycled, the handle goes stale and is ignored.
+typedef uint32_t VoiceHandle;
+
+// Returned by PlaySoundInstance when no instance was started.
+#define SOUNDSYSTEM_INVALID_VOICE 0u
+
+// Bits of SoundParamUpdate::flags: which fields to apply, and what the handle refers to.
+#define SOUNDSYSTEM_PARAM_POSITION 0x1u  // Apply x, y, z
+#define SOUNDSYSTEM_PARAM_VOLUME   0x2u  // Apply volume
+#define SOUNDSYSTEM_PARAM_PAN      0x4u  // Apply pan
+#define SOUNDSYSTEM_PARAM_PITCH    0x8u  // Apply pitch
+#define SOUNDSYSTEM_PARAM_VOICE    0x10u // 'handle' is a VoiceHandle rather than a SoundHandle
+
+// One entry for SetSoundParametersBatch. Plain 32-byte layout with no padding, so
+// bindings can mirror it directly (e.g. a C# struct with sequential layout).
+typedef struct SoundParamUpdate {
+    uint32_t handle;  // SoundHandle, or VoiceHandle with SOUNDSYSTEM_PARAM_VOICE
+    uint32_t flags;   // SOUNDSYSTEM_PARAM_* bits
+    float x, y, z;    // Position
+    float volume;     // 0.0 to 1.0
+    float pan;        // -1.0 to 1.0
+    float pitch;      // Greater than 0.0
+} SoundParamUpdate;
+
+// Log levels, from most to least verbose. Per-frame setters log at TRACE,
+// play/stop style events at DEBUG, loads and lifecycle at INFO.
+#define SOUNDSYSTEM_LOG_LEVEL_TRACE   0
+#define SOUNDSYSTEM_LOG_LEVEL_DEBUG   1
+#define SOUNDSYSTEM_LOG_LEVEL_INFO    2
+#define SOUNDSYSTEM_LOG_LEVEL_WARNING 3
+#define SOUNDSYSTEM_LOG_LEVEL_ERROR   4
+#define SOUNDSYSTEM_LOG_LEVEL_NONE    5
+
+// Flags for LoadSoundEx.
+#define SOUNDSYSTEM_LOAD_DEFAULT 0u     // Decode the whole file into memory at load time
+#define SOUNDSYSTEM_LOAD_STREAM  0x1u   // Stream from disk through a small double buffer refilled on a
+                                        // background thread; for music and long ambience beds
+#define SOUNDSYSTEM_LOAD_RESAMPLE 0x2u  // Convert to the engine's sample rate while decoding, with a
+                                        // high quality filter, so playing at pitch 1.0 costs no
+                                        // resampling. Uses more memory when upsampling (44.1 to 48 kHz:
+                                        // +9%). Streams are always decoded at the engine's rate.
+#define SOUNDSYSTEM_LOAD_COMPRESSED 0x4u // Keep the file's encoded bytes in memory and decode them on
+                                        // each play, per voice, in the audio callback. Typically 4-10x
+                                        // less memory than decoded PCM for some CPU per playing voice;
+                                        // for large, rarely overlapping SFX. Ignores RESAMPLE; STREAM
+                                        // takes precedence.
+#define SOUNDSYSTEM_LOAD_COPY_DATA 0x8u // LoadSoundFromMemoryEx with COMPRESSED: keep a copy of the
+                                        // caller's bytes instead of reading them in place
+
+// Values returned by GetSoundLoadState.
+#define SOUNDSYSTEM_LOAD_STATE_NOT_LOADED 0 // No sound has this ID (or its load failed)
+#define SOUNDSYSTEM_LOAD_STATE_LOADING    1 // Queued or decoding on a loader thread
+#define SOUNDSYSTEM_LOAD_STATE_LOADED     2 // Ready to play
+
+// Pass to WaitForSound to wait without a time limit.
+#define SOUNDSYSTEM_WAIT_INFINITE 0xFFFFFFFFu
+
+// Called when a LoadSoundAsync request completes. Runs on a loader thread.
+// 'handle' is SOUNDSYSTEM_INVALID_HANDLE and 'success' false if the load failed
+// or was cancelled by ShutdownSoundSystem.
+typedef void (*SoundLoadCallback)(SoundHandle handle, const char* soundId, bool success, void* userData);
+
+// Values for SoundSystemConfig::latencyProfile.
+#define SOUNDSYSTEM_LATENCY_LOW          0u // Small periods for responsive playback (default, ~10 ms)
+#define SOUNDSYSTEM_LATENCY_POWER_SAVING 1u // Large periods so the CPU wakes less often (~100 ms)
+
+// Values for SoundSystemConfig::resamplerQuality: the low-pass filter used when the
+// device's rate differs from the engine's.
+#define SOUNDSYSTEM_RESAMPLER_DEFAULT 0u // Linear with a 4th order filter (miniaudio's default)
+#define SOUNDSYSTEM_RESAMPLER_FAST    1u // Linear without a filter; cheapest, may alias
+#define SOUNDSYSTEM_RESAMPLER_HIGH    2u // Linear with an 8th order filter
+
+// Flags for SoundSystemConfig::flags.
+#define SOUNDSYSTEM_INIT_NO_DEVICE         0x1u // Open no device; mix with ReadMixedFrames
+#define SOUNDSYSTEM_INIT_RESAMPLE_ON_LOAD  0x2u // Load every decoded sound as if with SOUNDSYSTEM_LOAD_RESAMPLE
+#define SOUNDSYSTEM_INIT_SCALAR_MIX        0x4u // Use the plain C++ mixing kernels instead of the CPU's SIMD ones
+
+// Engine settings for InitializeSoundSystemEx. Zero-initialize it and set only what you
+// need: a zero field means "let the device choose" (or 48 kHz stereo without a device).
+// GetSoundSystemConfig returns the same structure with the values actually in effect.
+typedef struct SoundSystemConfig {
+    uint32_t sampleRate;               // Mixing rate in Hz; the device resamples if it runs at another
+    uint32_t channels;                 // Output channel count
+    uint32_t periodSizeInFrames;       // Frames mixed per callback; takes precedence over milliseconds
+    uint32_t periodSizeInMilliseconds; // Period as a duration; 0 for the profile's default
+    uint32_t latencyProfile;           // SOUNDSYSTEM_LATENCY_*
+    uint32_t resamplerQuality;         // SOUNDSYSTEM_RESAMPLER_*
+    uint32_t flags;                    // SOUNDSYSTEM_INIT_* bits
+} SoundSystemConfig;
+
+// Filled in by GetSoundSystemStats. Callback figures cover every mix since
+// InitializeSoundSystem or the last ResetSoundSystemStats; a "callback" is one period
+// mixed by the device (or one ReadMixedFrames call) plus the command batch after it.
+typedef struct SoundSystemStats {
+    uint64_t callbackCount;         // Periods mixed
+    uint64_t callbackOverruns;      // Periods that took longer to mix than they last (risk of underruns)
+    uint64_t skippedCommandBatches; // Callbacks that left queued commands for later because the sound table was busy
+    uint64_t decodedBytes;          // Decoded PCM currently held in memory
+    uint64_t cacheHits;             // Loads that reused audio another sound had already decoded
+    uint64_t cacheMisses;           // Loads that decoded their file
+    float callbackAvgUs;            // Mean callback time, in microseconds
+    float callbackMaxUs;            // Longest callback
+    float callbackP50Us;            // Median callback; percentiles are accurate to about 10%
+    float callbackP95Us;
+    float callbackP99Us;
+    float decodeAvgMs;              // Mean time to decode a file on a cache miss, in milliseconds
+    uint32_t activeVoices;          // Voices being mixed (GetPlayingVoiceCount)
+    uint32_t virtualVoices;         // Virtual voices (GetVirtualVoiceCount)
+    uint32_t loadedSounds;          // Sound IDs currently loaded or loading
+    uint32_t commandQueueDepth;     // Commands waiting to be applied right now
+    uint32_t commandQueuePeak;      // Most commands a single batch has applied
+    uint32_t commandQueueCapacity;  // Commands the queue holds before callers apply it themselves
+    uint64_t encodedBytes;          // Compressed file data held for SOUNDSYSTEM_LOAD_COMPRESSED sounds
+    uint64_t evictions;             // Times a sound's decoded data was released to meet the memory budget
+    uint64_t reloads;               // Times an evicted sound was decoded again to be played
+    uint32_t binauralVoices;        // Playing sounds and instances filtered with the HRTF (not panned for distance)
+    uint64_t hrtfCacheHits;         // Direction changes served from the HRTF filter cache
+    uint64_t hrtfCacheMisses;       // Direction changes that had to blend a filter
+    uint32_t emitters;              // Playing sounds and instances in the last spatialization pass
+} SoundSystemStats;
+
+// Receives log messages. While the sound system is initialized it is called from the
+// sound system's log thread, never from the thread that made the API call, so it may
+// block without stalling the game. Messages logged before InitializeSoundSystem or
+// after ShutdownSoundSystem (e.g. errors from calls made then) have no log thread to
+// go through and are delivered on the calling thread.
+typedef void (*SoundLogCallback)(int level, const char* message, void* userData);
+
+// Threading: every function may be called from any thread. Functions that change
+// playback state (play/stop/pause/resume, the Set* functions) don't block: they queue
+// a command that is applied at the next UpdateSoundSystem() call or, if the game
+// doesn't call it, at the end of the next audio callback. Loads, unloads and the
+// Is*/Get* queries briefly lock the sound table; queries apply queued commands first,
+// so a sound started just before IsSoundPlaying reports as playing. Freeing finished
+// voices and re-spatializing sounds happen once per audio callback and per
+// UpdateSoundSystem() call, never in a query, so counts such as GetPlayingVoiceCount
+// are as of the last of those.
+// SetSoundParametersBatch is the exception among the setters: it takes that lock once
+// and applies the whole array directly.
+
+// We use 'extern "C"' to prevent C++ name mangling, ensuring that
+// the function names are easily callable from other languages or C code.
+extern "C" {
+
+    /**
+     * @brief Initializes the sound engine.
+     * @return True if initialization was successful, false otherwise.
+     */
+    SOUNDSYSTEM_API bool InitializeSoundSystem();
+
+    /**
+     * @brief Initializes the sound engine with explicit device settings, e.g. a small period for
+     * rhythm gameplay or SOUNDSYSTEM_LATENCY_POWER_SAVING for background playback.
+     * @param config The settings, or nullptr for the defaults (same as InitializeSoundSystem).
+     * @return True if initialization was successful, false otherwise.
+     */
+    SOUNDSYSTEM_API bool InitializeSoundSystemEx(const SoundSystemConfig* config);
+
+    /**
+     * @brief Reports the settings in effect, which can differ from those requested when the
+     * device doesn't support them (e.g. a backend that rounds the period).
+     * @param out Receives the effective settings; zero fields of the request are filled in.
+     * @return False if the sound system isn't initialized or 'out' is null.
+     */
+    SOUNDSYSTEM_API bool GetSoundSystemConfig(SoundSystemConfig* out);
+
+    /**
+     * @brief Initializes the sound engine without an audio device, for offline rendering.
+     * Same as InitializeSoundSystemEx with SOUNDSYSTEM_INIT_NO_DEVICE.
+     * Nothing plays on its own: the mixer only runs when ReadMixedFrames is called, so
+     * audio can be rendered faster than real time (build servers, tests, benchmarks) and
+     * the same calls always produce the same output.
+     * @param sampleRate The output sample rate, e.g. 48000.
+     * @param channels The number of interleaved output channels, e.g. 2.
+     * @return True if initialization was successful, false otherwise.
+     */
+    SOUNDSYSTEM_API bool InitializeSoundSystemNoDevice(uint32_t sampleRate, uint32_t channels);
+
+    /**
+     * @brief Mixes the next frames of output. Only valid without a device (SOUNDSYSTEM_INIT_NO_DEVICE).
+     * Queued commands are applied after each call, as the audio callback would.
+     * @param out Receives frameCount * channels interleaved 32-bit float samples, clipped to [-1, 1].
+     * @param frameCount The number of frames to mix.
+     * @return The number of frames written, or 0 on error.
+     */
+    SOUNDSYSTEM_API uint64_t ReadMixedFrames(float* out, uint64_t frameCount);
+
+    /**
+     * @brief Deinitializes the sound engine and cleans up resources.
+     */
+    SOUNDSYSTEM_API void ShutdownSoundSystem();
+
+    /**
+     * @brief Applies every queued play/stop/parameter command now.
+     * Optional: queued commands are also applied from the audio callback. Call it once
+     * per frame to apply a frame's changes together at a point of your choosing.
+     */
+    SOUNDSYSTEM_API void UpdateSoundSystem();
+
+    /**
+     * @brief Loads an audio file into memory.
+     * @param filePath The path to the audio file.
+     * @param soundId A unique ID to refer to this sound later (e.g., "explosion_sound").
+     * @return True if the sound was loaded successfully, false otherwise.
+     */
+    SOUNDSYSTEM_API bool LoadSound(const char* filePath, const char* soundId);
+
+    /**
+     * @brief Opens an audio file for streaming instead of decoding it into memory.
+     * Only a few hundred KB of decoded audio is held per stream, refilled in the background
+     * while it plays, so use this for music and long ambience. Takes the same calls as LoadSound.
+     * @param filePath The path to the audio file.
+     * @param soundId A unique ID to refer to this sound later.
+     * @return True if the stream was opened successfully, false otherwise.
+     */
+    SOUNDSYSTEM_API bool LoadSoundStream(const char* filePath, const char* soundId);
+
+    /**
+     * @brief Loads an audio file on a background loader thread without blocking the caller.
+     * The ID is reserved immediately; commands sent to it before the load finishes are ignored.
+     * @param filePath The path to the audio file.
+     * @param soundId A unique ID to refer to this sound later.
+     * @param callback Called on the loader thread when the load finishes. May be NULL.
+     * @param userData A pointer passed back to the callback unchanged.
+     * @return True if the load was queued (or the ID was already loaded, in which case the
+     *         callback runs immediately), false if the ID is already loading or on error.
+     */
+    SOUNDSYSTEM_API bool LoadSoundAsync(const char* filePath, const char* soundId, SoundLoadCallback callback, void* userData);
+
+    /**
+     * @brief Reports whether a sound is loaded, still loading, or unknown.
+     * @param soundId The unique ID of the sound.
+     * @return One of the SOUNDSYSTEM_LOAD_STATE_* values.
+     */
+    SOUNDSYSTEM_API int GetSoundLoadState(const char* soundId);
+
+    /**
+     * @brief Blocks until a sound queued with LoadSoundAsync has finished loading.
+     * @param soundId The unique ID of the sound.
+     * @param timeoutMs How long to wait at most, 0 to only check, or SOUNDSYSTEM_WAIT_INFINITE.
+     * @return True if the sound is loaded, false if it failed, timed out or is unknown.
+     */
+    SOUNDSYSTEM_API bool WaitForSound(const char* soundId, uint32_t timeoutMs);
+
+    /**
+     * @brief Unloads a sound from memory.
+     * @param soundId The unique ID of the sound to unload.
+     */
+    SOUNDSYSTEM_API void UnloadSound(const char* soundId);
+
+    /**
+     * @brief Plays a loaded sound.
+     * @param soundId The unique ID of the sound to play.
+     * @param loop If true, the sound will loop indefinitely.
+     */
+    SOUNDSYSTEM_API void SndPlaySound(const char* soundId, bool loop);
+
+    /**
+     * @brief Stops a currently playing sound.
+     * @param soundId The unique ID of the sound to stop.
+     */
+    SOUNDSYSTEM_API void StopSound(const char* soundId);
+
+    /**
+     * @brief Pauses a currently playing sound.
+     * @param soundId The unique ID of the sound to pause.
+     */
+    SOUNDSYSTEM_API void PauseSound(const char* soundId);
+
+    /**
+     * @brief Resumes a paused sound.
+     * @param soundId The unique ID of the sound to resume.
+     */
+    SOUNDSYSTEM_API void ResumeSound(const char* soundId);
+
+    /**
+     * @brief Sets the master volume for all sounds.
+     * @param volume A float value between 0.0 (mute) and 1.0 (full volume).
+     */
+    SOUNDSYSTEM_API void SetMasterVolume(float volume);
+
+    /**
+     * @brief Sets the volume for a specific loaded sound.
+     * @param soundId The unique ID of the sound.
+     * @param volume A float value between 0.0 (mute) and 1.0 (full volume).
+     */
+    SOUNDSYSTEM_API void SetSoundVolume(const char* soundId, float volume);
+
+    /**
+     * @brief Sets the panning for a specific loaded sound.
+     * @param soundId The unique ID of the sound.
+     * @param pan A float value between -1.0 (full left) and 1.0 (full right), 0.0 for center.
+     */
+    SOUNDSYSTEM_API void SetSoundPan(const char* soundId, float pan);
+
+    /**
+     * @brief Sets the pitch for a specific loaded sound.
+     * @param soundId The unique ID of the sound.
+     * @param pitch A float value where 1.0 is normal pitch, >1.0 is higher, <1.0 is lower.
+     */
+    SOUNDSYSTEM_API void SetSoundPitch(const char* soundId, float pitch);
+
+    /**
+     * @brief Sets the 3D position of a specific loaded sound.
+     * @param soundId The unique ID of the sound.
+     * @param x X-coordinate.
+     * @param y Y-coordinate.
+     * @param z Z-coordinate.
+     */
+    SOUNDSYSTEM_API void SetSoundPosition(const char* soundId, float x, float y, float z);
+
+    /**
+     * @brief Sets the velocity of a specific loaded sound, for the doppler shift. Its instances
+     *        start with it. It doesn't move the sound.
+     * @param soundId The unique ID of the sound.
+     * @param x X-component, in position units per second.
+     * @param y Y-component.
+     * @param z Z-component.
+     */
+    SOUNDSYSTEM_API void SetSoundVelocity(const char* soundId, float x, float y, float z);
+
+    /**
+     * @brief Sets the 3D position of the audio listener.
+     * @param x X-coordinate.
+     * @param y Y-coordinate.
+     * @param z Z-coordinate.
+     */
+    SOUNDSYSTEM_API void SetListenerPosition(float x, float y, float z);
+
+    /**
+     * @brief Sets the velocity of the audio listener, for the doppler shift.
+     * @param x X-component, in position units per second.
+     * @param y Y-component.
+     * @param z Z-component.
+     */
+    SOUNDSYSTEM_API void SetListenerVelocity(float x, float y, float z);
+
+    /**
+     * @brief Sets the 3D orientation of the audio listener (forward vector only).
+     * @param forwardX X-component of the forward vector.
+     * @param forwardY Y-component of the forward vector.
+     * @param forwardZ Z-component of the forward vector.
+     */
+    SOUNDSYSTEM_API void SetListenerOrientation(float forwardX, float forwardY, float forwardZ); // Simplified signature
+
+    /**
+     * @brief Checks if a sound is currently playing.
+     * @param soundId The unique ID of the sound to check.
+     * @return True if the sound is playing, false otherwise.
+     */
+    SOUNDSYSTEM_API bool IsSoundPlaying(const char* soundId);
+
+    // --- Logging ---
+
+    /**
+     * @brief Redirects log messages to a callback instead of the console. Messages still
+     *        queued go to the new callback; one being delivered as this is called may still
+     *        reach the previous one.
+     * @param callback The function to receive messages, or NULL to restore console output.
+     * @param userData A pointer passed back to the callback unchanged.
+     */
+    SOUNDSYSTEM_API void SetSoundLogCallback(SoundLogCallback callback, void* userData);
+
+    /**
+     * @brief Sets the minimum level of messages that are reported.
+     * Levels below the compile-time SOUNDSYSTEM_LOG_LEVEL (INFO in release builds)
+     * are compiled out and cannot be re-enabled at runtime.
+     * @param level One of the SOUNDSYSTEM_LOG_LEVEL_* values.
+     */
+    SOUNDSYSTEM_API void SetSoundLogLevel(int level);
+
+    // --- Handle-based API ---
+    // The functions below mirror the string-ID API above but take a SoundHandle,
+    // which resolves in constant time without building a std::string or searching
+    // the ID registry. Prefer them for per-frame updates.
+
+    /**
+     * @brief Loads an audio file into memory and returns a handle to it.
+     * @param filePath The path to the audio file.
+     * @param soundId A unique ID to refer to this sound later. The string-ID API keeps working for it.
+     * @return A handle to the sound, or SOUNDSYSTEM_INVALID_HANDLE if loading failed.
+     *         If the ID is already loaded, the existing sound's handle is returned.
+     */
+    SOUNDSYSTEM_API SoundHandle LoadSoundWithHandle(const char* filePath, const char* soundId);
+
+    /**
+     * @brief Loads an audio file with load options and returns a handle to it.
+     * @param filePath The path to the audio file.
+     * @param soundId A unique ID to refer to this sound later.
+     * @param loadFlags A combination of SOUNDSYSTEM_LOAD_* flags.
+     * @return A handle to the sound, or SOUNDSYSTEM_INVALID_HANDLE if loading failed.
+     */
+    SOUNDSYSTEM_API SoundHandle LoadSoundEx(const char* filePath, const char* soundId, uint32_t loadFlags);
+
+    /**
+     * @brief Loads a sound from an encoded file image in memory (WAV, FLAC, MP3, ...), for
+     *        sounds kept in an asset archive rather than on disk. The sound stays compressed
+     *        and is decoded while it plays, as with SOUNDSYSTEM_LOAD_COMPRESSED.
+     * @param data The encoded bytes.
+     * @param size Size of 'data' in bytes.
+     * @param soundId A unique ID to refer to this sound later.
+     * @param copy If false, the sound reads 'data' in place with no copy, and the buffer must
+     *        stay valid and unchanged until the sound is unloaded. If true, the bytes are copied
+     *        and the buffer may be freed as soon as this returns.
+     * @return True if the sound was loaded (or the ID was already loaded).
+     */
+    SOUNDSYSTEM_API bool LoadSoundFromMemory(const void* data, size_t size, const char* soundId, bool copy);
+
+    /**
+     * @brief Loads a sound from an encoded file image in memory with load options.
+     *        Without SOUNDSYSTEM_LOAD_COMPRESSED the sound is decoded before this returns and
+     *        'data' isn't used afterwards. With it, 'data' is read in place unless
+     *        SOUNDSYSTEM_LOAD_COPY_DATA is also given. SOUNDSYSTEM_LOAD_STREAM means
+     *        SOUNDSYSTEM_LOAD_COMPRESSED here.
+     * @param data The encoded bytes.
+     * @param size Size of 'data' in bytes.
+     * @param soundId A unique ID to refer to this sound later.
+     * @param loadFlags A combination of SOUNDSYSTEM_LOAD_* flags.
+     * @return A handle to the sound, or SOUNDSYSTEM_INVALID_HANDLE if loading failed.
+     */
+    SOUNDSYSTEM_API SoundHandle LoadSoundFromMemoryEx(const void* data, size_t size, const char* soundId, uint32_t loadFlags);
+
+    /**
+     * @brief Loads a sound stored as an encoded file image inside a larger pack file. The
+     *        pack is memory-mapped once and shared by every sound loaded from it, so loads
+     *        read no more of it than the decoder touches and copy nothing. Compressed sounds
+     *        decode straight from the mapping, which stays open until the last one is unloaded.
+     *        Flags behave as for LoadSoundFromMemoryEx; the pack itself is never copied.
+     * @param packPath The path to the pack file.
+     * @param offset Byte offset of the sound's data in the pack.
+     * @param size Size of the sound's data in bytes.
+     * @param soundId A unique ID to refer to this sound later.
+     * @param loadFlags A combination of SOUNDSYSTEM_LOAD_* flags.
+     * @return A handle to the sound, or SOUNDSYSTEM_INVALID_HANDLE if loading failed
+     *         (including when the range lies outside the pack).
+     */
+    SOUNDSYSTEM_API SoundHandle LoadSoundFromPack(const char* packPath, uint64_t offset, uint64_t size, const char* soundId, uint32_t loadFlags);
+
+    /**
+     * @brief Loads every sound in a sound bank made by SoundBankPacker, registering each
+     *        under the ID it was packed with. The bank is memory-mapped and read front to
+     *        back once. Sounds packed as float PCM play straight from the mapping and 16-bit
+     *        PCM is only converted to float; the others are decoded at load like LoadSound.
+     *        IDs that are already loaded are left as they are.
+     * @param bankPath The path to the bank file.
+     * @return The number of sounds now loaded from the bank, or -1 if the bank couldn't be
+     *         opened or isn't a valid bank. Sounds that fail to load are logged and skipped.
+     */
+    SOUNDSYSTEM_API int LoadSoundBank(const char* bankPath);
+
+    /**
+     * @brief Loads every sound in a sound bank with load options. The flags apply to sounds
+     *        packed as encoded files (e.g. SOUNDSYSTEM_LOAD_COMPRESSED to decode them from the
+     *        mapping while playing); sounds packed as PCM ignore them.
+     * @param bankPath The path to the bank file.
+     * @param loadFlags A combination of SOUNDSYSTEM_LOAD_* flags.
+     * @return As for LoadSoundBank.
+     */
+    SOUNDSYSTEM_API int LoadSoundBankEx(const char* bankPath, uint32_t loadFlags);
+
+    /**
+     * @brief Unloads every sound whose ID is in the bank, as UnloadSound would. The bank is
+     *        unmapped once none of its sounds remain.
+     * @param bankPath The path the bank was loaded from.
+     */
+    SOUNDSYSTEM_API void UnloadSoundBank(const char* bankPath);
+
+    /**
+     * @brief Looks up the handle of a sound loaded by ID.
+     * @param soundId The unique ID of the sound.
+     * @return The sound's handle, or SOUNDSYSTEM_INVALID_HANDLE if no sound has that ID.
+     */
+    SOUNDSYSTEM_API SoundHandle GetSoundHandle(const char* soundId);
+
+    /**
+     * @brief Checks whether a handle still refers to a loaded sound.
+     * @param handle The handle to check.
+     * @return True if the sound is loaded, false if the handle is invalid or stale.
+     */
+    SOUNDSYSTEM_API bool IsSoundHandleValid(SoundHandle handle);
+
+    /**
+     * @brief Unloads a sound from memory. The handle becomes invalid.
+     * @param handle The handle of the sound to unload.
+     */
+    SOUNDSYSTEM_API void UnloadSoundByHandle(SoundHandle handle);
+
+    /**
+     * @brief Plays a loaded sound.
+     * @param handle The handle of the sound to play.
+     * @param loop If true, the sound will loop indefinitely.
+     */
+    SOUNDSYSTEM_API void SndPlaySoundByHandle(SoundHandle handle, bool loop);
+
+    /**
+     * @brief Stops a currently playing sound.
+     * @param handle The handle of the sound to stop.
+     */
+    SOUNDSYSTEM_API void StopSoundByHandle(SoundHandle handle);
+
+    /**
+     * @brief Pauses a currently playing sound.
+     * @param handle The handle of the sound to pause.
+     */
+    SOUNDSYSTEM_API void PauseSoundByHandle(SoundHandle handle);
+
+    /**
+     * @brief Resumes a paused sound.
+     * @param handle The handle of the sound to resume.
+     */
+    SOUNDSYSTEM_API void ResumeSoundByHandle(SoundHandle handle);
+
+    /**
+     * @brief Sets the volume for a specific loaded sound.
+     * @param handle The handle of the sound.
+     * @param volume A float value between 0.0 (mute) and 1.0 (full volume).
+     */
+    SOUNDSYSTEM_API void SetSoundVolumeByHandle(SoundHandle handle, float volume);
+
+    /**
+     * @brief Sets the panning for a specific loaded sound.
+     * @param handle The handle of the sound.
+     * @param pan A float value between -1.0 (full left) and 1.0 (full right), 0.0 for center.
+     */
+    SOUNDSYSTEM_API void SetSoundPanByHandle(SoundHandle handle, float pan);
+
+    /**
+     * @brief Sets the pitch for a specific loaded sound.
+     * @param handle The handle of the sound.
+     * @param pitch A float value where 1.0 is normal pitch, >1.0 is higher, <1.0 is lower.
+     */
+    SOUNDSYSTEM_API void SetSoundPitchByHandle(SoundHandle handle, float pitch);
+
+    /**
+     * @brief Sets the 3D position of a specific loaded sound.
+     * @param handle The handle of the sound.
+     * @param x X-coordinate.
+     * @param y Y-coordinate.
+     * @param z Z-coordinate.
+     */
+    SOUNDSYSTEM_API void SetSoundPositionByHandle(SoundHandle handle, float x, float y, float z);
+
+    /**
+     * @brief Sets the velocity of a specific loaded sound, for the doppler shift.
+     * @param handle The handle of the sound.
+     * @param x X-component, in position units per second.
+     * @param y Y-component.
+     * @param z Z-component.
+     */
+    SOUNDSYSTEM_API void SetSoundVelocityByHandle(SoundHandle handle, float x, float y, float z);
+
+    /**
+     * @brief Checks if a sound is currently playing.
+     * @param handle The handle of the sound to check.
+     * @return True if the sound is playing, false otherwise (including for invalid handles).
+     */
+    SOUNDSYSTEM_API bool IsSoundPlayingByHandle(SoundHandle handle);
+
+    // --- Voices (fire-and-forget instances) ---
+    // SndPlaySound restarts the one sound tied to an ID. PlaySoundInstance instead starts
+    // an extra, independent instance on a voice taken from a fixed pool, so rapid-fire
+    // sounds (footsteps, gunfire) overlap instead of cutting each other off. Voices share
+    // the sound's decoded data and return to the pool on their own when they finish.
+    // Starting an instance of a decoded sound allocates nothing: voices read the data in
+    // place whatever its format, and binaural renderers are made for the whole pool when
+    // binaural rendering is turned on. Two cases do allocate. A sound loaded with
+    // SOUNDSYSTEM_LOAD_COMPRESSED needs a decoder on the voice, made when the voice didn't
+    // play that sound last. A sound evicted by the memory budget is decoded again first.
+
+    /**
+     * @brief Starts a new instance of a loaded sound on a free voice.
+     * The instance starts at the sound's current 3D position. Sounds loaded with
+     * SOUNDSYSTEM_LOAD_STREAM have no shared data and can't be instanced.
+     * @param soundId The unique ID of the sound to play.
+     * @param volume The instance's volume, between 0.0 and 1.0.
+     * @param pitch The instance's pitch, where 1.0 is normal pitch.
+     * @return A handle to the instance, or SOUNDSYSTEM_INVALID_VOICE if the sound isn't
+     *         loaded or every voice is in use.
+     */
+    SOUNDSYSTEM_API VoiceHandle PlaySoundInstance(const char* soundId, float volume, float pitch);
+
+    /**
+     * @brief Starts a new instance of a loaded sound on a free voice.
+     * @param handle The handle of the sound to play.
+     * @param volume The instance's volume, between 0.0 and 1.0.
+     * @param pitch The instance's pitch, where 1.0 is normal pitch.
+     * @return A handle to the instance, or SOUNDSYSTEM_INVALID_VOICE on failure.
+     */
+    SOUNDSYSTEM_API VoiceHandle PlaySoundInstanceByHandle(SoundHandle handle, float volume, float pitch);
+
+    /**
+     * @brief Stops an instance early and returns its voice to the pool.
+     * @param voice The instance to stop.
+     */
+    SOUNDSYSTEM_API void StopVoice(VoiceHandle voice);
+
+    /**
+     * @brief Sets the volume of a playing instance.
+     * @param voice The instance.
+     * @param volume A float value between 0.0 (mute) and 1.0 (full volume).
+     */
+    SOUNDSYSTEM_API void SetVoiceVolume(VoiceHandle voice, float volume);
+
+    /**
+     * @brief Sets the panning of a playing instance.
+     * @param voice The instance.
+     * @param pan A float value between -1.0 (full left) and 1.0 (full right), 0.0 for center.
+     */
+    SOUNDSYSTEM_API void SetVoicePan(VoiceHandle voice, float pan);
+
+    /**
+     * @brief Sets the pitch of a playing instance.
+     * @param voice The instance.
+     * @param pitch A float value where 1.0 is normal pitch.
+     */
+    SOUNDSYSTEM_API void SetVoicePitch(VoiceHandle voice, float pitch);
+
+    /**
+     * @brief Sets the 3D position of a playing instance.
+     * @param voice The instance.
+     * @param x X-coordinate.
+     * @param y Y-coordinate.
+     * @param z Z-coordinate.
+     */
+    SOUNDSYSTEM_API void SetVoicePosition(VoiceHandle voice, float x, float y, float z);
+
+    /**
+     * @brief Sets the velocity of a playing instance, for the doppler shift.
+     * @param voice The instance.
+     * @param x X-component, in position units per second.
+     * @param y Y-component.
+     * @param z Z-component.
+     */
+    SOUNDSYSTEM_API void SetVoiceVelocity(VoiceHandle voice, float x, float y, float z);
+
+    /**
+     * @brief Checks if an instance is still playing.
+     * @param voice The instance to check.
+     * @return True while the instance plays, false once it has finished or been stopped.
+     */
+    SOUNDSYSTEM_API bool IsVoicePlaying(VoiceHandle voice);
+
+    // --- Voice limits ---
+    // Every playing sound and instance is a voice that the mixer processes each callback.
+    // Voices count against a global limit, their sound's limit and their sound's voice
+    // group limit. Starting a voice that would exceed one stops the least important voice
+    // in that scope: lowest priority first, then the quietest at the listener (volume times
+    // distance attenuation), then the oldest. A stolen looping voice becomes virtual (see
+    // below) instead of stopping. If every voice in the scope is more important, the new
+    // sound or instance doesn't start. Limits apply when voices start; lowering one doesn't
+    // stop voices that are already playing.
+
+    /**
+     * @brief Sets how many voices may play at once.
+     * @param maxVoices The limit, or 0 for no limit. Defaults to 128. Instances are also
+     *        bounded by the voice pool (256).
+     */
+    SOUNDSYSTEM_API void SetMaxVoices(uint32_t maxVoices);
+
+    /**
+     * @brief Sets a sound's priority for voice stealing. Applies to the sound and its instances.
+     * @param soundId The unique ID of the sound.
+     * @param priority 0 (stolen first) to 255 (stolen last). Defaults to 128.
+     */
+    SOUNDSYSTEM_API void SetSoundPriority(const char* soundId, int priority);
+
+    /**
+     * @brief Limits how many voices of one sound (the sound itself plus its instances) play at once.
+     * @param soundId The unique ID of the sound.
+     * @param maxInstances The limit, or 0 for no limit (the default).
+     */
+    SOUNDSYSTEM_API void SetSoundMaxInstances(const char* soundId, uint32_t maxInstances);
+
+    /**
+     * @brief Puts a sound in a voice group so its voices count against that group's limit.
+     * @param soundId The unique ID of the sound.
+     * @param group A group number from 0 to 15. Sounds start in group 0.
+     */
+    SOUNDSYSTEM_API void SetSoundVoiceGroup(const char* soundId, uint32_t group);
+
+    /**
+     * @brief Limits how many voices of the sounds in a group play at once.
+     * @param group A group number from 0 to 15.
+     * @param maxVoices The limit, or 0 for no limit (the default).
+     */
+    SOUNDSYSTEM_API void SetVoiceGroupLimit(uint32_t group, uint32_t maxVoices);
+
+    /**
+     * @brief Returns how many voices are currently being mixed.
+     * @return The number of playing sounds and instances, not counting virtual ones.
+     */
+    SOUNDSYSTEM_API uint32_t GetPlayingVoiceCount();
+
+    // --- Virtual voices ---
+    // A voice whose audibility at the listener (volume times distance attenuation) falls
+    // below the threshold becomes virtual: it stops being mixed and frees its place under
+    // the voice limits, but its position keeps advancing with the engine clock. When it
+    // becomes audible again (twice the threshold, so it doesn't flicker at the boundary) it
+    // resumes from where it would have been. Voices are re-checked by UpdateSoundSystem and
+    // every audio callback.
+    // Virtual voices still report true from IsSoundPlaying and IsVoicePlaying, and a
+    // non-looping one ends when its sound would have finished.
+
+    /**
+     * @brief Sets the audibility below which voices become virtual.
+     * @param audibility Linear gain, or 0 to disable virtual voices. Defaults to 0.001 (-60 dB).
+     */
+    SOUNDSYSTEM_API void SetVirtualVoiceThreshold(float audibility);
+
+    /**
+     * @brief Returns how many voices are currently virtual.
+     * @return The number of sounds and instances tracked but not mixed.
+     */
+    SOUNDSYSTEM_API uint32_t GetVirtualVoiceCount();
+
+    // --- Memory budget ---
+    // Decoded audio (PCM held by sounds loaded with LoadSound and friends) can be kept to a
+    // budget. When a load takes it over, the least recently played sounds that are stopped
+    // are evicted: their PCM is freed, but they stay loaded with their ID, handle and
+    // settings. Playing an evicted sound decodes it again: PlaySoundInstance does so before
+    // returning; SndPlaySound and the other queued calls start the sound once a loader
+    // thread has decoded it. That decode is started by the next UpdateSoundSystem (or other
+    // call that applies the queue on your thread), never by the audio callback. Paused sounds and sounds with playing instances are never
+    // evicted, nor are pinned ones. Streamed and compressed sounds hold no decoded PCM, and
+    // sounds from memory, packs or banks can't be decoded again, so none of them are evicted.
+    // The budget counts PCM shared by several IDs once, and GetSoundSystemStats reports
+    // decodedBytes against it.
+
+    /**
+     * @brief Sets the decoded audio memory budget and evicts sounds to meet it.
+     * @param bytes The budget in bytes, or 0 for no budget (the default).
+     */
+    SOUNDSYSTEM_API void SetSoundMemoryBudget(uint64_t bytes);
+
+    /**
+     * @brief Returns the decoded audio memory budget.
+     * @return The budget in bytes, or 0 if there is none.
+     */
+    SOUNDSYSTEM_API uint64_t GetSoundMemoryBudget();
+
+    /**
+     * @brief Pins a sound so the memory budget never evicts it, or unpins it. Pinning an
+     *        evicted sound decodes it again in the background.
+     * @param soundId The unique ID of the sound.
+     * @param pinned True to pin, false to unpin.
+     */
+    SOUNDSYSTEM_API void SetSoundPinned(const char* soundId, bool pinned);
+
+    /**
+     * @brief Handle version of SetSoundPinned.
+     * @param handle The sound's handle.
+     * @param pinned True to pin, false to unpin.
+     */
+    SOUNDSYSTEM_API void SetSoundPinnedByHandle(SoundHandle handle, bool pinned);
+
+    /**
+     * @brief Checks whether a loaded sound's audio is in memory, i.e. it hasn't been evicted.
+     * @param soundId The unique ID of the sound.
+     * @return True if the sound is loaded and not evicted.
+     */
+    SOUNDSYSTEM_API bool IsSoundResident(const char* soundId);
+
+    // --- Buses ---
+    // Sounds play through a tree of buses, each mixing the sounds and buses assigned to it
+    // and applying one volume to the result, so one call changes a whole category. The tree
+    // starts as "Master" with "Music", "SFX" and "Voice" under it; CreateBus adds more, up
+    // to 64 in all. Every sound starts on Master, and its instances play through whatever
+    // bus the sound is on. A sound's level is its own volume times the volume of each bus
+    // from its own up to Master, times SetMasterVolume. Bus volume also counts towards
+    // audibility for voice stealing and virtual voices, so a muted bus's voices go virtual.
+    // Pausing a bus holds everything under it in place; its sounds still report playing.
+    // Bus names are case-sensitive and up to 63 characters. Volume and pause changes are
+    // queued like the other playback calls.
+
+    /**
+     * @brief Creates a bus.
+     * @param busName The new bus's name.
+     * @param parentBus The bus it feeds, or nullptr for "Master".
+     * @return True if the bus exists afterwards (including if it already did).
+     */
+    SOUNDSYSTEM_API bool CreateBus(const char* busName, const char* parentBus);
+
+    /**
+     * @brief Destroys a bus. Its sounds and child buses move to its parent, and sends to it are
+     *        removed. Master can't be destroyed.
+     * @param busName The bus to destroy.
+     */
+    SOUNDSYSTEM_API void DestroyBus(const char* busName);
+
+    /**
+     * @brief Routes a loaded sound, and its playing instances, through a bus.
+     * @param soundId The unique ID of the sound.
+     * @param busName The bus to play through.
+     * @return True on success, false if the sound or bus doesn't exist.
+     */
+    SOUNDSYSTEM_API bool AssignSoundToBus(const char* soundId, const char* busName);
+
+    /**
+     * @brief Handle version of AssignSoundToBus.
+     * @param handle The sound's handle.
+     * @param busName The bus to play through.
+     * @return True on success, false if the handle is invalid or the bus doesn't exist.
+     */
+    SOUNDSYSTEM_API bool AssignSoundToBusByHandle(SoundHandle handle, const char* busName);
+
+    /**
+     * @brief Sets a bus's volume.
+     * @param busName The bus.
+     * @param volume Linear gain, 0.0 (silent) and up; 1.0 is unchanged (the default).
+     */
+    SOUNDSYSTEM_API void SetBusVolume(const char* busName, float volume);
+
+    /**
+     * @brief Pauses every sound and instance under a bus, including its child buses.
+     * @param busName The bus to pause.
+     */
+    SOUNDSYSTEM_API void PauseBus(const char* busName);
+
+    /**
+     * @brief Resumes a bus paused with PauseBus. Sounds continue from where they were held.
+     * @param busName The bus to resume.
+     */
+    SOUNDSYSTEM_API void ResumeBus(const char* busName);
+
+    // A reverb bus convolves everything that reaches it with an impulse response (a recording
+    // of a space's echo) and passes on only the reverb. Rather than assigning sounds to it,
+    // other buses send a share of their mix to it with SetBusSend, so every sound routed
+    // through those buses shares one reverb; the reverb bus's own volume is the wet level.
+    // The impulse response is any sound loaded with LoadSound, LoadSoundEx (except streamed),
+    // LoadSoundFromMemory or from a bank; it is read once, so it can be unloaded afterwards.
+    // It is converted to the engine's sample rate, and a mono IR is used for every channel.
+    // The reverb lags the dry sound by 256 frames; seconds-long IRs cost a few percent of
+    // one core (Benchmarks/ConvolverBenchmark measures it) and about 3 MB per second of IR.
+
+    /**
+     * @brief Creates a reverb bus.
+     * @param busName The new bus's name.
+     * @param impulseSoundId ID of a loaded sound holding the impulse response (at most 20 seconds are used).
+     * @param parentBus The bus the reverb feeds, or nullptr for "Master".
+     * @return True on success, false if the name is taken, the sound or parent doesn't exist, or the sound is streamed.
+     */
+    SOUNDSYSTEM_API bool CreateReverbBus(const char* busName, const char* impulseSoundId, const char* parentBus);
+
+    /**
+     * @brief Sends a share of a bus's mix to a reverb bus, on top of its normal output. A bus has
+     *        at most one send; setting another replaces it. Takes effect immediately.
+     * @param busName The bus whose mix is sent. Can't be a reverb bus.
+     * @param reverbBus The reverb bus to send to, or nullptr to remove the send. Its output can't come back into busName, through its parents or other sends.
+     * @param level Linear send gain; 0.0 or less removes the send.
+     * @return True on success, false if either bus doesn't exist or the send isn't allowed.
+     */
+    SOUNDSYSTEM_API bool SetBusSend(const char* busName, const char* reverbBus, float level);
+
+    // --- Binaural voices ---
+    // For headphones: with binaural rendering on, sounds are placed with head-related
+    // transfer functions (HRTFs), the filtering a listener's head and ears apply to sound
+    // from each direction, so they can be heard in front, behind, above or below rather
+    // than only panned between the ears. The HRTF is a table made by Tools/HrtfTablePacker
+    // from measured impulse responses (e.g. exported from a SOFA dataset); it is converted to
+    // the engine's sample rate when loaded. Positions, the listener and distance attenuation
+    // work as before. Each sound is downmixed to mono and SetSoundPan has no effect on it.
+    // Sounds further than the binaural distance are panned instead of filtered, which is
+    // much cheaper, as are the many distant sounds of a busy scene. Filtering costs about
+    // 0.15% of one core per sound for 128-tap filters at 48 kHz (Benchmarks/HrtfBenchmark
+    // measures it). Needs a stereo engine.
+
+    /**
+     * @brief Loads an HRTF table for binaural rendering, replacing any loaded before.
+     *        Sounds already rendered binaurally switch to it.
+     * @param filePath Path to a table written by HrtfTablePacker.
+     * @return True on success, false if the file can't be read or isn't a valid table.
+     */
+    SOUNDSYSTEM_API bool LoadHrtf(const char* filePath);
+
+    /**
+     * @brief Turns binaural rendering on or off for every sound and instance. Off by default.
+     * @param enabled True to render through the HRTF, false to go back to plain panning.
+     * @return True on success, false if turning it on without an HRTF loaded or with an engine that isn't stereo.
+     */
+    SOUNDSYSTEM_API bool SetBinauralEnabled(bool enabled);
+
+    /**
+     * @brief Sets the distance from the listener beyond which binaural sounds are only panned.
+     *        Takes effect from the next update.
+     * @param distance Distance in the units of SetSoundPosition (default 30); 0 filters sounds at any distance.
+     */
+    SOUNDSYSTEM_API void SetBinauralLodDistance(float distance);
+
+    // --- Emitters ---
+    // Sounds and instances are placed by the sound system itself. Their positions,
+    // velocities and distance ranges are kept side by side in arrays, and once per update
+    // a single SIMD pass works out the distance attenuation, left/right panning and doppler
+    // shift of every playing sound relative to the listener, so thousands of moving sounds
+    // cost little more than a few hundred (Benchmarks/EmitterBenchmark measures it).
+    // Attenuation follows the inverse distance model: full volume up to the minimum
+    // distance, then minDistance / (minDistance + rolloff * (distance - minDistance)), held
+    // from the maximum distance on. Panning keeps the near side at full volume and fades the
+    // far side out, so no sound gets louder by panning, and it combines with SetSoundPan.
+    // The doppler shift multiplies the pitch set with SetSoundPitch. Moves take effect from
+    // the next pass, which runs once per audio callback (and per UpdateSoundSystem call)
+    // when anything has moved since the last one.
+
+    /**
+     * @brief Sets how a sound fades with distance. Instances take it when they start.
+     * @param soundId The unique ID of the sound.
+     * @param minDistance Distance up to which the sound plays at full volume (default 1). 0 turns attenuation off.
+     * @param maxDistance Distance beyond which it fades no further (default unlimited). Must exceed minDistance.
+     * @param rolloff How quickly it fades beyond minDistance (default 1); 0 doesn't fade. Clamped to at least 0.
+     */
+    SOUNDSYSTEM_API void SetSoundDistanceRange(const char* soundId, float minDistance, float maxDistance, float rolloff);
+
+    /**
+     * @brief Scales the doppler shift of every sound. Sources approaching at more than half
+     *        the speed of sound are treated as moving at half of it.
+     * @param factor 1.0 for the physical shift (the default), 0.0 to turn it off. Clamped to at least 0.
+     */
+    SOUNDSYSTEM_API void SetDopplerFactor(float factor);
+
+    // --- Statistics ---
+
+    /**
+     * @brief Reports the sound system's performance counters. Cheap enough to call every frame;
+     * the counters are always on.
+     * @param out Receives the statistics.
+     * @return False if 'out' is null.
+     */
+    SOUNDSYSTEM_API bool GetSoundSystemStats(SoundSystemStats* out);
+
+    /**
+     * @brief Restarts the callback timings, cache hit/miss counts and queue peak from zero,
+     * e.g. at the start of a level or a profiling capture.
+     */
+    SOUNDSYSTEM_API void ResetSoundSystemStats();
+
+    // --- Batched updates ---
+
+    /**
+     * @brief Applies parameter changes to many sounds and instances in one call.
+     * Meant for per-frame emitter sync: one call per frame instead of several per emitter,
+     * with no string lookups. Queued commands are applied first, so the batch lands after
+     * any setter called before it. Stale handles are skipped. New positions are
+     * spatialized by the next audio callback or UpdateSoundSystem, like SetSoundPosition's.
+     * @param updates An array of updates; each applies only the fields named in its flags.
+     * @param count The number of entries in 'updates'.
+     */
+    SOUNDSYSTEM_API void SetSoundParametersBatch(const SoundParamUpdate* updates, size_t count);
+}
+
+#endif // SOUNDSYSTEM_H
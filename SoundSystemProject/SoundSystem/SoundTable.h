@@ -0,0 +1,208 @@
+// --- SoundTable.h ---
+// Internal containers used by SoundSystem.cpp to store loaded sounds.
+// Nothing in this file is exported from the DLL.
+//
+// SlabArray keeps objects in fixed-size chunks so their addresses never change,
+// which miniaudio requires for ma_sound (the node graph holds pointers to it).
+// SoundIdTable maps the hash of a string ID to a slot index using open addressing
+// in one contiguous array, so a lookup is a hash plus a short linear scan instead
+// of a pointer chase down a tree of heap-allocated nodes.
+
+#ifndef SOUNDTABLE_H
+#define SOUNDTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Hashes a sound ID with 64-bit FNV-1a. Computed once per call (or once at load time
+// and stored alongside the ID) and reused for every probe.
+inline uint64_t HashSoundId(const char* id, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(id[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// A growable array whose elements are allocated ChunkSize at a time and never move.
+// Elements are value-initialized when their chunk is allocated and destroyed by Clear().
+template <typename T, size_t ChunkSize = 256>
+class SlabArray {
+public:
+    T& operator[](size_t index) {
+        return m_chunks[index / ChunkSize][index % ChunkSize];
+    }
+
+    const T& operator[](size_t index) const {
+        return m_chunks[index / ChunkSize][index % ChunkSize];
+    }
+
+    size_t Size() const {
+        return m_size;
+    }
+
+    // Appends an element and returns it, allocating a new chunk when the last one is full.
+    // Returns nullptr if the chunk could not be allocated.
+    T* EmplaceBack() {
+        if (m_size == m_chunks.size() * ChunkSize) {
+            std::unique_ptr<T[]> chunk(new (std::nothrow) T[ChunkSize]());
+            if (!chunk) {
+                return nullptr;
+            }
+            m_chunks.push_back(std::move(chunk));
+        }
+        return &(*this)[m_size++];
+    }
+
+    // Destroys every element and releases all chunks.
+    void Clear() {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    // Calls fn(element) for every element in index order, walking each chunk contiguously.
+    template <typename Fn>
+    void ForEach(Fn&& fn) {
+        size_t remaining = m_size;
+        for (auto& chunk : m_chunks) {
+            size_t count = remaining < ChunkSize ? remaining : ChunkSize;
+            for (size_t i = 0; i < count; ++i) {
+                fn(chunk[i]);
+            }
+            remaining -= count;
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<T[]>> m_chunks;
+    size_t m_size = 0;
+};
+
+// An open-addressing (linear probing) hash table from precomputed ID hashes to 32-bit
+// values. The table does not store the IDs themselves: lookups take a predicate that
+// confirms a candidate value really belongs to the ID being searched, which the caller
+// answers from wherever it keeps the ID (for SoundSystem.cpp, the sound's slot).
+class SoundIdTable {
+public:
+    static const uint32_t kEmpty = 0xFFFFFFFFu;
+
+    size_t Count() const {
+        return m_count;
+    }
+
+    // Returns the value stored for 'hash' that satisfies matches(value), or kEmpty.
+    template <typename Matches>
+    uint32_t Find(uint64_t hash, Matches&& matches) const {
+        if (m_count == 0) {
+            return kEmpty;
+        }
+        size_t mask = m_entries.size() - 1;
+        for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask) {
+            const Entry& entry = m_entries[i];
+            if (entry.value == kEmpty) {
+                return kEmpty;
+            }
+            if (entry.hash == hash && matches(entry.value)) {
+                return entry.value;
+            }
+        }
+    }
+
+    // Inserts a value. The caller guarantees the ID is not already present.
+    // Returns false if the table could not grow.
+    bool Insert(uint64_t hash, uint32_t value) {
+        // Keep the load factor at or below 1/2 so probe sequences stay short.
+        if ((m_count + 1) * 2 > m_entries.size()) {
+            if (!Rehash(m_entries.empty() ? 16 : m_entries.size() * 2)) {
+                return false;
+            }
+        }
+        Place(hash, value);
+        ++m_count;
+        return true;
+    }
+
+    // Removes the entry for 'hash' that satisfies matches(value). Returns false if not found.
+    template <typename Matches>
+    bool Erase(uint64_t hash, Matches&& matches) {
+        if (m_count == 0) {
+            return false;
+        }
+        size_t mask = m_entries.size() - 1;
+        size_t i = static_cast<size_t>(hash) & mask;
+        for (;; i = (i + 1) & mask) {
+            const Entry& entry = m_entries[i];
+            if (entry.value == kEmpty) {
+                return false;
+            }
+            if (entry.hash == hash && matches(entry.value)) {
+                break;
+            }
+        }
+
+        // Backward-shift deletion: pull later members of the probe run into the hole so
+        // lookups never need tombstones.
+        size_t hole = i;
+        for (size_t j = (hole + 1) & mask; m_entries[j].value != kEmpty; j = (j + 1) & mask) {
+            size_t home = static_cast<size_t>(m_entries[j].hash) & mask;
+            // Move entry j into the hole unless its home lies cyclically in (hole, j].
+            bool homeBetween = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+            if (!homeBetween) {
+                m_entries[hole] = m_entries[j];
+                hole = j;
+            }
+        }
+        m_entries[hole].value = kEmpty;
+        --m_count;
+        return true;
+    }
+
+    void Clear() {
+        m_entries.clear();
+        m_count = 0;
+    }
+
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        uint32_t value = kEmpty;
+    };
+
+    void Place(uint64_t hash, uint32_t value) {
+        size_t mask = m_entries.size() - 1;
+        size_t i = static_cast<size_t>(hash) & mask;
+        while (m_entries[i].value != kEmpty) {
+            i = (i + 1) & mask;
+        }
+        m_entries[i].hash = hash;
+        m_entries[i].value = value;
+    }
+
+    bool Rehash(size_t capacity) {
+        std::vector<Entry> old;
+        old.swap(m_entries);
+        try {
+            m_entries.resize(capacity);
+        }
+        catch (const std::bad_alloc&) {
+            m_entries.swap(old);
+            return false;
+        }
+        for (const Entry& entry : old) {
+            if (entry.value != kEmpty) {
+                Place(entry.hash, entry.value);
+            }
+        }
+        return true;
+    }
+
+    std::vector<Entry> m_entries; // Capacity is always zero or a power of two
+    size_t m_count = 0;
+};
+
+#endif // SOUNDTABLE_H
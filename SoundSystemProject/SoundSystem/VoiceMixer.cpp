@@ -0,0 +1,384 @@
+// --- VoiceMixer.cpp ---
+// Voice playback, resampling and placement with the mixing kernels (see VoiceMixer.h).
+
+#include "VoiceMixer.h"
+#include "Hrtf.h"
+#include "MixKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <thread>
+
+const uint32_t VoiceMixer::kMaxChannels;
+const uint32_t VoiceMixer::kMaxStep;
+const uint64_t VoiceMixer::kUnknownLength;
+
+namespace {
+
+    const double kOne = 4294967296.0; // 1.0 in 32.32 fixed point
+
+    inline uint64_t FrameOf(uint64_t position) {
+        return position >> 32;
+    }
+
+    inline float FractionOf(uint64_t position) {
+        return static_cast<float>(static_cast<uint32_t>(position) * (1.0 / kOne));
+    }
+
+    // Frames k in [0, frames) whose position, start + k * step, lies before 'length'.
+    uint32_t FramesBefore(uint64_t start, uint64_t step, uint64_t length, uint32_t frames) {
+        if (FrameOf(start) >= length) {
+            return 0;
+        }
+        uint64_t left = (length << 32) - start;
+        uint64_t fit = (left + step - 1) / step;
+        return static_cast<uint32_t>(std::min<uint64_t>(fit, frames));
+    }
+
+}
+
+VoiceMixer::VoiceMixer() {
+}
+
+VoiceMixer::~VoiceMixer() {
+    Shutdown();
+}
+
+bool VoiceMixer::Init(uint32_t voiceCount, uint32_t channels, uint32_t sampleRate) {
+    Shutdown();
+    if (channels == 0 || sampleRate == 0) {
+        return false;
+    }
+    m_voices.reset(new (std::nothrow) Voice[voiceCount]);
+    if (!m_voices) {
+        return false;
+    }
+    try {
+        m_stage.assign(kChunkFrames * 2, 0.0f);
+        m_block.assign(kChunkFrames * std::max<uint32_t>(channels, 2), 0.0f);
+        m_window.assign(static_cast<size_t>(kWindowFrames) * kMaxChannels, 0.0f);
+    }
+    catch (const std::bad_alloc&) {
+        Shutdown();
+        return false;
+    }
+    m_voiceCount = voiceCount;
+    m_channels = channels;
+    m_sampleRate = sampleRate;
+    return true;
+}
+
+void VoiceMixer::Shutdown() {
+    m_voices.reset();
+    m_voiceCount = 0;
+    m_channels = 0;
+    m_sampleRate = 0;
+    std::vector<float>().swap(m_stage);
+    std::vector<float>().swap(m_block);
+    std::vector<float>().swap(m_window);
+}
+
+// Waits out a Mix call that has the voice, then keeps Mix off it until the caller stores
+// the next state. Returns the state it had.
+uint8_t VoiceMixer::Hold(Voice& voice) {
+    for (;;) {
+        uint8_t state = voice.state.load(std::memory_order_acquire);
+        if (state == Mixing) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (voice.state.compare_exchange_weak(state, Held, std::memory_order_acquire)) {
+            return state;
+        }
+    }
+}
+
+void VoiceMixer::Seek(Voice& voice, uint64_t frame) {
+    voice.position = frame << 32;
+    voice.readFrame = frame;
+    voice.carryCount = 0;
+    if (voice.source.seek) {
+        voice.source.seek(voice.source.user, frame);
+    }
+}
+
+void VoiceMixer::Start(uint32_t index, const Source& source, uint32_t bus, bool paused) {
+    Voice& voice = m_voices[index];
+    Hold(voice);
+    voice.source = source;
+    voice.length = source.frameCount != 0 || !source.read ? source.frameCount : kUnknownLength;
+    voice.rate = static_cast<double>(source.sampleRate) / m_sampleRate;
+    voice.restart = true;
+    Seek(voice, 0);
+    voice.bus.store(bus, std::memory_order_relaxed);
+    voice.state.store(paused ? Paused : Playing, std::memory_order_release);
+}
+
+void VoiceMixer::Stop(uint32_t index) {
+    Voice& voice = m_voices[index];
+    Hold(voice);
+    voice.source = Source();
+    voice.length = 0;
+    voice.position = 0;
+    voice.state.store(Idle, std::memory_order_release);
+}
+
+void VoiceMixer::Pause(uint32_t index) {
+    Voice& voice = m_voices[index];
+    uint8_t state = Hold(voice);
+    voice.state.store(state == Playing ? static_cast<uint8_t>(Paused) : state, std::memory_order_release);
+}
+
+void VoiceMixer::Resume(uint32_t index, uint64_t frame) {
+    Voice& voice = m_voices[index];
+    uint8_t state = Hold(voice);
+    if (state == Idle) {
+        voice.state.store(Idle, std::memory_order_release);
+        return;
+    }
+    Seek(voice, frame);
+    voice.restart = true;
+    voice.state.store(Playing, std::memory_order_release);
+}
+
+bool VoiceMixer::IsPlaying(uint32_t index) const {
+    uint8_t state = m_voices[index].state.load(std::memory_order_acquire);
+    return state == Playing || state == Mixing;
+}
+
+uint64_t VoiceMixer::Cursor(uint32_t index) const {
+    return FrameOf(m_voices[index].position);
+}
+
+void VoiceMixer::SetBus(uint32_t index, uint32_t bus) {
+    m_voices[index].bus.store(bus, std::memory_order_relaxed);
+}
+
+void VoiceMixer::SetGains(uint32_t index, float left, float right) {
+    m_voices[index].left.store(left, std::memory_order_relaxed);
+    m_voices[index].right.store(right, std::memory_order_relaxed);
+}
+
+void VoiceMixer::SetPitch(uint32_t index, float pitch) {
+    m_voices[index].pitch.store(pitch, std::memory_order_relaxed);
+}
+
+void VoiceMixer::SetRenderer(uint32_t index, HrtfRenderer* renderer) {
+    Voice& voice = m_voices[index];
+    uint8_t state = Hold(voice);
+    voice.renderer = renderer;
+    voice.state.store(state, std::memory_order_release);
+}
+
+// Mono sources stage as mono; everything else as its front pair.
+uint32_t VoiceMixer::StageChannels(const Voice& voice) const {
+    return voice.source.channels == 1 ? 1 : 2;
+}
+
+// Resamples up to 'frames' output frames of a PCM source from the voice's position and
+// moves it on. Returns the staged frames, StageChannels() per frame, and sets 'frames' to
+// how many there are; fewer than asked means the source ended. At the source's own rate a
+// mono or stereo source is returned in place.
+const float* VoiceMixer::Stage(Voice& voice, uint64_t step, uint32_t& frames) {
+    const Source& source = voice.source;
+    uint32_t channels = source.channels;
+    frames = FramesBefore(voice.position, step, voice.length, frames);
+    uint64_t first = FrameOf(voice.position);
+
+    if (step == (1ull << 32) && static_cast<uint32_t>(voice.position) == 0 && channels <= 2) {
+        voice.position += static_cast<uint64_t>(frames) << 32;
+        return source.frames + first * channels;
+    }
+
+    uint32_t stageChannels = StageChannels(voice);
+    float* stage = m_stage.data();
+    uint64_t position = voice.position;
+    for (uint32_t k = 0; k < frames; ++k, position += step) {
+        uint64_t frame = FrameOf(position);
+        float fraction = FractionOf(position);
+        const float* a = source.frames + frame * channels;
+        const float* b = frame + 1 < voice.length ? a + channels : nullptr;
+        for (uint32_t c = 0; c < stageChannels; ++c) {
+            float next = b ? b[c] : 0.0f;
+            stage[k * stageChannels + c] = a[c] + (next - a[c]) * fraction;
+        }
+    }
+    voice.position = position;
+    return stage;
+}
+
+// As Stage, for a reader source. Reads on from where the last chunk stopped into the
+// window, after the two frames the last chunk kept for interpolating across the boundary.
+// The caller keeps 'frames' small enough for the chunk to fit in the window.
+const float* VoiceMixer::StageReader(Voice& voice, uint64_t step, uint32_t& frames) {
+    const Source& source = voice.source;
+    uint32_t channels = source.channels;
+    float* window = m_window.data();
+    uint64_t base = voice.readFrame - voice.carryCount;
+    std::memcpy(window, voice.carry, voice.carryCount * channels * sizeof(float));
+
+    // The chunk reads frames up to the one after its last position.
+    uint64_t last = FrameOf(voice.position + (frames - 1) * step);
+    uint64_t end = std::min(last + 2, voice.length);
+    if (end > voice.readFrame) {
+        uint64_t wanted = end - voice.readFrame;
+        uint64_t read = source.read(source.user, window + (voice.readFrame - base) * channels, wanted);
+        voice.readFrame += read;
+        if (read < wanted) {
+            voice.length = voice.readFrame;
+        }
+    }
+    uint64_t available = voice.readFrame;
+    if (voice.length != kUnknownLength) {
+        frames = FramesBefore(voice.position, step, voice.length, frames);
+    }
+
+    uint32_t stageChannels = StageChannels(voice);
+    float* stage = m_stage.data();
+    uint64_t position = voice.position;
+    for (uint32_t k = 0; k < frames; ++k, position += step) {
+        uint64_t frame = FrameOf(position);
+        float fraction = FractionOf(position);
+        const float* a = window + (frame - base) * channels;
+        const float* b = frame + 1 < available ? a + channels : nullptr;
+        for (uint32_t c = 0; c < stageChannels; ++c) {
+            float next = b ? b[c] : 0.0f;
+            stage[k * stageChannels + c] = a[c] + (next - a[c]) * fraction;
+        }
+    }
+    voice.position = position;
+
+    voice.carryCount = static_cast<uint32_t>(std::min<uint64_t>(2, available - base));
+    std::memcpy(voice.carry, window + (available - base - voice.carryCount) * channels,
+                voice.carryCount * channels * sizeof(float));
+    return stage;
+}
+
+// Adds 'frames' staged frames to 'out', shaped by 'left' and 'right' (each at most 1) and
+// ramped from 'gainStart' to 'gainEnd'.
+void VoiceMixer::Place(Voice& voice, const float* stage, uint32_t frames, float* out, float gainStart, float gainEnd, float left, float right) {
+    const MixKernels::Table& kernels = MixKernels::Active();
+    uint32_t stageChannels = StageChannels(voice);
+    float* block = m_block.data();
+
+    if (m_channels == 2) {
+        if (voice.renderer) {
+            if (stageChannels == 1) {
+                std::memset(block, 0, frames * 2 * sizeof(float));
+                kernels.spreadMonoToStereo(block, stage, frames, left, right);
+            }
+            else {
+                std::memcpy(block, stage, frames * 2 * sizeof(float));
+                kernels.panStereo(block, frames, left, right);
+            }
+            voice.renderer->Process(block, block, frames);
+            kernels.mixRamp(out, block, frames, 2, gainStart, gainEnd);
+        }
+        else if (stageChannels == 1) {
+            if (gainStart == gainEnd) {
+                kernels.spreadMonoToStereo(out, stage, frames, left * gainStart, right * gainStart);
+            }
+            else {
+                std::memset(block, 0, frames * 2 * sizeof(float));
+                kernels.spreadMonoToStereo(block, stage, frames, left, right);
+                kernels.mixRamp(out, block, frames, 2, gainStart, gainEnd);
+            }
+        }
+        else if (left == 1.0f && right == 1.0f) {
+            kernels.mixRamp(out, stage, frames, 2, gainStart, gainEnd);
+        }
+        else {
+            std::memcpy(block, stage, frames * 2 * sizeof(float));
+            kernels.panStereo(block, frames, left, right);
+            kernels.mixRamp(out, block, frames, 2, gainStart, gainEnd);
+        }
+    }
+    else if (m_channels == 1) {
+        if (stageChannels == 2) {
+            for (uint32_t k = 0; k < frames; ++k) {
+                block[k] = (stage[k * 2] + stage[k * 2 + 1]) * 0.5f;
+            }
+            stage = block;
+        }
+        kernels.mixRamp(out, stage, frames, 1, gainStart, gainEnd);
+    }
+    else {
+        // Surround: the front pair only.
+        std::memset(block, 0, frames * m_channels * sizeof(float));
+        for (uint32_t k = 0; k < frames; ++k) {
+            const float* frame = stage + k * stageChannels;
+            block[k * m_channels] = frame[0] * left;
+            block[k * m_channels + 1] = frame[stageChannels - 1] * right;
+        }
+        kernels.mixRamp(out, block, frames, m_channels, gainStart, gainEnd);
+    }
+}
+
+// Mixes one block of a voice. Returns false once the voice has reached its end.
+bool VoiceMixer::MixVoice(Voice& voice, float* out, uint32_t frames) {
+    double speed = voice.rate * voice.pitch.load(std::memory_order_relaxed);
+    speed = std::min(std::max(speed, 1.0 / kOne), static_cast<double>(kMaxStep));
+    uint64_t step = static_cast<uint64_t>(speed * kOne);
+
+    float left = std::fabs(voice.left.load(std::memory_order_relaxed));
+    float right = std::fabs(voice.right.load(std::memory_order_relaxed));
+    float peak = std::max(left, right);
+    float gainStart = voice.restart ? peak : voice.lastGain;
+    voice.restart = false;
+    voice.lastGain = peak;
+    if (peak > 0.0f) {
+        left /= peak;
+        right /= peak;
+    }
+    else {
+        left = right = 1.0f; // Fading out: keep both sides
+    }
+
+    // Silent PCM only needs to move on; readers still have to be read.
+    if (peak == 0.0f && gainStart == 0.0f && voice.source.frames) {
+        voice.position += step * frames;
+        return FrameOf(voice.position) < voice.length;
+    }
+
+    // A reader chunk has to fit in the window with room for the frames it skips.
+    uint32_t chunkFrames = kChunkFrames;
+    if (!voice.source.frames) {
+        uint64_t fit = (static_cast<uint64_t>(kWindowFrames / 2) << 32) / step;
+        chunkFrames = static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(chunkFrames, fit)));
+    }
+
+    float gainStep = (peak - gainStart) / frames;
+    uint32_t done = 0;
+    while (done < frames) {
+        uint32_t wanted = std::min(chunkFrames, frames - done);
+        uint32_t staged = wanted;
+        const float* stage = voice.source.frames ? Stage(voice, step, staged) : StageReader(voice, step, staged);
+        float chunkStart = gainStart + gainStep * done;
+        float chunkEnd = staged == frames - done ? peak : gainStart + gainStep * (done + staged);
+        Place(voice, stage, staged, out + static_cast<size_t>(done) * m_channels, chunkStart, chunkEnd, left, right);
+        done += staged;
+        if (staged < wanted) {
+            return false;
+        }
+    }
+    return FrameOf(voice.position) < voice.length;
+}
+
+void VoiceMixer::Mix(uint32_t bus, float* out, uint32_t frames) {
+    if (frames == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < m_voiceCount; ++i) {
+        Voice& voice = m_voices[i];
+        if (voice.bus.load(std::memory_order_relaxed) != bus) {
+            continue;
+        }
+        uint8_t expected = Playing;
+        if (!voice.state.compare_exchange_strong(expected, Mixing, std::memory_order_acquire)) {
+            continue;
+        }
+        bool playing = MixVoice(voice, out, frames);
+        voice.state.store(playing ? Playing : Ended, std::memory_order_release);
+    }
+}
@@ -0,0 +1,169 @@
+// --- VoiceMixer.h ---
+// Mixes the voices of PlaySoundInstance straight into their buses with the SIMD kernels, in
+// place of one miniaudio sound per voice, each an engine node with its own resampler,
+// panner, volume stage and trip through the node graph.
+//
+// The mixer holds the playback state of every pool voice: the data it reads, where it is,
+// its gains and pitch, and the bus it plays on. Each bus has a node (see "Voice mixing" in
+// SoundSystem.cpp) that calls Mix for the bus once per block. Mix reads each of the bus's
+// voices in chunks, resampling by linear interpolation when the voice's rate differs from
+// the mixing rate (its sample rate, pitch or doppler shift, as miniaudio's sounds do), and
+// places it with the kernels: spreadMonoToStereo for mono sources, panStereo for stereo
+// ones, then mixRamp to add it to the bus with its gain ramped across the block. A voice
+// reading PCM at the mixing rate and pitch is summed straight out of the cached data.
+// Benchmarks/VoiceMixerBenchmark times it against miniaudio sounds at 256 voices.
+//
+// Sources are interleaved 32-bit float: decoded PCM read in place, or a reader callback
+// (a decoder over a compressed sound) that Mix calls on the audio thread. Sources with more
+// than two channels play their first two, front left and right.
+//
+// Threads: Mix runs on the thread that mixes, one call at a time. Everything else is for the
+// sound system, which calls it with its registry lock held. Gains, pitch and bus are
+// atomics that may change while a voice is being mixed. Start, Stop, Pause, Resume and
+// SetRenderer change what Mix reads, so they wait out a block that is mixing the voice
+// right now (microseconds); Mix never waits, and skips a voice they hold.
+
+#ifndef VOICEMIXER_H
+#define VOICEMIXER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class HrtfRenderer;
+
+class VoiceMixer {
+public:
+    // Most channels a source may have.
+    static const uint32_t kMaxChannels = 8;
+
+    // Fastest a voice plays, as source frames per output frame. Higher pitches play at this.
+    static const uint32_t kMaxStep = 64;
+
+    // Reads up to 'frames' frames into 'out' and returns how many were read; fewer means
+    // the source has ended. Called on the mixing thread.
+    typedef uint64_t (*ReadProc)(void* user, float* out, uint64_t frames);
+
+    // Moves a reader to 'frame'. Called by Start and Resume.
+    typedef void (*SeekProc)(void* user, uint64_t frame);
+
+    struct Source {
+        const float* frames = nullptr; // Interleaved PCM, or nullptr to use 'read'
+        uint64_t frameCount = 0;       // Length in frames; 0 if a reader's length is unknown
+        uint32_t channels = 0;         // 1 to kMaxChannels
+        uint32_t sampleRate = 0;
+        ReadProc read = nullptr;
+        SeekProc seek = nullptr;
+        void* user = nullptr;
+    };
+
+    VoiceMixer();
+    ~VoiceMixer();
+    VoiceMixer(const VoiceMixer&) = delete;
+    VoiceMixer& operator=(const VoiceMixer&) = delete;
+
+    // Makes room for 'voiceCount' voices mixed to 'channels' channels at 'sampleRate', all
+    // idle. Returns false if memory runs out.
+    bool Init(uint32_t voiceCount, uint32_t channels, uint32_t sampleRate);
+
+    // Frees everything. Nothing may be mixing.
+    void Shutdown();
+
+    uint32_t Channels() const { return m_channels; }
+
+    // Starts a voice on 'source' from its first frame, on 'bus', or loads it paused there.
+    // It plays with the gains and pitch last set, without ramping from what it last played.
+    void Start(uint32_t voice, const Source& source, uint32_t bus, bool paused = false);
+
+    // Stops a voice. Once this returns, Mix no longer reads its source.
+    void Stop(uint32_t voice);
+
+    // Stops mixing a voice but keeps its place, which Cursor then reports.
+    void Pause(uint32_t voice);
+
+    // Plays a started voice again from source frame 'frame', if it hasn't been stopped.
+    void Resume(uint32_t voice, uint64_t frame);
+
+    // True from Start or Resume until the voice reaches the end of its source or is paused
+    // or stopped.
+    bool IsPlaying(uint32_t voice) const;
+
+    // The source frame a voice that isn't playing stopped at.
+    uint64_t Cursor(uint32_t voice) const;
+
+    // The bus whose Mix calls play the voice.
+    void SetBus(uint32_t voice, uint32_t bus);
+
+    // Gains of the left and right output channels, volume and pan included. With mono
+    // output the voice plays at the louder of the two; with more than two channels it plays
+    // on the front pair.
+    void SetGains(uint32_t voice, float left, float right);
+
+    // Playback speed, 1 for the source's own rate: pitch times doppler shift.
+    void SetPitch(uint32_t voice, float pitch);
+
+    // Renders the voice binaurally through 'renderer' (stereo output only), or not with
+    // nullptr. The gains then only carry volume and pan; the renderer adds distance.
+    void SetRenderer(uint32_t voice, HrtfRenderer* renderer);
+
+    // Adds the playing voices on 'bus' to 'out', 'frames' interleaved frames.
+    void Mix(uint32_t bus, float* out, uint32_t frames);
+
+private:
+    static const uint32_t kChunkFrames = 256;     // Output frames placed per kernel call
+    static const uint32_t kWindowFrames = 2048;   // Source frames a reader chunk may span
+    static const uint64_t kUnknownLength = ~0ull;
+
+    enum State : uint8_t {
+        Idle,    // Free, or stopped
+        Playing,
+        Mixing,  // Being mixed; only Mix leaves this state
+        Held,    // Being changed by the control side; Mix skips it
+        Paused,
+        Ended,   // Reached the end of its source
+    };
+
+    struct Voice {
+        std::atomic<uint8_t> state{ Idle };
+        std::atomic<uint32_t> bus{ 0xFFFFFFFFu };
+        std::atomic<float> left{ 1.0f };
+        std::atomic<float> right{ 1.0f };
+        std::atomic<float> pitch{ 1.0f };
+
+        // Changed only while Held; Mix reads them while Mixing.
+        Source source;
+        HrtfRenderer* renderer = nullptr;
+        uint64_t length = 0;       // Frames in the source; kUnknownLength for a reader until it ends
+        double rate = 1.0;         // Source rate over mixing rate
+        bool restart = true;       // Play the next block at the set gain rather than ramping to it
+
+        // Mix's own between blocks.
+        uint64_t position = 0;     // Source frame, 32.32 fixed point
+        float lastGain = 0.0f;     // Gain at the end of the last block
+        uint64_t readFrame = 0;    // Reader sources: next frame 'read' returns
+        uint32_t carryCount = 0;   // Reader sources: frames kept from the last chunk, up to 2
+        float carry[2 * kMaxChannels] = {};
+    };
+
+    uint8_t Hold(Voice& voice);
+    void Seek(Voice& voice, uint64_t frame);
+    uint32_t StageChannels(const Voice& voice) const;
+    const float* Stage(Voice& voice, uint64_t step, uint32_t& frames);
+    const float* StageReader(Voice& voice, uint64_t step, uint32_t& frames);
+    void Place(Voice& voice, const float* stage, uint32_t frames, float* out, float gainStart, float gainEnd, float left, float right);
+    bool MixVoice(Voice& voice, float* out, uint32_t frames);
+
+    std::unique_ptr<Voice[]> m_voices;
+    uint32_t m_voiceCount = 0;
+    uint32_t m_channels = 0;
+    uint32_t m_sampleRate = 0;
+
+    // Scratch for Mix, sized by Init.
+    std::vector<float> m_stage;   // A chunk resampled: kChunkFrames frames of 1 or 2 channels
+    std::vector<float> m_block;   // A chunk placed: kChunkFrames frames of the output channels
+    std::vector<float> m_window;  // Frames read from a reader
+};
+
+#endif // VOICEMIXER_H
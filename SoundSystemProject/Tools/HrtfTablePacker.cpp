@@ -0,0 +1,250 @@
+// --- HrtfTablePacker.cpp ---
+// Command-line tool that packs measured head-related impulse responses into an HRTF table
+// for LoadHrtf. The layout is described in SoundSystem/HrtfFormat.h.
+//
+// Usage:
+//   HrtfTablePacker -o <table> [--taps <n>] [--threshold <dB>] --list <file>
+//
+//   -o <table>         Table file to write.
+//   --list <file>      The measurements: one "azimuth elevation file" per line, azimuth and
+//                      elevation in degrees as in SOFA (azimuth counterclockwise from ahead,
+//                      so 90 is the left; elevation up). Each file holds one direction's
+//                      impulse responses as stereo audio, left ear first, in any format
+//                      miniaudio decodes. Blank lines and lines starting with '#' are ignored.
+//   --taps <n>         Longest response to keep after its onset, in frames (default 256).
+//                      Longer responses are cut with a short fade; shorter ones are padded.
+//   --threshold <dB>   Onset level relative to each response's peak (default -20).
+//
+// Every file must have the same sample rate; the loader converts the table to the mixing
+// rate. SOFA files (HDF5) aren't read directly: export the Data.IR of each source position
+// to a stereo WAV, e.g. with the SOFA toolboxes for MATLAB/Octave or python-sofa, and list them.
+//
+// Each ear's onset, the first frame within --threshold of its peak (less two frames of
+// lead-in), is cut from the response and stored as that ear's delay. The delay all
+// responses share, the travel time from the loudspeaker, is removed, so the delays left are
+// the interaural time differences plus the head's own shading.
+//
+// Build with CMake (SOUNDSYSTEM_BUILD_TOOLS), or by hand with miniaudio.h on the include path:
+//   g++ -O2 -std=c++17 -I../SoundSystem -I<miniaudio> HrtfTablePacker.cpp -o HrtfTablePacker -lpthread -ldl -lm
+//   cl /O2 /std:c++17 /EHsc /I..\SoundSystem /I<miniaudio> HrtfTablePacker.cpp
+
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+#include "HrtfFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct MeasuredDirection {
+    float azimuth = 0.0f;
+    float elevation = 0.0f;
+    std::string path;
+    std::vector<float> ears[2]; // Whole decoded response of each ear
+    uint32_t onsets[2] = {};
+};
+
+static void PrintUsage() {
+    std::fprintf(stderr,
+        "Usage: HrtfTablePacker -o <table> [--taps <n>] [--threshold <dB>] --list <file>\n"
+        "  -o <table>         Table file to write\n"
+        "  --list <file>      \"azimuth elevation file\" lines; files are stereo impulse responses\n"
+        "  --taps <n>         Frames of each response to keep after its onset (default 256)\n"
+        "  --threshold <dB>   Onset level relative to the response's peak (default -20)\n");
+}
+
+static bool ReadList(const char* listPath, std::vector<MeasuredDirection>& directions) {
+    std::ifstream list(listPath);
+    if (!list) {
+        std::fprintf(stderr, "error: can't open list file '%s'\n", listPath);
+        return false;
+    }
+    std::string line;
+    for (int lineNumber = 1; std::getline(list, line); ++lineNumber) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        MeasuredDirection direction;
+        std::istringstream fields(line);
+        if (!(fields >> direction.azimuth >> direction.elevation) || !std::getline(fields >> std::ws, direction.path) ||
+            direction.path.empty() || direction.elevation < -90.0f || direction.elevation > 90.0f) {
+            std::fprintf(stderr, "error: %s:%d: expected \"azimuth elevation file\"\n", listPath, lineNumber);
+            return false;
+        }
+        directions.push_back(direction);
+    }
+    return true;
+}
+
+// Decodes one direction's stereo file into its two ears.
+static bool ReadResponses(MeasuredDirection& direction, ma_uint32& sampleRate) {
+    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, 0, 0);
+    ma_decoder decoder;
+    ma_result result = ma_decoder_init_file(direction.path.c_str(), &decoderConfig, &decoder);
+    if (result != MA_SUCCESS) {
+        std::fprintf(stderr, "error: can't decode '%s' (%d)\n", direction.path.c_str(), result);
+        return false;
+    }
+    ma_uint32 channels = decoder.outputChannels;
+    ma_uint32 rate = decoder.outputSampleRate;
+    std::vector<float> frames;
+    const ma_uint64 kChunkFrames = 4096;
+    ma_uint64 total = 0;
+    for (;;) {
+        frames.resize(static_cast<size_t>((total + kChunkFrames) * channels));
+        ma_uint64 read = 0;
+        result = ma_decoder_read_pcm_frames(&decoder, &frames[static_cast<size_t>(total * channels)], kChunkFrames, &read);
+        total += read;
+        if (read < kChunkFrames || result != MA_SUCCESS) {
+            break;
+        }
+    }
+    ma_decoder_uninit(&decoder);
+    if (channels != 2 || total == 0) {
+        std::fprintf(stderr, "error: '%s' must be a stereo impulse response (left, right)\n", direction.path.c_str());
+        return false;
+    }
+    if (sampleRate != 0 && rate != sampleRate) {
+        std::fprintf(stderr, "error: '%s' is at %u Hz; the others are at %u Hz\n", direction.path.c_str(), rate, sampleRate);
+        return false;
+    }
+    sampleRate = rate;
+    for (int ear = 0; ear < 2; ++ear) {
+        direction.ears[ear].resize(static_cast<size_t>(total));
+        for (ma_uint64 i = 0; i < total; ++i) {
+            direction.ears[ear][static_cast<size_t>(i)] = frames[static_cast<size_t>(i * 2 + ear)];
+        }
+    }
+    return true;
+}
+
+// The first frame within 'threshold' (a fraction of the peak) of the response's peak, less
+// two frames so the rise into the onset isn't clipped.
+static uint32_t FindOnset(const std::vector<float>& response, float threshold) {
+    float peak = 0.0f;
+    for (float sample : response) {
+        peak = std::max(peak, std::fabs(sample));
+    }
+    for (size_t i = 0; i < response.size(); ++i) {
+        if (std::fabs(response[i]) >= peak * threshold) {
+            return static_cast<uint32_t>(i >= 2 ? i - 2 : 0);
+        }
+    }
+    return 0;
+}
+
+static bool WriteTable(const char* tablePath, const std::vector<MeasuredDirection>& directions, ma_uint32 sampleRate,
+                       uint32_t taps, uint32_t commonDelay) {
+    HrtfTable::Header header = {};
+    std::memcpy(header.magic, HrtfTable::kMagic, sizeof(header.magic));
+    header.version = HrtfTable::kVersion;
+    header.sampleRate = sampleRate;
+    header.measurementCount = static_cast<uint32_t>(directions.size());
+    header.taps = taps;
+
+    std::ofstream table(tablePath, std::ios::binary | std::ios::trunc);
+    if (!table) {
+        std::fprintf(stderr, "error: can't create '%s'\n", tablePath);
+        return false;
+    }
+    table.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // The last 16 kept frames fade out, so a response cut short doesn't end on a step.
+    const uint32_t kFadeFrames = std::min(16u, taps);
+    std::vector<float> response(taps);
+    for (const MeasuredDirection& direction : directions) {
+        HrtfTable::Measurement measurement = {};
+        measurement.azimuth = direction.azimuth;
+        measurement.elevation = direction.elevation;
+        measurement.delayLeft = static_cast<float>(direction.onsets[0] - commonDelay);
+        measurement.delayRight = static_cast<float>(direction.onsets[1] - commonDelay);
+        table.write(reinterpret_cast<const char*>(&measurement), sizeof(measurement));
+        for (int ear = 0; ear < 2; ++ear) {
+            const std::vector<float>& source = direction.ears[ear];
+            std::fill(response.begin(), response.end(), 0.0f);
+            size_t available = source.size() - direction.onsets[ear];
+            bool cut = available > taps;
+            for (uint32_t i = 0; i < taps && i < available; ++i) {
+                response[i] = source[direction.onsets[ear] + i];
+                if (cut && i >= taps - kFadeFrames) {
+                    response[i] *= static_cast<float>(taps - i) / (kFadeFrames + 1);
+                }
+            }
+            table.write(reinterpret_cast<const char*>(response.data()), static_cast<std::streamsize>(taps * sizeof(float)));
+        }
+    }
+    if (!table) {
+        std::fprintf(stderr, "error: failed writing '%s'\n", tablePath);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* tablePath = nullptr;
+    uint32_t maxTaps = 256;
+    float thresholdDb = -20.0f;
+    std::vector<MeasuredDirection> directions;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            tablePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--taps") == 0 && i + 1 < argc) {
+            maxTaps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            if (maxTaps == 0) {
+                std::fprintf(stderr, "error: --taps needs a length in frames\n");
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            thresholdDb = static_cast<float>(std::strtod(argv[++i], nullptr));
+            if (!(thresholdDb < 0.0f)) {
+                std::fprintf(stderr, "error: --threshold needs a level below 0 dB\n");
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+            if (!ReadList(argv[++i], directions)) {
+                return 1;
+            }
+        }
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (!tablePath || directions.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    ma_uint32 sampleRate = 0;
+    float threshold = std::pow(10.0f, thresholdDb / 20.0f);
+    uint32_t commonDelay = 0xFFFFFFFFu;
+    uint32_t taps = 0;
+    for (MeasuredDirection& direction : directions) {
+        if (!ReadResponses(direction, sampleRate)) {
+            return 1;
+        }
+        for (int ear = 0; ear < 2; ++ear) {
+            direction.onsets[ear] = FindOnset(direction.ears[ear], threshold);
+            commonDelay = std::min(commonDelay, direction.onsets[ear]);
+            taps = std::max(taps, static_cast<uint32_t>(direction.ears[ear].size() - direction.onsets[ear]));
+        }
+    }
+    taps = std::min(taps, maxTaps);
+    if (!WriteTable(tablePath, directions, sampleRate, taps, commonDelay)) {
+        return 1;
+    }
+    std::printf("Packed %zu directions (%u taps at %u Hz, %u frames of common delay removed) into '%s'.\n",
+                directions.size(), taps, sampleRate, commonDelay, tablePath);
+    return 0;
+}
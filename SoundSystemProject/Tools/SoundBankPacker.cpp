@@ -0,0 +1,262 @@
+// --- SoundBankPacker.cpp ---
+// Command-line tool that packs audio files into a sound bank for LoadSoundBank.
+// The layout is described in SoundSystem/SoundBankFormat.h.
+//
+// Usage:
+//   SoundBankPacker -o <bank> [--pcm <rate> [--s16]] [--list <file>] [id=]file...
+//
+//   -o <bank>      Bank file to write.
+//   --pcm <rate>   Decode every sound to 32-bit float PCM at <rate> Hz (normally the game's
+//                  mixing rate) while packing, so loading the bank decodes nothing. Larger
+//                  banks; without it the files are stored as they are.
+//   --s16          With --pcm, store 16-bit PCM instead: half the size, converted to float
+//                  when the bank is loaded (still no decode).
+//   --list <file>  Read more sounds from a text file, one "[id=]file" per line. Blank lines
+//                  and lines starting with '#' are ignored.
+//
+// A sound's ID defaults to its file name without directory or extension.
+//
+// Build with CMake (SOUNDSYSTEM_BUILD_TOOLS), or by hand with miniaudio.h on the include path:
+//   g++ -O2 -std=c++17 -I../SoundSystem -I<miniaudio> SoundBankPacker.cpp -o SoundBankPacker -lpthread -ldl -lm
+//   cl /O2 /std:c++17 /EHsc /I..\SoundSystem /I<miniaudio> SoundBankPacker.cpp
+
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+#include "SoundBankFormat.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+struct PackInput {
+    std::string id;
+    std::string path;
+};
+
+// One sound's data and how it is stored, ready to be written.
+struct PackedSound {
+    std::string id;
+    std::vector<unsigned char> data;
+    SoundBank::Entry entry = {};
+};
+
+static void PrintUsage() {
+    std::fprintf(stderr,
+        "Usage: SoundBankPacker -o <bank> [--pcm <rate> [--s16]] [--list <file>] [id=]file...\n"
+        "  -o <bank>      Bank file to write\n"
+        "  --pcm <rate>   Store sounds decoded to 32-bit float PCM at <rate> Hz\n"
+        "  --s16          With --pcm, store 16-bit PCM instead of float\n"
+        "  --list <file>  Read \"[id=]file\" lines from a text file\n");
+}
+
+// Splits "id=file" into its parts; a plain "file" gets its name without extension as the ID.
+static PackInput ParseInput(const std::string& argument) {
+    PackInput input;
+    size_t equals = argument.find('=');
+    if (equals != std::string::npos && equals > 0) {
+        input.id = argument.substr(0, equals);
+        input.path = argument.substr(equals + 1);
+        return input;
+    }
+    input.path = argument;
+    size_t nameStart = argument.find_last_of("/\\");
+    nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+    size_t dot = argument.find_last_of('.');
+    size_t nameEnd = dot == std::string::npos || dot < nameStart ? argument.size() : dot;
+    input.id = argument.substr(nameStart, nameEnd - nameStart);
+    return input;
+}
+
+static bool ReadList(const char* listPath, std::vector<PackInput>& inputs) {
+    std::ifstream list(listPath);
+    if (!list) {
+        std::fprintf(stderr, "error: can't open list file '%s'\n", listPath);
+        return false;
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        inputs.push_back(ParseInput(line));
+    }
+    return true;
+}
+
+static bool ReadWholeFile(const std::string& path, std::vector<unsigned char>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamoff size = file.tellg();
+    if (size <= 0) {
+        return false;
+    }
+    data.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+// Fills in a sound's data: the file as it is, or decoded to 'pcmFormat' when 'pcmRate' isn't
+// 0. Files are always opened with miniaudio so a bank never holds something the game can't play.
+static bool PackSound(const PackInput& input, ma_uint32 pcmRate, ma_format pcmFormat, PackedSound& out) {
+    out.id = input.id;
+    if (pcmRate == 0) {
+        if (!ReadWholeFile(input.path, out.data)) {
+            std::fprintf(stderr, "error: can't read '%s'\n", input.path.c_str());
+            return false;
+        }
+        ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, 0, 0);
+        ma_decoder decoder;
+        ma_result result = ma_decoder_init_memory(out.data.data(), out.data.size(), &decoderConfig, &decoder);
+        if (result != MA_SUCCESS) {
+            std::fprintf(stderr, "error: '%s' is not a format miniaudio can decode (%d)\n", input.path.c_str(), result);
+            return false;
+        }
+        ma_decoder_uninit(&decoder);
+        out.entry.encoding = SoundBank::kEncodingFile;
+        return true;
+    }
+
+    // Same conversion SOUNDSYSTEM_LOAD_RESAMPLE does at load time, done once here instead.
+    ma_decoder_config decoderConfig = ma_decoder_config_init(pcmFormat, 0, pcmRate);
+    decoderConfig.resampling.linear.lpfOrder = MA_MAX_FILTER_ORDER;
+    ma_uint64 frameCount = 0;
+    void* frames = NULL;
+    ma_result result = ma_decode_file(input.path.c_str(), &decoderConfig, &frameCount, &frames);
+    if (result != MA_SUCCESS) {
+        std::fprintf(stderr, "error: can't decode '%s' (%d)\n", input.path.c_str(), result);
+        return false;
+    }
+    const unsigned char* bytes = static_cast<const unsigned char*>(frames);
+    out.data.assign(bytes, bytes + frameCount * ma_get_bytes_per_frame(pcmFormat, decoderConfig.channels));
+    ma_free(frames, NULL);
+    out.entry.encoding = pcmFormat == ma_format_s16 ? SoundBank::kEncodingPcmS16 : SoundBank::kEncodingPcmF32;
+    out.entry.channels = decoderConfig.channels;
+    out.entry.sampleRate = decoderConfig.sampleRate;
+    return true;
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool WriteBank(const char* bankPath, std::vector<PackedSound>& sounds) {
+    std::string strings;
+    for (PackedSound& sound : sounds) {
+        sound.entry.idOffset = static_cast<uint32_t>(strings.size());
+        sound.entry.idLength = static_cast<uint32_t>(sound.id.size());
+        strings += sound.id;
+    }
+
+    SoundBank::Header header = {};
+    std::memcpy(header.magic, SoundBank::kMagic, sizeof(header.magic));
+    header.version = SoundBank::kVersion;
+    header.entryCount = static_cast<uint32_t>(sounds.size());
+    header.stringsOffset = sizeof(SoundBank::Header) + sounds.size() * sizeof(SoundBank::Entry);
+    header.stringsSize = strings.size();
+
+    // Data follows the strings in input order, each sound aligned for SIMD loads of its PCM.
+    uint64_t offset = header.stringsOffset + header.stringsSize;
+    for (PackedSound& sound : sounds) {
+        offset = AlignUp(offset, SoundBank::kDataAlignment);
+        sound.entry.offset = offset;
+        sound.entry.size = sound.data.size();
+        offset += sound.data.size();
+    }
+
+    std::ofstream bank(bankPath, std::ios::binary | std::ios::trunc);
+    if (!bank) {
+        std::fprintf(stderr, "error: can't create '%s'\n", bankPath);
+        return false;
+    }
+    bank.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const PackedSound& sound : sounds) {
+        bank.write(reinterpret_cast<const char*>(&sound.entry), sizeof(sound.entry));
+    }
+    bank.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    uint64_t written = header.stringsOffset + header.stringsSize;
+    static const char kPadding[SoundBank::kDataAlignment] = {};
+    for (const PackedSound& sound : sounds) {
+        bank.write(kPadding, static_cast<std::streamsize>(sound.entry.offset - written));
+        bank.write(reinterpret_cast<const char*>(sound.data.data()), static_cast<std::streamsize>(sound.data.size()));
+        written = sound.entry.offset + sound.entry.size;
+    }
+    if (!bank) {
+        std::fprintf(stderr, "error: failed writing '%s'\n", bankPath);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* bankPath = nullptr;
+    ma_uint32 pcmRate = 0;
+    ma_format pcmFormat = ma_format_f32;
+    std::vector<PackInput> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            bankPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--pcm") == 0 && i + 1 < argc) {
+            pcmRate = static_cast<ma_uint32>(std::strtoul(argv[++i], nullptr, 10));
+            if (pcmRate == 0) {
+                std::fprintf(stderr, "error: --pcm needs a sample rate in Hz\n");
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--s16") == 0) {
+            pcmFormat = ma_format_s16;
+        }
+        else if (std::strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+            if (!ReadList(argv[++i], inputs)) {
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-') {
+            PrintUsage();
+            return 1;
+        }
+        else {
+            inputs.push_back(ParseInput(argv[i]));
+        }
+    }
+    if (!bankPath || inputs.empty()) {
+        PrintUsage();
+        return 1;
+    }
+    if (pcmFormat == ma_format_s16 && pcmRate == 0) {
+        std::fprintf(stderr, "error: --s16 needs --pcm\n");
+        return 1;
+    }
+
+    std::set<std::string> ids;
+    for (const PackInput& input : inputs) {
+        if (input.id.empty() || !ids.insert(input.id).second) {
+            std::fprintf(stderr, "error: duplicate or empty sound ID '%s' (from '%s')\n", input.id.c_str(), input.path.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<PackedSound> sounds(inputs.size());
+    uint64_t totalBytes = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!PackSound(inputs[i], pcmRate, pcmFormat, sounds[i])) {
+            return 1;
+        }
+        totalBytes += sounds[i].data.size();
+    }
+    if (!WriteBank(bankPath, sounds)) {
+        return 1;
+    }
+    std::printf("Packed %zu sounds (%llu bytes of %s) into '%s'.\n", sounds.size(),
+                static_cast<unsigned long long>(totalBytes), pcmRate ? "PCM" : "file data", bankPath);
+    return 0;
+}